@@ -0,0 +1,153 @@
+/*
+  ==============================================================================
+
+    AnalysisBus.cpp
+
+    Implementation of the analysis taps.
+
+  ==============================================================================
+*/
+
+#include "AnalysisBus.h"
+
+#include <cstring>
+
+namespace mmg
+{
+
+//==============================================================================
+AnalysisTap::AnalysisTap(int capacityFrames)
+    : capacity(juce::nextPowerOfTwo(juce::jmax(64, capacityFrames))),
+      mask(capacity - 1)
+{
+    leftRing.allocate((size_t)capacity, true);
+    rightRing.allocate((size_t)capacity, true);
+}
+
+void AnalysisTap::write(const float* left, const float* right, int numFrames) noexcept
+{
+    if (numFrames <= 0)
+        return;
+
+    if (right == nullptr)
+        right = left;
+
+    auto position = writePosition.load(std::memory_order_relaxed);
+
+    // Only the newest ring's worth of an oversized block can be kept
+    if (numFrames > capacity)
+    {
+        const int skipped = numFrames - capacity;
+        left += skipped;
+        right += skipped;
+        position += skipped;
+        numFrames = capacity;
+    }
+
+    // Announce the frames about to be overwritten before touching them, so a
+    // reader that copied any of them sees the claim when it re-checks
+    writeClaim.store(position + numFrames, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    const int start = (int)(position & mask);
+    const int firstPart = juce::jmin(numFrames, capacity - start);
+    const int secondPart = numFrames - firstPart;
+
+    std::memcpy(leftRing.get() + start, left, sizeof(float) * (size_t)firstPart);
+    std::memcpy(rightRing.get() + start, right, sizeof(float) * (size_t)firstPart);
+
+    if (secondPart > 0)
+    {
+        std::memcpy(leftRing.get(), left + firstPart, sizeof(float) * (size_t)secondPart);
+        std::memcpy(rightRing.get(), right + firstPart, sizeof(float) * (size_t)secondPart);
+    }
+
+    writePosition.store(position + numFrames, std::memory_order_release);
+}
+
+//==============================================================================
+int AnalysisTap::copyOut(juce::int64 start, int numFrames, float* left, float* right) const noexcept
+{
+    const int ringStart = (int)(start & mask);
+    const int firstPart = juce::jmin(numFrames, capacity - ringStart);
+    const int secondPart = numFrames - firstPart;
+
+    std::memcpy(left, leftRing.get() + ringStart, sizeof(float) * (size_t)firstPart);
+    std::memcpy(right, rightRing.get() + ringStart, sizeof(float) * (size_t)firstPart);
+
+    if (secondPart > 0)
+    {
+        std::memcpy(left + firstPart, leftRing.get(), sizeof(float) * (size_t)secondPart);
+        std::memcpy(right + firstPart, rightRing.get(), sizeof(float) * (size_t)secondPart);
+    }
+
+    // Anything the producer has lapped or claimed since we started copying may be torn
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const auto oldestIntact = writeClaim.load(std::memory_order_relaxed) - capacity;
+
+    return (int)juce::jlimit((juce::int64)0, (juce::int64)numFrames, oldestIntact - start);
+}
+
+int AnalysisTap::read(Reader& reader, float* left, float* right, int maxFrames) const noexcept
+{
+    const auto written = getWritePosition();
+
+    if (reader.position < 0 || reader.position > written)
+        reader.position = written;
+
+    // Fell more than a ring behind: the oldest unread frames are gone
+    auto start = juce::jmax(reader.position, written - capacity);
+    const int numFrames = (int)juce::jmin((juce::int64)juce::jmax(0, maxFrames), written - start);
+
+    if (numFrames <= 0)
+        return 0;
+
+    const int lost = copyOut(start, numFrames, left, right);
+
+    if (lost > 0)
+    {
+        // Keep only the intact tail
+        std::memmove(left, left + lost, sizeof(float) * (size_t)(numFrames - lost));
+        std::memmove(right, right + lost, sizeof(float) * (size_t)(numFrames - lost));
+    }
+
+    reader.position = start + numFrames;
+    return numFrames - lost;
+}
+
+bool AnalysisTap::readLatest(float* left, float* right, int numFrames) const noexcept
+{
+    if (numFrames <= 0)
+        return true;
+
+    numFrames = juce::jmin(numFrames, capacity);
+
+    const auto written = getWritePosition();
+    const auto available = (int)juce::jmin((juce::int64)numFrames, written);
+    const int silent = numFrames - available;
+
+    if (silent > 0)
+    {
+        juce::FloatVectorOperations::clear(left, silent);
+        juce::FloatVectorOperations::clear(right, silent);
+    }
+
+    return available == 0
+        || copyOut(written - available, available, left + silent, right + silent) == 0;
+}
+
+//==============================================================================
+AnalysisBus::AnalysisBus()
+{
+    for (auto& tap : trackTaps)
+        tap = std::make_unique<AnalysisTap>(trackCapacity);
+}
+
+AnalysisTap* AnalysisBus::getTrackTap(int trackIndex) noexcept
+{
+    if (trackIndex >= 0 && trackIndex < maxTrackTaps)
+        return trackTaps[(size_t)trackIndex].get();
+    return nullptr;
+}
+
+} // namespace mmg
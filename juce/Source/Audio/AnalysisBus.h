@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    AnalysisBus.h
+
+    Taps that carry audio from the render threads to analyzers (waveform,
+    spectrum, meters). Each tap is one stereo ring written with bulk copies;
+    any number of readers on other threads follow it with their own cursors.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+namespace mmg
+{
+
+//==============================================================================
+/**
+    Single-producer ring of stereo audio for analysis.
+
+    The producer (whichever thread renders the tapped signal, one block at a
+    time) copies each block in with at most two memcpys per channel and then
+    publishes the new total. It never waits and its cost does not depend on
+    how many readers there are.
+
+    Readers never modify the tap. Each keeps a Reader cursor, or asks for the
+    latest frames. A reader that falls more than a ring behind skips ahead,
+    and frames the producer overwrote, or had started overwriting, while they
+    were being copied are discarded rather than returned torn.
+*/
+class AnalysisTap
+{
+public:
+    /** @param capacityFrames Ring size, rounded up to a power of two */
+    explicit AnalysisTap(int capacityFrames);
+
+    //==========================================================================
+    /** Append a block. Producer thread only; right may be null for mono. */
+    void write(const float* left, const float* right, int numFrames) noexcept;
+
+    //==========================================================================
+    /** Where a reader has got to, in frames since the tap was created. */
+    struct Reader
+    {
+        juce::int64 position = -1;      // -1: start from the newest frame on the first read
+    };
+
+    /** Frames written so far, in total. */
+    juce::int64 getWritePosition() const noexcept { return writePosition.load(std::memory_order_acquire); }
+
+    /** Copy up to maxFrames frames that arrived since the reader's last call and advance it.
+        @returns the number of frames copied into left and right */
+    int read(Reader& reader, float* left, float* right, int maxFrames) const noexcept;
+
+    /** Copy the newest numFrames frames, oldest first. Frames from before the tap
+        started are zero. @returns false if the copy was overrun and nothing is valid */
+    bool readLatest(float* left, float* right, int numFrames) const noexcept;
+
+    int getCapacity() const noexcept { return capacity; }
+
+private:
+    /** Copy frames [start, start + numFrames) out of the ring.
+        @returns how many leading frames were overwritten during the copy */
+    int copyOut(juce::int64 start, int numFrames, float* left, float* right) const noexcept;
+
+    const int capacity;
+    const int mask;
+    juce::HeapBlock<float> leftRing, rightRing;
+    std::atomic<juce::int64> writePosition { 0 };
+    std::atomic<juce::int64> writeClaim { 0 };      // End of the block being written, set before its copy starts
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisTap)
+};
+
+//==============================================================================
+/**
+    The engine's tap points: the master output and each track (by index)
+    after its instrument and volume, before the mixer's FX.
+
+    All taps exist for the engine's lifetime, so analyzers can hold on to
+    them while tracks come and go.
+*/
+class AnalysisBus
+{
+public:
+    AnalysisBus();
+
+    AnalysisTap& getMasterTap() noexcept { return masterTap; }
+
+    /** The tap for a track index, or null past maxTrackTaps. */
+    AnalysisTap* getTrackTap(int trackIndex) noexcept;
+
+    static constexpr int masterCapacity = 1 << 15;     // ~0.7s at 48kHz
+    static constexpr int trackCapacity = 1 << 13;
+    static constexpr int maxTrackTaps = 32;
+
+private:
+    AnalysisTap masterTap { masterCapacity };
+    std::array<std::unique_ptr<AnalysisTap>, maxTrackTaps> trackTaps;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisBus)
+};
+
+} // namespace mmg
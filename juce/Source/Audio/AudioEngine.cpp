@@ -10,6 +10,7 @@
 */
 
 #include "AudioEngine.h"
+#include "OfflineRenderer.h"
 
 #include <cmath>
 
@@ -183,6 +184,9 @@ struct DefaultSynthVoice : public juce::SynthesiserVoice
 AudioEngine::Track::Track(int id, const juce::String& name, juce::AudioFormatManager& formatMgr)
     : id(id), name(name), formatManager(formatMgr)
 {
+    sampler = std::make_unique<SamplerInstrument>();
+    sampler->setVoiceBudget(&voiceBudget);
+    
     // Setup simple sine synth as fallback
     simpleSynth.clearVoices();
     for (int i = 0; i < 8; ++i)
@@ -236,26 +240,39 @@ AudioEngine::Track::~Track() {}
 
 void AudioEngine::Track::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
+    const juce::ScopedLock sl(trackLock);
+    
+    {
+        const juce::ScopedLock ssl(settingsLock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = juce::jmax(1, samplesPerBlock);
+    }
+    
+    // Allocate render scratch and MIDI storage up front - never on the audio thread
+    renderBuffer.setSize(2, preparedBlockSize, false, true, false);
+    midiBuffer.ensureSize(4096);
+    
     simpleSynth.setCurrentPlaybackSampleRate(sampleRate);
-    sampler.prepareToPlay(sampleRate, samplesPerBlock);
+    sampler->prepareToPlay(sampleRate, samplesPerBlock);
     
     if (sf2Instrument)
-        sf2Instrument->setSampleRate(sampleRate);
+        sf2Instrument->prepareToPlay(sampleRate, preparedBlockSize);
     if (sfzInstrument)
         sfzInstrument->setSampleRate(sampleRate);
 }
 
 void AudioEngine::Track::releaseResources() 
 {
-    {
-        const juce::ScopedLock sl(trackLock);
-        // Ensure any sustaining voices are released immediately.
-        midiBuffer.clear();
-        simpleSynth.allNotesOff(0, true);
-        sampler.allNotesOff(0, true);
-    }
-
-    sampler.releaseResources();
+    const juce::ScopedLock sl(trackLock);
+    
+    // Ensure any sustaining voices are released immediately. Scheduled notes belong
+    // to the render side, so they are cleared by a command it applies.
+    midiBuffer.clear();
+    allNotesOff();
+    simpleSynth.allNotesOff(0, true);
+    sampler->allNotesOff(0, true);
+    sampler->releaseResources();
+    
     if (sf2Instrument)
         sf2Instrument->allNotesOff();
     if (sfzInstrument)
@@ -264,86 +281,293 @@ void AudioEngine::Track::releaseResources()
 
 void AudioEngine::Track::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples)
 {
-    if (muted.load())
+    // Never wait on the audio thread: if the message thread or a loader holds the
+    // lock right now, this track sits out one block (its note-offs are held over).
+    const juce::ScopedTryLock stl(trackLock);
+    
+    // Live input is picked up here, timed from the start of this block
+    // (left in the queue while a loader holds the lock)
+    if (stl.isLocked())
+        applyPendingCommands();
+    
+    if (muted.load() || !stl.isLocked() || renderBuffer.getNumSamples() == 0)
     {
-        // Zero out metering when muted
+        skipScheduledNotes(numSamples, stl.isLocked());
+        
+        // Zero out metering when muted or skipped
         rmsLevel.store(0.0f);
         peakLevel.store(0.0f);
         return;
     }
+    
+    const int numChannels = juce::jmin(outputBuffer.getNumChannels(), renderBuffer.getNumChannels());
+    const int chunkCapacity = renderBuffer.getNumSamples();
+    const float gain = volume.load();
+    
+    float sumSquares[2] = { 0.0f, 0.0f };
+    float peak = 0.0f;
+    int nextNote = 0;
+    
+    // Hosts may deliver blocks larger than announced; render those in prepared-size chunks
+    for (int done = 0; done < numSamples;)
+    {
+        const int chunkSize = juce::jmin(chunkCapacity, numSamples - done);
         
-    // Render synth to a temp buffer
-    juce::AudioBuffer<float> tempBuffer(outputBuffer.getNumChannels(), numSamples);
-    tempBuffer.clear();
+        // View over the preallocated scratch - no allocation
+        juce::AudioBuffer<float> chunk(renderBuffer.getArrayOfWritePointers(), numChannels, 0, chunkSize);
+        chunk.clear();
+        
+        // Render up to each scheduled note, start it, and carry on, so every note
+        // begins on its own sample whatever the block size
+        for (int pos = 0; pos < chunkSize;)
+        {
+            while (nextNote < numScheduledNotes && scheduledNotes[(size_t)nextNote].sampleOffset <= done + pos)
+                applyScheduledNote(scheduledNotes[(size_t)nextNote++], pos);
+            
+            int segmentEnd = chunkSize;
+            if (nextNote < numScheduledNotes)
+                segmentEnd = juce::jmin(chunkSize, scheduledNotes[(size_t)nextNote].sampleOffset - done);
+            
+            renderInstrument(chunk, pos, segmentEnd - pos);
+            pos = segmentEnd;
+        }
+        
+        // Everything queued for this chunk has been rendered
+        midiBuffer.clear();
+        
+        chunk.applyGain(gain);
+        
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const float chunkRms = chunk.getRMSLevel(ch, 0, chunkSize);
+            sumSquares[juce::jmin(ch, 1)] += chunkRms * chunkRms * (float)chunkSize;
+            peak = juce::jmax(peak, chunk.getMagnitude(ch, 0, chunkSize));
+            
+            outputBuffer.addFrom(ch, startSample + done, chunk, ch, 0, chunkSize);
+        }
+        
+        done += chunkSize;
+    }
     
+    // Compute RMS and peak for metering (average across channels)
+    float rms = 0.0f;
+    if (numChannels > 0 && numSamples > 0)
     {
-        const juce::ScopedLock sl(trackLock);
+        for (int ch = 0; ch < juce::jmin(numChannels, 2); ++ch)
+            rms += std::sqrt(sumSquares[ch] / (float)numSamples);
+        rms /= (float)juce::jmin(numChannels, 2);
+    }
+    
+    rmsLevel.store(rms);
+    peakLevel.store(peak);
+    
+    // Notes beyond this call belong to the next one (the mixer renders oversized host blocks in chunks)
+    for (int i = nextNote; i < numScheduledNotes; ++i)
+    {
+        scheduledNotes[(size_t)(i - nextNote)] = scheduledNotes[(size_t)i];
+        scheduledNotes[(size_t)(i - nextNote)].sampleOffset -= numSamples;
+    }
+    numScheduledNotes -= nextNote;
+}
+
+void AudioEngine::Track::renderInstrument(juce::AudioBuffer<float>& chunk, int startSample, int numSamples)
+{
+    switch (activeInstrumentType)
+    {
+        case InstrumentType::SF2:
+            if (sf2Instrument && sf2Instrument->isLoaded())
+                sf2Instrument->renderNextBlock(chunk, startSample, numSamples);
+            break;
+            
+        case InstrumentType::SFZ:
+            if (sfzInstrument && sfzInstrument->isLoaded())
+                sfzInstrument->renderNextBlock(chunk, startSample, numSamples);
+            break;
+            
+        case InstrumentType::ExpansionSampler:
+            if (sampler->isLoaded())
+                sampler->renderNextBlock(chunk, midiBuffer, startSample, numSamples);
+            break;
+            
+        case InstrumentType::SimpleSynth:
+        case InstrumentType::None:
+        default:
+            simpleSynth.renderNextBlock(chunk, midiBuffer, startSample, numSamples);
+            break;
+    }
+}
+
+void AudioEngine::Track::skipBlock(int numSamples)
+{
+    const juce::ScopedTryLock stl(trackLock);
+    
+    if (stl.isLocked())
+        applyPendingCommands();
+    
+    skipScheduledNotes(numSamples, stl.isLocked());
+    
+    rmsLevel.store(0.0f);
+    peakLevel.store(0.0f);
+}
+
+void AudioEngine::Track::skipScheduledNotes(int numSamples, bool canApply)
+{
+    // Nothing is rendered, so due notes must not reach midiBuffer (it would only
+    // grow and then fire all at once once the track plays again): note-offs release
+    // their voices directly and note-ons are dropped. Without the lock the instrument
+    // cannot be touched, so due note-offs wait at the front for the next block.
+    int kept = 0;
+    int due = 0;
+    while (due < numScheduledNotes && scheduledNotes[(size_t)due].sampleOffset < numSamples)
+    {
+        const auto scheduled = scheduledNotes[(size_t)due++];
         
-        switch (activeInstrumentType)
+        if (canApply)
+            skipScheduledNote(scheduled);
+        else if (scheduled.velocity <= 0.0f)
+            scheduledNotes[(size_t)kept++] = { 0, scheduled.note, 0.0f };
+    }
+    
+    for (int i = due; i < numScheduledNotes; ++i)
+    {
+        scheduledNotes[(size_t)kept] = scheduledNotes[(size_t)i];
+        scheduledNotes[(size_t)kept++].sampleOffset -= numSamples;
+    }
+    numScheduledNotes = kept;
+}
+
+void AudioEngine::Track::noteOn(int note, float velocity, int sampleOffset)
+{
+    if (!commandQueue.push({ { TrackCommand::Type::NoteOn, note, velocity, sampleOffset } }))
+        DBG("Track " << id << ": Command queue full, note-on dropped");
+}
+
+void AudioEngine::Track::noteOff(int note, int sampleOffset)
+{
+    if (!commandQueue.push({ { TrackCommand::Type::NoteOff, note, 0.0f, sampleOffset } }))
+        DBG("Track " << id << ": Command queue full, note-off dropped");
+}
+
+void AudioEngine::Track::auditionNote(int note, float velocity, int durationSamples)
+{
+    if (!commandQueue.push({ { TrackCommand::Type::NoteOn, note, velocity, 0 },
+                             { TrackCommand::Type::NoteOff, note, 0.0f, juce::jmax(1, durationSamples) } }))
+        DBG("Track " << id << ": Command queue full, audition dropped");
+}
+
+void AudioEngine::Track::allNotesOff()
+{
+    if (!commandQueue.push({ { TrackCommand::Type::AllNotesOff } }))
+        DBG("Track " << id << ": Command queue full, all-notes-off dropped");
+}
+
+void AudioEngine::Track::applyPendingCommands()
+{
+    commandQueue.drain([this](const TrackCommand& command)
+    {
+        switch (command.type)
         {
-            case InstrumentType::SF2:
-                if (sf2Instrument && sf2Instrument->isLoaded())
-                {
-                    sf2Instrument->renderNextBlock(tempBuffer, 0, numSamples);
-                }
+            case TrackCommand::Type::NoteOn:
+                scheduleNote(command.note, juce::jmax(command.velocity, 1.0f / 127.0f), command.sampleOffset);
                 break;
                 
-            case InstrumentType::SFZ:
-                if (sfzInstrument && sfzInstrument->isLoaded())
-                {
-                    sfzInstrument->renderNextBlock(tempBuffer, 0, numSamples);
-                }
-                break;
-                
-            case InstrumentType::ExpansionSampler:
-                if (sampler.isLoaded())
-                {
-                    sampler.renderNextBlock(tempBuffer, midiBuffer, 0, numSamples);
-                }
+            case TrackCommand::Type::NoteOff:
+                scheduleNote(command.note, 0.0f, command.sampleOffset);
                 break;
                 
-            case InstrumentType::SimpleSynth:
-            case InstrumentType::None:
-            default:
-                simpleSynth.renderNextBlock(tempBuffer, midiBuffer, 0, numSamples);
+            case TrackCommand::Type::AllNotesOff:
+                // Pending notes (including audition note-offs) go too
+                numScheduledNotes = 0;
+                midiBuffer.clear();
+                simpleSynth.allNotesOff(0, true);
+                sampler->allNotesOff(0, true);
+                if (sf2Instrument)
+                    sf2Instrument->allNotesOff();
+                if (sfzInstrument)
+                    sfzInstrument->allNotesOff();
                 break;
         }
-        midiBuffer.clear();
+    });
+}
+
+void AudioEngine::Track::noteOnFromAudioThread(int note, float velocity, int sampleOffset)
+{
+    // scheduledNotes belongs to the render side (the audio thread, or the worker it hands
+    // the track to within the same callback), so queueing needs no lock and never fails
+    // because the message thread holds trackLock
+    scheduleNote(note, juce::jmax(velocity, 1.0f / 127.0f), sampleOffset);
+}
+
+void AudioEngine::Track::noteOffFromAudioThread(int note, int sampleOffset)
+{
+    scheduleNote(note, 0.0f, sampleOffset);
+}
+
+void AudioEngine::Track::scheduleNote(int note, float velocity, int sampleOffset)
+{
+    // The last slots are kept for note-offs, so a flood of note-ons cannot strand one
+    if (velocity > 0.0f && numScheduledNotes >= maxScheduledNotes - noteOffReserve)
+        return;
+    
+    // Full of note-offs: release this one straight away if the instrument is free
+    if (numScheduledNotes == maxScheduledNotes)
+    {
+        const juce::ScopedTryLock stl(trackLock);
+        if (stl.isLocked())
+            skipScheduledNote({ 0, note, velocity });
+        return;
     }
     
-    // Apply volume
-    tempBuffer.applyGain(volume.load());
+    sampleOffset = juce::jmax(0, sampleOffset);
     
-    // Compute RMS and peak for metering (average across channels)
+    // Events mostly arrive in order, so this rarely moves anything
+    int index = numScheduledNotes++;
+    while (index > 0 && scheduledNotes[(size_t)(index - 1)].sampleOffset > sampleOffset)
     {
-        float rms = 0.0f;
-        float peak = 0.0f;
-        int numChannels = tempBuffer.getNumChannels();
-        
-        for (int ch = 0; ch < numChannels; ++ch)
-        {
-            rms += tempBuffer.getRMSLevel(ch, 0, numSamples);
-            peak = juce::jmax(peak, tempBuffer.getMagnitude(ch, 0, numSamples));
-        }
-        
-        if (numChannels > 0)
-            rms /= (float)numChannels;
-        
-        rmsLevel.store(rms);
-        peakLevel.store(peak);
+        scheduledNotes[(size_t)index] = scheduledNotes[(size_t)(index - 1)];
+        --index;
     }
     
-    // Mix into output
-    for (int ch = 0; ch < outputBuffer.getNumChannels(); ++ch)
+    scheduledNotes[(size_t)index] = { sampleOffset, note, velocity };
+}
+
+void AudioEngine::Track::applyScheduledNote(const ScheduledNote& scheduled, int chunkOffset)
+{
+    if (scheduled.velocity > 0.0f)
+        applyNoteOn(scheduled.note, scheduled.velocity, chunkOffset);
+    else
+        applyNoteOff(scheduled.note, chunkOffset);
+}
+
+void AudioEngine::Track::skipScheduledNote(const ScheduledNote& scheduled)
+{
+    if (scheduled.velocity > 0.0f)
+        return;
+    
+    switch (activeInstrumentType)
     {
-        outputBuffer.addFrom(ch, startSample, tempBuffer, ch, 0, numSamples);
+        case InstrumentType::SF2:
+            if (sf2Instrument)
+                sf2Instrument->noteOff(scheduled.note);
+            break;
+            
+        case InstrumentType::SFZ:
+            if (sfzInstrument)
+                sfzInstrument->noteOff(scheduled.note);
+            break;
+            
+        case InstrumentType::ExpansionSampler:
+            sampler->noteOff(1, scheduled.note, 0.0f, true);
+            break;
+            
+        default:
+            simpleSynth.noteOff(1, scheduled.note, 0.0f, true);
+            break;
     }
 }
 
-void AudioEngine::Track::noteOn(int note, float velocity)
+void AudioEngine::Track::applyNoteOn(int note, float velocity, int sampleOffset)
 {
-    const juce::ScopedLock sl(trackLock);
-    
     switch (activeInstrumentType)
     {
         case InstrumentType::SF2:
@@ -357,15 +581,13 @@ void AudioEngine::Track::noteOn(int note, float velocity)
             break;
             
         default:
-            midiBuffer.addEvent(juce::MidiMessage::noteOn(1, note, velocity), 0);
+            midiBuffer.addEvent(juce::MidiMessage::noteOn(1, note, velocity), sampleOffset);
             break;
     }
 }
 
-void AudioEngine::Track::noteOff(int note)
+void AudioEngine::Track::applyNoteOff(int note, int sampleOffset)
 {
-    const juce::ScopedLock sl(trackLock);
-    
     switch (activeInstrumentType)
     {
         case InstrumentType::SF2:
@@ -379,14 +601,17 @@ void AudioEngine::Track::noteOff(int note)
             break;
             
         default:
-            midiBuffer.addEvent(juce::MidiMessage::noteOff(1, note), 0);
+            midiBuffer.addEvent(juce::MidiMessage::noteOff(1, note), sampleOffset);
             break;
     }
 }
 
 void AudioEngine::Track::handleProgramChange(int programNumber, int bankNumber)
 {
-    const juce::ScopedLock sl(trackLock);
+    // Delivered from MidiPlayer on the audio thread, so never block here
+    const juce::ScopedTryLock stl(trackLock);
+    if (!stl.isLocked())
+        return;
 
     if (activeInstrumentType != InstrumentType::SF2 || sf2Instrument == nullptr || !sf2Instrument->isLoaded())
         return;
@@ -425,98 +650,231 @@ bool AudioEngine::Track::loadInstrumentById(const juce::String& instrumentId,
         return false;
     }
     
-    const juce::ScopedLock sl(trackLock);
+    // Decode samples without holding trackLock; the old instrument keeps playing meanwhile
+    const auto settings = getPreparedSettings();
+    auto newSampler = std::make_unique<SamplerInstrument>();
+    newSampler->setNonRealtime(settings.nonRealtime);
+    newSampler->setVoiceBudget(&voiceBudget);
+    if (settings.sampleRate > 0.0)
+        newSampler->prepareToPlay(settings.sampleRate, settings.blockSize);
     
-    if (sampler.loadFromDefinition(*instrument, fmtManager))
+    if (!newSampler->loadFromDefinition(*instrument, fmtManager))
     {
+        DBG("Track " << id << ": Failed to load " << instrumentId);
+        return false;
+    }
+    
+    {
+        const juce::ScopedLock sl(trackLock);
+        
+        // A prepareToPlay or setNonRealtime during the load only reached the old sampler
+        if (nonRealtime != settings.nonRealtime)
+            newSampler->setNonRealtime(nonRealtime);
+        if (preparedSampleRate > 0.0 && (preparedSampleRate != settings.sampleRate || preparedBlockSize != settings.blockSize))
+            newSampler->prepareToPlay(preparedSampleRate, preparedBlockSize);
+        
+        std::swap(sampler, newSampler);
+        setInstrumentSource({ InstrumentType::ExpansionSampler, {}, 0, instrumentId });
         currentInstrumentId = instrumentId;
         currentInstrumentName = instrument->name;
         useSimpleSynth = false;
         activeInstrumentType = InstrumentType::ExpansionSampler;
-        
-        DBG("Track " << id << ": Loaded " << instrument->name);
-        return true;
     }
     
-    DBG("Track " << id << ": Failed to load " << instrumentId);
-    return false;
+    // Previous sampler is released here, outside the lock
+    DBG("Track " << id << ": Loaded " << instrument->name);
+    return true;
 }
 
 bool AudioEngine::Track::loadSF2(const juce::File& sf2File, int preset)
 {
-    const juce::ScopedLock sl(trackLock);
+    // Load the soundfont without holding trackLock, then swap it in
+    const auto settings = getPreparedSettings();
+    auto newInstrument = std::make_unique<SF2Instrument>();
+    if (settings.sampleRate > 0.0)
+        newInstrument->prepareToPlay(settings.sampleRate, settings.blockSize);
+    
+    if (!newInstrument->load(sf2File))
+    {
+        DBG("Track " << id << ": Failed to load SF2 " << sf2File.getFileName());
+        return false;
+    }
     
-    if (!sf2Instrument)
-        sf2Instrument = std::make_unique<SF2Instrument>();
+    // Set the preset if specified
+    if (preset >= 0 && preset < newInstrument->getNumPresets())
+        newInstrument->setActivePreset(preset);
     
-    if (sf2Instrument->load(sf2File))
+    juce::String newName = sf2File.getFileNameWithoutExtension();
+    if (newInstrument->getNumPresets() > preset)
     {
-        // Set the preset if specified
-        if (preset >= 0 && preset < sf2Instrument->getNumPresets())
-            sf2Instrument->setActivePreset(preset);
-        
-        currentInstrumentId = "sf2:" + sf2File.getFileNameWithoutExtension();
-        currentInstrumentName = sf2File.getFileNameWithoutExtension();
+        auto presetInfo = newInstrument->getPresetInfo(preset);
+        if (presetInfo.name.isNotEmpty())
+            newName = presetInfo.name;
+    }
+    
+    {
+        const juce::ScopedLock sl(trackLock);
         
-        if (sf2Instrument->getNumPresets() > preset)
-        {
-            auto presetInfo = sf2Instrument->getPresetInfo(preset);
-            if (presetInfo.name.isNotEmpty())
-                currentInstrumentName = presetInfo.name;
-        }
+        // A prepareToPlay during the load only reached the old soundfont
+        if (preparedSampleRate > 0.0 && (preparedSampleRate != settings.sampleRate || preparedBlockSize != settings.blockSize))
+            newInstrument->prepareToPlay(preparedSampleRate, preparedBlockSize);
         
+        std::swap(sf2Instrument, newInstrument);
+        setInstrumentSource({ InstrumentType::SF2, sf2File, preset, {} });
+        currentInstrumentId = "sf2:" + sf2File.getFileNameWithoutExtension();
+        currentInstrumentName = newName;
         activeInstrumentType = InstrumentType::SF2;
         useSimpleSynth = false;
-        
-        DBG("Track " << id << ": Loaded SF2 " << sf2File.getFileName() << " preset " << preset);
-        return true;
     }
     
-    DBG("Track " << id << ": Failed to load SF2 " << sf2File.getFileName());
-    return false;
+    DBG("Track " << id << ": Loaded SF2 " << sf2File.getFileName() << " preset " << preset);
+    return true;
 }
 
 bool AudioEngine::Track::loadSFZ(const juce::File& sfzFile)
 {
-    const juce::ScopedLock sl(trackLock);
+    // Parse and decode without holding trackLock, then swap it in
+    const auto settings = getPreparedSettings();
+    auto newInstrument = std::make_unique<SFZInstrument>();
+    newInstrument->setNonRealtime(settings.nonRealtime);
+    newInstrument->setVoiceBudget(&voiceBudget);
+    if (settings.sampleRate > 0.0)
+        newInstrument->setSampleRate(settings.sampleRate);
+    
+    if (!newInstrument->loadFromFile(sfzFile))
+    {
+        DBG("Track " << id << ": Failed to load SFZ " << sfzFile.getFileName() << 
+            ": " << newInstrument->getLastError());
+        return false;
+    }
     
-    if (!sfzInstrument)
-        sfzInstrument = std::make_unique<SFZInstrument>();
+    const int numRegions = newInstrument->getNumRegions();
     
-    if (sfzInstrument->loadFromFile(sfzFile))
     {
+        const juce::ScopedLock sl(trackLock);
+        
+        // A prepareToPlay or setNonRealtime during the load only reached the old instrument
+        if (nonRealtime != settings.nonRealtime)
+            newInstrument->setNonRealtime(nonRealtime);
+        if (preparedSampleRate > 0.0 && preparedSampleRate != settings.sampleRate)
+            newInstrument->setSampleRate(preparedSampleRate);
+        
+        std::swap(sfzInstrument, newInstrument);
+        setInstrumentSource({ InstrumentType::SFZ, sfzFile, 0, {} });
         currentInstrumentId = "sfz:" + sfzFile.getFileNameWithoutExtension();
         currentInstrumentName = sfzFile.getFileNameWithoutExtension();
         activeInstrumentType = InstrumentType::SFZ;
         useSimpleSynth = false;
-        
-        DBG("Track " << id << ": Loaded SFZ " << sfzFile.getFileName() << 
-            " with " << sfzInstrument->getNumRegions() << " regions");
-        return true;
     }
     
-    DBG("Track " << id << ": Failed to load SFZ " << sfzFile.getFileName() << 
-        ": " << sfzInstrument->getLastError());
-    return false;
+    DBG("Track " << id << ": Loaded SFZ " << sfzFile.getFileName() << 
+        " with " << numRegions << " regions");
+    return true;
 }
 
-void AudioEngine::Track::loadSample(const juce::File& file, juce::AudioFormatManager& fmtManager)
+AudioEngine::Track::PreparedSettings AudioEngine::Track::getPreparedSettings() const
+{
+    const juce::ScopedLock sl(settingsLock);
+    return { preparedSampleRate, preparedBlockSize, nonRealtime };
+}
+
+void AudioEngine::Track::setInstrumentSource(const InstrumentSource& source)
+{
+    const juce::ScopedLock sl(settingsLock);
+    instrumentSource = source;
+}
+
+void AudioEngine::Track::setNonRealtime(bool isNonRealtime)
 {
     const juce::ScopedLock sl(trackLock);
     
+    {
+        const juce::ScopedLock ssl(settingsLock);
+        nonRealtime = isNonRealtime;
+    }
+    
+    sampler->setNonRealtime(isNonRealtime);
+    if (sfzInstrument)
+        sfzInstrument->setNonRealtime(isNonRealtime);
+}
+
+void AudioEngine::Track::setPolyphonyBudget(PolyphonyBudget* budget)
+{
+    const juce::ScopedLock sl(trackLock);
+    
+    // Voices must not straddle two budgets
+    sampler->allNotesOff(0, false);
+    if (sfzInstrument)
+        sfzInstrument->allNotesOff();
+    
+    voiceBudget.setBudget(budget);
+}
+
+bool AudioEngine::Track::copyInstrumentFrom(const Track& source, const ExpansionInstrumentLoader& loader)
+{
+    InstrumentSource recipe;
+    {
+        const juce::ScopedLock sl(source.settingsLock);
+        recipe = source.instrumentSource;
+    }
+    
+    setVolume(source.getVolume());
+    setMute(source.isMuted());
+    setSolo(source.isSoloed());
+    
+    defaultSynth.waveform.store(source.defaultSynth.waveform.load());
+    defaultSynth.attackSeconds.store(source.defaultSynth.attackSeconds.load());
+    defaultSynth.decaySeconds.store(source.defaultSynth.decaySeconds.load());
+    defaultSynth.sustainLevel.store(source.defaultSynth.sustainLevel.load());
+    defaultSynth.releaseSeconds.store(source.defaultSynth.releaseSeconds.load());
+    defaultSynth.cutoffHz.store(source.defaultSynth.cutoffHz.load());
+    defaultSynth.cutoffVelocityDeltaHz.store(source.defaultSynth.cutoffVelocityDeltaHz.load());
+    defaultSynth.lfoRateHz.store(source.defaultSynth.lfoRateHz.load());
+    defaultSynth.lfoDepth.store(source.defaultSynth.lfoDepth.load());
+    
+    switch (recipe.type)
+    {
+        case InstrumentType::SF2:
+            return loadSF2(recipe.file, recipe.preset);
+            
+        case InstrumentType::SFZ:
+            return loadSFZ(recipe.file);
+            
+        case InstrumentType::ExpansionSampler:
+            return loadInstrumentById(recipe.instrumentId, loader, formatManager);
+            
+        case InstrumentType::SimpleSynth:
+        case InstrumentType::None:
+        default:
+            if (recipe.file.existsAsFile())
+                loadSample(recipe.file, formatManager);
+            return true;
+    }
+}
+
+void AudioEngine::Track::loadSample(const juce::File& file, juce::AudioFormatManager& fmtManager)
+{
     std::unique_ptr<juce::AudioFormatReader> reader(fmtManager.createReaderFor(file));
-    if (reader)
+    if (reader == nullptr)
+    {
+        DBG("Track " << id << ": Failed to load sample " << file.getFileName());
+        return;
+    }
+    
+    // Map to all notes
+    juce::BigInteger allNotes;
+    allNotes.setRange(0, 128, true);
+    
+    // Create SamplerSound (reads the sample data) before taking the lock
+    // Base note 60 (C3), Attack 0.0s, Release 0.1s, Max length 10.0s
+    juce::SynthesiserSound::Ptr sound(new juce::SamplerSound("Sample", *reader, allNotes, 60, 0.0, 0.1, 10.0));
+    
     {
+        const juce::ScopedLock sl(trackLock);
+        
         simpleSynth.clearSounds();
         simpleSynth.clearVoices();
-        
-        // Map to all notes
-        juce::BigInteger allNotes;
-        allNotes.setRange(0, 128, true);
-        
-        // Create SamplerSound
-        // Base note 60 (C3), Attack 0.0s, Release 0.1s, Max length 10.0s
-        simpleSynth.addSound(new juce::SamplerSound("Sample", *reader, allNotes, 60, 0.0, 0.1, 10.0));
+        simpleSynth.addSound(sound);
         
         // Add SamplerVoices
         for (int i = 0; i < 8; ++i)
@@ -524,15 +882,12 @@ void AudioEngine::Track::loadSample(const juce::File& file, juce::AudioFormatMan
         
         useSimpleSynth = true;
         activeInstrumentType = InstrumentType::SimpleSynth;
+        setInstrumentSource({ InstrumentType::SimpleSynth, file, 0, {} });
         currentInstrumentId.clear();
         currentInstrumentName = file.getFileNameWithoutExtension();
-            
-        DBG("Track " << id << ": Loaded sample " << file.getFileName());
-    }
-    else
-    {
-        DBG("Track " << id << ": Failed to load sample " << file.getFileName());
     }
+    
+    DBG("Track " << id << ": Loaded sample " << file.getFileName());
 }
 
 //==============================================================================
@@ -551,10 +906,6 @@ AudioEngine::AudioEngine()
     // internal synth muted to avoid masking/doubling.
     midiPlayer.setRenderInternalSynth(false);
     
-    // Initialize visualization listeners to nullptr
-    for (auto& listener : visualizationListeners)
-        listener.store(nullptr);
-        
     // Initialize Tracks
     for (int i = 0; i < 4; ++i)
     {
@@ -587,6 +938,9 @@ juce::String AudioEngine::initialise()
         return result;
     }
     
+    // Workers must be running before the first callback can dispatch to them
+    workerPool.start();
+    
     // Connect audio source player to device manager
     deviceManager.addAudioCallback(&sourcePlayer);
     sourcePlayer.setSource(this);
@@ -617,6 +971,7 @@ void AudioEngine::shutdown()
     sourcePlayer.setSource(nullptr);
     deviceManager.removeAudioCallback(&sourcePlayer);
     deviceManager.closeAudioDevice();
+    workerPool.stop();
     
     initialised = false;
     DBG("AudioEngine: Shutdown complete");
@@ -685,13 +1040,14 @@ void AudioEngine::stop()
         midiPlayer.setPlaying(false);
         midiPlayer.setPosition(0.0);
         
-        // Send all notes off to stop any sustaining sounds
+        // Send all notes off to stop any sustaining sounds (queued, so the
+        // message thread never waits on a track the audio thread is rendering)
         {
             const juce::ScopedLock sl(tracksLock);
             for (auto& track : tracks)
             {
                 if (track)
-                    track->releaseResources();
+                    track->allNotesOff();
             }
         }
         
@@ -825,46 +1181,25 @@ void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferTo
         }
     }
 
+    // Pin the current track snapshot for this callback (lock-free; see publishTrackList)
+    renderTrackList = acquireTrackList();
+    renderBlockTime = -1.0;
+
     // MIDI playback (renders to buffer) - fallback only when no audio file is loaded
     if (!shouldRenderAudioFile && isTransportPlaying && midiPlayer.hasMidiLoaded() && !testToneEnabled.load())
     {
-        // Render MIDI directly to the output buffer's active region
-        auto* leftChannel = bufferToFill.buffer->getWritePointer(0, bufferToFill.startSample);
-        auto* rightChannel = bufferToFill.buffer->getNumChannels() > 1
-                           ? bufferToFill.buffer->getWritePointer(1, bufferToFill.startSample)
-                           : nullptr;
+        // FX automation follows the song position the tracks render from
+        renderBlockTime = midiPlayer.getPosition();
         
-        // Create temporary buffer for MIDI rendering
-        juce::AudioBuffer<float> midiBuffer(bufferToFill.buffer->getNumChannels(), bufferToFill.numSamples);
-        midiBuffer.clear();
+        // Render MIDI straight into the (already cleared) active region through a
+        // non-owning view, so no temporary buffer is allocated per callback
+        juce::AudioBuffer<float> outputRegion(bufferToFill.buffer->getArrayOfWritePointers(),
+                                              bufferToFill.buffer->getNumChannels(),
+                                              bufferToFill.startSample,
+                                              bufferToFill.numSamples);
         
         midiPlayer.setPlaying(true);
-        midiPlayer.renderNextBlock(midiBuffer, bufferToFill.numSamples);
-        
-        // Copy MIDI output to the main buffer
-        for (int ch = 0; ch < midiBuffer.getNumChannels(); ++ch)
-        {
-            auto* src = midiBuffer.getReadPointer(ch);
-            auto* dst = bufferToFill.buffer->getWritePointer(ch, bufferToFill.startSample);
-            for (int i = 0; i < bufferToFill.numSamples; ++i)
-            {
-                dst[i] = src[i];
-            }
-        }
-        
-        // Debug: track max sample in MIDI output
-        static int midiDebugCounter = 0;
-        if (++midiDebugCounter % 500 == 0)
-        {
-            float maxSample = 0.0f;
-            for (int ch = 0; ch < midiBuffer.getNumChannels(); ++ch)
-            {
-                auto* data = midiBuffer.getReadPointer(ch);
-                for (int i = 0; i < bufferToFill.numSamples; ++i)
-                    maxSample = juce::jmax(maxSample, std::abs(data[i]));
-            }
-            DBG("AudioEngine: MIDI rendered, maxSample=" << maxSample);
-        }
+        midiPlayer.renderNextBlock(outputRegion, bufferToFill.numSamples);
         
         // Check if playback finished
         if (!midiPlayer.isPlaying())
@@ -912,24 +1247,10 @@ void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferTo
         }
     }
     
-    // Process Tracks. Skip while the mastered audio file is playing to avoid doubling MIDI-rendered tracks.
-    if (!shouldRenderAudioFile)
-    {
-        const juce::ScopedLock sl(tracksLock);
-        
-        // Check for solo
-        bool anySolo = false;
-        for (auto& track : tracks)
-            if (track->isSoloed()) { anySolo = true; break; }
-            
-        for (auto& track : tracks)
-        {
-            if (anySolo && !track->isSoloed())
-                continue;
-                
-            track->renderNextBlock(*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
-        }
-    }
+    // Process Tracks through the mixer. Skip while the mastered audio file is playing to
+    // avoid doubling MIDI-rendered tracks (and mastering it twice).
+    if (!shouldRenderAudioFile && renderTrackList != nullptr)
+        renderTracksThroughMixer(bufferToFill);
     
     // Test tone generation (for verification) - only if no MIDI or test tone enabled
     if (testToneEnabled.load() && currentSampleRate > 0)
@@ -977,23 +1298,145 @@ void AudioEngine::getNextAudioBlock(const juce::AudioSourceChannelInfo& bufferTo
         masterPeakLevel.store(peak);
     }
     
-    // Send audio samples to visualization listeners (lock-free)
+    // Publish the master output to analyzers (a bulk copy; they read it on their own timers)
     {
         auto* leftChannel = bufferToFill.buffer->getReadPointer(0, bufferToFill.startSample);
         auto* rightChannel = bufferToFill.buffer->getNumChannels() > 1
                            ? bufferToFill.buffer->getReadPointer(1, bufferToFill.startSample)
                            : leftChannel;
         
-        for (auto& listenerPtr : visualizationListeners)
+        analysisBus.getMasterTap().write(leftChannel, rightChannel, bufferToFill.numSamples);
+    }
+    
+    // Let go of the snapshot so the message thread may retire it
+    renderTrackList = nullptr;
+    trackListInUse.store(nullptr);
+}
+
+void AudioEngine::renderTracksThroughMixer(const juce::AudioSourceChannelInfo& bufferToFill)
+{
+    const auto& renderTracks = renderTrackList->tracks;
+    
+    // Check for solo
+    bool anySolo = false;
+    for (auto* track : renderTracks)
+        if (track != nullptr && track->isSoloed()) { anySolo = true; break; }
+    
+    juce::AudioBuffer<float> outputRegion(bufferToFill.buffer->getArrayOfWritePointers(),
+                                          bufferToFill.buffer->getNumChannels(),
+                                          bufferToFill.startSample,
+                                          bufferToFill.numSamples);
+    
+    // Track strips hold at most one prepared block, so oversized host blocks are mixed in chunks
+    const int maxChunk = mixerGraph.getMaximumBlockSize() > 0 ? mixerGraph.getMaximumBlockSize()
+                                                              : bufferToFill.numSamples;
+    
+    for (int done = 0; done < bufferToFill.numSamples;)
+    {
+        const int chunkSize = juce::jmin(maxChunk, bufferToFill.numSamples - done);
+        
+        mixerGraph.beginBlock(chunkSize, renderBlockTime >= 0.0 ? renderBlockTime + done / currentSampleRate : -1.0);
+        
+        auto& jobs = renderTrackList->renderJobs;
+        jobs.clear();
+        
+        // A track being removed leaves an empty slot (see removeTrack). Until the mixer
+        // drops its strip the slot keeps its strip index; once it has, the slot takes none
+        const bool stripRemoved = mixerGraph.getNumTrackInputs() < (int)renderTracks.size();
+        int stripIndex = -1;
+        
+        for (auto* track : renderTracks)
         {
-            if (auto* listener = listenerPtr.load())
+            if (track == nullptr && stripRemoved)
+                continue;
+            
+            ++stripIndex;
+            
+            if (track == nullptr)
+                continue;
+            
+            // Soloed-out tracks still consume their events, so nothing piles up for when they return
+            if (anySolo && !track->isSoloed())
             {
-                listener->audioSamplesReady(leftChannel, rightChannel, bufferToFill.numSamples);
+                track->skipBlock(chunkSize);
+                continue;
             }
+            
+            // Tracks without a strip (mixer not prepared yet) play dry, in order, on this thread
+            if (auto* stripInput = mixerGraph.getTrackInput(stripIndex))
+                jobs.push_back({ track, stripInput, analysisBus.getTrackTap(stripIndex) });
+            else
+                track->renderNextBlock(outputRegion, done, chunkSize);
         }
+        
+        // Each job writes only its own strip and the mixer sums strips in track order,
+        // so the result does not depend on which thread rendered which track
+        renderJobSamples = chunkSize;
+        workerPool.run((int)jobs.size(), &AudioEngine::renderTrackJob, this);
+        
+        // Whatever is already in the region (MidiPlayer's internal synth) joins the master bus
+        juce::AudioBuffer<float> chunk(outputRegion.getArrayOfWritePointers(), outputRegion.getNumChannels(), done, chunkSize);
+        mixerGraph.processBlock(chunk, mixerMidi);
+        
+        done += chunkSize;
     }
 }
 
+void AudioEngine::renderTrackJob(void* context, int jobIndex)
+{
+    auto& engine = *static_cast<AudioEngine*>(context);
+    const auto& job = engine.renderTrackList->renderJobs[(size_t)jobIndex];
+    job.track->renderNextBlock(*job.destination, 0, engine.renderJobSamples);
+    
+    // Written by whichever thread rendered the track; the pool orders successive blocks
+    if (job.tap != nullptr && job.destination->getNumChannels() > 0)
+    {
+        auto* left = job.destination->getReadPointer(0);
+        auto* right = job.destination->getNumChannels() > 1 ? job.destination->getReadPointer(1) : left;
+        job.tap->write(left, right, engine.renderJobSamples);
+    }
+}
+
+const AudioEngine::TrackList* AudioEngine::acquireTrackList() noexcept
+{
+    // Announce the snapshot we are about to use, then confirm it is still current.
+    // A writer that swapped in between will see trackListInUse and wait for us,
+    // or we see its new snapshot on the re-check and retry.
+    for (;;)
+    {
+        auto* list = liveTrackList.load();
+        trackListInUse.store(list);
+        
+        if (liveTrackList.load() == list)
+            return list;
+    }
+}
+
+void AudioEngine::publishTrackList()
+{
+    auto newList = std::make_unique<TrackList>();
+    newList->tracks.reserve(tracks.size());
+    for (auto& track : tracks)
+        newList->tracks.push_back(track.get());
+    newList->renderJobs.reserve(tracks.size());
+    
+    auto* previous = publishedTrackList.get();
+    liveTrackList.store(newList.get());
+    
+    // Wait for an in-flight callback to finish with the old snapshot (at most one block)
+    while (previous != nullptr && trackListInUse.load() == previous)
+        juce::Thread::sleep(1);
+    
+    publishedTrackList = std::move(newList);
+}
+
+AudioEngine::Track* AudioEngine::getTrackForAudioThread(int index) const noexcept
+{
+    if (renderTrackList != nullptr && index >= 0 && index < (int)renderTrackList->tracks.size())
+        return renderTrackList->tracks[(size_t)index];
+    return nullptr;
+}
+
 //==============================================================================
 // ChangeListener Implementation
 //==============================================================================
@@ -1024,29 +1467,30 @@ void AudioEngine::changeListenerCallback(juce::ChangeBroadcaster* source)
 // MidiPlayerListener Implementation (for routing MIDI to Tracks)
 //==============================================================================
 
-void AudioEngine::midiNoteOn(int channel, int note, float velocity)
+void AudioEngine::midiNoteOn(int channel, int note, float velocity, int sampleOffset)
 {
     // Route MIDI note-on to the appropriate Track
-    // Channel/track index comes from MidiPlayer (0-based)
-    if (auto* track = getTrack(channel))
+    // Channel/track index comes from MidiPlayer (0-based); called on the audio thread.
+    // The offset is relative to this callback's block, which the tracks render next.
+    if (auto* track = getTrackForAudioThread(channel))
     {
-        track->noteOn(note, velocity);
+        track->noteOnFromAudioThread(note, velocity, sampleOffset);
     }
 }
 
-void AudioEngine::midiNoteOff(int channel, int note)
+void AudioEngine::midiNoteOff(int channel, int note, int sampleOffset)
 {
     // Route MIDI note-off to the appropriate Track
-    if (auto* track = getTrack(channel))
+    if (auto* track = getTrackForAudioThread(channel))
     {
-        track->noteOff(note);
+        track->noteOffFromAudioThread(note, sampleOffset);
     }
 }
 
 void AudioEngine::midiProgramChange(int channel, int program, int bank)
 {
-    if (auto* track = getTrack(channel))
-    track->handleProgramChange(program, bank);
+    if (auto* track = getTrackForAudioThread(channel))
+        track->handleProgramChange(program, bank);
 }
 
 //==============================================================================
@@ -1063,28 +1507,6 @@ void AudioEngine::removeListener(Listener* listener)
     listeners.remove(listener);
 }
 
-void AudioEngine::addVisualizationListener(VisualizationListener* listener)
-{
-    // Find an empty slot (lock-free for audio thread safety)
-    for (auto& slot : visualizationListeners)
-    {
-        VisualizationListener* expected = nullptr;
-        if (slot.compare_exchange_strong(expected, listener))
-            return;
-    }
-    DBG("AudioEngine: Warning - max visualization listeners reached!");
-}
-
-void AudioEngine::removeVisualizationListener(VisualizationListener* listener)
-{
-    // Find and clear the slot
-    for (auto& slot : visualizationListeners)
-    {
-        VisualizationListener* expected = listener;
-        slot.compare_exchange_strong(expected, nullptr);
-    }
-}
-
 void AudioEngine::notifyListeners(std::function<void(Listener*)> callback)
 {
     // Ensure we're on the message thread for listener callbacks
@@ -1218,83 +1640,24 @@ bool AudioEngine::renderToWavFile(const juce::File& outputFile, double sampleRat
         return false;
     }
     
-    // Create a temporary MidiPlayer for offline rendering
-    MidiPlayer renderPlayer;
-    renderPlayer.prepareToPlay(sampleRate, 512);
-    
-    // Copy MIDI data from current player
-    auto loadedFile = midiPlayer.getLoadedFile();
-    if (!loadedFile.existsAsFile())
-    {
-        DBG("AudioEngine::renderToWavFile - MIDI file not found");
-        return false;
-    }
-    
-    if (!renderPlayer.loadMidiFile(loadedFile))
-    {
-        DBG("AudioEngine::renderToWavFile - Failed to load MIDI for rendering");
-        return false;
-    }
-    
-    double totalDuration = renderPlayer.getTotalDuration();
-    int totalSamples = static_cast<int>(totalDuration * sampleRate) + static_cast<int>(sampleRate); // Add 1 second for tail
-    
-    DBG("AudioEngine::renderToWavFile - Rendering " << totalDuration << "s to " << outputFile.getFullPathName());
-    
-    // Create output buffer
-    juce::AudioBuffer<float> outputBuffer(2, totalSamples);
-    outputBuffer.clear();
-    
-    // Render in blocks
-    const int blockSize = 512;
-    renderPlayer.setPlaying(true);
-    renderPlayer.setPosition(0.0);
+    OfflineRenderer renderer(formatManager, expansionLoader, sampleRate);
+    renderer.setMidiData(midiPlayer.getSourceMidiData());
     
-    for (int pos = 0; pos < totalSamples && renderPlayer.isPlaying(); pos += blockSize)
     {
-        int numSamples = juce::jmin(blockSize, totalSamples - pos);
-        
-        // Create a sub-buffer for this block
-        juce::AudioBuffer<float> blockBuffer(2, numSamples);
-        blockBuffer.clear();
-        
-        renderPlayer.renderNextBlock(blockBuffer, numSamples);
-        
-        // Copy to output buffer
-        for (int ch = 0; ch < 2; ++ch)
-        {
-            outputBuffer.copyFrom(ch, pos, blockBuffer, ch, 0, numSamples);
-        }
-    }
-    
-    // Write to WAV file
-    outputFile.deleteFile();
-    std::unique_ptr<juce::FileOutputStream> outStream(outputFile.createOutputStream());
-    
-    if (outStream == nullptr)
-    {
-        DBG("AudioEngine::renderToWavFile - Could not create output file");
-        return false;
-    }
-    
-    juce::WavAudioFormat wavFormat;
-    std::unique_ptr<juce::AudioFormatWriter> writer(
-        wavFormat.createWriterFor(outStream.get(), sampleRate, 2, bitDepth, {}, 0));
-    
-    if (writer == nullptr)
-    {
-        DBG("AudioEngine::renderToWavFile - Could not create WAV writer");
-        return false;
+        const juce::ScopedLock sl(tracksLock);
+        for (auto& track : tracks)
+            renderer.addTrackCopy(*track);
     }
     
-    outStream.release(); // Writer takes ownership
+    renderer.copyMixerSettings(mixerGraph);
     
-    if (!writer->writeFromAudioSampleBuffer(outputBuffer, 0, outputBuffer.getNumSamples()))
+    if (!renderer.render(outputFile, bitDepth))
     {
-        DBG("AudioEngine::renderToWavFile - Failed to write audio data");
+        DBG("AudioEngine::renderToWavFile - " << renderer.getLastError());
         return false;
     }
     
+    lastRenderStats = renderer.getStats();
     DBG("AudioEngine::renderToWavFile - Successfully rendered to " << outputFile.getFullPathName());
     return true;
 }
@@ -1304,7 +1667,12 @@ double AudioEngine::getPlaybackPosition() const
     if (audioFileLoaded.load())
         return audioTransportSource.getCurrentPosition();
 
-    return midiPlayer.getPosition();
+    // What is heard lags the MIDI playhead by the mixer's FX latency
+    double latencySeconds = 0.0;
+    if (currentSampleRate > 0.0)
+        latencySeconds = mixerGraph.getTotalLatencySamples() / currentSampleRate;
+
+    return juce::jmax(0.0, midiPlayer.getPosition() - latencySeconds);
 }
 
 void AudioEngine::setPlaybackPosition(double positionSeconds)
@@ -1332,19 +1700,41 @@ AudioEngine::Track* AudioEngine::addTrack(const juce::String& name)
     const juce::ScopedLock sl(tracksLock);
     int id = (int)tracks.size(); // Simple ID generation
     auto newTrack = std::make_unique<Track>(id, name, formatManager);
+    newTrack->setPolyphonyBudget(&polyphonyBudget);
     if (currentSampleRate > 0)
         newTrack->prepareToPlay(currentSampleRate, currentBufferSize);
     
+    // Give the track its mixer strip (same index) before the audio thread can see the track
+    mixerGraph.addTrack(name);
+    
     auto* ptr = newTrack.get();
     tracks.push_back(std::move(newTrack));
+    publishTrackList();
     return ptr;
 }
 
 void AudioEngine::removeTrack(int index)
 {
-    const juce::ScopedLock sl(tracksLock);
-    if (index >= 0 && index < tracks.size())
+    std::unique_ptr<Track> retired;
+    
+    {
+        const juce::ScopedLock sl(tracksLock);
+        if (index < 0 || index >= (int)tracks.size())
+            return;
+        
+        // Leave the slot empty first so every later track keeps its strip while the
+        // mixer removes this one. Once this returns the audio thread can no longer
+        // reach the retired track.
+        retired = std::move(tracks[(size_t)index]);
+        publishTrackList();
+        
+        mixerGraph.removeTrack(index);
+        
         tracks.erase(tracks.begin() + index);
+        publishTrackList();
+    }
+    
+    // 'retired' is destroyed here, off the audio thread
 }
 
 AudioEngine::Track* AudioEngine::getTrack(int index)
@@ -1363,21 +1753,14 @@ int AudioEngine::getNumTracks() const
 
 void AudioEngine::playNote(int trackIndex, int noteNumber, float velocity, float durationSeconds)
 {
-    if (auto* track = getTrack(trackIndex))
-        track->noteOn(noteNumber, velocity);
-
     // Fire-and-forget preview notes must be turned off, otherwise they can sustain indefinitely.
     // If durationSeconds isn't provided, use a short default so clicks on keys/notes don't stick.
-    const float effectiveDurationSeconds = (durationSeconds > 0.0f ? durationSeconds : 0.25f);
-    const int delayMs = juce::jlimit(1, 60 * 1000, (int)std::round(effectiveDurationSeconds * 1000.0f));
-
-    juce::Timer::callAfterDelay(delayMs, [this, trackIndex, noteNumber]() {
-        if (!initialised.load())
-            return;
-
-        if (auto* track = getTrack(trackIndex))
-            track->noteOff(noteNumber);
-    });
+    // The note-off is queued with the note-on at a sample offset, so every audition has the same length.
+    const float effectiveDurationSeconds = juce::jlimit(0.001f, 60.0f, durationSeconds > 0.0f ? durationSeconds : 0.25f);
+    const double sampleRate = currentSampleRate > 0.0 ? currentSampleRate : 44100.0;
+    
+    if (auto* track = getTrack(trackIndex))
+        track->auditionNote(noteNumber, velocity, (int)std::round(effectiveDurationSeconds * sampleRate));
 }
 
 void AudioEngine::loadInstrument(int trackIndex, const juce::File& sampleFile, const juce::String& instrumentName)
@@ -1409,6 +1792,12 @@ bool AudioEngine::loadTrackInstrument(int trackIndex, const juce::String& instru
     return false;
 }
 
+void AudioEngine::setTrackVoiceReservation(int trackIndex, int numVoices)
+{
+    if (auto* track = getTrack(trackIndex))
+        track->setReservedVoices(numVoices);
+}
+
 void AudioEngine::setTrackDefaultSynthWaveform(int trackIndex, DefaultSynthWaveform waveform)
 {
     if (auto* track = getTrack(trackIndex))
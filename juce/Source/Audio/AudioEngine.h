@@ -18,10 +18,15 @@
 #include <juce_audio_utils/juce_audio_utils.h>
 #include "MidiPlayer.h"
 #include "MixerGraph.h"
+#include "AudioWorkerPool.h"
+#include "AnalysisBus.h"
 #include "ExpansionInstrumentLoader.h"
 #include "SamplerInstrument.h"
 #include "SF2Instrument.h"
+#include "SampleCache.h"
 #include "SFZInstrument.h"
+#include "VoiceAllocator.h"
+#include "TrackCommandQueue.h"
 
 namespace mmg // Multimodal Music Generator
 {
@@ -40,6 +45,8 @@ namespace mmg // Multimodal Music Generator
     - Audio callbacks run on audio thread
     - UI updates must be posted to message thread
     - Use atomics/locks for shared state
+    - The audio callback never waits on a lock: the track list is published
+      as an atomic snapshot and per-track locks are only ever try-locked there
 */
 class AudioEngine : public juce::AudioSource,
                     public juce::ChangeListener,
@@ -186,13 +193,52 @@ public:
     // Offline Rendering
     //==========================================================================
     
-    /** Render the currently loaded MIDI to a WAV file.
+    /** Timing of the last offline render */
+    struct RenderStats
+    {
+        double audioSeconds = 0.0;      // Length of the rendered file
+        double wallSeconds = 0.0;       // Time the render took
+        double realtimeFactor = 0.0;    // audioSeconds / wallSeconds
+        int numThreads = 1;
+    };
+    
+    /** Render the currently loaded MIDI to a WAV file, through copies of the
+        track instruments and mixer (live playback is not interrupted).
+        Tracks render in parallel and blocks stream to disk as they finish.
         @param outputFile The destination WAV file
         @param sampleRate Sample rate for rendering (default 44100)
         @param bitDepth Bit depth (16 or 24, default 16)
         @returns true if rendering succeeded */
     bool renderToWavFile(const juce::File& outputFile, double sampleRate = 44100.0, int bitDepth = 16);
     
+    /** Stats of the last successful renderToWavFile() call */
+    const RenderStats& getLastRenderStats() const { return lastRenderStats; }
+    
+    //==========================================================================
+    // Sample Cache
+    //==========================================================================
+    
+    /** Hit/miss counts and memory of the samples and soundfonts shared between tracks */
+    SampleCache::Stats getSampleCacheStats() const { return sampleCache->getStats(); }
+    
+    /** Memory the sample cache may use before idle samples are released */
+    void setSampleCacheBudget(size_t bytes) { sampleCache->setMemoryBudget(bytes); }
+    
+    //==========================================================================
+    // Polyphony
+    //==========================================================================
+    
+    /** Voices the sample instruments of all tracks may play at once. When the budget
+        is reached, new notes take over the oldest released or quietest voice. */
+    void setPolyphonyBudget(int maxVoices) { polyphonyBudget.setMaxVoices(maxVoices); }
+    int getPolyphonyBudget() const { return polyphonyBudget.getMaxVoices(); }
+    
+    /** Voices of the budget kept for one track, whatever the other tracks play. */
+    void setTrackVoiceReservation(int trackIndex, int numVoices);
+    
+    /** Budgeted voices sounding across all tracks. */
+    int getActiveVoiceCount() const { return polyphonyBudget.getVoicesInUse(); }
+    
     //==========================================================================
     // Live Synthesis (Preview)
     //==========================================================================
@@ -254,8 +300,28 @@ public:
         void releaseResources();
         void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
         
-        void noteOn(int note, float velocity);
-        void noteOff(int note);
+        /** Stand-in for renderNextBlock() on a block the track is left out of (soloed out):
+            applies queued input and consumes the block's events without rendering. */
+        void skipBlock(int numSamples);
+        
+        /** Live input from the message thread (auditions, piano-roll clicks). Never blocks:
+            the event is queued and applied sampleOffset samples into the next rendered block. */
+        void noteOn(int note, float velocity, int sampleOffset = 0);
+        void noteOff(int note, int sampleOffset = 0);
+        
+        /** Queue a note-on and its note-off together, so the note lasts exactly
+            durationSamples however the blocks fall. */
+        void auditionNote(int note, float velocity, int durationSamples);
+        
+        /** Release every sounding note at the start of the next block (non-blocking). */
+        void allNotesOff();
+        
+        /** Non-blocking variants for events routed from MidiPlayer on the audio thread.
+            The event is queued and starts exactly sampleOffset samples into the next
+            renderNextBlock() call; offsets past that call carry over to the following one. */
+        void noteOnFromAudioThread(int note, float velocity, int sampleOffset = 0);
+        void noteOffFromAudioThread(int note, int sampleOffset = 0);
+        
         void handleProgramChange(int programNumber, int bankNumber = 0);
         
         // Load a sample file (WAV, AIFF, etc.) - legacy simple sample loading
@@ -272,10 +338,29 @@ public:
         // Load SFZ instrument file
         bool loadSFZ(const juce::File& sfzFile);
         
+        /** Load the same instrument as another track (file, preset or expansion id) and copy
+            its volume, mute/solo and Default Synth settings. Used to build offline render copies. */
+        bool copyInstrumentFrom(const Track& source, const ExpansionInstrumentLoader& loader);
+        
+        /** Offline rendering: disk-streamed samples are waited for instead of dropping out.
+            Applies to the current instrument and every one loaded afterwards. */
+        void setNonRealtime(bool isNonRealtime);
+        
+        /** Share a polyphony budget with other tracks (sample instruments only).
+            Call before the track plays; tracks without a budget are unlimited. */
+        void setPolyphonyBudget(PolyphonyBudget* budget);
+        
+        /** Voices of the budget kept for this track whatever the others use. */
+        void setReservedVoices(int numVoices) { voiceBudget.setReservedVoices(numVoices); }
+        int getReservedVoices() const { return voiceBudget.getReservedVoices(); }
+        
+        /** Budgeted voices this track is playing right now. */
+        int getActiveVoiceCount() const { return voiceBudget.getVoicesInUse(); }
+        
         // Get currently loaded instrument info
         juce::String getInstrumentId() const { return currentInstrumentId; }
         juce::String getInstrumentName() const { return currentInstrumentName; }
-        bool hasInstrument() const { return sampler.isLoaded(); }
+        bool hasInstrument() const { return sampler->isLoaded(); }
         
         void setVolume(float newVolume);
         float getVolume() const { return volume.load(); }
@@ -322,8 +407,12 @@ public:
         enum class InstrumentType { None, SimpleSynth, ExpansionSampler, SF2, SFZ };
         InstrumentType activeInstrumentType = InstrumentType::SimpleSynth;
         
+        // This track's share of the engine's polyphony budget (declared before the
+        // instruments, so their voices hand it back before it goes)
+        PolyphonyBudget::Client voiceBudget;
+        
         // Sampler instrument (for expansion instruments)
-        SamplerInstrument sampler;
+        std::unique_ptr<SamplerInstrument> sampler;
         juce::String currentInstrumentId;
         juce::String currentInstrumentName;
         
@@ -336,9 +425,62 @@ public:
         // Fallback simple synth (sine wave)
         juce::Synthesiser simpleSynth;
         bool useSimpleSynth = true;
+        
+        /** Where the current instrument came from, so it can be loaded again elsewhere. */
+        struct InstrumentSource
+        {
+            InstrumentType type = InstrumentType::SimpleSynth;
+            juce::File file;            // SF2, SFZ or plain sample
+            int preset = 0;             // SF2 preset index at load time
+            juce::String instrumentId;  // Expansion instrument
+        };
+        
+        InstrumentSource instrumentSource;   // Written under trackLock and settingsLock
+        
+        void setInstrumentSource(const InstrumentSource& source);
 
         DefaultSynthState defaultSynth;
         
+        // Instrument dispatch; caller must hold trackLock.
+        // sampleOffset positions Synthesiser-based notes inside the chunk being rendered.
+        void applyNoteOn(int note, float velocity, int sampleOffset = 0);
+        void applyNoteOff(int note, int sampleOffset = 0);
+        
+        /** Render the active instrument into [startSample, startSample + numSamples) of chunk. */
+        void renderInstrument(juce::AudioBuffer<float>& chunk, int startSample, int numSamples);
+        
+        /** A MidiPlayer note waiting for its sample in renderNextBlock (audio thread only). */
+        struct ScheduledNote
+        {
+            int sampleOffset = 0;
+            int note = 0;
+            float velocity = 0.0f;      // 0 = note-off
+        };
+        
+        void applyScheduledNote(const ScheduledNote& scheduled, int chunkOffset);
+        
+        /** For a note whose block is not rendered: releases a note-off's voices
+            straight away, bypassing midiBuffer, and drops a note-on. */
+        void skipScheduledNote(const ScheduledNote& scheduled);
+        
+        /** Consume the notes due within numSamples without rendering and shift the rest.
+            Due notes are skipped with skipScheduledNote() if canApply, else dropped. */
+        void skipScheduledNotes(int numSamples, bool canApply);
+        
+        /** Insert a note into scheduledNotes, keeping it ordered by sampleOffset. */
+        void scheduleNote(int note, float velocity, int sampleOffset);
+        
+        /** Move queued live input into scheduledNotes; caller must hold trackLock. */
+        void applyPendingCommands();
+        
+        /** Live input waiting for the render thread. */
+        TrackCommandQueue commandQueue;
+        
+        static constexpr int maxScheduledNotes = 512;
+        static constexpr int noteOffReserve = 64;   // Slots only note-offs may take
+        std::array<ScheduledNote, maxScheduledNotes> scheduledNotes;
+        int numScheduledNotes = 0;
+        
         std::atomic<float> volume { 1.0f };
         std::atomic<bool> muted { false };
         std::atomic<bool> soloed { false };
@@ -347,9 +489,36 @@ public:
         std::atomic<float> rmsLevel { 0.0f };
         std::atomic<float> peakLevel { 0.0f };
         
+        // Settings from the last prepareToPlay, applied to instruments loaded afterwards.
+        // Written under trackLock and settingsLock, so either one is enough to read them;
+        // loaders read them through getPreparedSettings without touching trackLock.
+        double preparedSampleRate = 0.0;
+        int preparedBlockSize = 0;
+        bool nonRealtime = false;
+        
+        struct PreparedSettings
+        {
+            double sampleRate = 0.0;
+            int blockSize = 0;
+            bool nonRealtime = false;
+        };
+        
+        PreparedSettings getPreparedSettings() const;
+        
+        // Scratch buffer sized in prepareToPlay; renderNextBlock works in chunks of
+        // this size so the audio thread never allocates
+        juce::AudioBuffer<float> renderBuffer;
+        
         juce::MidiBuffer midiBuffer;
+        
+        // Held by loaders only while swapping in a fully-loaded instrument.
+        // The audio thread try-locks it and skips the block if it is busy.
         juce::CriticalSection trackLock;
         
+        // Guards instrumentSource and the prepared settings for readers; never taken
+        // by the audio thread. Always taken after trackLock, never before.
+        juce::CriticalSection settingsLock;
+        
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Track)
     };
     
@@ -399,23 +568,9 @@ public:
     // Audio Visualization Support
     //==========================================================================
     
-    /** Listener interface for visualization - receives audio samples */
-    class VisualizationListener
-    {
-    public:
-        virtual ~VisualizationListener() = default;
-        
-        /** Called with audio samples for visualization (on audio thread!) */
-        virtual void audioSamplesReady(const float* leftSamples, 
-                                       const float* rightSamples, 
-                                       int numSamples) = 0;
-    };
-    
-    /** Add a visualization listener (lock-free, call from message thread) */
-    void addVisualizationListener(VisualizationListener* listener);
-    
-    /** Remove a visualization listener (lock-free, call from message thread) */
-    void removeVisualizationListener(VisualizationListener* listener);
+    /** Tap points for analyzers (master output, and each track by index). Writers are
+        the render threads; readers poll the taps from their own timers. */
+    AnalysisBus& getAnalysisBus() noexcept { return analysisBus; }
     
     //==========================================================================
     // Listener Management
@@ -441,8 +596,8 @@ private:
     //==========================================================================
     // MidiPlayerListener Implementation (for routing MIDI to Tracks)
     //==========================================================================
-    void midiNoteOn(int channel, int note, float velocity) override;
-    void midiNoteOff(int channel, int note) override;
+    void midiNoteOn(int channel, int note, float velocity, int sampleOffset) override;
+    void midiNoteOff(int channel, int note, int sampleOffset) override;
     void midiProgramChange(int channel, int program, int bank) override;
     
     //==========================================================================
@@ -487,23 +642,76 @@ private:
     juce::AudioTransportSource audioTransportSource;
     std::atomic<bool> audioFileLoaded { false };
     
-    // Mixer
+    // Mixer (one strip per track, same index)
     Audio::MixerGraph mixerGraph;
+    juce::MidiBuffer mixerMidi;     // Always empty; the mixer's processors ignore MIDI
     
     // Expansion instruments
     ExpansionInstrumentLoader expansionLoader;
     
-    // Tracks
+    // Keeps the shared cache alive between instrument reloads (declared before tracks, so it outlives them)
+    juce::SharedResourcePointer<SampleCache> sampleCache;
+    
+    // Voice limit across tracks (declared before tracks, so it outlives their clients)
+    PolyphonyBudget polyphonyBudget;
+    
+    // Offline rendering
+    RenderStats lastRenderStats;
+    
+    // Tracks (owned and edited off the audio thread; tracksLock is never taken by the callback)
     std::vector<std::unique_ptr<Track>> tracks;
     juce::CriticalSection tracksLock;
+    
+    /** One track render dispatched to the worker pool. */
+    struct TrackRenderJob
+    {
+        Track* track = nullptr;
+        juce::AudioBuffer<float>* destination = nullptr;
+        AnalysisTap* tap = nullptr;     // Receives the track's strip input once rendered
+    };
+    
+    /** Immutable view of the track list that the audio thread renders from. */
+    struct TrackList
+    {
+        std::vector<Track*> tracks;                 // Null for a track whose strip is being removed
+        
+        // Audio-thread scratch, reserved to tracks.size() at publish so filling it never allocates
+        mutable std::vector<TrackRenderJob> renderJobs;
+    };
+    
+    std::unique_ptr<TrackList> publishedTrackList;          // Writer-owned, live on the audio thread
+    std::atomic<TrackList*> liveTrackList { nullptr };       // Latest snapshot
+    std::atomic<TrackList*> trackListInUse { nullptr };      // Snapshot the callback currently holds
+    const TrackList* renderTrackList = nullptr;              // Audio thread only, valid inside getNextAudioBlock
+    
+    /** Rebuild the snapshot from 'tracks' and swap it in. Call with tracksLock held.
+        Blocks until the audio thread has let go of the previous snapshot, so any
+        retired tracks can be safely destroyed afterwards. */
+    void publishTrackList();
+    
+    /** Grab the current snapshot for the duration of one audio callback. */
+    const TrackList* acquireTrackList() noexcept;
+    
+    /** Track lookup for the audio thread (MidiPlayer callbacks); uses renderTrackList. */
+    Track* getTrackForAudioThread(int index) const noexcept;
+    
+    /** Render every track into its mixer strip and mix the result into the output region. */
+    void renderTracksThroughMixer(const juce::AudioSourceChannelInfo& bufferToFill);
+    
+    /** AudioWorkerPool entry point: renders renderTrackList->renderJobs[jobIndex]. */
+    static void renderTrackJob(void* context, int jobIndex);
+    
+    // Renders independent tracks in parallel; started in initialise()
+    AudioWorkerPool workerPool;
+    int renderJobSamples = 0;   // Chunk size of the jobs currently in flight
+    double renderBlockTime = -1.0;  // Song position of the callback's first sample (MIDI playback), else -1
 
     // Master bus metering (written on audio thread, read on UI thread)
     std::atomic<float> masterRmsLevel { 0.0f };
     std::atomic<float> masterPeakLevel { 0.0f };
     
-    // Visualization listeners (lock-free array for audio thread safety)
-    static constexpr int maxVisualizationListeners = 8;
-    std::array<std::atomic<VisualizationListener*>, maxVisualizationListeners> visualizationListeners;
+    // Audio for analyzers: one bulk copy per tap per block, however many analyzers read it
+    AnalysisBus analysisBus;
     
     // Listeners
     juce::ListenerList<Listener> listeners;
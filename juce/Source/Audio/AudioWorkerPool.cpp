@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    AudioWorkerPool.cpp
+
+    Implementation of the real-time worker pool.
+
+  ==============================================================================
+*/
+
+#include "AudioWorkerPool.h"
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace mmg
+{
+
+namespace
+{
+    // Roughly 50-200us of polling before a worker parks; covers the gap between
+    // the sub-rounds of one callback without burning a core between callbacks
+    constexpr int spinIterations = 4000;
+    constexpr int parkTimeoutMs = 100;
+
+    inline void cpuRelax() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && (JUCE_CLANG || JUCE_GCC)
+        __asm__ __volatile__ ("yield");
+       #endif
+    }
+}
+
+//==============================================================================
+class AudioWorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker(AudioWorkerPool& owner, int workerIndex, int core)
+        : juce::Thread("Audio Worker " + juce::String(workerIndex + 1)),
+          pool(owner),
+          queueIndex(workerIndex + 1),
+          cpuCore(core)
+    {
+    }
+
+    ~Worker() override
+    {
+        stopThread(1000);
+    }
+
+    void run() override
+    {
+        juce::ScopedNoDenormals noDenormals;
+
+        if (cpuCore >= 0 && cpuCore < 32)
+            juce::Thread::setCurrentThreadAffinityMask((juce::uint32)1 << cpuCore);
+
+        auto seen = pool.generation.load();
+
+        while (!threadShouldExit())
+        {
+            if (!waitForRound(seen))
+                continue;
+
+            seen = pool.generation.load();
+            pool.participate(queueIndex);
+        }
+    }
+
+    /** Called by the pool owner after opening a round. */
+    void wake() noexcept
+    {
+        if (parked.load())
+            wakeEvent.signal();
+    }
+
+    void stop()
+    {
+        signalThreadShouldExit();
+        wakeEvent.signal();
+        stopThread(1000);
+    }
+
+private:
+    /** Spin, then park until the generation moves on. Returns true if it did. */
+    bool waitForRound(juce::uint32 seen)
+    {
+        for (int i = 0; i < spinIterations; ++i)
+        {
+            if (pool.generation.load() != seen)
+                return true;
+            cpuRelax();
+        }
+
+        // Announce parking before the final check; the owner signals after bumping
+        // the generation, so one of us always sees the other
+        parked.store(true);
+
+        if (pool.generation.load() == seen)
+            wakeEvent.wait(parkTimeoutMs);
+
+        parked.store(false);
+        return pool.generation.load() != seen;
+    }
+
+    AudioWorkerPool& pool;
+    const int queueIndex;
+    const int cpuCore;
+
+    std::atomic<bool> parked { false };
+    juce::WaitableEvent wakeEvent;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Worker)
+};
+
+//==============================================================================
+AudioWorkerPool::AudioWorkerPool() = default;
+
+AudioWorkerPool::~AudioWorkerPool()
+{
+    stop();
+}
+
+void AudioWorkerPool::start(int numWorkers, bool realtime)
+{
+    stop();
+
+    const int numCpus = juce::SystemStats::getNumCpus();
+    const int count = juce::jlimit(0, maxWorkers, numWorkers >= 0 ? numWorkers
+                                                                  : juce::SystemStats::getNumPhysicalCpus() - 1);
+
+    numActiveWorkers = count;
+    numQueues = count + 1;
+
+    for (int i = 0; i < count; ++i)
+    {
+        // Core 0 is left to the device callback thread and the UI
+        const int core = (realtime && numCpus > 1) ? (i + 1) % numCpus : -1;
+
+        auto* worker = workers.add(new Worker(*this, i, core));
+        worker->startThread(realtime ? juce::Thread::Priority::highest : juce::Thread::Priority::normal);
+    }
+
+    DBG("AudioWorkerPool: Started " << count << (realtime ? " real-time" : " background") << " workers");
+}
+
+void AudioWorkerPool::stop()
+{
+    for (auto* worker : workers)
+        worker->stop();
+
+    workers.clear();
+    numActiveWorkers = 0;
+    numQueues = 1;
+}
+
+//==============================================================================
+void AudioWorkerPool::run(int numTasks, TaskFunction fn, void* context) noexcept
+{
+    if (numTasks <= 0)
+        return;
+
+    if (numActiveWorkers == 0 || numTasks == 1)
+    {
+        for (int i = 0; i < numTasks; ++i)
+            fn(context, i);
+        return;
+    }
+
+    // Every worker has left the previous round (see the end of this function),
+    // so the queues can be rewritten before the round is opened
+    currentTask = fn;
+    currentContext = context;
+
+    for (int q = 0; q < numQueues; ++q)
+    {
+        queues[(size_t)q].end = (q + 1) * numTasks / numQueues;
+        queues[(size_t)q].next.store(q * numTasks / numQueues);
+    }
+
+    pendingTasks.store(numTasks);
+    roundOpen.store(true);
+    generation.fetch_add(1);
+
+    for (auto* worker : workers)
+        worker->wake();
+
+    drainQueues(0);
+
+    // Tasks still running on workers; never park the audio thread
+    while (pendingTasks.load() > 0)
+        cpuRelax();
+
+    // Close the round and wait for stragglers that are still scanning queues
+    roundOpen.store(false);
+
+    while (workersInRound.load() > 0)
+        cpuRelax();
+}
+
+void AudioWorkerPool::participate(int ownQueue) noexcept
+{
+    // Paired with run(): either we see the round closed, or run() sees us and waits
+    workersInRound.fetch_add(1);
+
+    if (roundOpen.load())
+        drainQueues(ownQueue);
+
+    workersInRound.fetch_sub(1);
+}
+
+void AudioWorkerPool::drainQueues(int ownQueue) noexcept
+{
+    auto* task = currentTask;
+    auto* context = currentContext;
+
+    for (int offset = 0; offset < numQueues; ++offset)
+    {
+        auto& queue = queues[(size_t)((ownQueue + offset) % numQueues)];
+
+        for (;;)
+        {
+            const int taskIndex = queue.next.fetch_add(1);
+            if (taskIndex >= queue.end)
+                break;
+
+            task(context, taskIndex);
+            pendingTasks.fetch_sub(1);
+        }
+    }
+}
+
+} // namespace mmg
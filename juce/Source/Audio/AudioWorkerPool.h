@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    AudioWorkerPool.h
+
+    Real-time worker pool for rendering independent jobs (tracks) in parallel
+    inside an audio callback. Workers are pinned to cores, spin briefly
+    between blocks and then park; idle workers steal from busy ones.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+
+namespace mmg
+{
+
+//==============================================================================
+/**
+    Fork/join pool for the audio thread.
+
+    run() splits the task range into one queue per participant (the calling
+    thread plus every worker). Each participant drains its own queue and then
+    steals from the others, and run() returns once every task has finished.
+    Nothing is allocated or locked on the calling thread; waking a parked
+    worker is a single event signal.
+
+    Only one thread may call run() at a time.
+*/
+class AudioWorkerPool
+{
+public:
+    /** Task entry point: called once per index in [0, numTasks). */
+    using TaskFunction = void (*)(void* context, int taskIndex);
+
+    AudioWorkerPool();
+    ~AudioWorkerPool();
+
+    /** Start the worker threads.
+        @param numWorkers Number of threads besides the caller; -1 picks one per
+                          spare core (capped at maxWorkers)
+        @param realtime   Pin workers to cores at the highest priority (live playback).
+                          Offline renders pass false so they never compete with it. */
+    void start(int numWorkers = -1, bool realtime = true);
+
+    /** Stop and join all workers. Must not overlap a run() call. */
+    void stop();
+
+    int getNumWorkers() const noexcept { return numActiveWorkers; }
+
+    /** Run fn(context, i) for every i in [0, numTasks) and wait for all of them.
+        Falls back to running inline when there are no workers or only one task. */
+    void run(int numTasks, TaskFunction fn, void* context) noexcept;
+
+    static constexpr int maxWorkers = 15;
+
+private:
+    class Worker;
+
+    /** One participant's share of the current round. Anyone may claim from it. */
+    struct alignas(64) TaskQueue
+    {
+        std::atomic<int> next { 0 };
+        int end = 0;
+    };
+
+    /** Claim and run tasks, starting with the own queue and then stealing. */
+    void drainQueues(int ownQueue) noexcept;
+
+    /** Worker side of a round; does nothing if the round has already closed. */
+    void participate(int ownQueue) noexcept;
+
+    std::array<TaskQueue, maxWorkers + 1> queues;   // Queue 0 belongs to the caller
+    int numQueues = 1;
+
+    TaskFunction currentTask = nullptr;
+    void* currentContext = nullptr;
+
+    std::atomic<int> pendingTasks { 0 };
+    std::atomic<int> workersInRound { 0 };
+    std::atomic<bool> roundOpen { false };
+    std::atomic<juce::uint32> generation { 0 };
+
+    juce::OwnedArray<Worker> workers;
+    int numActiveWorkers = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioWorkerPool)
+};
+
+} // namespace mmg
@@ -10,17 +10,35 @@
 
 #include "ExpansionInstrumentLoader.h"
 
+#include <atomic>
+
 namespace mmg
 {
 
 //==============================================================================
-ExpansionInstrumentLoader::ExpansionInstrumentLoader() {}
+ExpansionInstrumentLoader::ExpansionInstrumentLoader()
+    : indexFile(getDefaultIndexFile())
+{
+}
 
 //==============================================================================
 // Scanning
 //==============================================================================
 
 bool ExpansionInstrumentLoader::scanExpansion(const juce::File& expansionFolder)
+{
+    loadIndex();
+    
+    ExpansionDefinition expansion;
+    if (!buildExpansion(expansionFolder, expansion))
+        return false;
+    
+    addExpansion(std::move(expansion));
+    saveIndexIfChanged();
+    return true;
+}
+
+bool ExpansionInstrumentLoader::buildExpansion(const juce::File& expansionFolder, ExpansionDefinition& expansion)
 {
     if (!expansionFolder.isDirectory())
         return false;
@@ -86,7 +104,6 @@ bool ExpansionInstrumentLoader::scanExpansion(const juce::File& expansionFolder)
     DBG("  Found " << xpmFiles.size() << " XPM files");
     
     // Create expansion definition
-    ExpansionDefinition expansion;
     expansion.path = contentFolder;
     expansion.name = contentFolder.getFileName();
     expansion.id = sanitizeId(expansion.name);
@@ -107,28 +124,25 @@ bool ExpansionInstrumentLoader::scanExpansion(const juce::File& expansionFolder)
     {
         InstrumentDefinition instrument;
         
-        if (parseXpmFile(xpmFile, instrument))
+        if (parseXpmCached(xpmFile, instrument))
         {
             instrument.expansionId = expansion.id;
             instrument.expansionName = expansion.name;
             instrument.expansionPath = contentFolder;
             
-            // Add to category
-            expansion.instruments[instrument.category].push_back(instrument);
             if (!expansion.categories.contains(instrument.category))
                 expansion.categories.add(instrument.category);
             
-            // Add to lookup
-            instrumentLookup[instrument.id] = instrument;
-            
             DBG("  Loaded: " << instrument.name << " (" << instrument.category << ") with " 
                 << instrument.zones.size() << " zones");
+            
+            // Add to category (the lookup table points here once the expansion is added)
+            expansion.instruments[instrument.category].push_back(std::move(instrument));
         }
     }
     
     if (expansion.getTotalInstrumentCount() > 0)
     {
-        expansions[expansion.id] = std::move(expansion);
         DBG("  Expansion loaded: " << expansion.name << " with " 
             << expansion.getTotalInstrumentCount() << " instruments");
         return true;
@@ -142,27 +156,211 @@ int ExpansionInstrumentLoader::scanExpansionsDirectory(const juce::File& expansi
     if (!expansionsDir.isDirectory())
         return 0;
     
-    int count = 0;
-    auto subDirs = expansionsDir.findChildFiles(juce::File::findDirectories, false);
+    loadIndex();
+    
+    const auto folders = expansionsDir.findChildFiles(juce::File::findDirectories, false);
+    std::vector<ExpansionDefinition> results((size_t)folders.size());
+    std::vector<char> succeeded((size_t)folders.size(), 0);
+    
+    // Each expansion is independent: walk and parse them in parallel, then merge in
+    // folder order. This is disk-bound work, so the jobs run on ordinary threads and
+    // this thread sleeps until the last one is done.
+    if (!folders.isEmpty())
+    {
+        std::atomic<int> remaining { folders.size() };
+        juce::WaitableEvent finished;
+        juce::ThreadPool pool(juce::jlimit(1, folders.size(), juce::SystemStats::getNumCpus()));
+        
+        for (int i = 0; i < folders.size(); ++i)
+        {
+            pool.addJob([this, &folders, &results, &succeeded, &remaining, &finished, i]
+            {
+                if (buildExpansion(folders[i], results[(size_t)i]))
+                    succeeded[(size_t)i] = 1;
+                
+                if (--remaining == 0)
+                    finished.signal();
+            });
+        }
+        
+        finished.wait();
+    }
     
-    for (const auto& dir : subDirs)
+    // Merge everything, then point the lookup table at it once
+    int count = 0;
+    for (size_t i = 0; i < results.size(); ++i)
     {
-        if (scanExpansion(dir))
+        if (succeeded[i] != 0)
+        {
+            auto id = results[i].id;
+            expansions[id] = std::move(results[i]);
             count++;
+        }
     }
     
+    rebuildLookup();
+    
+    saveIndexIfChanged();
+    
     DBG("ExpansionInstrumentLoader: Loaded " << count << " expansions with " 
         << getTotalInstrumentCount() << " total instruments");
     
     return count;
 }
 
+void ExpansionInstrumentLoader::addExpansion(ExpansionDefinition&& expansion)
+{
+    auto id = expansion.id;
+    expansions[id] = std::move(expansion);
+    rebuildLookup();
+}
+
+void ExpansionInstrumentLoader::rebuildLookup()
+{
+    instrumentLookup.clear();
+    
+    for (const auto& [expId, expansion] : expansions)
+        for (const auto& [category, instruments] : expansion.instruments)
+            for (const auto& inst : instruments)
+                instrumentLookup[inst.id] = &inst;
+}
+
 void ExpansionInstrumentLoader::clear()
 {
     expansions.clear();
     instrumentLookup.clear();
 }
 
+//==============================================================================
+// Scan Index
+//==============================================================================
+
+juce::File ExpansionInstrumentLoader::getDefaultIndexFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+        .getChildFile("AI Music Generator")
+        .getChildFile("expansion_index.json");
+}
+
+void ExpansionInstrumentLoader::setIndexFile(const juce::File& file)
+{
+    const juce::ScopedLock sl(indexLock);
+    indexFile = file;
+    index.clear();
+    indexLoaded = false;
+    indexChanged = false;
+}
+
+bool ExpansionInstrumentLoader::parseXpmCached(const juce::File& xpmFile, InstrumentDefinition& outInstrument)
+{
+    const auto path = xpmFile.getFullPathName();
+    const auto size = xpmFile.getSize();
+    const auto modificationTime = xpmFile.getLastModificationTime().toMilliseconds();
+    
+    {
+        const juce::ScopedLock sl(indexLock);
+        auto it = index.find(path);
+        if (it != index.end() && it->second.size == size && it->second.modificationTime == modificationTime)
+        {
+            if (it->second.valid)
+                outInstrument = it->second.instrument;
+            return it->second.valid;
+        }
+    }
+    
+    // New or changed file: parse outside the lock so other expansions keep going
+    InstrumentDefinition parsed;
+    const bool valid = parseXpmFile(xpmFile, parsed);
+    
+    {
+        const juce::ScopedLock sl(indexLock);
+        auto& entry = index[path];
+        entry.size = size;
+        entry.modificationTime = modificationTime;
+        entry.valid = valid;
+        entry.instrument = parsed;
+        indexChanged = true;
+    }
+    
+    if (valid)
+        outInstrument = std::move(parsed);
+    return valid;
+}
+
+void ExpansionInstrumentLoader::loadIndex()
+{
+    const juce::ScopedLock sl(indexLock);
+    
+    if (indexLoaded)
+        return;
+    indexLoaded = true;
+    
+    if (!indexFile.existsAsFile())
+        return;
+    
+    juce::var root = juce::JSON::parse(indexFile.loadFileAsString());
+    auto* obj = root.getDynamicObject();
+    
+    // Unknown layout: start over, the next save replaces it
+    if (obj == nullptr || (int)obj->getProperty("version") != indexVersion)
+        return;
+    
+    if (auto* entries = obj->getProperty("entries").getArray())
+    {
+        for (const auto& item : *entries)
+        {
+            auto* entryObj = item.getDynamicObject();
+            if (entryObj == nullptr)
+                continue;
+            
+            IndexEntry entry;
+            entry.size = (juce::int64)entryObj->getProperty("size");
+            entry.modificationTime = (juce::int64)entryObj->getProperty("modified");
+            entry.valid = (bool)entryObj->getProperty("valid");
+            if (entry.valid)
+                entry.instrument = InstrumentDefinition::fromVar(entryObj->getProperty("instrument"));
+            
+            index[entryObj->getProperty("path").toString()] = std::move(entry);
+        }
+    }
+    
+    DBG("ExpansionInstrumentLoader: Index has " << (int)index.size() << " XPM files");
+}
+
+void ExpansionInstrumentLoader::saveIndexIfChanged()
+{
+    const juce::ScopedLock sl(indexLock);
+    
+    if (!indexChanged || indexFile == juce::File())
+        return;
+    indexChanged = false;
+    
+    juce::Array<juce::var> entries;
+    for (const auto& [path, entry] : index)
+    {
+        // Forget XPMs that were deleted since they were indexed
+        if (!juce::File(path).existsAsFile())
+            continue;
+        
+        auto* entryObj = new juce::DynamicObject();
+        entryObj->setProperty("path", path);
+        entryObj->setProperty("size", entry.size);
+        entryObj->setProperty("modified", entry.modificationTime);
+        entryObj->setProperty("valid", entry.valid);
+        if (entry.valid)
+            entryObj->setProperty("instrument", entry.instrument.toVar());
+        entries.add(juce::var(entryObj));
+    }
+    
+    auto* obj = new juce::DynamicObject();
+    obj->setProperty("version", indexVersion);
+    obj->setProperty("entries", entries);
+    
+    // Ensure directory exists
+    indexFile.getParentDirectory().createDirectory();
+    indexFile.replaceWithText(juce::JSON::toString(juce::var(obj), true));
+}
+
 //==============================================================================
 // Catalog Access
 //==============================================================================
@@ -184,7 +382,7 @@ ExpansionInstrumentLoader::getInstrumentsByCategory() const
         {
             for (const auto& inst : instruments)
             {
-                result[category].push_back(&instrumentLookup.at(inst.id));
+                result[category].push_back(&inst);
             }
         }
     }
@@ -195,7 +393,7 @@ ExpansionInstrumentLoader::getInstrumentsByCategory() const
 const InstrumentDefinition* ExpansionInstrumentLoader::getInstrument(const juce::String& instrumentId) const
 {
     auto it = instrumentLookup.find(instrumentId);
-    return it != instrumentLookup.end() ? &it->second : nullptr;
+    return it != instrumentLookup.end() ? it->second : nullptr;
 }
 
 std::vector<const InstrumentDefinition*> 
@@ -210,7 +408,7 @@ ExpansionInstrumentLoader::getInstrumentsInCategory(const juce::String& category
         {
             for (const auto& inst : it->second)
             {
-                result.push_back(&instrumentLookup.at(inst.id));
+                result.push_back(&inst);
             }
         }
     }
@@ -263,7 +461,7 @@ int ExpansionInstrumentLoader::getTotalInstrumentCount() const
 // XPM Parsing
 //==============================================================================
 
-bool ExpansionInstrumentLoader::parseXpmFile(const juce::File& xpmFile, InstrumentDefinition& outInstrument)
+bool ExpansionInstrumentLoader::parseXpmFile(const juce::File& xpmFile, InstrumentDefinition& outInstrument) const
 {
     // Parse XML structure of XPM file
     auto xml = juce::XmlDocument::parse(xpmFile);
@@ -46,6 +46,40 @@ struct SampleZone
         return midiNote >= lowNote && midiNote <= highNote &&
                velocity >= lowVelocity && velocity <= highVelocity;
     }
+    
+    // Serialization (scan index)
+    juce::var toVar() const
+    {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("sampleName", sampleName);
+        obj->setProperty("sampleFile", sampleFile.getFullPathName());
+        obj->setProperty("rootNote", rootNote);
+        obj->setProperty("lowNote", lowNote);
+        obj->setProperty("highNote", highNote);
+        obj->setProperty("lowVelocity", lowVelocity);
+        obj->setProperty("highVelocity", highVelocity);
+        obj->setProperty("volume", volume);
+        obj->setProperty("pan", pan);
+        return juce::var(obj);
+    }
+    
+    static SampleZone fromVar(const juce::var& v)
+    {
+        SampleZone zone;
+        if (auto* obj = v.getDynamicObject())
+        {
+            zone.sampleName = obj->getProperty("sampleName").toString();
+            zone.sampleFile = juce::File(obj->getProperty("sampleFile").toString());
+            zone.rootNote = (int)obj->getProperty("rootNote");
+            zone.lowNote = (int)obj->getProperty("lowNote");
+            zone.highNote = (int)obj->getProperty("highNote");
+            zone.lowVelocity = (int)obj->getProperty("lowVelocity");
+            zone.highVelocity = (int)obj->getProperty("highVelocity");
+            zone.volume = (float)obj->getProperty("volume");
+            zone.pan = (float)obj->getProperty("pan");
+        }
+        return zone;
+    }
 };
 
 //==============================================================================
@@ -73,6 +107,57 @@ struct InstrumentDefinition
     float decay = 0.05f;
     float sustain = 1.0f;
     float release = 0.1f;
+    
+    // Serialization (scan index) - the fields parsed from the XPM; the expansion ones are set on scan
+    juce::var toVar() const
+    {
+        auto* obj = new juce::DynamicObject();
+        obj->setProperty("id", id);
+        obj->setProperty("name", name);
+        obj->setProperty("category", category);
+        obj->setProperty("xpmFile", xpmFile.getFullPathName());
+        obj->setProperty("isChromatic", isChromatic);
+        obj->setProperty("isMono", isMono);
+        obj->setProperty("polyphony", polyphony);
+        obj->setProperty("attack", attack);
+        obj->setProperty("decay", decay);
+        obj->setProperty("sustain", sustain);
+        obj->setProperty("release", release);
+        
+        juce::Array<juce::var> zoneArray;
+        for (const auto& zone : zones)
+            zoneArray.add(zone.toVar());
+        obj->setProperty("zones", zoneArray);
+        
+        return juce::var(obj);
+    }
+    
+    static InstrumentDefinition fromVar(const juce::var& v)
+    {
+        InstrumentDefinition instrument;
+        if (auto* obj = v.getDynamicObject())
+        {
+            instrument.id = obj->getProperty("id").toString();
+            instrument.name = obj->getProperty("name").toString();
+            instrument.category = obj->getProperty("category").toString();
+            instrument.xpmFile = juce::File(obj->getProperty("xpmFile").toString());
+            instrument.isChromatic = (bool)obj->getProperty("isChromatic");
+            instrument.isMono = (bool)obj->getProperty("isMono");
+            instrument.polyphony = (int)obj->getProperty("polyphony");
+            instrument.attack = (float)obj->getProperty("attack");
+            instrument.decay = (float)obj->getProperty("decay");
+            instrument.sustain = (float)obj->getProperty("sustain");
+            instrument.release = (float)obj->getProperty("release");
+            
+            if (auto* zoneArray = obj->getProperty("zones").getArray())
+            {
+                instrument.zones.reserve((size_t)zoneArray->size());
+                for (const auto& zone : *zoneArray)
+                    instrument.zones.push_back(SampleZone::fromVar(zone));
+            }
+        }
+        return instrument;
+    }
 };
 
 //==============================================================================
@@ -115,12 +200,20 @@ public:
     /** Scan a single expansion folder and add to catalog. */
     bool scanExpansion(const juce::File& expansionFolder);
     
-    /** Scan all expansions in a parent directory. */
+    /** Scan all expansions in a parent directory, in parallel. */
     int scanExpansionsDirectory(const juce::File& expansionsDir);
     
     /** Clear all loaded expansions. */
     void clear();
     
+    /** File that remembers parsed XPMs between runs (keyed by path, size and
+        modification time), so unchanged ones are never parsed again.
+        An empty File disables the index. Call before scanning. */
+    void setIndexFile(const juce::File& file);
+    
+    /** Default index location in the user's application data folder. */
+    static juce::File getDefaultIndexFile();
+    
     //==========================================================================
     // Catalog Access
     //==========================================================================
@@ -151,16 +244,50 @@ private:
     // XPM Parsing
     //==========================================================================
     
-    bool parseXpmFile(const juce::File& xpmFile, InstrumentDefinition& outInstrument);
+    bool parseXpmFile(const juce::File& xpmFile, InstrumentDefinition& outInstrument) const;
     juce::String categorizeInstrument(const juce::String& filename) const;
     juce::String sanitizeId(const juce::String& name) const;
     
+    //==========================================================================
+    // Scanning internals
+    //==========================================================================
+    
+    /** Scan one expansion folder without touching the catalog. Safe to call from several threads. */
+    bool buildExpansion(const juce::File& expansionFolder, ExpansionDefinition& outExpansion);
+    
+    /** Add a scanned expansion to the catalog and repoint the lookup table. */
+    void addExpansion(ExpansionDefinition&& expansion);
+    void rebuildLookup();
+    
+    /** parseXpmFile() through the index: a hit returns the stored result without reading the file. */
+    bool parseXpmCached(const juce::File& xpmFile, InstrumentDefinition& outInstrument);
+    
+    void loadIndex();
+    void saveIndexIfChanged();
+    
     //==========================================================================
     // Members
     //==========================================================================
     
     std::map<juce::String, ExpansionDefinition> expansions;
-    std::map<juce::String, InstrumentDefinition> instrumentLookup; // Quick lookup by ID
+    std::map<juce::String, const InstrumentDefinition*> instrumentLookup; // Quick lookup by ID, into expansions
+    
+    /** One parsed XPM in the scan index. */
+    struct IndexEntry
+    {
+        juce::int64 size = 0;
+        juce::int64 modificationTime = 0;
+        bool valid = false;                 // Failed parses are remembered too
+        InstrumentDefinition instrument;
+    };
+    
+    juce::File indexFile;
+    std::map<juce::String, IndexEntry> index;   // By XPM path
+    bool indexLoaded = false;
+    bool indexChanged = false;
+    juce::CriticalSection indexLock;
+    
+    static constexpr int indexVersion = 1;
     
     // Category detection patterns
     struct CategoryPattern
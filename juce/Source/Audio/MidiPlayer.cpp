@@ -10,6 +10,9 @@
 
 #include "MidiPlayer.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace mmg
 {
 
@@ -30,20 +33,15 @@ void MidiPlayer::resetBankSelectState()
     }
 }
 
-void MidiPlayer::applyBankSelectMessage(const juce::MidiMessage& msg)
+void MidiPlayer::applyBankSelect(int channelIndex, int controller, int value)
 {
-    if (!msg.isController())
-        return;
-
-    const int controller = msg.getControllerNumber();
     if (controller != 0 && controller != 32)
         return;
 
-    const int channelIndex = msg.getChannel() - 1;
     if (channelIndex < 0 || channelIndex >= numMidiChannels)
         return;
 
-    const int value = juce::jlimit(0, 127, msg.getControllerValue());
+    value = juce::jlimit(0, 127, value);
     if (controller == 0)
         bankSelectMsb[(size_t)channelIndex].store(value);
     else
@@ -62,17 +60,91 @@ int MidiPlayer::getEffectiveBankForChannelIndex(int channelIndex) const
 
 void MidiPlayer::rebuildBankSelectStateUpToEventIndex(int eventIndex)
 {
-    resetBankSelectState();
+    const int clampedIndex = juce::jlimit(0, (int)events.size(), eventIndex);
 
-    const int clampedIndex = juce::jlimit(0, combinedSequence.getNumEvents(), eventIndex);
-    for (int i = 0; i < clampedIndex; ++i)
+    // Start from the nearest checkpoint at or before the target instead of time zero
+    const int checkpoint = juce::jmin(clampedIndex / checkpointInterval, (int)bankCheckpoints.size() - 1);
+    int firstEvent = 0;
+
+    if (checkpoint >= 0)
+    {
+        const auto& state = bankCheckpoints[(size_t)checkpoint];
+        for (int ch = 0; ch < numMidiChannels; ++ch)
+        {
+            bankSelectMsb[(size_t)ch].store(state.msb[(size_t)ch]);
+            bankSelectLsb[(size_t)ch].store(state.lsb[(size_t)ch]);
+        }
+        firstEvent = checkpoint * checkpointInterval;
+    }
+    else
+    {
+        resetBankSelectState();
+    }
+
+    for (int i = firstEvent; i < clampedIndex; ++i)
+    {
+        const auto& event = events[(size_t)i];
+        if (event.type == ScheduledEvent::Type::Controller)
+            applyBankSelect(event.channel, event.data1, event.data2);
+    }
+}
+
+//==============================================================================
+void MidiPlayer::compileEventStream()
+{
+    const int numSourceEvents = combinedSequence.getNumEvents();
+
+    events.clear();
+    events.reserve((size_t)numSourceEvents);
+    bankCheckpoints.clear();
+
+    for (int i = 0; i < numSourceEvents; ++i)
     {
         const auto& msg = combinedSequence.getEventPointer(i)->message;
-        if (msg.isMetaEvent())
+
+        // Only channel messages are played; meta events and SysEx have no consumer
+        if (msg.isMetaEvent() || msg.isSysEx() || msg.getRawDataSize() < 2)
+            continue;
+
+        const auto* raw = msg.getRawData();
+
+        ScheduledEvent event;
+        event.samplePosition = (juce::int64)std::llround(msg.getTimeStamp() * sampleRate);
+        event.channel = (juce::uint8)juce::jlimit(0, 15, msg.getChannel() - 1);
+        event.status = raw[0];
+        event.data1 = raw[1];
+        event.data2 = msg.getRawDataSize() > 2 ? raw[2] : (juce::uint8)0;
+
+        if (msg.isNoteOn())
+            event.type = ScheduledEvent::Type::NoteOn;
+        else if (msg.isNoteOff())
+            event.type = ScheduledEvent::Type::NoteOff;
+        else if (msg.isProgramChange())
+            event.type = ScheduledEvent::Type::ProgramChange;
+        else if (msg.isController())
+            event.type = ScheduledEvent::Type::Controller;
+
+        events.push_back(event);
+    }
+
+    // Snapshot bank select state every checkpointInterval events for setPosition
+    bankCheckpoints.reserve(events.size() / (size_t)checkpointInterval + 1);
+
+    BankSelectCheckpoint state;
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (i % (size_t)checkpointInterval == 0)
+            bankCheckpoints.push_back(state);
+
+        const auto& event = events[i];
+        if (event.type != ScheduledEvent::Type::Controller)
             continue;
 
-        if (msg.isController())
-            applyBankSelectMessage(msg);
+        const auto value = (juce::uint8)juce::jmin(127, (int)event.data2);
+        if (event.data1 == 0)
+            state.msb[event.channel] = value;
+        else if (event.data1 == 32)
+            state.lsb[event.channel] = value;
     }
 }
 
@@ -98,9 +170,21 @@ void MidiPlayer::setupSynthesiser()
 //==============================================================================
 void MidiPlayer::prepareToPlay(double newSampleRate, int newSamplesPerBlock)
 {
+    const bool rateChanged = newSampleRate != sampleRate;
+    
     sampleRate = newSampleRate;
     samplesPerBlock = newSamplesPerBlock;
     
+    // Room for a dense block of events, so renderNextBlock never grows it
+    synthMidi.ensureSize(4096);
+    
+    // Event positions are in samples, so they have to follow the rate
+    if (rateChanged && midiLoaded)
+    {
+        compileEventStream();
+        playheadSamples = currentPositionSeconds * sampleRate;
+    }
+    
     synth.setCurrentPlaybackSampleRate(sampleRate);
     
     // Prepare each voice
@@ -144,6 +228,8 @@ bool MidiPlayer::loadMidiFile(const juce::File& file)
         return false;
     }
     
+    sourceMidiFile = midiFile;
+    
     // Convert timestamps to seconds
     midiFile.convertTimestampTicksToSeconds();
     
@@ -160,12 +246,14 @@ bool MidiPlayer::loadMidiFile(const juce::File& file)
     
     // Sort by timestamp
     combinedSequence.sort();
+    compileEventStream();
     
     // Update state
     loadedFile = file;
     midiLoaded = true;
     currentEventIndex = 0;
     currentPositionSeconds = 0.0;
+    playheadSamples = 0.0;
     resetBankSelectState();
     
     // Extract metadata (tempo, time signature, etc.)
@@ -227,6 +315,7 @@ bool MidiPlayer::loadMidiFile(const juce::File& file)
 void MidiPlayer::setMidiData(const juce::MidiFile& midi)
 {
     midiFile = midi;
+    sourceMidiFile = midi;
     
     // Convert timestamps to seconds
     midiFile.convertTimestampTicksToSeconds();
@@ -244,12 +333,14 @@ void MidiPlayer::setMidiData(const juce::MidiFile& midi)
     
     // Sort by timestamp
     combinedSequence.sort();
+    compileEventStream();
     
     // Update state
     loadedFile = juce::File(); // Clear file path as it's memory-based
     midiLoaded = true;
     currentEventIndex = 0;
     currentPositionSeconds = 0.0;
+    playheadSamples = 0.0;
     resetBankSelectState();
     
     // Extract metadata (tempo, time signature, etc.)
@@ -301,10 +392,14 @@ void MidiPlayer::clearMidiFile()
     playing = false;
     midiLoaded = false;
     combinedSequence.clear();
+    events.clear();
+    bankCheckpoints.clear();
     midiFile.clear();
+    sourceMidiFile.clear();
     loadedFile = juce::File();
     currentEventIndex = 0;
     currentPositionSeconds = 0.0;
+    playheadSamples = 0.0;
     totalDurationSeconds = 0.0;
     resetBankSelectState();
     
@@ -369,20 +464,18 @@ void MidiPlayer::setPosition(double positionInSeconds)
     // Clamp to valid range
     currentPositionSeconds = juce::jlimit(0.0, totalDurationSeconds, positionInSeconds);
     
-    // Find the event index for this position
-    currentEventIndex = 0;
-    for (int i = 0; i < combinedSequence.getNumEvents(); ++i)
-    {
-        if (combinedSequence.getEventPointer(i)->message.getTimeStamp() >= currentPositionSeconds)
-        {
-            currentEventIndex = i;
-            break;
-        }
-        currentEventIndex = i + 1;
-    }
+    playheadSamples = currentPositionSeconds * sampleRate;
+    
+    // First event at or after the new position (binary search over the event stream)
+    const auto firstEvent = std::lower_bound(events.begin(), events.end(), playheadSamples,
+                                             [](const ScheduledEvent& event, double position)
+                                             {
+                                                 return (double)event.samplePosition < position;
+                                             });
+    currentEventIndex = (int)std::distance(events.begin(), firstEvent);
 
     // Bank-select state should never be reused from a prior playback position.
-    // Conservatively rebuild bank state from the start of the file up to the seek point.
+    // Restore it from the nearest checkpoint, then replay up to the seek point.
     rebuildBankSelectStateUpToEventIndex(currentEventIndex);
     
     // Turn off all notes when seeking
@@ -402,74 +495,69 @@ void MidiPlayer::renderNextBlock(juce::AudioBuffer<float>& buffer, int numSample
     if (shouldRenderSynth)
         buffer.clear();
     
-    // Calculate time advance for this block
-    double blockDurationSeconds = numSamples / sampleRate;
-    double endPositionSeconds = currentPositionSeconds + (blockDurationSeconds * tempoMultiplier);
+    // This block covers [blockStart, blockEnd) of the event timeline;
+    // tempoMultiplier scales how much of the timeline one output sample covers
+    const double blockStart = playheadSamples;
+    const double blockEnd = blockStart + numSamples * tempoMultiplier;
     
-    // Create MIDI buffer for events in this time range (only needed if we're rendering the internal synth)
-    juce::MidiBuffer midiBuffer;
+    synthMidi.clear();
     int eventsAdded = 0;
     
-    while (currentEventIndex < combinedSequence.getNumEvents())
+    while (currentEventIndex < (int)events.size())
     {
-        auto* eventPtr = combinedSequence.getEventPointer(currentEventIndex);
-        double eventTime = eventPtr->message.getTimeStamp();
+        const auto& event = events[(size_t)currentEventIndex];
         
-        // Check if event is within this block's time range
-        if (eventTime >= endPositionSeconds)
+        if ((double)event.samplePosition >= blockEnd)
             break;
         
-        // Calculate sample offset within this block
-        double offsetSeconds = eventTime - currentPositionSeconds;
-        int sampleOffset = juce::jmax(0, static_cast<int>(offsetSeconds * sampleRate / tempoMultiplier));
-        sampleOffset = juce::jmin(sampleOffset, numSamples - 1);
+        // Exact output sample of the event within this block
+        const int sampleOffset = juce::jlimit(0, numSamples - 1,
+                                              (int)(((double)event.samplePosition - blockStart) / tempoMultiplier));
+        const int trackIndex = event.channel;   // Channel 1-16 maps to track index 0-15
         
-        // Process MIDI message (skip meta events)
-        if (!eventPtr->message.isMetaEvent())
+        switch (event.type)
         {
-            const auto& msg = eventPtr->message;
-
-            // Bounded Bank Select support for SF2 preset switching.
-            // Track only CC0 (MSB) and CC32 (LSB) per MIDI channel.
-            if (msg.isController())
-                applyBankSelectMessage(msg);
-            
-            // Route note events to external instruments (Track SamplerInstruments)
-            if (midiListener)
-            {
-                if (msg.isNoteOn())
-                {
-                    // Channel 1-16 maps to track index 0-15
-                    int trackIndex = msg.getChannel() - 1;
-                    float velocity = msg.getVelocity() / 127.0f;
-                    midiListener->midiNoteOn(trackIndex, msg.getNoteNumber(), velocity);
-                }
-                else if (msg.isNoteOff())
-                {
-                    int trackIndex = msg.getChannel() - 1;
-                    midiListener->midiNoteOff(trackIndex, msg.getNoteNumber());
-                }
-                else if (msg.isProgramChange())
-                {
-                    int trackIndex = msg.getChannel() - 1;
-                    const int bank = getEffectiveBankForChannelIndex(trackIndex);
-                    midiListener->midiProgramChange(trackIndex, msg.getProgramChangeNumber(), bank);
-                }
-            }
-            
-            // Also feed to internal synth (fallback sine waves for unmapped instruments)
-            if (shouldRenderSynth)
-                midiBuffer.addEvent(msg, sampleOffset);
-            eventsAdded++;
+            case ScheduledEvent::Type::NoteOn:
+                if (midiListener)
+                    midiListener->midiNoteOn(trackIndex, event.data1, event.data2 / 127.0f, sampleOffset);
+                break;
+                
+            case ScheduledEvent::Type::NoteOff:
+                if (midiListener)
+                    midiListener->midiNoteOff(trackIndex, event.data1, sampleOffset);
+                break;
+                
+            case ScheduledEvent::Type::ProgramChange:
+                if (midiListener)
+                    midiListener->midiProgramChange(trackIndex, event.data1, getEffectiveBankForChannelIndex(trackIndex));
+                break;
+                
+            case ScheduledEvent::Type::Controller:
+                // Bounded Bank Select support for SF2 preset switching.
+                // Track only CC0 (MSB) and CC32 (LSB) per MIDI channel.
+                applyBankSelect(trackIndex, event.data1, event.data2);
+                break;
+                
+            case ScheduledEvent::Type::Other:
+            default:
+                break;
+        }
+        
+        // Also feed to internal synth (fallback sine waves for unmapped instruments)
+        if (shouldRenderSynth)
+        {
+            const juce::uint8 raw[] = { event.status, event.data1, event.data2 };
+            synthMidi.addEvent(raw, juce::MidiMessage::getMessageLengthFromFirstByte(event.status), sampleOffset);
         }
         
+        ++eventsAdded;
         ++currentEventIndex;
     }
     
     // Render internal synth with MIDI events (sine wave fallback)
     // If disabled, AudioEngine tracks provide all audio.
     if (shouldRenderSynth)
-        synth.renderNextBlock(buffer, midiBuffer, 0, numSamples);
+        synth.renderNextBlock(buffer, synthMidi, 0, numSamples);
     
     // Track max output level for debug status
     float maxSample = 0.0f;
@@ -482,13 +570,15 @@ void MidiPlayer::renderNextBlock(juce::AudioBuffer<float>& buffer, int numSample
     lastEventsInBlock.store(eventsAdded);
     
     // Update position
-    currentPositionSeconds = endPositionSeconds;
+    playheadSamples = blockEnd;
+    currentPositionSeconds = playheadSamples / sampleRate;
     
     // Check for end of file
     if (currentPositionSeconds >= totalDurationSeconds)
     {
         playing = false;
         currentPositionSeconds = 0.0;
+        playheadSamples = 0.0;
         currentEventIndex = 0;
         resetBankSelectState();
         synth.allNotesOff(0, true);
@@ -11,6 +11,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
@@ -31,15 +32,17 @@ public:
     virtual ~MidiPlayerListener() = default;
     
     /** Called when a note-on event should trigger.
-        @param channel  0-based track index (derived from MIDI channel - 1)
-        @param note     MIDI note number (0-127)
-        @param velocity Note velocity (0.0-1.0) */
-    virtual void midiNoteOn(int channel, int note, float velocity) = 0;
+        @param channel      0-based track index (derived from MIDI channel - 1)
+        @param note         MIDI note number (0-127)
+        @param velocity     Note velocity (0.0-1.0)
+        @param sampleOffset Exact position of the event within the block being rendered */
+    virtual void midiNoteOn(int channel, int note, float velocity, int sampleOffset) = 0;
     
     /** Called when a note-off event should trigger.
-        @param channel  0-based track index (derived from MIDI channel - 1)
-        @param note     MIDI note number (0-127) */
-    virtual void midiNoteOff(int channel, int note) = 0;
+        @param channel      0-based track index (derived from MIDI channel - 1)
+        @param note         MIDI note number (0-127)
+        @param sampleOffset Exact position of the event within the block being rendered */
+    virtual void midiNoteOff(int channel, int note, int sampleOffset) = 0;
 
     /** Called when a playback-time program-change event occurs.
         @param channel  0-based track index (derived from MIDI channel - 1)
@@ -105,6 +108,10 @@ public:
     /** Get the file that was loaded */
     juce::File getLoadedFile() const { return loadedFile; }
     
+    /** The MIDI data as loaded, before timestamps were converted to seconds.
+        Feed this to another player's setMidiData() to get an identical copy. */
+    const juce::MidiFile& getSourceMidiData() const { return sourceMidiFile; }
+    
     //==========================================================================
     // Playback Control
     //==========================================================================
@@ -132,7 +139,8 @@ public:
     //==========================================================================
     
     /** Render audio for the next block.
-        Call this from your audio callback. */
+        Call this from your audio callback. Events are dispatched to the listener
+        in order, each with its sample offset inside this block; nothing is allocated. */
     void renderNextBlock(juce::AudioBuffer<float>& buffer, int numSamples);
     
     //==========================================================================
@@ -189,9 +197,13 @@ private:
 
     void resetBankSelectState();
     void rebuildBankSelectStateUpToEventIndex(int eventIndex);
-    void applyBankSelectMessage(const juce::MidiMessage& msg);
+    void applyBankSelect(int channelIndex, int controller, int value);
     int getEffectiveBankForChannelIndex(int channelIndex) const;
     
+    /** Flatten combinedSequence into 'events' at the current sample rate and
+        rebuild the bank select checkpoints. Message thread only. */
+    void compileEventStream();
+    
     //==========================================================================
     // Members
     //==========================================================================
@@ -201,6 +213,7 @@ private:
     
     // MIDI data
     juce::MidiFile midiFile;
+    juce::MidiFile sourceMidiFile;              // Unconverted copy (ticks), for cloning
     juce::MidiMessageSequence combinedSequence; // All tracks merged
     juce::File loadedFile;
     bool midiLoaded { false };
@@ -208,7 +221,8 @@ private:
     // Playback state
     std::atomic<bool> playing { false };
     double currentPositionSeconds { 0.0 };
-    int currentEventIndex { 0 };
+    double playheadSamples { 0.0 };             // Same position on the sample timeline
+    int currentEventIndex { 0 };                // Next entry of 'events' to dispatch
     double totalDurationSeconds { 0.0 };
     
     // Audio settings
@@ -239,6 +253,38 @@ private:
     static constexpr int numMidiChannels { 16 };
     std::array<std::atomic<int>, numMidiChannels> bankSelectMsb;
     std::array<std::atomic<int>, numMidiChannels> bankSelectLsb;
+
+    // Precompiled event stream: every channel message of combinedSequence, sorted,
+    // with its position in samples (tempo map applied). Rebuilt on load and on
+    // sample-rate changes; read-only on the audio thread.
+    struct ScheduledEvent
+    {
+        enum class Type : juce::uint8 { NoteOn, NoteOff, ProgramChange, Controller, Other };
+        
+        juce::int64 samplePosition = 0;
+        Type type = Type::Other;
+        juce::uint8 channel = 0;                // 0-based
+        juce::uint8 status = 0;                 // Raw bytes, for the internal synth
+        juce::uint8 data1 = 0;
+        juce::uint8 data2 = 0;
+    };
+    
+    std::vector<ScheduledEvent> events;
+    
+    // Internal synth input, sized in prepareToPlay and reused every block
+    juce::MidiBuffer synthMidi;
+    
+    // Seek index: bankCheckpoints[k] is the bank select state just before
+    // events[k * checkpointInterval], so a seek (binary search over the sample
+    // positions) replays at most checkpointInterval - 1 events.
+    struct BankSelectCheckpoint
+    {
+        std::array<juce::uint8, numMidiChannels> msb {};
+        std::array<juce::uint8, numMidiChannels> lsb {};
+    };
+    
+    static constexpr int checkpointInterval { 256 };
+    std::vector<BankSelectCheckpoint> bankCheckpoints;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MidiPlayer)
 };
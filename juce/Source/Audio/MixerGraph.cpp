@@ -1,122 +1,620 @@
 #include "MixerGraph.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace Audio
 {
+    namespace
+    {
+        constexpr int mixChannels = 2;
+
+        /** Run a unit over the block in segments that end at its lanes' breakpoints,
+            ramping each automated parameter linearly across a segment. */
+        void processAutomated(const FXNodeInfo& node, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi,
+                              double time, double sampleRate)
+        {
+            const int numSamples = buffer.getNumSamples();
+
+            for (int done = 0; done < numSamples;)
+            {
+                const double segmentStart = time + done / sampleRate;
+                int segmentLength = numSamples - done;
+
+                for (const auto& lane : node.automation)
+                {
+                    const double nextPoint = lane.getNextPointTime(segmentStart);
+                    if (nextPoint >= 0.0)
+                        segmentLength = juce::jmin(segmentLength,
+                                                   juce::jmax(1, (int)std::ceil((nextPoint - segmentStart) * sampleRate)));
+                }
+
+                const double segmentEnd = segmentStart + segmentLength / sampleRate;
+
+                for (const auto& lane : node.automation)
+                    node.processor->getProcessorParameter(lane.parameterIndex)
+                        .automate(lane.getValueAt(segmentStart), lane.getValueAt(segmentEnd), segmentLength);
+
+                juce::AudioBuffer<float> segment(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), done, segmentLength);
+                node.processor->processBlock(segment, midi);
+
+                done += segmentLength;
+            }
+        }
+
+        /** time is the song position of the buffer's first sample, negative while stopped. */
+        void processChain(const std::vector<FXNodeInfo>& chain, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi,
+                          double time, double sampleRate)
+        {
+            for (const auto& node : chain)
+            {
+                if (!node.enabled)
+                    continue;
+
+                if (node.automation.empty() || time < 0.0 || sampleRate <= 0.0)
+                    node.processor->processBlock(buffer, midi);
+                else
+                    processAutomated(node, buffer, midi, time, sampleRate);
+            }
+        }
+    }
+
+    //==============================================================================
+    // Automation lanes
+
+    float AutomationLane::getValueAt(double time) const noexcept
+    {
+        if (points.empty())
+            return 0.0f;
+
+        auto next = std::upper_bound(points.begin(), points.end(), time,
+                                     [](double t, const Point& point) { return t < point.time; });
+
+        if (next == points.begin())
+            return points.front().value;
+        if (next == points.end())
+            return points.back().value;
+
+        const auto& previous = *(next - 1);
+        const double proportion = (time - previous.time) / (next->time - previous.time);
+        return previous.value + (float)proportion * (next->value - previous.value);
+    }
+
+    double AutomationLane::getNextPointTime(double time) const noexcept
+    {
+        auto next = std::upper_bound(points.begin(), points.end(), time,
+                                     [](double t, const Point& point) { return t < point.time; });
+
+        return next != points.end() ? next->time : -1.0;
+    }
+
     MixerGraph::MixerGraph()
         : AudioProcessor(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true)
                                           .withOutput("Output", juce::AudioChannelSet::stereo(), true))
     {
-        mainGraph = std::make_unique<juce::AudioProcessorGraph>();
-        initializeGraph();
+        masterGain = std::make_shared<GainProcessor>();
+
+        // +3dB on the master makes up for the -3dB centre of the constant-power pan
+        // law on every track strip, so a centred track plays at its fader level
+        masterGain->setGainDecibels(3.0f);
+
+        const juce::ScopedLock sl(configLock);
+        publishPlan();
+
+        DBG("MixerGraph: Initialized with Strips -> Buses -> Master FX -> MasterGain (+3dB)");
     }
 
     MixerGraph::~MixerGraph()
     {
-        mainGraph = nullptr;
+        livePlan.store(nullptr);
     }
 
-    void MixerGraph::initializeGraph()
+    void MixerGraph::prepareToPlay(double sampleRate, int samplesPerBlock)
     {
-        mainGraph->clear();
-        fxChains.clear();
+        const juce::ScopedLock sl(configLock);
+
+        setRateAndBufferSizeDetails(sampleRate, samplesPerBlock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize.store(samplesPerBlock);
+
+        prepareProcessor(*masterGain);
+
+        for (auto& strip : trackStrips)
+        {
+            prepareProcessor(*strip.pan);
+            prepareProcessor(*strip.width);
+        }
 
-        // Create IO nodes
-        audioInputNodeID = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::audioInputNode))->nodeID;
-        audioOutputNodeID = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::audioOutputNode))->nodeID;
-        midiInputNodeID = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::midiInputNode))->nodeID;
-        midiOutputNodeID = mainGraph->addNode(std::make_unique<juce::AudioProcessorGraph::AudioGraphIOProcessor>(juce::AudioProcessorGraph::AudioGraphIOProcessor::midiOutputNode))->nodeID;
-
-        // Create Master Bus
-        auto masterGain = std::make_unique<GainProcessor>();
-        masterGainNodeID = mainGraph->addNode(std::move(masterGain))->nodeID;
-        
-        // Apply default master volume boost (+9dB) to compensate for quiet samples
-        if (auto* node = mainGraph->getNodeForId(masterGainNodeID))
+        for (auto& [bus, chain] : fxChains)
+            for (auto& fxInfo : chain)
+                prepareProcessor(*fxInfo.processor);
+
+        // Compensation delays start empty, like the freshly prepared processors
+        busCompensation.clear();
+        directCompensation = nullptr;
+
+        // Reallocate scratch buffers for the new block size
+        publishPlan();
+    }
+
+    void MixerGraph::releaseResources()
+    {
+        const juce::ScopedLock sl(configLock);
+
+        masterGain->releaseResources();
+
+        for (auto& strip : trackStrips)
         {
-            if (auto* gainProc = dynamic_cast<GainProcessor*>(node->getProcessor()))
+            strip.pan->releaseResources();
+            strip.width->releaseResources();
+        }
+
+        for (auto& [bus, chain] : fxChains)
+            for (auto& fxInfo : chain)
+                fxInfo.processor->releaseResources();
+    }
+
+    void MixerGraph::prepareProcessor(juce::AudioProcessor& processor)
+    {
+        if (preparedSampleRate <= 0.0)
+            return;
+
+        const int blockSize = preparedBlockSize.load();
+        processor.setNonRealtime(isNonRealtime());   // Offline renders pick their quality settings
+        processor.setRateAndBufferSizeDetails(preparedSampleRate, blockSize);
+        processor.prepareToPlay(preparedSampleRate, blockSize);
+    }
+
+    //==============================================================================
+    // Audio thread
+
+    void MixerGraph::beginBlock(int numSamples, double timelineSeconds) noexcept
+    {
+        renderPlan = acquirePlan();
+
+        if (renderPlan == nullptr)
+            return;
+
+        jassert(numSamples <= renderPlan->blockSize);
+        renderPlan->trackSamples = juce::jlimit(0, renderPlan->blockSize, numSamples);
+        renderPlan->blockTime = timelineSeconds;
+
+        for (auto& strip : renderPlan->strips)
+            strip.input.clear(0, renderPlan->trackSamples);
+    }
+
+    juce::AudioBuffer<float>* MixerGraph::getTrackInput(int trackIndex) noexcept
+    {
+        if (renderPlan == nullptr || renderPlan->trackSamples <= 0)
+            return nullptr;
+
+        if (trackIndex < 0 || trackIndex >= (int)renderPlan->strips.size())
+            return nullptr;
+
+        return &renderPlan->strips[(size_t)trackIndex].input;
+    }
+
+    int MixerGraph::getNumTrackInputs() const noexcept
+    {
+        return renderPlan != nullptr ? (int)renderPlan->strips.size() : 0;
+    }
+
+    void MixerGraph::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+    {
+        // Called without beginBlock(): master input only
+        if (renderPlan == nullptr)
+        {
+            renderPlan = acquirePlan();
+            if (renderPlan != nullptr)
             {
-                gainProc->setGainDecibels(9.0f);
-                DBG("MixerGraph: Master gain set to +9dB");
+                renderPlan->trackSamples = 0;
+                renderPlan->blockTime = -1.0;
             }
         }
 
-        // Connect Input -> Master Gain -> Output (direct passthrough by default)
-        for (int channel = 0; channel < 2; ++channel)
+        if (renderPlan != nullptr && renderPlan->blockSize > 0 && buffer.getNumChannels() > 0)
         {
-            // Input to Master Gain (THIS WAS MISSING!)
-            mainGraph->addConnection({ { audioInputNodeID, channel }, { masterGainNodeID, channel } });
-            // Master Gain to Output
-            mainGraph->addConnection({ { masterGainNodeID, channel }, { audioOutputNodeID, channel } });
+            const int numSamples = buffer.getNumSamples();
+
+            for (int done = 0; done < numSamples;)
+            {
+                const int chunkSize = juce::jmin(renderPlan->blockSize, numSamples - done);
+                renderChunk(*renderPlan, buffer, done, chunkSize, midiMessages);
+                done += chunkSize;
+            }
         }
-        
-        DBG("MixerGraph: Initialized with Input -> MasterGain -> Output routing (+9dB boost)");
+
+        releasePlan();
     }
 
-    void MixerGraph::prepareToPlay(double sampleRate, int samplesPerBlock)
+    void MixerGraph::renderChunk(RenderPlan& plan, juce::AudioBuffer<float>& buffer,
+                                 int startSample, int numSamples, juce::MidiBuffer& midi) noexcept
     {
-        mainGraph->setPlayConfigDetails(getTotalNumInputChannels(),
-                                        getTotalNumOutputChannels(),
-                                        sampleRate, samplesPerBlock);
-        mainGraph->prepareToPlay(sampleRate, samplesPerBlock);
+        const int numOutputChannels = buffer.getNumChannels();
+        const double time = plan.blockTime >= 0.0 ? plan.blockTime + startSample / plan.sampleRate : -1.0;
+
+        // Views over the plan's preallocated scratch - no allocation
+        juce::AudioBuffer<float> master(plan.masterBuffer.getArrayOfWritePointers(), mixChannels, 0, numSamples);
+
+        // Direct input goes straight to the master sum (mono is spread to both sides)
+        master.copyFrom(0, 0, buffer, 0, startSample, numSamples);
+        master.copyFrom(1, 0, buffer, numOutputChannels > 1 ? 1 : 0, startSample, numSamples);
+
+        for (auto& bus : plan.buses)
+            bus.buffer.clear(0, numSamples);
+
+        // Track strips only hold audio for the samples rendered since beginBlock()
+        const int stripSamples = juce::jmin(numSamples, plan.trackSamples - startSample);
+
+        if (stripSamples > 0)
+        {
+            for (auto& strip : plan.strips)
+            {
+                juce::AudioBuffer<float> input(strip.input.getArrayOfWritePointers(), mixChannels, startSample, stripSamples);
+                strip.pan->processBlock(input, midi);
+                strip.width->processBlock(input, midi);
+
+                auto& destination = strip.outputBus >= 0 ? plan.buses[(size_t)strip.outputBus].buffer
+                                                         : plan.masterBuffer;
+
+                for (int ch = 0; ch < mixChannels; ++ch)
+                {
+                    destination.addFrom(ch, 0, input, ch, 0, stripSamples);
+
+                    for (const auto& [busIndex, level] : strip.sends)
+                        plan.buses[(size_t)busIndex].buffer.addFrom(ch, 0, input, ch, 0, stripSamples, level);
+                }
+            }
+        }
+
+        // Paths that skip the buses wait for the slowest bus chain
+        plan.directCompensation->process(master, numSamples);
+
+        // Group and return buses run every block so FX tails keep ringing
+        for (auto& bus : plan.buses)
+        {
+            juce::AudioBuffer<float> busView(bus.buffer.getArrayOfWritePointers(), mixChannels, 0, numSamples);
+            processChain(bus.chain, busView, midi, time, plan.sampleRate);
+            bus.compensation->process(busView, numSamples);
+
+            for (int ch = 0; ch < mixChannels; ++ch)
+                master.addFrom(ch, 0, busView, ch, 0, numSamples);
+        }
+
+        processChain(plan.masterChain, master, midi, time, plan.sampleRate);
+        plan.masterGain->processBlock(master, midi);
+
+        if (numOutputChannels > 1)
+        {
+            buffer.copyFrom(0, startSample, master, 0, 0, numSamples);
+            buffer.copyFrom(1, startSample, master, 1, 0, numSamples);
+        }
+        else
+        {
+            buffer.copyFrom(0, startSample, master.getReadPointer(0), numSamples, 0.5f);
+            buffer.addFrom(0, startSample, master.getReadPointer(1), numSamples, 0.5f);
+        }
     }
 
-    void MixerGraph::releaseResources()
+    //==============================================================================
+    // Delay compensation
+
+    void MixerGraph::CompensationDelay::prepare(int numChannels, int delay)
     {
-        mainGraph->releaseResources();
+        delaySamples = juce::jmax(0, delay);
+        position = 0;
+        line.setSize(numChannels, juce::jmax(1, delaySamples));
+        line.clear();
     }
 
-    void MixerGraph::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+    void MixerGraph::CompensationDelay::process(juce::AudioBuffer<float>& block, int numSamples) noexcept
     {
-        mainGraph->processBlock(buffer, midiMessages);
+        if (delaySamples == 0)
+            return;
+
+        const int numChannels = juce::jmin(block.getNumChannels(), line.getNumChannels());
+
+        // Swapping a span with the line hands back the samples from delaySamples
+        // ago and stores the new ones in their place
+        for (int done = 0; done < numSamples;)
+        {
+            const int spanLength = juce::jmin(numSamples - done, delaySamples - position);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                float* data = block.getWritePointer(ch, done);
+                std::swap_ranges(data, data + spanLength, line.getWritePointer(ch, position));
+            }
+
+            position += spanLength;
+            if (position == delaySamples)
+                position = 0;
+
+            done += spanLength;
+        }
     }
 
-    juce::AudioProcessorGraph::NodeID MixerGraph::addTrack(const juce::String& trackName)
+    int MixerGraph::getChainLatency(const std::vector<FXNodeInfo>& chain)
     {
-        // Create processors for the track strip
-        auto gain = std::make_unique<GainProcessor>();
-        auto pan = std::make_unique<PanProcessor>();
-        auto ms = std::make_unique<MSProcessor>();
+        int latency = 0;
+        for (const auto& node : chain)
+            if (node.enabled)
+                latency += node.processor->getLatencySamples();
+        return latency;
+    }
 
-        auto gainNode = mainGraph->addNode(std::move(gain));
-        auto panNode = mainGraph->addNode(std::move(pan));
-        auto msNode = mainGraph->addNode(std::move(ms));
+    MixerGraph::RenderPlan* MixerGraph::acquirePlan() noexcept
+    {
+        // Same handshake as AudioEngine::acquireTrackList: announce, then confirm
+        for (;;)
+        {
+            auto* plan = livePlan.load();
+            planInUse.store(plan);
 
-        // Connect Gain -> Pan
-        for (int channel = 0; channel < 2; ++channel)
+            if (livePlan.load() == plan)
+                return plan;
+        }
+    }
+
+    void MixerGraph::releasePlan() noexcept
+    {
+        renderPlan = nullptr;
+        planInUse.store(nullptr);
+    }
+
+    //==============================================================================
+    // Plan compilation (message thread)
+
+    void MixerGraph::publishPlan()
+    {
+        auto plan = std::make_unique<RenderPlan>();
+        plan->blockSize = preparedBlockSize.load();
+        plan->sampleRate = preparedSampleRate;
+        plan->masterGain = masterGain;
+
+        auto findBus = [&plan](const juce::String& name)
+        {
+            for (size_t i = 0; i < plan->buses.size(); ++i)
+                if (plan->buses[i].name == name)
+                    return (int)i;
+            return -1;
+        };
+
+        auto addBus = [&plan, &findBus](const juce::String& name)
+        {
+            auto index = findBus(name);
+            if (index < 0)
+            {
+                RenderPlan::Bus bus;
+                bus.name = name;
+                plan->buses.push_back(std::move(bus));
+                index = (int)plan->buses.size() - 1;
+            }
+            return index;
+        };
+
+        // Group buses first, then returns that carry an FX chain, in a stable order
+        for (const auto& name : getGroupBusNames())
+            addBus(name);
+
+        for (const auto& [name, chain] : fxChains)
         {
-            mainGraph->addConnection({ { gainNode->nodeID, channel }, { panNode->nodeID, channel } });
+            if (name == "master")
+                plan->masterChain = chain;
+            else
+                plan->buses[(size_t)addBus(name)].chain = chain;
+        }
+
+        for (const auto& config : trackStrips)
+        {
+            RenderPlan::Strip strip;
+            strip.pan = config.pan;
+            strip.width = config.width;
+            strip.outputBus = config.outputBus == "master" ? -1 : findBus(config.outputBus);
+
+            for (const auto& [name, level] : config.sends)
+            {
+                // Sends to a bus without FX still get an (empty) return
+                const auto busIndex = addBus(name);
+                if (busIndex != strip.outputBus)
+                    strip.sends.emplace_back(busIndex, level);
+            }
+
+            plan->strips.push_back(std::move(strip));
         }
 
-        // Connect Pan -> MS
-        for (int channel = 0; channel < 2; ++channel)
+        if (plan->blockSize > 0)
         {
-            mainGraph->addConnection({ { panNode->nodeID, channel }, { msNode->nodeID, channel } });
+            for (auto& strip : plan->strips)
+                strip.input.setSize(mixChannels, plan->blockSize);
+
+            for (auto& bus : plan->buses)
+                bus.buffer.setSize(mixChannels, plan->blockSize);
+
+            plan->masterBuffer.setSize(mixChannels, plan->blockSize);
         }
 
-        // Connect MS -> Master
-        for (int channel = 0; channel < 2; ++channel)
+        // Line every path into the master up with the slowest bus chain
+        int slowestBus = 0;
+        for (const auto& bus : plan->buses)
+            slowestBus = juce::jmax(slowestBus, getChainLatency(bus.chain));
+
+        // A delay line whose length still fits carries over with its contents
+        auto getCompensation = [](std::shared_ptr<CompensationDelay> current, int delay)
         {
-            mainGraph->addConnection({ { msNode->nodeID, channel }, { masterGainNodeID, channel } });
+            if (current == nullptr || current->delaySamples != delay)
+            {
+                current = std::make_shared<CompensationDelay>();
+                current->prepare(mixChannels, delay);
+            }
+            return current;
+        };
+
+        std::map<juce::String, std::shared_ptr<CompensationDelay>> compensation;
+
+        for (auto& bus : plan->buses)
+        {
+            const auto found = busCompensation.find(bus.name);
+            bus.compensation = getCompensation(found != busCompensation.end() ? found->second : nullptr,
+                                               slowestBus - getChainLatency(bus.chain));
+            compensation[bus.name] = bus.compensation;
         }
 
-        // Return the input node ID (Gain) so sources can connect to it
-        return gainNode->nodeID;
+        busCompensation = std::move(compensation);
+        directCompensation = getCompensation(directCompensation, slowestBus);
+        plan->directCompensation = directCompensation;
+
+        const int latency = slowestBus + getChainLatency(plan->masterChain);
+        totalLatency.store(latency);
+        setLatencySamples(latency);
+
+        auto* previous = publishedPlan.get();
+        livePlan.store(plan.get());
+
+        // Wait for an in-flight callback to finish with the old plan (at most one block)
+        while (previous != nullptr && planInUse.load() == previous)
+            juce::Thread::sleep(1);
+
+        // Processors only referenced by the old plan are released here, off the audio thread
+        publishedPlan = std::move(plan);
+    }
+
+    //==============================================================================
+    // Track Strips
+
+    const juce::StringArray& MixerGraph::getGroupBusNames()
+    {
+        static const juce::StringArray names { "drums", "bass", "melodic" };
+        return names;
+    }
+
+    juce::String MixerGraph::guessOutputBus(const juce::String& trackName, int trackIndex)
+    {
+        // Index 9 is MIDI channel 10, the General MIDI percussion channel
+        if (trackIndex == 9 || trackName.containsIgnoreCase("drum") || trackName.containsIgnoreCase("perc"))
+            return "drums";
+        if (trackName.containsIgnoreCase("bass"))
+            return "bass";
+        return "melodic";
+    }
+
+    int MixerGraph::addTrack(const juce::String& trackName)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        TrackStrip strip;
+        strip.name = trackName;
+        strip.outputBus = guessOutputBus(trackName, (int)trackStrips.size());
+        strip.pan = std::make_shared<PanProcessor>();
+        strip.width = std::make_shared<MSProcessor>();
+
+        prepareProcessor(*strip.pan);
+        prepareProcessor(*strip.width);
+
+        trackStrips.push_back(std::move(strip));
+        publishPlan();
+
+        return (int)trackStrips.size() - 1;
+    }
+
+    void MixerGraph::removeTrack(int trackIndex)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size())
+            return;
+
+        trackStrips.erase(trackStrips.begin() + trackIndex);
+        publishPlan();
     }
 
     void MixerGraph::clearTracks()
     {
-        // Remove all nodes except IO and Master
-        // Note: Iterating and removing is tricky, so we'll just re-initialize
-        initializeGraph();
+        const juce::ScopedLock sl(configLock);
+        trackStrips.clear();
+        fxChains.clear();
+        fxChainSettings.clear();
+        publishPlan();
+    }
+
+    int MixerGraph::getNumTracks() const
+    {
+        const juce::ScopedLock sl(configLock);
+        return (int)trackStrips.size();
+    }
+
+    void MixerGraph::setTrackOutputBus(int trackIndex, const juce::String& bus)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size())
+            return;
+
+        auto& strip = trackStrips[(size_t)trackIndex];
+        if (strip.outputBus == bus)
+            return;
+
+        strip.outputBus = bus;
+        publishPlan();
     }
-    
+
+    juce::String MixerGraph::getTrackOutputBus(int trackIndex) const
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size())
+            return {};
+
+        return trackStrips[(size_t)trackIndex].outputBus;
+    }
+
+    void MixerGraph::setTrackSend(int trackIndex, const juce::String& returnBus, float level)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size() || returnBus.isEmpty() || returnBus == "master")
+            return;
+
+        auto& sends = trackStrips[(size_t)trackIndex].sends;
+        if (level > 0.0f)
+            sends[returnBus] = level;
+        else
+            sends.erase(returnBus);
+
+        publishPlan();
+    }
+
+    void MixerGraph::setTrackPan(int trackIndex, float pan)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size())
+            return;
+
+        auto& strip = trackStrips[(size_t)trackIndex];
+        strip.panValue = pan;
+        strip.pan->setPan(pan);
+    }
+
+    void MixerGraph::setTrackStereoWidth(int trackIndex, float width)
+    {
+        const juce::ScopedLock sl(configLock);
+
+        if (trackIndex < 0 || trackIndex >= (int)trackStrips.size())
+            return;
+
+        auto& strip = trackStrips[(size_t)trackIndex];
+        strip.widthValue = width;
+        strip.width->setWidth(width);
+    }
+
     //==============================================================================
     // FX Chain Management
-    
-    std::unique_ptr<juce::AudioProcessor> MixerGraph::createProcessor(const juce::String& type)
+
+    std::unique_ptr<ProcessorBase> MixerGraph::createProcessor(const juce::String& type)
     {
         auto lowerType = type.toLowerCase();
-        
+
         if (lowerType == "eq" || lowerType == "equalizer")
             return std::make_unique<EQProcessor>();
         if (lowerType == "compressor" || lowerType == "comp")
@@ -135,175 +633,149 @@ namespace Audio
             return std::make_unique<PanProcessor>();
         if (lowerType == "ms" || lowerType == "midside" || lowerType == "stereowidth" || lowerType == "width")
             return std::make_unique<MSProcessor>();
-            
+
         DBG("MixerGraph: Unknown processor type: " << type);
         return nullptr;
     }
-    
+
+    void MixerGraph::applyParameter(ProcessorBase& processor, const juce::String& paramName, float value)
+    {
+        const int index = processor.findProcessorParameter(paramName);
+        if (index >= 0)
+            processor.setProcessorParameter(index, value);
+    }
+
+    AutomationLane MixerGraph::parseAutomationLane(const ProcessorBase& processor, const juce::String& paramName,
+                                                   const juce::var& points)
+    {
+        AutomationLane lane;
+
+        const int index = processor.findProcessorParameter(paramName);
+        if (index < 0 || !processor.getProcessorParameter(index).isAutomatable())
+        {
+            DBG("MixerGraph: Cannot automate '" << paramName << "' on " << processor.getName());
+            return lane;
+        }
+
+        if (auto* pointArray = points.getArray())
+        {
+            for (const auto& point : *pointArray)
+            {
+                if (auto* pair = point.getArray(); pair != nullptr && pair->size() >= 2)
+                    lane.points.push_back({ (double)(*pair)[0], (float)(*pair)[1] });
+            }
+        }
+
+        std::stable_sort(lane.points.begin(), lane.points.end(),
+                         [](const auto& a, const auto& b) { return a.time < b.time; });
+
+        if (!lane.points.empty())
+            lane.parameterIndex = index;
+
+        return lane;
+    }
+
     void MixerGraph::setFXChainForBus(const juce::String& bus, const juce::var& chainJson)
     {
-        // Clear existing FX for this bus
-        clearFXForBus(bus);
-        
-        auto* chainArray = chainJson.getArray();
-        if (chainArray == nullptr)
-            return;
-            
+        const juce::ScopedLock sl(configLock);
+
+        // Units still in use keep running; everything else is retired with the old plan
+        std::vector<FXNodeInfo> previousChain;
+        if (auto it = fxChains.find(bus); it != fxChains.end())
+            previousChain = it->second;
+
         std::vector<FXNodeInfo> newChain;
-        
-        for (const auto& fxVar : *chainArray)
+
+        if (auto* chainArray = chainJson.getArray())
         {
-            juce::String fxId = fxVar.getProperty("id", "").toString();
-            juce::String fxType = fxVar.getProperty("type", "").toString();
-            bool enabled = fxVar.getProperty("enabled", true);
-            
-            if (fxType.isEmpty())
-                continue;
-                
-            auto processor = createProcessor(fxType);
-            if (processor == nullptr)
-                continue;
-                
-            // Apply parameters
-            if (auto* paramsObj = fxVar.getProperty("parameters", juce::var()).getDynamicObject())
+            for (const auto& fxVar : *chainArray)
             {
-                for (const auto& prop : paramsObj->getProperties())
+                juce::String fxId = fxVar.getProperty("id", "").toString();
+                juce::String fxType = fxVar.getProperty("type", "").toString();
+                bool enabled = fxVar.getProperty("enabled", true);
+
+                if (fxType.isEmpty())
+                    continue;
+
+                std::shared_ptr<ProcessorBase> processor;
+
+                if (fxId.isNotEmpty())
                 {
-                    juce::String paramName = prop.name.toString();
-                    float value = static_cast<float>(prop.value);
-                    
-                    // Apply parameter based on processor type
-                    if (auto* eq = dynamic_cast<EQProcessor*>(processor.get()))
-                    {
-                        if (paramName == "low_gain") eq->setLowGain(value);
-                        else if (paramName == "mid_gain") eq->setMidGain(value);
-                        else if (paramName == "high_gain") eq->setHighGain(value);
-                    }
-                    else if (auto* comp = dynamic_cast<CompressorProcessor*>(processor.get()))
+                    for (auto it = previousChain.begin(); it != previousChain.end(); ++it)
                     {
-                        if (paramName == "threshold") comp->setThreshold(value);
-                        else if (paramName == "ratio") comp->setRatio(value);
-                        else if (paramName == "attack") comp->setAttack(value);
-                        else if (paramName == "release") comp->setRelease(value);
+                        if (it->id == fxId && it->type.equalsIgnoreCase(fxType))
+                        {
+                            processor = it->processor;
+                            previousChain.erase(it);
+                            break;
+                        }
                     }
-                    else if (auto* reverb = dynamic_cast<ReverbProcessor*>(processor.get()))
-                    {
-                        if (paramName == "room_size") reverb->setRoomSize(value);
-                        else if (paramName == "damping") reverb->setDamping(value);
-                        else if (paramName == "wet") reverb->setWetLevel(value);
-                        else if (paramName == "dry") reverb->setDryLevel(value);
-                        else if (paramName == "width") reverb->setWidth(value);
-                    }
-                    else if (auto* delay = dynamic_cast<DelayProcessor*>(processor.get()))
-                    {
-                        if (paramName == "time" || paramName == "delay_time") delay->setDelayTime(value);
-                        else if (paramName == "feedback") delay->setFeedback(value);
-                        else if (paramName == "wet") delay->setWetLevel(value);
-                        else if (paramName == "dry") delay->setDryLevel(value);
-                    }
-                    else if (auto* sat = dynamic_cast<SaturationProcessor*>(processor.get()))
-                    {
-                        if (paramName == "drive") sat->setDrive(value);
-                        else if (paramName == "mix") sat->setMix(value);
-                    }
-                    else if (auto* lim = dynamic_cast<LimiterProcessor*>(processor.get()))
-                    {
-                        if (paramName == "threshold") lim->setThreshold(value);
-                        else if (paramName == "release") lim->setRelease(value);
-                    }
-                    else if (auto* gain = dynamic_cast<GainProcessor*>(processor.get()))
-                    {
-                        if (paramName == "gain") gain->setGainDecibels(value);
-                    }
-                    else if (auto* ms = dynamic_cast<MSProcessor*>(processor.get()))
+                }
+
+                if (processor == nullptr)
+                {
+                    auto created = createProcessor(fxType);
+                    if (created == nullptr)
+                        continue;
+
+                    prepareProcessor(*created);
+                    processor = std::move(created);
+                }
+
+                // Apply parameters
+                if (auto* paramsObj = fxVar.getProperty("parameters", juce::var()).getDynamicObject())
+                {
+                    for (const auto& prop : paramsObj->getProperties())
+                        applyParameter(*processor, prop.name.toString(), static_cast<float>(prop.value));
+                }
+
+                processor->setEnabled(enabled);
+
+                FXNodeInfo info;
+                info.id = fxId.isEmpty() ? juce::Uuid().toString() : fxId;
+                info.type = fxType;
+                info.enabled = enabled;
+
+                if (auto* automationObj = fxVar.getProperty("automation", juce::var()).getDynamicObject())
+                {
+                    for (const auto& prop : automationObj->getProperties())
                     {
-                        if (paramName == "width") ms->setWidth(value);
-                        else if (paramName == "mid_gain") ms->setMidGain(value);
-                        else if (paramName == "side_gain") ms->setSideGain(value);
+                        auto lane = parseAutomationLane(*processor, prop.name.toString(), prop.value);
+                        if (lane.parameterIndex >= 0)
+                            info.automation.push_back(std::move(lane));
                     }
                 }
+
+                info.processor = std::move(processor);
+
+                newChain.push_back(std::move(info));
             }
-            
-            // Add node to graph
-            auto node = mainGraph->addNode(std::move(processor));
-            
-            FXNodeInfo info;
-            info.id = fxId.isEmpty() ? juce::Uuid().toString() : fxId;
-            info.type = fxType;
-            info.nodeId = node->nodeID;
-            info.enabled = enabled;
-            
-            newChain.push_back(info);
         }
-        
+
         fxChains[bus] = std::move(newChain);
-        reconnectFXChain(bus);
-        
+        fxChainSettings[bus] = chainJson.clone();
+        publishPlan();
+
         DBG("MixerGraph: Set FX chain for bus '" << bus << "' with " << fxChains[bus].size() << " effects");
     }
-    
+
     void MixerGraph::clearFXForBus(const juce::String& bus)
     {
+        const juce::ScopedLock sl(configLock);
+
         auto it = fxChains.find(bus);
         if (it == fxChains.end())
             return;
-            
-        // Remove all FX nodes for this bus
-        for (const auto& fxInfo : it->second)
-        {
-            mainGraph->removeNode(fxInfo.nodeId);
-        }
-        
+
         fxChains.erase(it);
+        fxChainSettings.erase(bus);
+        publishPlan();
     }
-    
-    void MixerGraph::reconnectFXChain(const juce::String& bus)
-    {
-        auto it = fxChains.find(bus);
-        if (it == fxChains.end() || it->second.empty())
-            return;
-            
-        const auto& chain = it->second;
-        
-        // For master bus, connect: Input -> FX chain -> MasterGain -> Output
-        if (bus == "master")
-        {
-            // Remove existing connections to masterGainNodeID input
-            for (auto& connection : mainGraph->getConnections())
-            {
-                if (connection.destination.nodeID == masterGainNodeID)
-                {
-                    mainGraph->removeConnection(connection);
-                }
-            }
-            
-            // Connect FX chain in series
-            for (size_t i = 0; i < chain.size() - 1; ++i)
-            {
-                for (int channel = 0; channel < 2; ++channel)
-                {
-                    mainGraph->addConnection({ 
-                        { chain[i].nodeId, channel }, 
-                        { chain[i + 1].nodeId, channel } 
-                    });
-                }
-            }
-            
-            // Connect last FX to master gain
-            for (int channel = 0; channel < 2; ++channel)
-            {
-                mainGraph->addConnection({ 
-                    { chain.back().nodeId, channel }, 
-                    { masterGainNodeID, channel } 
-                });
-            }
-            
-            // Note: Input connection to first FX should come from track outputs
-        }
-    }
-    
+
     void MixerGraph::setFXParameter(const juce::String& fxId, const juce::String& paramName, float value)
     {
+        const juce::ScopedLock sl(configLock);
+
         // Find the FX node
         for (auto& [bus, chain] : fxChains)
         {
@@ -311,94 +783,125 @@ namespace Audio
             {
                 if (fxInfo.id == fxId)
                 {
-                    auto* node = mainGraph->getNodeForId(fxInfo.nodeId);
-                    if (node == nullptr)
+                    const int index = fxInfo.processor->findProcessorParameter(paramName);
+                    if (index < 0)
                         return;
-                        
-                    auto* processor = node->getProcessor();
-                    
-                    if (auto* eq = dynamic_cast<EQProcessor*>(processor))
-                    {
-                        if (paramName == "low_gain") eq->setLowGain(value);
-                        else if (paramName == "mid_gain") eq->setMidGain(value);
-                        else if (paramName == "high_gain") eq->setHighGain(value);
-                    }
-                    else if (auto* comp = dynamic_cast<CompressorProcessor*>(processor))
-                    {
-                        if (paramName == "threshold") comp->setThreshold(value);
-                        else if (paramName == "ratio") comp->setRatio(value);
-                        else if (paramName == "attack") comp->setAttack(value);
-                        else if (paramName == "release") comp->setRelease(value);
-                    }
-                    else if (auto* reverb = dynamic_cast<ReverbProcessor*>(processor))
-                    {
-                        if (paramName == "room_size") reverb->setRoomSize(value);
-                        else if (paramName == "damping") reverb->setDamping(value);
-                        else if (paramName == "wet") reverb->setWetLevel(value);
-                        else if (paramName == "dry") reverb->setDryLevel(value);
-                    }
-                    else if (auto* delay = dynamic_cast<DelayProcessor*>(processor))
-                    {
-                        if (paramName == "time") delay->setDelayTime(value);
-                        else if (paramName == "feedback") delay->setFeedback(value);
-                        else if (paramName == "wet") delay->setWetLevel(value);
-                        else if (paramName == "dry") delay->setDryLevel(value);
-                    }
-                    else if (auto* sat = dynamic_cast<SaturationProcessor*>(processor))
-                    {
-                        if (paramName == "drive") sat->setDrive(value);
-                        else if (paramName == "mix") sat->setMix(value);
-                    }
-                    else if (auto* lim = dynamic_cast<LimiterProcessor*>(processor))
-                    {
-                        if (paramName == "threshold") lim->setThreshold(value);
-                        else if (paramName == "release") lim->setRelease(value);
-                    }
-                    else if (auto* ms = dynamic_cast<MSProcessor*>(processor))
+
+                    const int previousLatency = fxInfo.processor->getLatencySamples();
+                    fxInfo.processor->setProcessorParameter(index, value);
+
+                    // e.g. an oversampling change: the compensation delays must follow
+                    if (fxInfo.processor->getLatencySamples() != previousLatency)
+                        publishPlan();
+
+                    if (auto* settings = findFXSettings(fxId).getDynamicObject())
                     {
-                        if (paramName == "width") ms->setWidth(value);
-                        else if (paramName == "mid_gain") ms->setMidGain(value);
-                        else if (paramName == "side_gain") ms->setSideGain(value);
+                        auto parameters = settings->getProperty("parameters");
+                        if (parameters.getDynamicObject() == nullptr)
+                        {
+                            parameters = juce::var(new juce::DynamicObject());
+                            settings->setProperty("parameters", parameters);
+                        }
+                        parameters.getDynamicObject()->setProperty(paramName, value);
                     }
-                    
                     return;
                 }
             }
         }
     }
-    
+
     void MixerGraph::setFXEnabled(const juce::String& fxId, bool enabled)
     {
+        const juce::ScopedLock sl(configLock);
+
         for (auto& [bus, chain] : fxChains)
         {
             for (auto& fxInfo : chain)
             {
                 if (fxInfo.id == fxId)
                 {
+                    if (fxInfo.enabled == enabled)
+                        return;
+
                     fxInfo.enabled = enabled;
-                    
-                    auto* node = mainGraph->getNodeForId(fxInfo.nodeId);
-                    if (node != nullptr)
-                    {
-                        auto* processor = node->getProcessor();
-                        
-                        // Set enabled state on processor if it supports it
-                        if (auto* eq = dynamic_cast<EQProcessor*>(processor))
-                            eq->setEnabled(enabled);
-                        else if (auto* comp = dynamic_cast<CompressorProcessor*>(processor))
-                            comp->setEnabled(enabled);
-                        else if (auto* reverb = dynamic_cast<ReverbProcessor*>(processor))
-                            reverb->setEnabled(enabled);
-                        else if (auto* delay = dynamic_cast<DelayProcessor*>(processor))
-                            delay->setEnabled(enabled);
-                        else if (auto* sat = dynamic_cast<SaturationProcessor*>(processor))
-                            sat->setEnabled(enabled);
-                        else if (auto* lim = dynamic_cast<LimiterProcessor*>(processor))
-                            lim->setEnabled(enabled);
-                    }
+                    fxInfo.processor->setEnabled(enabled);
+
+                    if (auto* settings = findFXSettings(fxId).getDynamicObject())
+                        settings->setProperty("enabled", enabled);
+
+                    // Units without their own bypass are skipped by the plan
+                    publishPlan();
                     return;
                 }
             }
         }
     }
+
+    juce::var MixerGraph::findFXSettings(const juce::String& fxId) const
+    {
+        for (const auto& [bus, chainJson] : fxChainSettings)
+        {
+            if (auto* chainArray = chainJson.getArray())
+            {
+                for (const auto& fxVar : *chainArray)
+                    if (fxVar.getProperty("id", "").toString() == fxId)
+                        return fxVar;
+            }
+        }
+
+        return {};
+    }
+
+    void MixerGraph::copySettingsFrom(const MixerGraph& source)
+    {
+        jassert(&source != this);
+
+        std::vector<TrackStrip> strips;
+        std::map<juce::String, juce::var> chains;
+
+        {
+            const juce::ScopedLock sl(source.configLock);
+
+            for (const auto& strip : source.trackStrips)
+            {
+                TrackStrip copy;
+                copy.name = strip.name;
+                copy.outputBus = strip.outputBus;
+                copy.sends = strip.sends;
+                copy.panValue = strip.panValue;
+                copy.widthValue = strip.widthValue;
+                strips.push_back(std::move(copy));
+            }
+
+            for (const auto& [bus, chainJson] : source.fxChainSettings)
+                chains[bus] = chainJson.clone();
+        }
+
+        {
+            const juce::ScopedLock sl(configLock);
+
+            for (auto& strip : strips)
+            {
+                strip.pan = std::make_shared<PanProcessor>();
+                strip.width = std::make_shared<MSProcessor>();
+                strip.pan->setPan(strip.panValue);
+                strip.width->setWidth(strip.widthValue);
+                prepareProcessor(*strip.pan);
+                prepareProcessor(*strip.width);
+
+                // Start at the copied values instead of gliding from the defaults
+                strip.pan->reset();
+                strip.width->reset();
+            }
+
+            trackStrips = std::move(strips);
+            fxChains.clear();
+            fxChainSettings.clear();
+            publishPlan();
+        }
+
+        // fxChains is empty now, so every unit gets its own fresh processor
+        for (const auto& [bus, chainJson] : chains)
+            setFXChainForBus(bus, chainJson);
+    }
 }
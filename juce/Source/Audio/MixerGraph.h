@@ -13,22 +13,62 @@
 #include "Processors/LimiterProcessor.h"
 #include "Processors/MSProcessor.h"
 
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace Audio
 {
+    /**
+     * Automation of one processor parameter: breakpoints on the song timeline
+     * (seconds, like the MIDI player position), linear in between and held
+     * before the first and after the last point.
+     */
+    struct AutomationLane
+    {
+        struct Point
+        {
+            double time = 0.0;
+            float value = 0.0f;
+        };
+
+        int parameterIndex = -1;
+        std::vector<Point> points;      // Sorted by time
+
+        float getValueAt(double time) const noexcept;
+
+        /** Time of the first point after time, or a negative value if there is none. */
+        double getNextPointTime(double time) const noexcept;
+    };
+
     /**
      * FX unit info for chain management.
+     * Processors are shared between the editable chain and any render plan that
+     * still references them, so rebuilding a plan never resets an FX tail.
      */
     struct FXNodeInfo
     {
         juce::String id;
         juce::String type;
-        juce::AudioProcessorGraph::NodeID nodeId;
+        std::shared_ptr<ProcessorBase> processor;
+        std::vector<AutomationLane> automation;
         bool enabled = true;
     };
 
     /**
-     * Manages the AudioProcessorGraph for the project.
-     * Handles routing, track creation, and master bus processing.
+     * The project mixer, processed on the audio thread every block.
+     *
+     * Routing:
+     *   Track strip (Pan -> M/S width) -> group bus ("drums", "bass", "melodic") -> master
+     *                                  \-> sends -> return buses ----------------/
+     *   master FX chain -> master gain -> output
+     *
+     * Any bus name other than master and the group buses passed to setFXChainForBus
+     * or setTrackSend becomes a return bus. All editing happens on the message
+     * thread, which compiles an immutable RenderPlan (processors plus preallocated
+     * scratch buffers) and swaps it in atomically; the audio thread never locks
+     * or allocates.
      */
     class MixerGraph : public juce::AudioProcessor
     {
@@ -39,6 +79,13 @@ namespace Audio
         //==============================================================================
         void prepareToPlay(double sampleRate, int samplesPerBlock) override;
         void releaseResources() override;
+
+        /**
+         * Mix one block. The incoming buffer content is treated as direct master input;
+         * track strips filled since beginBlock() are summed through their buses, the
+         * master chain runs, and the result is written back to the buffer.
+         * Releases the plan pinned by beginBlock().
+         */
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override;
 
         //==============================================================================
@@ -63,73 +110,230 @@ namespace Audio
         void setStateInformation(const void* data, int sizeInBytes) override {}
 
         //==============================================================================
-        // Graph Management
-        
+        // Audio thread
+
         /**
-         * Adds a new track to the mixer.
-         * Creates a chain of Gain -> Pan -> Master.
-         * Returns the NodeID of the input node for this track (where audio should be fed).
+         * Pin the current render plan and clear every track input for numSamples.
+         * numSamples must not exceed getMaximumBlockSize(). Must be followed by processBlock().
+         * timelineSeconds is the song position of the block's first sample, used to play
+         * FX automation; pass a negative value while the transport is stopped.
          */
-        juce::AudioProcessorGraph::NodeID addTrack(const juce::String& trackName);
+        void beginBlock(int numSamples, double timelineSeconds = -1.0) noexcept;
 
         /**
-         * Clears all tracks and resets to default state (Master bus only).
+         * Stereo input buffer of a track strip, valid between beginBlock() and processBlock().
+         * Render into samples [0, numSamples). Returns nullptr if the strip does not exist
+         * or the mixer is not prepared yet.
          */
-        void clearTracks();
+        juce::AudioBuffer<float>* getTrackInput(int trackIndex) noexcept;
+
+        /** Number of track strips in the plan pinned by beginBlock() (0 outside a block). */
+        int getNumTrackInputs() const noexcept;
+
+        /** Largest block the mixer was prepared for (0 before prepareToPlay). */
+        int getMaximumBlockSize() const noexcept { return preparedBlockSize.load(); }
+
+        /**
+         * Total FX latency of the current plan: the slowest bus chain plus the master
+         * chain (also reported through getLatencySamples()). Every parallel path into
+         * the master is delayed to match the slowest bus, so buses stay phase-aligned.
+         */
+        int getTotalLatencySamples() const noexcept { return totalLatency.load(); }
+
+        //==============================================================================
+        // Track Strips (message thread)
 
         /**
-         * Get the underlying graph for visualization or advanced manipulation.
+         * Adds a track strip (Pan -> M/S) at the end of the strip list.
+         * The output bus is guessed from the name ("drum"/"perc" or the GM percussion
+         * channel -> drums, "bass" -> bass, otherwise melodic) and can be changed with
+         * setTrackOutputBus.
+         * Returns the index of the new strip, which matches the engine track index.
          */
-        juce::AudioProcessorGraph& getGraph() { return *mainGraph; }
+        int addTrack(const juce::String& trackName);
+
+        /** Removes a track strip; later strips shift down by one. */
+        void removeTrack(int trackIndex);
+
+        /**
+         * Clears all tracks and FX chains (master gain stage only).
+         */
+        void clearTracks();
+
+        int getNumTracks() const;
+
+        /** Route a track strip to a group bus, or to "master" directly. */
+        void setTrackOutputBus(int trackIndex, const juce::String& bus);
+        juce::String getTrackOutputBus(int trackIndex) const;
+
+        /** Set a post-fader send level (linear, 0 removes the send) to a return bus. */
+        void setTrackSend(int trackIndex, const juce::String& returnBus, float level);
+
+        /** Strip parameters; these do not rebuild the plan. */
+        void setTrackPan(int trackIndex, float pan);
+        void setTrackStereoWidth(int trackIndex, float width);
 
         //==============================================================================
         // FX Chain Management
-        
+
         /**
          * Set the FX chain for a specific bus from JSON.
-         * Rebuilds the processor chain to match the JSON configuration.
-         * @param bus "master", "drums", "bass", or "melodic"
+         * Units whose id and type match the current chain keep their processor (and
+         * any tail state); only new units are created. A unit's "automation" object
+         * maps parameter ids to [[seconds, value], ...] breakpoint lists.
+         * @param bus "master", "drums", "bass", "melodic" or a return bus name
          * @param chainJson Array of FX unit objects
          */
         void setFXChainForBus(const juce::String& bus, const juce::var& chainJson);
-        
+
         /**
          * Clear all FX from a bus, leaving only the gain stage.
          */
         void clearFXForBus(const juce::String& bus);
-        
+
         /**
-         * Update a single FX parameter.
+         * Update a single FX parameter. The processor glides to the new value on the
+         * audio thread; an automation lane on the same parameter takes precedence
+         * while the transport plays.
          */
         void setFXParameter(const juce::String& fxId, const juce::String& paramName, float value);
-        
+
         /**
          * Enable/disable an FX unit.
          */
         void setFXEnabled(const juce::String& fxId, bool enabled);
 
+        /**
+         * Replace strips and FX chains with a copy of another mixer's settings.
+         * The copy gets its own processors (no shared state), e.g. for offline rendering.
+         */
+        void copySettingsFrom(const MixerGraph& source);
+
+        /** The group buses every track strip can feed, in processing order. */
+        static const juce::StringArray& getGroupBusNames();
+
     private:
-        std::unique_ptr<juce::AudioProcessorGraph> mainGraph;
-        
-        // Node IDs for fixed routing
-        juce::AudioProcessorGraph::NodeID audioInputNodeID;
-        juce::AudioProcessorGraph::NodeID audioOutputNodeID;
-        juce::AudioProcessorGraph::NodeID midiInputNodeID;
-        juce::AudioProcessorGraph::NodeID midiOutputNodeID;
+        //==============================================================================
+        // Editable state (message thread, guarded by configLock)
+
+        struct TrackStrip
+        {
+            juce::String name;
+            juce::String outputBus;
+            std::map<juce::String, float> sends;
+            std::shared_ptr<PanProcessor> pan;
+            std::shared_ptr<MSProcessor> width;
+            float panValue = 0.0f;
+            float widthValue = 1.0f;
+        };
+
+        std::vector<TrackStrip> trackStrips;
 
-        // Master Bus
-        juce::AudioProcessorGraph::NodeID masterGainNodeID;
-        
         // FX chains per bus
         std::map<juce::String, std::vector<FXNodeInfo>> fxChains;
-        
+
+        // JSON each chain was built from, kept current by setFXParameter/setFXEnabled
+        std::map<juce::String, juce::var> fxChainSettings;
+
+        // Master Bus
+        std::shared_ptr<GainProcessor> masterGain;
+
+        // Never taken by the audio thread
+        juce::CriticalSection configLock;
+
+        double preparedSampleRate = 0.0;
+        std::atomic<int> preparedBlockSize { 0 };
+
+        //==============================================================================
+        // Compiled routing for the audio thread
+
+        /** Fixed delay lining a path up with the slowest parallel one. */
+        struct CompensationDelay
+        {
+            juce::AudioBuffer<float> line;
+            int delaySamples = 0;
+            int position = 0;
+
+            /** Allocate; message thread only. */
+            void prepare(int numChannels, int delay);
+
+            /** Delay samples [0, numSamples) of block in place. */
+            void process(juce::AudioBuffer<float>& block, int numSamples) noexcept;
+        };
+
+        struct RenderPlan
+        {
+            struct Strip
+            {
+                std::shared_ptr<PanProcessor> pan;
+                std::shared_ptr<MSProcessor> width;
+                int outputBus = -1;                         // Index into buses, -1 = master
+                std::vector<std::pair<int, float>> sends;   // Bus index, linear level
+                juce::AudioBuffer<float> input;
+            };
+
+            struct Bus
+            {
+                juce::String name;
+                std::vector<FXNodeInfo> chain;
+                juce::AudioBuffer<float> buffer;
+                std::shared_ptr<CompensationDelay> compensation;    // Slowest bus latency minus this chain's
+            };
+
+            std::vector<Strip> strips;
+            std::vector<Bus> buses;                         // Group buses first, then returns
+            std::vector<FXNodeInfo> masterChain;
+            std::shared_ptr<GainProcessor> masterGain;
+            juce::AudioBuffer<float> masterBuffer;
+            std::shared_ptr<CompensationDelay> directCompensation;  // Direct input and strips routed to master
+            double sampleRate = 0.0;
+            int blockSize = 0;
+            int trackSamples = 0;                           // Set by beginBlock
+            double blockTime = -1.0;                        // Set by beginBlock; negative while stopped
+        };
+
+        // Shared with the plans like the FX processors, so republishing for an edit
+        // that leaves a path's latency alone keeps the audio its delay line holds
+        std::map<juce::String, std::shared_ptr<CompensationDelay>> busCompensation;
+        std::shared_ptr<CompensationDelay> directCompensation;
+
+        std::atomic<int> totalLatency { 0 };
+
+        /** Latency of the enabled units of a chain. */
+        static int getChainLatency(const std::vector<FXNodeInfo>& chain);
+
+        std::unique_ptr<RenderPlan> publishedPlan;          // Writer-owned, live on the audio thread
+        std::atomic<RenderPlan*> livePlan { nullptr };      // Latest plan
+        std::atomic<RenderPlan*> planInUse { nullptr };     // Plan the callback currently holds
+        RenderPlan* renderPlan = nullptr;                   // Audio thread only, between beginBlock and processBlock
+
+        /** Compile the editable state into a new plan and swap it in. Call with configLock held.
+            Blocks until the audio thread has let go of the previous plan. */
+        void publishPlan();
+
+        RenderPlan* acquirePlan() noexcept;
+        void releasePlan() noexcept;
+
+        /** Mix samples [startSample, startSample + numSamples) of buffer through the plan. */
+        void renderChunk(RenderPlan& plan, juce::AudioBuffer<float>& buffer,
+                         int startSample, int numSamples, juce::MidiBuffer& midi) noexcept;
+
         // Helper to create processor from type name
-        std::unique_ptr<juce::AudioProcessor> createProcessor(const juce::String& type);
-        
-        // Reconnect FX chain for a bus after modifications
-        void reconnectFXChain(const juce::String& bus);
+        std::unique_ptr<ProcessorBase> createProcessor(const juce::String& type);
+
+        /** Set a parameter by id; unknown ids are ignored. */
+        static void applyParameter(ProcessorBase& processor, const juce::String& paramName, float value);
+
+        /** Build a lane from [[seconds, value], ...]; parameterIndex is -1 if it cannot be used. */
+        static AutomationLane parseAutomationLane(const ProcessorBase& processor, const juce::String& paramName,
+                                                  const juce::var& points);
+
+        void prepareProcessor(juce::AudioProcessor& processor);
+
+        static juce::String guessOutputBus(const juce::String& trackName, int trackIndex);
 
-        void initializeGraph();
+        /** Find an FX unit's entry in fxChainSettings (an object var), or a void var. */
+        juce::var findFXSettings(const juce::String& fxId) const;
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MixerGraph)
     };
@@ -0,0 +1,222 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+    Implementation of the parallel offline renderer.
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+
+namespace mmg
+{
+
+OfflineRenderer::OfflineRenderer(juce::AudioFormatManager& formatMgr,
+                                 const ExpansionInstrumentLoader& loader,
+                                 double renderSampleRate,
+                                 int renderBlockSize)
+    : formatManager(formatMgr),
+      expansionLoader(loader),
+      sampleRate(renderSampleRate),
+      blockSize(juce::jmax(1, renderBlockSize))
+{
+    player.prepareToPlay(sampleRate, blockSize);
+    player.setMidiListener(this);
+    player.setRenderInternalSynth(false);
+
+    // Before prepareToPlay, so FX units are built with their offline quality
+    mixer.setNonRealtime(true);
+    mixer.prepareToPlay(sampleRate, blockSize);
+}
+
+OfflineRenderer::~OfflineRenderer()
+{
+    workerPool.stop();
+    player.setMidiListener(nullptr);
+}
+
+void OfflineRenderer::setMidiData(const juce::MidiFile& midi)
+{
+    player.setMidiData(midi);
+}
+
+bool OfflineRenderer::addTrackCopy(const AudioEngine::Track& source)
+{
+    auto track = std::make_unique<AudioEngine::Track>((int)tracks.size(), source.getName(), formatManager);
+    track->prepareToPlay(sampleRate, blockSize);
+    track->setNonRealtime(true);
+
+    const bool loaded = track->copyInstrumentFrom(source, expansionLoader);
+    if (!loaded)
+        DBG("OfflineRenderer: Track " << (int)tracks.size() << " falls back to the default synth");
+
+    tracks.push_back(std::move(track));
+    renderJobs.reserve(tracks.size());
+    return loaded;
+}
+
+void OfflineRenderer::copyMixerSettings(const Audio::MixerGraph& source)
+{
+    mixer.copySettingsFrom(source);
+}
+
+//==============================================================================
+bool OfflineRenderer::render(const juce::File& outputFile, int bitDepth)
+{
+    const auto startMs = juce::Time::getMillisecondCounterHiRes();
+
+    if (!player.hasMidiLoaded())
+    {
+        lastError = "No MIDI loaded";
+        return false;
+    }
+
+    const auto totalSamples = (juce::int64)((player.getTotalDuration() + tailSeconds) * sampleRate);
+
+    DBG("OfflineRenderer: Rendering " << player.getTotalDuration() << "s with " << (int)tracks.size()
+        << " tracks to " << outputFile.getFullPathName());
+
+    outputFile.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> outStream(outputFile.createOutputStream());
+
+    if (outStream == nullptr)
+    {
+        lastError = "Could not create output file";
+        return false;
+    }
+
+    juce::WavAudioFormat wavFormat;
+    std::unique_ptr<juce::AudioFormatWriter> writer(
+        wavFormat.createWriterFor(outStream.get(), sampleRate, 2, bitDepth, {}, 0));
+
+    if (writer == nullptr)
+    {
+        lastError = "Could not create WAV writer";
+        return false;
+    }
+
+    outStream.release(); // Writer takes ownership
+
+    // Bounded queue to disk: the writer thread drains the FIFO while we render ahead
+    juce::TimeSliceThread writerThread("Offline Render Writer");
+    writerThread.startThread();
+
+    auto threadedWriter = std::make_unique<juce::AudioFormatWriter::ThreadedWriter>(writer.release(),
+                                                                                    writerThread,
+                                                                                    writerFifoSamples);
+
+    workerPool.start(-1, false);
+
+    juce::AudioBuffer<float> block(2, blockSize);
+
+    player.setPosition(0.0);
+    player.setPlaying(true);
+
+    // The mixer's FX latency is rendered past the end and trimmed from the start,
+    // so the bounce lines up with the MIDI
+    const int latency = mixer.getTotalLatencySamples();
+    const auto samplesToRender = totalSamples + latency;
+
+    for (juce::int64 position = 0; position < samplesToRender;)
+    {
+        const int numSamples = (int)juce::jmin((juce::int64)blockSize, samplesToRender - position);
+
+        juce::AudioBuffer<float> view(block.getArrayOfWritePointers(), 2, 0, numSamples);
+        view.clear();
+
+        // Dispatches this block's events to the track copies; the tail renders with no new events
+        if (player.isPlaying())
+            player.renderNextBlock(view, numSamples);
+
+        renderBlock(view, numSamples, (double)position / sampleRate);
+
+        const int skip = (int)juce::jlimit((juce::int64)0, (juce::int64)numSamples, latency - position);
+        const float* const channels[] = { view.getReadPointer(0, skip), view.getReadPointer(1, skip) };
+
+        // FIFO full: wait for the writer thread to catch up instead of buffering the whole song
+        while (skip < numSamples && !threadedWriter->write(channels, numSamples - skip))
+            juce::Thread::sleep(1);
+
+        position += numSamples;
+    }
+
+    // Flushes whatever is still queued
+    threadedWriter.reset();
+    writerThread.stopThread(5000);
+
+    stats.audioSeconds = (double)totalSamples / sampleRate;
+    stats.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+    stats.realtimeFactor = stats.wallSeconds > 0.0 ? stats.audioSeconds / stats.wallSeconds : 0.0;
+    stats.numThreads = workerPool.getNumWorkers() + 1;
+
+    workerPool.stop();
+
+    DBG("OfflineRenderer: Rendered " << stats.audioSeconds << "s in " << stats.wallSeconds << "s ("
+        << stats.realtimeFactor << "x realtime, " << stats.numThreads << " threads)");
+    return true;
+}
+
+void OfflineRenderer::renderBlock(juce::AudioBuffer<float>& block, int numSamples, double timelineSeconds)
+{
+    bool anySolo = false;
+    for (auto& track : tracks)
+        if (track->isSoloed()) { anySolo = true; break; }
+
+    mixer.beginBlock(numSamples, timelineSeconds);
+    renderJobs.clear();
+
+    for (int i = 0; i < (int)tracks.size(); ++i)
+    {
+        auto* track = tracks[(size_t)i].get();
+        auto* stripInput = mixer.getTrackInput(i);
+
+        // Tracks left out still consume their events, as in the live engine
+        if ((anySolo && !track->isSoloed()) || stripInput == nullptr)
+            track->skipBlock(numSamples);
+        else
+            renderJobs.push_back({ track, stripInput });
+    }
+
+    // Same determinism argument as the live engine: one strip per job, summed in track order
+    renderJobSamples = numSamples;
+    workerPool.run((int)renderJobs.size(), &OfflineRenderer::renderTrackJob, this);
+
+    mixer.processBlock(block, mixerMidi);
+}
+
+void OfflineRenderer::renderTrackJob(void* context, int jobIndex)
+{
+    auto& renderer = *static_cast<OfflineRenderer*>(context);
+    const auto& job = renderer.renderJobs[(size_t)jobIndex];
+    job.track->renderNextBlock(*job.destination, 0, renderer.renderJobSamples);
+}
+
+//==============================================================================
+AudioEngine::Track* OfflineRenderer::getTrack(int index) const noexcept
+{
+    if (index >= 0 && index < (int)tracks.size())
+        return tracks[(size_t)index].get();
+    return nullptr;
+}
+
+void OfflineRenderer::midiNoteOn(int channel, int note, float velocity, int sampleOffset)
+{
+    if (auto* track = getTrack(channel))
+        track->noteOnFromAudioThread(note, velocity, sampleOffset);
+}
+
+void OfflineRenderer::midiNoteOff(int channel, int note, int sampleOffset)
+{
+    if (auto* track = getTrack(channel))
+        track->noteOffFromAudioThread(note, sampleOffset);
+}
+
+void OfflineRenderer::midiProgramChange(int channel, int program, int bank)
+{
+    if (auto* track = getTrack(channel))
+        track->handleProgramChange(program, bank);
+}
+
+} // namespace mmg
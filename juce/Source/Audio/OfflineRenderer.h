@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+
+    Faster-than-realtime bounce of the loaded MIDI to a WAV file, using copies
+    of the live Track instruments and MixerGraph settings. Tracks render in
+    parallel; finished blocks stream to disk through a bounded FIFO.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "AudioEngine.h"
+#include "AudioWorkerPool.h"
+
+namespace mmg
+{
+
+//==============================================================================
+/**
+    One-shot offline render session.
+
+    Usage (message thread, since the sources are live engine objects):
+        OfflineRenderer renderer(formatManager, expansionLoader, 44100.0);
+        renderer.setMidiData(midiPlayer.getSourceMidiData());
+        renderer.addTrackCopy(*track);            // for every engine track, in order
+        renderer.copyMixerSettings(mixerGraph);
+        renderer.render(outputFile, 16);
+
+    Nothing here touches the live tracks or mixer after the copy, so playback
+    keeps running while a render is in progress.
+*/
+class OfflineRenderer : private MidiPlayerListener
+{
+public:
+    OfflineRenderer(juce::AudioFormatManager& formatManager,
+                    const ExpansionInstrumentLoader& expansionLoader,
+                    double sampleRate,
+                    int blockSize = 512);
+    ~OfflineRenderer() override;
+
+    /** MIDI to play, as returned by MidiPlayer::getSourceMidiData(). */
+    void setMidiData(const juce::MidiFile& midi);
+
+    /** Add a track that plays the same instrument as source. Order must match the engine. */
+    bool addTrackCopy(const AudioEngine::Track& source);
+
+    /** Copy strip routing, pan/width and FX chains from the live mixer. */
+    void copyMixerSettings(const Audio::MixerGraph& source);
+
+    /** Render the whole song plus a tail to outputFile. Blocks until the file is written. */
+    bool render(const juce::File& outputFile, int bitDepth);
+
+    const AudioEngine::RenderStats& getStats() const { return stats; }
+    juce::String getLastError() const { return lastError; }
+
+    /** Extra time rendered after the last event so release and FX tails are not cut. */
+    static constexpr double tailSeconds = 2.0;
+
+private:
+    //==========================================================================
+    // MidiPlayerListener - routes events to the render copies (render thread)
+    void midiNoteOn(int channel, int note, float velocity, int sampleOffset) override;
+    void midiNoteOff(int channel, int note, int sampleOffset) override;
+    void midiProgramChange(int channel, int program, int bank) override;
+
+    void renderBlock(juce::AudioBuffer<float>& block, int numSamples, double timelineSeconds);
+    static void renderTrackJob(void* context, int jobIndex);
+
+    AudioEngine::Track* getTrack(int index) const noexcept;
+
+    struct TrackRenderJob
+    {
+        AudioEngine::Track* track = nullptr;
+        juce::AudioBuffer<float>* destination = nullptr;
+    };
+
+    juce::AudioFormatManager& formatManager;
+    const ExpansionInstrumentLoader& expansionLoader;
+    const double sampleRate;
+    const int blockSize;
+
+    MidiPlayer player;
+    std::vector<std::unique_ptr<AudioEngine::Track>> tracks;
+    Audio::MixerGraph mixer;
+    juce::MidiBuffer mixerMidi;
+
+    AudioWorkerPool workerPool;
+    std::vector<TrackRenderJob> renderJobs;
+    int renderJobSamples = 0;
+
+    // Size of the FIFO between the render loop and the disk writer thread
+    static constexpr int writerFifoSamples = 65536;
+
+    AudioEngine::RenderStats stats;
+    juce::String lastError;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OfflineRenderer)
+};
+
+} // namespace mmg
@@ -11,11 +11,18 @@ namespace Audio
     class CompressorProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Threshold, Ratio, Attack, Release };
+
         CompressorProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
+            addProcessorParameter("threshold", { -60.0f, 0.0f }, -20.0f);
+            addProcessorParameter("ratio", { 1.0f, 20.0f }, 4.0f);
+            addProcessorParameter("attack", { 0.1f, 100.0f }, 10.0f);
+            addProcessorParameter("release", { 10.0f, 1000.0f }, 100.0f);
         }
 
         const juce::String getName() const override { return "Compressor"; }
@@ -28,64 +35,51 @@ namespace Audio
             spec.numChannels = 2;
             
             compressor.prepare(spec);
+            prepareParameters(sampleRate);
+            updateCompressor();
+        }
+
+        void reset() override
+        {
+            compressor.reset();
+            resetParameters();
             updateCompressor();
         }
 
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            if (!enabled)
+            if (!isEnabled())
                 return;
+            
+            updateParameters();
+            
+            processInControlSpans(buffer, [this](juce::AudioBuffer<float>& span)
+            {
+                updateCompressor();
                 
-            juce::dsp::AudioBlock<float> block(buffer);
-            juce::dsp::ProcessContextReplacing<float> context(block);
-            compressor.process(context);
+                juce::dsp::AudioBlock<float> block(span);
+                juce::dsp::ProcessContextReplacing<float> context(block);
+                compressor.process(context);
+            });
         }
 
-        // Parameters
-        void setThreshold(float thresholdDb)
-        {
-            threshold = juce::jlimit(-60.0f, 0.0f, thresholdDb);
-            updateCompressor();
-        }
-        
-        void setRatio(float r)
-        {
-            ratio = juce::jlimit(1.0f, 20.0f, r);
-            updateCompressor();
-        }
-        
-        void setAttack(float attackMs)
-        {
-            attack = juce::jlimit(0.1f, 100.0f, attackMs);
-            updateCompressor();
-        }
-        
-        void setRelease(float releaseMs)
-        {
-            release = juce::jlimit(10.0f, 1000.0f, releaseMs);
-            updateCompressor();
-        }
-        
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
+        // Parameters (any thread)
+        void setThreshold(float thresholdDb) { setProcessorParameter(Threshold, thresholdDb); }
+        void setRatio(float r) { setProcessorParameter(Ratio, r); }
+        void setAttack(float attackMs) { setProcessorParameter(Attack, attackMs); }
+        void setRelease(float releaseMs) { setProcessorParameter(Release, releaseMs); }
 
     private:
         void updateCompressor()
         {
-            compressor.setThreshold(threshold);
-            compressor.setRatio(ratio);
-            compressor.setAttack(attack);
-            compressor.setRelease(release);
+            compressor.setThreshold(getProcessorParameter(Threshold).getCurrentValue());
+            compressor.setRatio(getProcessorParameter(Ratio).getCurrentValue());
+            compressor.setAttack(getProcessorParameter(Attack).getCurrentValue());
+            compressor.setRelease(getProcessorParameter(Release).getCurrentValue());
         }
         
         juce::dsp::Compressor<float> compressor;
         
-        float threshold = -20.0f;
-        float ratio = 4.0f;
-        float attack = 10.0f;
-        float release = 100.0f;
-        bool enabled = true;
-        
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CompressorProcessor)
     };
 }
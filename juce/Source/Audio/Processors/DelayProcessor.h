@@ -2,108 +2,182 @@
 
 #include "ProcessorBase.h"
 #include <juce_dsp/juce_dsp.h>
+#include <array>
 
 namespace Audio
 {
     /**
      * Stereo delay processor with feedback.
+     *
+     * Processes in contiguous spans: while the delay time is steady, each
+     * channel reads a run of at most one delay length from the circular
+     * buffer and writes input + feedback back with vector operations. While
+     * any parameter ramps (a delay time glide or automation) it processes
+     * sample by sample with fractional reads, so moving a control does not click.
      */
     class DelayProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Time, Feedback, Wet, Dry };
+
         DelayProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
+            addParameterAlias("delay_time", addProcessorParameter("time", { 1.0f, 2000.0f }, 250.0f));
+            addProcessorParameter("feedback", { 0.0f, 0.95f }, 0.3f);
+            addProcessorParameter("wet", { 0.0f, 1.0f }, 0.3f);
+            addProcessorParameter("dry", { 0.0f, 1.0f }, 1.0f);
         }
 
         const juce::String getName() const override { return "Delay"; }
 
-        void prepareToPlay(double sampleRate, int samplesPerBlock) override
+        void prepareToPlay(double sampleRate, int /*samplesPerBlock*/) override
         {
-            currentSampleRate = sampleRate;
-            
-            juce::dsp::ProcessSpec spec;
-            spec.sampleRate = sampleRate;
-            spec.maximumBlockSize = static_cast<juce::uint32>(samplesPerBlock);
-            spec.numChannels = 2;
+            samplesPerMs = static_cast<float>(sampleRate / 1000.0);
             
-            // Max 2 seconds of delay
-            delayLine.setMaximumDelayInSamples(static_cast<int>(sampleRate * 2.0));
-            delayLine.prepare(spec);
+            // Max 2 seconds of delay (plus the frame being written)
+            bufferLength = static_cast<int>(sampleRate * 2.0) + 2;
+            delayBuffer.setSize(2, bufferLength);
+            delayBuffer.clear();
+            writePosition = 0;
             
-            updateDelay();
+            prepareParameters(sampleRate);
+        }
+
+        void reset() override
+        {
+            delayBuffer.clear();
+            writePosition = 0;
+            resetParameters();
         }
 
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            if (!enabled)
+            if (!isEnabled() || bufferLength == 0)
                 return;
-                
-            auto numSamples = buffer.getNumSamples();
-            auto numChannels = buffer.getNumChannels();
             
-            for (int sample = 0; sample < numSamples; ++sample)
+            updateParameters();
+            
+            const int numSamples = buffer.getNumSamples();
+            const int numChannels = juce::jmin(buffer.getNumChannels(), delayBuffer.getNumChannels());
+            
+            for (int done = 0; done < numSamples;)
             {
-                for (int channel = 0; channel < numChannels; ++channel)
+                if (isAnyParameterSmoothing())
                 {
-                    float inputSample = buffer.getSample(channel, sample);
-                    float delayedSample = delayLine.popSample(channel);
-                    
-                    // Push input + feedback to delay line
-                    delayLine.pushSample(channel, inputSample + (delayedSample * feedback));
-                    
-                    // Mix dry and wet
-                    float outputSample = (inputSample * dryLevel) + (delayedSample * wetLevel);
-                    buffer.setSample(channel, sample, outputSample);
+                    done += processGliding(buffer, numChannels, done, numSamples - done);
+                    continue;
                 }
+                
+                // A span no longer than the delay only reads frames written before it
+                const int delay = juce::jlimit(1, bufferLength - 1, static_cast<int>(getDelaySamples(getProcessorParameter(Time).getCurrentValue())));
+                const int spanLength = juce::jmin(numSamples - done, delay, spanSize);
+                
+                for (int channel = 0; channel < numChannels; ++channel)
+                    processSpan(channel, buffer.getWritePointer(channel, done), delay, spanLength);
+                
+                writePosition = wrap(writePosition + spanLength);
+                done += spanLength;
             }
         }
 
-        // Parameters
-        void setDelayTime(float timeMs)
-        {
-            delayTimeMs = juce::jlimit(1.0f, 2000.0f, timeMs);
-            updateDelay();
-        }
-        
-        void setFeedback(float fb)
+        // Parameters (any thread)
+        void setDelayTime(float timeMs) { setProcessorParameter(Time, timeMs); }
+        void setFeedback(float fb) { setProcessorParameter(Feedback, fb); }
+        void setWetLevel(float wet) { setProcessorParameter(Wet, wet); }
+        void setDryLevel(float dry) { setProcessorParameter(Dry, dry); }
+
+    private:
+        float getDelaySamples(float timeMs) const noexcept
         {
-            feedback = juce::jlimit(0.0f, 0.95f, fb);
+            return timeMs * samplesPerMs;
         }
         
-        void setWetLevel(float wet)
+        int wrap(int position) const noexcept
         {
-            wetLevel = juce::jlimit(0.0f, 1.0f, wet);
+            return position >= bufferLength ? position - bufferLength : position;
         }
         
-        void setDryLevel(float dry)
+        /** Steady parameters: read, feed back and mix one channel's span in bulk. */
+        void processSpan(int channel, float* data, int delay, int numSamples) noexcept
         {
-            dryLevel = juce::jlimit(0.0f, 1.0f, dry);
+            const float feedback = getProcessorParameter(Feedback).getCurrentValue();
+            const float wetLevel = getProcessorParameter(Wet).getCurrentValue();
+            const float dryLevel = getProcessorParameter(Dry).getCurrentValue();
+            
+            float* line = delayBuffer.getWritePointer(channel);
+            float* delayed = spanScratch.data();
+            
+            // Delayed signal, in up to two pieces around the end of the buffer
+            const int readPosition = wrap(writePosition - delay + bufferLength);
+            const int firstRead = juce::jmin(numSamples, bufferLength - readPosition);
+            juce::FloatVectorOperations::copy(delayed, line + readPosition, firstRead);
+            juce::FloatVectorOperations::copy(delayed + firstRead, line, numSamples - firstRead);
+            
+            // Push input + feedback to delay line
+            const int firstWrite = juce::jmin(numSamples, bufferLength - writePosition);
+            juce::FloatVectorOperations::copy(line + writePosition, data, firstWrite);
+            juce::FloatVectorOperations::addWithMultiply(line + writePosition, delayed, feedback, firstWrite);
+            juce::FloatVectorOperations::copy(line, data + firstWrite, numSamples - firstWrite);
+            juce::FloatVectorOperations::addWithMultiply(line, delayed + firstWrite, feedback, numSamples - firstWrite);
+            
+            // Mix dry and wet
+            juce::FloatVectorOperations::multiply(data, dryLevel, numSamples);
+            juce::FloatVectorOperations::addWithMultiply(data, delayed, wetLevel, numSamples);
         }
         
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
-
-    private:
-        void updateDelay()
+        /** Parameters ramping: fractional reads, one sample at a time. Returns samples processed. */
+        int processGliding(juce::AudioBuffer<float>& buffer, int numChannels, int startSample, int numSamples) noexcept
         {
-            if (currentSampleRate > 0.0)
+            auto& time = getProcessorParameter(Time);
+            auto& feedbackParameter = getProcessorParameter(Feedback);
+            auto& wetParameter = getProcessorParameter(Wet);
+            auto& dryParameter = getProcessorParameter(Dry);
+            
+            int sample = 0;
+            for (; sample < numSamples && isAnyParameterSmoothing(); ++sample)
             {
-                int delaySamples = static_cast<int>((delayTimeMs / 1000.0) * currentSampleRate);
-                delayLine.setDelay(static_cast<float>(delaySamples));
+                const float delay = juce::jlimit(1.0f, static_cast<float>(bufferLength - 2), getDelaySamples(time.getNextValue()));
+                const float feedback = feedbackParameter.getNextValue();
+                const float wetLevel = wetParameter.getNextValue();
+                const float dryLevel = dryParameter.getNextValue();
+                
+                float readPosition = static_cast<float>(writePosition) - delay;
+                if (readPosition < 0.0f)
+                    readPosition += static_cast<float>(bufferLength);
+                
+                const int index0 = static_cast<int>(readPosition);
+                const int index1 = wrap(index0 + 1);
+                const float fraction = readPosition - static_cast<float>(index0);
+                
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    float* line = delayBuffer.getWritePointer(channel);
+                    float* data = buffer.getWritePointer(channel, startSample + sample);
+                    
+                    const float input = *data;
+                    const float delayedSample = line[index0] + fraction * (line[index1] - line[index0]);
+                    
+                    line[writePosition] = input + delayedSample * feedback;
+                    *data = (input * dryLevel) + (delayedSample * wetLevel);
+                }
+                
+                writePosition = wrap(writePosition + 1);
             }
+            
+            return sample;
         }
         
-        juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayLine { 88200 };
+        static constexpr int spanSize = 256;
         
-        double currentSampleRate = 44100.0;
-        float delayTimeMs = 250.0f;
-        float feedback = 0.3f;
-        float wetLevel = 0.3f;
-        float dryLevel = 1.0f;
-        bool enabled = true;
+        juce::AudioBuffer<float> delayBuffer;
+        int bufferLength = 0;
+        int writePosition = 0;
+        float samplesPerMs = 44.1f;
+        std::array<float, spanSize> spanScratch {};
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DelayProcessor)
     };
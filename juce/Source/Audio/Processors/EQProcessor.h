@@ -2,6 +2,7 @@
 
 #include "ProcessorBase.h"
 #include <juce_dsp/juce_dsp.h>
+#include <limits>
 
 namespace Audio
 {
@@ -11,11 +12,17 @@ namespace Audio
     class EQProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { LowGain, MidGain, HighGain };
+
         EQProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
+            addProcessorParameter("low_gain", { -12.0f, 12.0f }, 0.0f);
+            addProcessorParameter("mid_gain", { -12.0f, 12.0f }, 0.0f);
+            addProcessorParameter("high_gain", { -12.0f, 12.0f }, 0.0f);
         }
 
         const juce::String getName() const override { return "EQ"; }
@@ -33,72 +40,89 @@ namespace Audio
             midPeak.prepare(spec);
             highShelf.prepare(spec);
             
+            prepareParameters(sampleRate);
             updateFilters();
         }
 
-        void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
+        void reset() override
         {
-            if (!enabled)
-                return;
-                
-            juce::dsp::AudioBlock<float> block(buffer);
-            juce::dsp::ProcessContextReplacing<float> context(block);
+            lowShelf.reset();
+            midPeak.reset();
+            highShelf.reset();
             
-            lowShelf.process(context);
-            midPeak.process(context);
-            highShelf.process(context);
-        }
-
-        // Parameters
-        void setLowGain(float gainDb)
-        {
-            lowGainDb = juce::jlimit(-12.0f, 12.0f, gainDb);
+            resetParameters();
             updateFilters();
         }
-        
-        void setMidGain(float gainDb)
-        {
-            midGainDb = juce::jlimit(-12.0f, 12.0f, gainDb);
-            updateFilters();
-        }
-        
-        void setHighGain(float gainDb)
+
+        void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            highGainDb = juce::jlimit(-12.0f, 12.0f, gainDb);
-            updateFilters();
+            if (!isEnabled())
+                return;
+            
+            updateParameters();
+            
+            processInControlSpans(buffer, [this](juce::AudioBuffer<float>& span)
+            {
+                updateFilters();
+                
+                juce::dsp::AudioBlock<float> block(span);
+                juce::dsp::ProcessContextReplacing<float> context(block);
+                
+                lowShelf.process(context);
+                midPeak.process(context);
+                highShelf.process(context);
+            });
         }
-        
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
+
+        // Parameters (any thread)
+        void setLowGain(float gainDb) { setProcessorParameter(LowGain, gainDb); }
+        void setMidGain(float gainDb) { setProcessorParameter(MidGain, gainDb); }
+        void setHighGain(float gainDb) { setProcessorParameter(HighGain, gainDb); }
 
     private:
+        /** Recompute the coefficients of any band whose gain moved. Audio thread; does not allocate. */
         void updateFilters()
         {
             if (currentSampleRate <= 0.0)
                 return;
-                
+            
+            using Coefficients = juce::dsp::IIR::ArrayCoefficients<float>;
+            
             // Low shelf at 200 Hz
-            *lowShelf.state = *juce::dsp::IIR::Coefficients<float>::makeLowShelf(
-                currentSampleRate, 200.0f, 0.707f, juce::Decibels::decibelsToGain(lowGainDb));
+            if (const float gainDb = getProcessorParameter(LowGain).getCurrentValue(); gainDb != appliedLowGainDb)
+            {
+                *lowShelf.state = Coefficients::makeLowShelf(currentSampleRate, 200.0f, 0.707f,
+                                                             juce::Decibels::decibelsToGain(gainDb));
+                appliedLowGainDb = gainDb;
+            }
             
             // Mid peak at 1 kHz
-            *midPeak.state = *juce::dsp::IIR::Coefficients<float>::makePeakFilter(
-                currentSampleRate, 1000.0f, 1.0f, juce::Decibels::decibelsToGain(midGainDb));
+            if (const float gainDb = getProcessorParameter(MidGain).getCurrentValue(); gainDb != appliedMidGainDb)
+            {
+                *midPeak.state = Coefficients::makePeakFilter(currentSampleRate, 1000.0f, 1.0f,
+                                                              juce::Decibels::decibelsToGain(gainDb));
+                appliedMidGainDb = gainDb;
+            }
             
             // High shelf at 5 kHz
-            *highShelf.state = *juce::dsp::IIR::Coefficients<float>::makeHighShelf(
-                currentSampleRate, 5000.0f, 0.707f, juce::Decibels::decibelsToGain(highGainDb));
+            if (const float gainDb = getProcessorParameter(HighGain).getCurrentValue(); gainDb != appliedHighGainDb)
+            {
+                *highShelf.state = Coefficients::makeHighShelf(currentSampleRate, 5000.0f, 0.707f,
+                                                               juce::Decibels::decibelsToGain(gainDb));
+                appliedHighGainDb = gainDb;
+            }
         }
         
         juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>> lowShelf;
         juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>> midPeak;
         juce::dsp::ProcessorDuplicator<juce::dsp::IIR::Filter<float>, juce::dsp::IIR::Coefficients<float>> highShelf;
         
-        double currentSampleRate = 44100.0;
-        float lowGainDb = 0.0f;
-        float midGainDb = 0.0f;
-        float highGainDb = 0.0f;
-        bool enabled = true;
+        double currentSampleRate = 0.0;
+        
+        // Gains the current coefficients were built for (NaN forces the first build)
+        float appliedLowGainDb = std::numeric_limits<float>::quiet_NaN();
+        float appliedMidGainDb = std::numeric_limits<float>::quiet_NaN();
+        float appliedHighGainDb = std::numeric_limits<float>::quiet_NaN();
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(EQProcessor)
     };
@@ -6,43 +6,60 @@ namespace Audio
         : ProcessorBase(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true)
                                          .withOutput("Output", juce::AudioChannelSet::stereo(), true))
     {
-        gain.setGainLinear(1.0f);
+        addProcessorParameter("gain", { -100.0f, 24.0f }, 0.0f); // dB; the bottom of the range is silence
     }
 
     void GainProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     {
-        spec.sampleRate = sampleRate;
-        spec.maximumBlockSize = samplesPerBlock;
-        spec.numChannels = getTotalNumOutputChannels();
-
-        gain.prepare(spec);
-        gain.setRampDurationSeconds(0.05); // Smooth parameter changes
+        prepareParameters(sampleRate); // Smooth parameter changes
     }
 
     void GainProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
     {
-        juce::dsp::AudioBlock<float> block(buffer);
-        juce::dsp::ProcessContextReplacing<float> context(block);
-        gain.process(context);
+        updateParameters();
+
+        auto& gain = getProcessorParameter(Gain);
+        const int numSamples = buffer.getNumSamples();
+
+        for (int start = 0; start < numSamples;)
+        {
+            const int spanLength = juce::jmin(spanSize, numSamples - start);
+
+            if (!gain.isSmoothing())
+            {
+                // Steady: one multiply per channel for the rest of the block
+                const float level = juce::Decibels::decibelsToGain(gain.getCurrentValue(), -100.0f);
+                buffer.applyGain(start, numSamples - start, level);
+                break;
+            }
+
+            for (int i = 0; i < spanLength; ++i)
+                gainRamp[(size_t)i] = juce::Decibels::decibelsToGain(gain.getNextValue(), -100.0f);
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                juce::FloatVectorOperations::multiply(buffer.getWritePointer(channel, start), gainRamp.data(), spanLength);
+
+            start += spanLength;
+        }
     }
 
     void GainProcessor::reset()
     {
-        gain.reset();
+        resetParameters();
     }
 
     void GainProcessor::setGainLinear(float newGain)
     {
-        gain.setGainLinear(newGain);
+        setGainDecibels(juce::Decibels::gainToDecibels(newGain, -100.0f));
     }
 
     void GainProcessor::setGainDecibels(float newGainDb)
     {
-        gain.setGainDecibels(newGainDb);
+        setProcessorParameter(Gain, newGainDb);
     }
 
     float GainProcessor::getGainLinear() const
     {
-        return gain.getGainLinear();
+        return juce::Decibels::decibelsToGain(getProcessorParameter(Gain).getValue(), -100.0f);
     }
 }
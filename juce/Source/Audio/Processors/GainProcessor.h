@@ -2,12 +2,16 @@
 
 #include "ProcessorBase.h"
 #include <juce_dsp/juce_dsp.h>
+#include <array>
 
 namespace Audio
 {
     class GainProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Gain };
+
         GainProcessor();
         ~GainProcessor() override = default;
 
@@ -17,14 +21,14 @@ namespace Audio
 
         const juce::String getName() const override { return "Gain"; }
 
-        // Parameter handling
+        // Parameter handling (any thread)
         void setGainLinear(float newGain);
         void setGainDecibels(float newGainDb);
         float getGainLinear() const;
 
     private:
-        juce::dsp::Gain<float> gain;
-        juce::dsp::ProcessSpec spec;
+        static constexpr int spanSize = 256;
+        std::array<float, spanSize> gainRamp {};
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GainProcessor)
     };
@@ -11,11 +11,16 @@ namespace Audio
     class LimiterProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Threshold, Release };
+
         LimiterProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
+            addProcessorParameter("threshold", { -20.0f, 0.0f }, -1.0f);
+            addProcessorParameter("release", { 1.0f, 500.0f }, 100.0f);
         }
 
         const juce::String getName() const override { return "Limiter"; }
@@ -28,48 +33,47 @@ namespace Audio
             spec.numChannels = 2;
             
             limiter.prepare(spec);
+            prepareParameters(sampleRate);
+            updateLimiter();
+        }
+
+        void reset() override
+        {
+            limiter.reset();
+            resetParameters();
             updateLimiter();
         }
 
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            if (!enabled)
+            if (!isEnabled())
                 return;
+            
+            updateParameters();
+            
+            processInControlSpans(buffer, [this](juce::AudioBuffer<float>& span)
+            {
+                updateLimiter();
                 
-            juce::dsp::AudioBlock<float> block(buffer);
-            juce::dsp::ProcessContextReplacing<float> context(block);
-            limiter.process(context);
+                juce::dsp::AudioBlock<float> block(span);
+                juce::dsp::ProcessContextReplacing<float> context(block);
+                limiter.process(context);
+            });
         }
 
-        // Parameters
-        void setThreshold(float thresholdDb)
-        {
-            threshold = juce::jlimit(-20.0f, 0.0f, thresholdDb);
-            updateLimiter();
-        }
-        
-        void setRelease(float releaseMs)
-        {
-            release = juce::jlimit(1.0f, 500.0f, releaseMs);
-            updateLimiter();
-        }
-        
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
+        // Parameters (any thread)
+        void setThreshold(float thresholdDb) { setProcessorParameter(Threshold, thresholdDb); }
+        void setRelease(float releaseMs) { setProcessorParameter(Release, releaseMs); }
 
     private:
         void updateLimiter()
         {
-            limiter.setThreshold(threshold);
-            limiter.setRelease(release);
+            limiter.setThreshold(getProcessorParameter(Threshold).getCurrentValue());
+            limiter.setRelease(getProcessorParameter(Release).getCurrentValue());
         }
         
         juce::dsp::Limiter<float> limiter;
         
-        float threshold = -1.0f;
-        float release = 100.0f;
-        bool enabled = true;
-        
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LimiterProcessor)
     };
 }
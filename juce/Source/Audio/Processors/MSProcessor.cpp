@@ -6,22 +6,14 @@ namespace Audio
         : ProcessorBase(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true)
                                          .withOutput("Output", juce::AudioChannelSet::stereo(), true))
     {
-        // Initialize smoothed values with defaults
-        smoothedWidth.reset(44100.0, smoothingTimeSeconds);
-        smoothedWidth.setCurrentAndTargetValue(1.0f);
-
-        smoothedMidGain.reset(44100.0, smoothingTimeSeconds);
-        smoothedMidGain.setCurrentAndTargetValue(1.0f);
-
-        smoothedSideGain.reset(44100.0, smoothingTimeSeconds);
-        smoothedSideGain.setCurrentAndTargetValue(1.0f);
+        addProcessorParameter("width", { 0.0f, 2.0f }, 1.0f, smoothingTimeSeconds);
+        addProcessorParameter("mid_gain", { -12.0f, 12.0f }, 0.0f, smoothingTimeSeconds);
+        addProcessorParameter("side_gain", { -12.0f, 12.0f }, 0.0f, smoothingTimeSeconds);
     }
 
     void MSProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     {
-        smoothedWidth.reset(sampleRate, smoothingTimeSeconds);
-        smoothedMidGain.reset(sampleRate, smoothingTimeSeconds);
-        smoothedSideGain.reset(sampleRate, smoothingTimeSeconds);
+        prepareParameters(sampleRate);
     }
 
     void MSProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
@@ -30,59 +22,71 @@ namespace Audio
         if (buffer.getNumChannels() < 2)
             return;
 
+        updateParameters();
+
+        auto& width = getProcessorParameter(Width);
+        auto& midGainDb = getProcessorParameter(MidGain);
+        auto& sideGainDb = getProcessorParameter(SideGain);
+
         const int numSamples = buffer.getNumSamples();
         auto* leftChannel = buffer.getWritePointer(0);
         auto* rightChannel = buffer.getWritePointer(1);
 
-        for (int i = 0; i < numSamples; ++i)
+        int i = 0;
+        for (; i < numSamples && isAnyParameterSmoothing(); ++i)
         {
             // Get smoothed parameter values
-            const float width = smoothedWidth.getNextValue();
-            const float midGain = smoothedMidGain.getNextValue();
-            const float sideGain = smoothedSideGain.getNextValue();
+            const float sampleWidth = width.getNextValue();
+            const float midGain = juce::Decibels::decibelsToGain(midGainDb.getNextValue());
+            const float sideGain = juce::Decibels::decibelsToGain(sideGainDb.getNextValue());
+
+            processSteady(leftChannel, rightChannel, i, i + 1, sampleWidth, midGain, sideGain);
+        }
 
-            // Read input samples
-            const float left = leftChannel[i];
-            const float right = rightChannel[i];
+        // Width and M/S gains have settled: the dB conversions happen once for the remainder
+        processSteady(leftChannel, rightChannel, i, numSamples, width.getCurrentValue(),
+                      juce::Decibels::decibelsToGain(midGainDb.getCurrentValue()),
+                      juce::Decibels::decibelsToGain(sideGainDb.getCurrentValue()));
+    }
 
+    void MSProcessor::processSteady(float* left, float* right, int start, int end,
+                                    float width, float midGain, float sideGain) noexcept
+    {
+        const float sideScale = sideGain * width;
+
+        for (int i = start; i < end; ++i)
+        {
             // Encode L/R to M/S
-            const float mid = (left + right) * 0.5f;
-            const float side = (left - right) * 0.5f;
+            const float mid = (left[i] + right[i]) * 0.5f;
+            const float side = (left[i] - right[i]) * 0.5f;
 
             // Apply gains and width
             const float midProcessed = mid * midGain;
-            const float sideProcessed = side * sideGain * width;
+            const float sideProcessed = side * sideScale;
 
             // Decode M/S back to L/R
-            leftChannel[i] = midProcessed + sideProcessed;
-            rightChannel[i] = midProcessed - sideProcessed;
+            left[i] = midProcessed + sideProcessed;
+            right[i] = midProcessed - sideProcessed;
         }
     }
 
     void MSProcessor::reset()
     {
-        smoothedWidth.setCurrentAndTargetValue(targetWidth);
-        smoothedMidGain.setCurrentAndTargetValue(midGainLinear);
-        smoothedSideGain.setCurrentAndTargetValue(sideGainLinear);
+        resetParameters();
     }
 
     void MSProcessor::setWidth(float newWidth)
     {
-        targetWidth = juce::jlimit(0.0f, 2.0f, newWidth);
-        smoothedWidth.setTargetValue(targetWidth);
+        setProcessorParameter(Width, newWidth);
     }
 
     void MSProcessor::setMidGain(float gainDb)
     {
-        midGainDb = juce::jlimit(-12.0f, 12.0f, gainDb);
-        midGainLinear = juce::Decibels::decibelsToGain(midGainDb);
-        smoothedMidGain.setTargetValue(midGainLinear);
+        setProcessorParameter(MidGain, gainDb);
     }
 
     void MSProcessor::setSideGain(float gainDb)
     {
-        sideGainDb = juce::jlimit(-12.0f, 12.0f, gainDb);
-        sideGainLinear = juce::Decibels::decibelsToGain(sideGainDb);
-        smoothedSideGain.setTargetValue(sideGainLinear);
+        setProcessorParameter(SideGain, gainDb);
     }
 }
@@ -14,12 +14,15 @@ namespace Audio
      * 
      * Parameters:
      *   - width: 0.0 (mono) to 2.0 (extra wide), default 1.0
-     *   - midGain: -12dB to +12dB, default 0dB
-     *   - sideGain: -12dB to +12dB, default 0dB
+     *   - mid_gain: -12dB to +12dB, default 0dB
+     *   - side_gain: -12dB to +12dB, default 0dB
      */
     class MSProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Width, MidGain, SideGain };
+
         MSProcessor();
         ~MSProcessor() override = default;
 
@@ -34,34 +37,26 @@ namespace Audio
          * @param newWidth 0.0 (mono) to 2.0 (extra wide)
          */
         void setWidth(float newWidth);
-        float getWidth() const { return targetWidth; }
+        float getWidth() const { return getProcessorParameter(Width).getValue(); }
 
         /**
          * Set mid channel gain.
          * @param gainDb -12dB to +12dB
          */
         void setMidGain(float gainDb);
-        float getMidGain() const { return midGainDb; }
+        float getMidGain() const { return getProcessorParameter(MidGain).getValue(); }
 
         /**
          * Set side channel gain.
          * @param gainDb -12dB to +12dB
          */
         void setSideGain(float gainDb);
-        float getSideGain() const { return sideGainDb; }
+        float getSideGain() const { return getProcessorParameter(SideGain).getValue(); }
 
     private:
-        // Target parameter values
-        float targetWidth = 1.0f;
-        float midGainDb = 0.0f;
-        float sideGainDb = 0.0f;
-        float midGainLinear = 1.0f;
-        float sideGainLinear = 1.0f;
-
-        // Smoothed values for click-free parameter changes
-        juce::LinearSmoothedValue<float> smoothedWidth;
-        juce::LinearSmoothedValue<float> smoothedMidGain;
-        juce::LinearSmoothedValue<float> smoothedSideGain;
+        /** Encode, scale and decode samples [start, end) with fixed gains. */
+        static void processSteady(float* left, float* right, int start, int end,
+                                  float width, float midGain, float sideGain) noexcept;
 
         // Smoothing time in seconds
         static constexpr double smoothingTimeSeconds = 0.02; // 20ms
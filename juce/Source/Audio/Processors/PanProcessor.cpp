@@ -2,17 +2,27 @@
 
 namespace Audio
 {
+    namespace
+    {
+        // Constant power panning: pan is -1 to 1, normalised to 0 to 1
+        inline void getPanGains(float pan, float& gainL, float& gainR) noexcept
+        {
+            const float normPan = (pan + 1.0f) * 0.5f;
+            gainL = std::cos(normPan * juce::MathConstants<float>::halfPi);
+            gainR = std::sin(normPan * juce::MathConstants<float>::halfPi);
+        }
+    }
+
     PanProcessor::PanProcessor()
         : ProcessorBase(BusesProperties().withInput("Input", juce::AudioChannelSet::stereo(), true)
                                          .withOutput("Output", juce::AudioChannelSet::stereo(), true))
     {
-        smoothedPan.reset(44100.0, 0.05); // Default, updated in prepareToPlay
-        smoothedPan.setCurrentAndTargetValue(0.0f);
+        addProcessorParameter("pan", { -1.0f, 1.0f }, 0.0f); // 50ms smoothing
     }
 
     void PanProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     {
-        smoothedPan.reset(sampleRate, 0.05); // 50ms smoothing
+        prepareParameters(sampleRate);
     }
 
     void PanProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
@@ -21,35 +31,39 @@ namespace Audio
         if (buffer.getNumChannels() != 2)
             return;
 
+        updateParameters();
+
+        auto& pan = getProcessorParameter(Pan);
         const int numSamples = buffer.getNumSamples();
         auto* left = buffer.getWritePointer(0);
         auto* right = buffer.getWritePointer(1);
 
-        for (int i = 0; i < numSamples; ++i)
-        {
-            float pan = smoothedPan.getNextValue();
-            
-            // Constant power panning
-            // pan is -1 to 1
-            // normalized to 0 to 1
-            float normPan = (pan + 1.0f) * 0.5f;
-            
-            float gainL = std::cos(normPan * juce::MathConstants<float>::halfPi);
-            float gainR = std::sin(normPan * juce::MathConstants<float>::halfPi);
+        float gainL, gainR;
 
+        int i = 0;
+        for (; i < numSamples && pan.isSmoothing(); ++i)
+        {
+            getPanGains(pan.getNextValue(), gainL, gainR);
             left[i] *= gainL;
             right[i] *= gainR;
         }
+
+        // Pan has settled: one pair of gains scales the remaining samples
+        if (i < numSamples)
+        {
+            getPanGains(pan.getCurrentValue(), gainL, gainR);
+            juce::FloatVectorOperations::multiply(left + i, gainL, numSamples - i);
+            juce::FloatVectorOperations::multiply(right + i, gainR, numSamples - i);
+        }
     }
 
     void PanProcessor::reset()
     {
-        smoothedPan.setCurrentAndTargetValue(currentPan);
+        resetParameters();
     }
 
     void PanProcessor::setPan(float newPan)
     {
-        currentPan = juce::jlimit(-1.0f, 1.0f, newPan);
-        smoothedPan.setTargetValue(currentPan);
+        setProcessorParameter(Pan, newPan);
     }
 }
@@ -7,6 +7,9 @@ namespace Audio
     class PanProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Pan };
+
         PanProcessor();
         ~PanProcessor() override = default;
 
@@ -21,11 +24,9 @@ namespace Audio
          * @param newPan -1.0 (left) to 1.0 (right)
          */
         void setPan(float newPan);
-        float getPan() const { return currentPan; }
+        float getPan() const { return getProcessorParameter(Pan).getValue(); }
 
     private:
-        float currentPan = 0.0f;
-        juce::LinearSmoothedValue<float> smoothedPan;
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PanProcessor)
     };
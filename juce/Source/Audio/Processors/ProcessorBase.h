@@ -2,12 +2,22 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_core/juce_core.h>
+#include "ProcessorParameter.h"
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace Audio
 {
     /**
      * Base class for internal audio processors used in the mixer graph.
      * Simplifies the AudioProcessor boilerplate for internal FX.
+     *
+     * Each processor declares its ProcessorParameters in its constructor. Any
+     * thread may set them by index (resolve names once with
+     * findProcessorParameter); the processor applies them on the audio thread.
      */
     class ProcessorBase : public juce::AudioProcessor
     {
@@ -46,7 +56,114 @@ namespace Audio
         void getStateInformation(juce::MemoryBlock& destData) override {}
         void setStateInformation(const void* data, int sizeInBytes) override {}
 
+        //==============================================================================
+        // Parameters
+
+        int getNumProcessorParameters() const noexcept { return (int)parameters.size(); }
+        ProcessorParameter& getProcessorParameter(int index) noexcept { return *parameters[(size_t)index]; }
+        const ProcessorParameter& getProcessorParameter(int index) const noexcept { return *parameters[(size_t)index]; }
+
+        /** Index of the parameter with this id or alias, or -1. */
+        int findProcessorParameter(const juce::String& parameterId) const
+        {
+            auto it = parameterIndices.find(parameterId);
+            return it != parameterIndices.end() ? it->second : -1;
+        }
+
+        /** Set a parameter from any thread; the audio thread glides to the new value. */
+        void setProcessorParameter(int index, float value)
+        {
+            parameters[(size_t)index]->setValue(value);
+            processorParameterChanged(index);
+        }
+
+        /** A disabled processor passes audio through untouched. */
+        virtual void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled); }
+        bool isEnabled() const noexcept { return enabled.load(); }
+
+    protected:
+        static constexpr double defaultSmoothingSeconds = 0.05;
+
+        /** Block-based DSP follows parameter ramps in spans of at most this many samples. */
+        static constexpr int controlInterval = 32;
+
+        /** Declare a parameter; constructors only. Returns its index. */
+        int addProcessorParameter(const juce::String& parameterId, juce::NormalisableRange<float> range,
+                                  float defaultValue, double smoothingSeconds = defaultSmoothingSeconds,
+                                  bool automatable = true)
+        {
+            const int index = (int)parameters.size();
+            parameters.push_back(std::make_unique<ProcessorParameter>(parameterId, range, defaultValue,
+                                                                      smoothingSeconds, automatable));
+            parameterIndices[parameterId] = index;
+            return index;
+        }
+
+        /** Accept another name for a parameter in findProcessorParameter(). */
+        void addParameterAlias(const juce::String& alias, int index) { parameterIndices[alias] = index; }
+
+        /** Called by setProcessorParameter(), on the thread that set it. */
+        virtual void processorParameterChanged(int /*index*/) {}
+
+        /** From prepareToPlay: apply the smoothing times for this rate and jump to the set values. */
+        void prepareParameters(double sampleRate) noexcept
+        {
+            for (auto& parameter : parameters)
+                parameter->prepare(sampleRate);
+        }
+
+        /** From reset: jump to the set values. */
+        void resetParameters() noexcept
+        {
+            for (auto& parameter : parameters)
+                parameter->reset();
+        }
+
+        /** From the start of processBlock: pick up new values and automation. */
+        void updateParameters() noexcept
+        {
+            for (auto& parameter : parameters)
+                parameter->update();
+        }
+
+        bool isAnyParameterSmoothing() const noexcept
+        {
+            for (const auto& parameter : parameters)
+                if (parameter->isSmoothing())
+                    return true;
+            return false;
+        }
+
+        /**
+         * Call processSpan(span) over the buffer in spans of at most controlInterval
+         * samples while any parameter ramps (one span otherwise). Every parameter is
+         * advanced to the end of a span before it is processed.
+         */
+        template <typename ProcessSpan>
+        void processInControlSpans(juce::AudioBuffer<float>& buffer, ProcessSpan&& processSpan)
+        {
+            const int numSamples = buffer.getNumSamples();
+
+            for (int start = 0; start < numSamples;)
+            {
+                const int spanLength = isAnyParameterSmoothing() ? juce::jmin(controlInterval, numSamples - start)
+                                                                 : numSamples - start;
+
+                for (auto& parameter : parameters)
+                    parameter->skip(spanLength);
+
+                juce::AudioBuffer<float> span(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, spanLength);
+                processSpan(span);
+
+                start += spanLength;
+            }
+        }
+
     private:
+        std::vector<std::unique_ptr<ProcessorParameter>> parameters;
+        std::map<juce::String, int> parameterIndices;
+        std::atomic<bool> enabled { true };
+
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProcessorBase)
     };
 }
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+#include <utility>
+
+namespace Audio
+{
+    /**
+     * One parameter of an internal processor.
+     *
+     * The value is stored atomically, so any thread may set it. The audio thread
+     * picks it up at the start of each processBlock (update()) and glides there
+     * linearly over the smoothing time. Automation takes over for a single
+     * processBlock call by ramping between two lane values (automate()); the
+     * mixer splits blocks at lane breakpoints, so automation is sample-accurate.
+     */
+    class ProcessorParameter
+    {
+    public:
+        ProcessorParameter(const juce::String& parameterId, juce::NormalisableRange<float> valueRange,
+                           float defaultParameterValue, double smoothingTimeSeconds, bool canBeAutomated)
+            : id(parameterId),
+              range(valueRange),
+              defaultValue(range.snapToLegalValue(defaultParameterValue)),
+              smoothingSeconds(smoothingTimeSeconds),
+              automatable(canBeAutomated),
+              value(defaultValue),
+              current(defaultValue),
+              target(defaultValue)
+        {
+        }
+
+        const juce::String& getId() const noexcept { return id; }
+        const juce::NormalisableRange<float>& getRange() const noexcept { return range; }
+        float getDefaultValue() const noexcept { return defaultValue; }
+
+        /** False for settings that change the processor's latency (e.g. oversampling). */
+        bool isAutomatable() const noexcept { return automatable; }
+
+        //==============================================================================
+        // Any thread
+
+        void setValue(float newValue) noexcept { value.store(range.snapToLegalValue(newValue)); }
+        float getValue() const noexcept { return value.load(); }
+
+        //==============================================================================
+        // Audio thread (or before playback starts)
+
+        void prepare(double sampleRate) noexcept
+        {
+            smoothingSamples = juce::roundToInt(sampleRate * smoothingSeconds);
+            reset();
+        }
+
+        /** Jump to the stored value. */
+        void reset() noexcept
+        {
+            current = target = value.load();
+            countdown = 0;
+            automated = false;
+        }
+
+        /** Head for the stored value, unless automate() was called since the last update. */
+        void update() noexcept
+        {
+            if (std::exchange(automated, false))
+                return;
+
+            const float newTarget = value.load();
+            if (newTarget != target)
+                rampTo(newTarget, smoothingSamples);
+        }
+
+        /** Ramp from start to end over numSamples, ignoring the stored value until the next update(). */
+        void automate(float start, float end, int numSamples) noexcept
+        {
+            current = range.snapToLegalValue(start);
+            rampTo(range.snapToLegalValue(end), numSamples);
+            automated = true;
+        }
+
+        float getNextValue() noexcept
+        {
+            if (countdown <= 0)
+                return current;
+
+            current = --countdown == 0 ? target : current + step;
+            return current;
+        }
+
+        void skip(int numSamples) noexcept
+        {
+            if (countdown <= 0)
+                return;
+
+            if (numSamples >= countdown)
+            {
+                current = target;
+                countdown = 0;
+            }
+            else
+            {
+                current += step * (float)numSamples;
+                countdown -= numSamples;
+            }
+        }
+
+        float getCurrentValue() const noexcept { return current; }
+        float getTargetValue() const noexcept { return target; }
+        bool isSmoothing() const noexcept { return countdown > 0; }
+
+    private:
+        void rampTo(float newTarget, int numSamples) noexcept
+        {
+            target = newTarget;
+            countdown = (numSamples > 0 && newTarget != current) ? numSamples : 0;
+
+            if (countdown == 0)
+                current = target;
+            else
+                step = (target - current) / (float)countdown;
+        }
+
+        const juce::String id;
+        const juce::NormalisableRange<float> range;
+        const float defaultValue;
+        const double smoothingSeconds;
+        const bool automatable;
+
+        std::atomic<float> value;
+
+        // Audio thread
+        float current;
+        float target;
+        float step = 0.0f;
+        int countdown = 0;
+        int smoothingSamples = 0;
+        bool automated = false;
+
+        JUCE_DECLARE_NON_COPYABLE(ProcessorParameter)
+    };
+}
@@ -11,11 +11,19 @@ namespace Audio
     class ReverbProcessor : public ProcessorBase
     {
     public:
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { RoomSize, Damping, Wet, Dry, Width };
+
         ReverbProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
+            addProcessorParameter("room_size", { 0.0f, 1.0f }, 0.5f);
+            addProcessorParameter("damping", { 0.0f, 1.0f }, 0.5f);
+            addProcessorParameter("wet", { 0.0f, 1.0f }, 0.3f);
+            addProcessorParameter("dry", { 0.0f, 1.0f }, 0.7f);
+            addProcessorParameter("width", { 0.0f, 1.0f }, 1.0f);
             updateReverb();
         }
 
@@ -29,73 +37,66 @@ namespace Audio
             spec.numChannels = 2;
             
             reverb.prepare(spec);
+            prepareParameters(sampleRate);
+            updateReverb();
+        }
+
+        void reset() override
+        {
+            reverb.reset();
+            resetParameters();
+            updateReverb();
         }
 
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            if (!enabled)
+            if (!isEnabled())
                 return;
+            
+            updateParameters();
+            
+            processInControlSpans(buffer, [this](juce::AudioBuffer<float>& span)
+            {
+                updateReverb();
                 
-            juce::dsp::AudioBlock<float> block(buffer);
-            juce::dsp::ProcessContextReplacing<float> context(block);
-            reverb.process(context);
+                juce::dsp::AudioBlock<float> block(span);
+                juce::dsp::ProcessContextReplacing<float> context(block);
+                reverb.process(context);
+            });
         }
 
-        // Parameters
-        void setRoomSize(float size)
-        {
-            roomSize = juce::jlimit(0.0f, 1.0f, size);
-            updateReverb();
-        }
-        
-        void setDamping(float d)
-        {
-            damping = juce::jlimit(0.0f, 1.0f, d);
-            updateReverb();
-        }
-        
-        void setWetLevel(float wet)
-        {
-            wetLevel = juce::jlimit(0.0f, 1.0f, wet);
-            updateReverb();
-        }
-        
-        void setDryLevel(float dry)
-        {
-            dryLevel = juce::jlimit(0.0f, 1.0f, dry);
-            updateReverb();
-        }
-        
-        void setWidth(float w)
-        {
-            width = juce::jlimit(0.0f, 1.0f, w);
-            updateReverb();
-        }
-        
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
+        // Parameters (any thread)
+        void setRoomSize(float size) { setProcessorParameter(RoomSize, size); }
+        void setDamping(float d) { setProcessorParameter(Damping, d); }
+        void setWetLevel(float wet) { setProcessorParameter(Wet, wet); }
+        void setDryLevel(float dry) { setProcessorParameter(Dry, dry); }
+        void setWidth(float w) { setProcessorParameter(Width, w); }
 
     private:
         void updateReverb()
         {
             juce::Reverb::Parameters params;
-            params.roomSize = roomSize;
-            params.damping = damping;
-            params.wetLevel = wetLevel;
-            params.dryLevel = dryLevel;
-            params.width = width;
+            params.roomSize = getProcessorParameter(RoomSize).getCurrentValue();
+            params.damping = getProcessorParameter(Damping).getCurrentValue();
+            params.wetLevel = getProcessorParameter(Wet).getCurrentValue();
+            params.dryLevel = getProcessorParameter(Dry).getCurrentValue();
+            params.width = getProcessorParameter(Width).getCurrentValue();
             params.freezeMode = 0.0f;
-            reverb.setParameters(params);
+            
+            // setParameters recomputes the comb filters, so skip it while nothing moves
+            if (params.roomSize != appliedParams.roomSize || params.damping != appliedParams.damping
+                || params.wetLevel != appliedParams.wetLevel || params.dryLevel != appliedParams.dryLevel
+                || params.width != appliedParams.width || !parametersApplied)
+            {
+                reverb.setParameters(params);
+                appliedParams = params;
+                parametersApplied = true;
+            }
         }
         
         juce::dsp::Reverb reverb;
-        
-        float roomSize = 0.5f;
-        float damping = 0.5f;
-        float wetLevel = 0.3f;
-        float dryLevel = 0.7f;
-        float width = 1.0f;
-        bool enabled = true;
+        juce::Reverb::Parameters appliedParams;
+        bool parametersApplied = false;
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReverbProcessor)
     };
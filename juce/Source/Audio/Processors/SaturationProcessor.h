@@ -2,81 +2,120 @@
 
 #include "ProcessorBase.h"
 #include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <memory>
 
 namespace Audio
 {
     /**
      * Saturation/Tape emulation processor using waveshaping.
+     *
+     * The curve can run oversampled (2x/4x/8x, cascaded half-band FIR stages)
+     * so high drive settings do not alias. Live playback and offline renders
+     * (isNonRealtime()) have separate settings; the latency of the active one
+     * is reported through getLatencySamples().
      */
     class SaturationProcessor : public ProcessorBase
     {
     public:
+        /** Oversampling factor; the value is the number of half-band stages. */
+        enum class Oversampling
+        {
+            None = 0,
+            x2,
+            x4,
+            x8
+        };
+
+        /** Parameter indices, in declaration order. */
+        enum ParameterIndex { Drive, Mix, Type, OversamplingFactor, OfflineOversamplingFactor };
+
         SaturationProcessor()
             : ProcessorBase(BusesProperties()
                 .withInput("Input", juce::AudioChannelSet::stereo(), true)
                 .withOutput("Output", juce::AudioChannelSet::stereo(), true))
         {
-            // Initialize waveshaper with soft clipping function
-            waveshaper.functionToUse = [](float x)
-            {
-                // Soft clipping using tanh
-                return std::tanh(x);
-            };
+            addProcessorParameter("drive", { 0.0f, 1.0f }, 0.3f);
+            addProcessorParameter("mix", { 0.0f, 1.0f }, 0.5f);
+            addProcessorParameter("type", { 0.0f, 3.0f, 1.0f }, static_cast<float>(SaturationType::Tape), 0.0);
+            
+            // Factors (1, 2, 4, 8); they change the latency, so they cannot be automated
+            addProcessorParameter("oversampling", { 1.0f, 8.0f, 1.0f }, 2.0f, 0.0, false);
+            addProcessorParameter("offline_oversampling", { 1.0f, 8.0f, 1.0f }, 8.0f, 0.0, false);
         }
 
         const juce::String getName() const override { return "Saturation"; }
 
         void prepareToPlay(double sampleRate, int samplesPerBlock) override
         {
-            juce::dsp::ProcessSpec spec;
-            spec.sampleRate = sampleRate;
-            spec.maximumBlockSize = static_cast<juce::uint32>(samplesPerBlock);
-            spec.numChannels = 2;
+            preparedBlockSize = juce::jmax(1, samplesPerBlock);
             
-            waveshaper.prepare(spec);
+            // Every factor is ready, so switching quality never allocates on the audio thread
+            for (size_t stages = 1; stages <= oversamplers.size(); ++stages)
+            {
+                auto& oversampler = oversamplers[stages - 1];
+                oversampler = std::make_unique<juce::dsp::Oversampling<float>>(
+                    2, stages, juce::dsp::Oversampling<float>::filterHalfBandFIREquiripple, true, true);
+                oversampler->initProcessing(static_cast<size_t>(preparedBlockSize));
+            }
+            
+            prepareParameters(sampleRate);
+            updateLatency();
+        }
+
+        void reset() override
+        {
+            for (auto& oversampler : oversamplers)
+                if (oversampler != nullptr)
+                    oversampler->reset();
+            
+            resetParameters();
+        }
+
+        void setNonRealtime(bool isNonRealtime) noexcept override
+        {
+            ProcessorBase::setNonRealtime(isNonRealtime);
+            updateLatency();
         }
 
         void processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override
         {
-            if (!enabled || drive <= 0.01f)
+            if (!isEnabled())
                 return;
-                
-            // Apply input gain (drive), then waveshaping, then output compensation
-            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            
+            updateParameters();
+            auto* oversampler = getActiveOversampler();
+            
+            processInControlSpans(buffer, [this, oversampler](juce::AudioBuffer<float>& span)
             {
-                auto* channelData = buffer.getWritePointer(channel);
-                for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
+                const float drive = getProcessorParameter(Drive).getCurrentValue();
+                
+                if (oversampler == nullptr)
                 {
-                    float input = channelData[sample];
-                    
-                    // Apply drive (increase before saturation)
-                    float driven = input * (1.0f + drive * 10.0f);
-                    
-                    // Apply saturation curve based on type
-                    float saturated;
-                    switch (type)
-                    {
-                        case SaturationType::Tape:
-                            saturated = tapeStyle(driven);
-                            break;
-                        case SaturationType::Tube:
-                            saturated = tubeStyle(driven);
-                            break;
-                        case SaturationType::Hard:
-                            saturated = hardClip(driven);
-                            break;
-                        default:
-                            saturated = softClip(driven);
-                            break;
-                    }
+                    if (drive > 0.01f)
+                        for (int channel = 0; channel < span.getNumChannels(); ++channel)
+                            processChannel(span.getWritePointer(channel), span.getNumSamples());
+                    return;
+                }
+                
+                // The dry signal goes through the filters too, so the mix stays phase-aligned
+                juce::dsp::AudioBlock<float> block(span.getArrayOfWritePointers(),
+                                                   static_cast<size_t>(juce::jmin(span.getNumChannels(), 2)),
+                                                   static_cast<size_t>(span.getNumSamples()));
+                
+                for (size_t start = 0; start < block.getNumSamples(); start += static_cast<size_t>(preparedBlockSize))
+                {
+                    auto chunk = block.getSubBlock(start, juce::jmin(block.getNumSamples() - start,
+                                                                     static_cast<size_t>(preparedBlockSize)));
+                    auto upsampled = oversampler->processSamplesUp(chunk);
                     
-                    // Compensate for drive gain
-                    float compensated = saturated / (1.0f + drive * 3.0f);
+                    if (drive > 0.01f)
+                        for (size_t channel = 0; channel < upsampled.getNumChannels(); ++channel)
+                            processChannel(upsampled.getChannelPointer(channel), static_cast<int>(upsampled.getNumSamples()));
                     
-                    // Mix dry/wet
-                    channelData[sample] = (input * (1.0f - mix)) + (compensated * mix);
+                    oversampler->processSamplesDown(chunk);
                 }
-            }
+            });
         }
 
         enum class SaturationType
@@ -87,64 +126,165 @@ namespace Audio
             Hard    // Hard clipping
         };
 
-        // Parameters
-        void setDrive(float d)
+        // Parameters (any thread)
+        void setDrive(float d) { setProcessorParameter(Drive, d); }
+        void setMix(float m) { setProcessorParameter(Mix, m); }
+        void setType(SaturationType t) { setProcessorParameter(Type, static_cast<float>(t)); }
+        
+        void setEnabled(bool shouldBeEnabled) override
         {
-            drive = juce::jlimit(0.0f, 1.0f, d);
+            ProcessorBase::setEnabled(shouldBeEnabled);
+            updateLatency();
         }
         
-        void setMix(float m)
+        /** Oversampling for live playback (default 2x, cheap enough for every bus). */
+        void setOversampling(Oversampling factor)
         {
-            mix = juce::jlimit(0.0f, 1.0f, m);
+            setProcessorParameter(OversamplingFactor, static_cast<float>(1 << static_cast<int>(factor)));
         }
         
-        void setType(SaturationType t)
+        Oversampling getOversampling() const
         {
-            type = t;
+            return oversamplingFromFactor(static_cast<int>(getProcessorParameter(OversamplingFactor).getValue()));
         }
         
-        void setEnabled(bool e) { enabled = e; }
-        bool isEnabled() const { return enabled; }
+        /** Oversampling while rendering offline (default 8x, for clean bounces). */
+        void setOfflineOversampling(Oversampling factor)
+        {
+            setProcessorParameter(OfflineOversamplingFactor, static_cast<float>(1 << static_cast<int>(factor)));
+        }
+        
+        Oversampling getOfflineOversampling() const
+        {
+            return oversamplingFromFactor(static_cast<int>(getProcessorParameter(OfflineOversamplingFactor).getValue()));
+        }
+        
+        /** Map a factor (1, 2, 4 or 8; anything else rounds down) to Oversampling. */
+        static Oversampling oversamplingFromFactor(int factor)
+        {
+            if (factor >= 8) return Oversampling::x8;
+            if (factor >= 4) return Oversampling::x4;
+            if (factor >= 2) return Oversampling::x2;
+            return Oversampling::None;
+        }
+
+    protected:
+        void processorParameterChanged(int index) override
+        {
+            if (index == OversamplingFactor || index == OfflineOversamplingFactor)
+                updateLatency();
+        }
 
     private:
-        // Soft clip using tanh
-        static float softClip(float x)
+        juce::dsp::Oversampling<float>* getActiveOversampler() const noexcept
         {
-            return std::tanh(x);
+            const auto factor = isNonRealtime() ? getOfflineOversampling() : getOversampling();
+            if (factor == Oversampling::None)
+                return nullptr;
+            
+            return oversamplers[static_cast<size_t>(factor) - 1].get();
         }
         
-        // Tape-style saturation with hysteresis-like curve
-        static float tapeStyle(float x)
+        void updateLatency()
         {
-            // Approximation of tape saturation
-            if (x > 0.0f)
-                return 1.0f - std::exp(-x);
-            else
-                return -1.0f + std::exp(x);
+            const auto* oversampler = isEnabled() ? getActiveOversampler() : nullptr;
+            setLatencySamples(oversampler != nullptr ? juce::roundToInt(oversampler->getLatencyInSamples()) : 0);
         }
         
-        // Tube-style asymmetric saturation
-        static float tubeStyle(float x)
+        /** Apply drive, the curve and the dry/wet mix to one channel. */
+        void processChannel(float* data, int numSamples) noexcept
         {
-            // Asymmetric - more compression on positive peaks
-            if (x >= 0.0f)
-                return std::tanh(x * 1.2f);
-            else
-                return std::tanh(x * 0.8f);
+            // Pick the curve once per span; each kernel is a branch-free loop over it
+            switch (static_cast<SaturationType>(static_cast<int>(getProcessorParameter(Type).getCurrentValue())))
+            {
+                case SaturationType::Tape:
+                    processWithCurve<TapeCurve>(data, numSamples);
+                    break;
+                case SaturationType::Tube:
+                    processWithCurve<TubeCurve>(data, numSamples);
+                    break;
+                case SaturationType::Hard:
+                    processWithCurve<HardCurve>(data, numSamples);
+                    break;
+                default:
+                    processWithCurve<SoftCurve>(data, numSamples);
+                    break;
+            }
         }
         
-        // Hard clipping
-        static float hardClip(float x)
+        template <typename Curve>
+        void processWithCurve(float* channelData, int numSamples) noexcept
         {
-            return juce::jlimit(-1.0f, 1.0f, x);
+            const float drive = getProcessorParameter(Drive).getCurrentValue();
+            const float mix = getProcessorParameter(Mix).getCurrentValue();
+            
+            // Apply drive (increase before saturation), compensate for it afterwards
+            const float inputGain = 1.0f + drive * 10.0f;
+            const float wetGain = mix / (1.0f + drive * 3.0f);
+            const float dryGain = 1.0f - mix;
+            
+            for (int start = 0; start < numSamples; start += spanSize)
+            {
+                const int spanLength = juce::jmin(spanSize, numSamples - start);
+                float* data = channelData + start;
+                float* shaped = spanScratch.data();
+                
+                juce::FloatVectorOperations::multiply(shaped, data, inputGain, spanLength);
+                Curve::apply(shaped, spanLength);
+                
+                // Mix dry/wet
+                juce::FloatVectorOperations::multiply(data, dryGain, spanLength);
+                juce::FloatVectorOperations::addWithMultiply(data, shaped, wetGain, spanLength);
+            }
         }
         
-        juce::dsp::WaveShaper<float> waveshaper;
+        // Soft clip using tanh
+        struct SoftCurve
+        {
+            static void apply(float* x, int n) noexcept
+            {
+                for (int i = 0; i < n; ++i)
+                    x[i] = std::tanh(x[i]);
+            }
+        };
+        
+        // Tape-style saturation with hysteresis-like curve
+        struct TapeCurve
+        {
+            static void apply(float* x, int n) noexcept
+            {
+                // Approximation of tape saturation: sign(x) * (1 - e^-|x|)
+                for (int i = 0; i < n; ++i)
+                    x[i] = std::copysign(1.0f - std::exp(-std::abs(x[i])), x[i]);
+            }
+        };
+        
+        // Tube-style asymmetric saturation
+        struct TubeCurve
+        {
+            static void apply(float* x, int n) noexcept
+            {
+                // Asymmetric - more compression on positive peaks
+                for (int i = 0; i < n; ++i)
+                    x[i] = std::tanh(x[i] * (x[i] >= 0.0f ? 1.2f : 0.8f));
+            }
+        };
+        
+        // Hard clipping
+        struct HardCurve
+        {
+            static void apply(float* x, int n) noexcept
+            {
+                juce::FloatVectorOperations::clip(x, x, -1.0f, 1.0f, n);
+            }
+        };
+        
+        static constexpr int spanSize = 256;
+        std::array<float, spanSize> spanScratch {};
         
-        float drive = 0.3f;
-        float mix = 0.5f;
-        SaturationType type = SaturationType::Tape;
-        bool enabled = true;
+        // Index = stages - 1 (2x, 4x, 8x); built in prepareToPlay
+        std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, 3> oversamplers;
+        int preparedBlockSize = 0;
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SaturationProcessor)
     };
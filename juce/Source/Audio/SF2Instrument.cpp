@@ -20,6 +20,8 @@ namespace mmg
 //==============================================================================
 SF2Instrument::SF2Instrument()
 {
+    // Usable before prepareToPlay; longer blocks are rendered in chunks
+    renderBuffer.allocate(static_cast<size_t>(currentBufferSize) * 2, true);
 }
 
 SF2Instrument::~SF2Instrument()
@@ -41,25 +43,24 @@ bool SF2Instrument::load(const juce::File& sf2File)
         return false;
     }
     
-    const juce::ScopedLock sl(lock);
+    // Parsed once per file; other tracks playing the same font share its samples
+    auto font = sampleCache->getSoundFont(sf2File);
     
-    // Load the soundfont
-    soundFont = tsf_load_filename(sf2File.getFullPathName().toRawUTF8());
-    
-    if (soundFont == nullptr)
+    if (font == nullptr)
     {
         DBG("SF2Instrument: Failed to load: " << sf2File.getFullPathName());
         return false;
     }
     
-    filePath = sf2File.getFullPathName();
+    soundFont = font->createInstance();
+    if (soundFont == nullptr)
+        return false;
+    
+    sharedFont = std::move(font);
     
-    // Configure output
-    tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED, 
-                   static_cast<int>(currentSampleRate), 0.0f);
+    filePath = sf2File.getFullPathName();
     
-    // Apply gain boost for better audibility (SF2 samples are often quiet)
-    tsf_set_volume(soundFont, 4.0f);  // +12dB boost
+    configureOutput();
     
     DBG("SF2Instrument: Loaded " << sf2File.getFileName() 
         << " with " << getNumPresets() << " presets");
@@ -71,8 +72,6 @@ bool SF2Instrument::loadFromMemory(const void* data, int size)
 {
     unload();
     
-    const juce::ScopedLock sl(lock);
-    
     soundFont = tsf_load_memory(data, size);
     
     if (soundFont == nullptr)
@@ -83,25 +82,43 @@ bool SF2Instrument::loadFromMemory(const void* data, int size)
     
     filePath = "<memory>";
     
-    tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED,
-                   static_cast<int>(currentSampleRate), 0.0f);
-    tsf_set_volume(soundFont, 4.0f);  // +12dB boost
+    configureOutput();
     
     return true;
 }
 
 void SF2Instrument::unload()
 {
-    const juce::ScopedLock sl(lock);
+    // Events queued for the old font are meaningless for the next one
+    events.drain([](const Event&) {});
     
     if (soundFont != nullptr)
     {
-        tsf_close(soundFont);
+        if (sharedFont != nullptr)
+            sharedFont->releaseInstance(soundFont);
+        else
+            tsf_close(soundFont);
         soundFont = nullptr;
     }
     
+    sharedFont.reset();
+    
     filePath.clear();
-    activePreset = 0;
+    activePreset.store(0);
+}
+
+void SF2Instrument::configureOutput()
+{
+    if (soundFont == nullptr)
+        return;
+    
+    // Planar output: tsf_render_float writes all left samples, then all right ones
+    tsf_set_output(soundFont, TSF_STEREO_UNWEAVED, static_cast<int>(currentSampleRate), 0.0f);
+    tsf_set_volume(soundFont, globalVolume);
+    
+    // Preallocated voices: tsf_note_on steals a releasing voice instead of reallocating
+    if (!tsf_set_max_voices(soundFont, maxVoices))
+        DBG("SF2Instrument: Failed to preallocate " << maxVoices << " voices");
 }
 
 //==============================================================================
@@ -156,7 +173,7 @@ void SF2Instrument::setActivePreset(int presetIndex)
 {
     if (presetIndex >= 0 && presetIndex < getNumPresets())
     {
-        activePreset = presetIndex;
+        activePreset.store(presetIndex);
     }
 }
 
@@ -167,56 +184,35 @@ void SF2Instrument::setActivePreset(int presetIndex)
 void SF2Instrument::prepareToPlay(double sampleRate, int samplesPerBlock)
 {
     currentSampleRate = sampleRate;
-    currentBufferSize = samplesPerBlock;
-    
-    // Resize render buffer for interleaved stereo
-    renderBuffer.resize(samplesPerBlock * 2, 0.0f);
+    currentBufferSize = juce::jmax(1, samplesPerBlock);
     
-    const juce::ScopedLock sl(lock);
+    // Left block followed by right block
+    renderBuffer.allocate(static_cast<size_t>(currentBufferSize) * 2, true);
     
-    if (soundFont != nullptr)
-    {
-        tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED,
-                       static_cast<int>(sampleRate), 0.0f);
-    }
+    configureOutput();
 }
 
 void SF2Instrument::setSampleRate(double sampleRate)
 {
     currentSampleRate = sampleRate;
-    
-    const juce::ScopedLock sl(lock);
-    
-    if (soundFont != nullptr)
-    {
-        tsf_set_output(soundFont, TSF_STEREO_INTERLEAVED,
-                       static_cast<int>(sampleRate), 0.0f);
-    }
+    configureOutput();
 }
 
 void SF2Instrument::releaseResources()
 {
-    renderBuffer.clear();
-    renderBuffer.shrink_to_fit();
+    events.drain([](const Event&) {});
+    
+    if (soundFont != nullptr)
+        tsf_reset(soundFont);
 }
 
 void SF2Instrument::noteOn(int channel, int midiNoteNumber, float velocity)
 {
-    const juce::ScopedLock sl(lock);
+    // If channel is -1, use the active preset; otherwise use channel as preset index (common for GM compatibility)
+    const int preset = channel < 0 ? activePreset.load() : channel;
     
-    if (soundFont == nullptr)
-        return;
-    
-    // If channel is -1, use the active preset
-    if (channel < 0)
-    {
-        tsf_note_on(soundFont, activePreset, midiNoteNumber, velocity);
-    }
-    else
-    {
-        // Use channel as preset index (common for GM compatibility)
-        tsf_note_on(soundFont, channel, midiNoteNumber, velocity);
-    }
+    // Only full if nothing has rendered for a long time, so the event is stale anyway
+    events.push({ { Event::Type::NoteOn, preset, midiNoteNumber, velocity } });
 }
 
 void SF2Instrument::noteOn(int midiNoteNumber, float velocity)
@@ -226,19 +222,8 @@ void SF2Instrument::noteOn(int midiNoteNumber, float velocity)
 
 void SF2Instrument::noteOff(int channel, int midiNoteNumber)
 {
-    const juce::ScopedLock sl(lock);
-    
-    if (soundFont == nullptr)
-        return;
-    
-    if (channel < 0)
-    {
-        tsf_note_off(soundFont, activePreset, midiNoteNumber);
-    }
-    else
-    {
-        tsf_note_off(soundFont, channel, midiNoteNumber);
-    }
+    const int preset = channel < 0 ? activePreset.load() : channel;
+    events.push({ { Event::Type::NoteOff, preset, midiNoteNumber, 0.0f } });
 }
 
 void SF2Instrument::noteOff(int midiNoteNumber)
@@ -248,45 +233,56 @@ void SF2Instrument::noteOff(int midiNoteNumber)
 
 void SF2Instrument::allNotesOff()
 {
-    const juce::ScopedLock sl(lock);
-    
-    if (soundFont != nullptr)
+    events.push({ { Event::Type::AllNotesOff, 0, 0, 0.0f } });
+}
+
+void SF2Instrument::applyEvent(const Event& event) noexcept
+{
+    switch (event.type)
     {
-        tsf_reset(soundFont);
+        case Event::Type::NoteOn:
+            tsf_note_on(soundFont, event.preset, event.note, event.value);
+            break;
+            
+        case Event::Type::NoteOff:
+            tsf_note_off(soundFont, event.preset, event.note);
+            break;
+            
+        case Event::Type::AllNotesOff:
+            // Quick fade of every voice; frees nothing, as the tsf_channel_* state is never used
+            tsf_reset(soundFont);
+            break;
+            
+        case Event::Type::Volume:
+            globalVolume = event.value;
+            tsf_set_volume(soundFont, globalVolume);
+            break;
     }
 }
 
 void SF2Instrument::renderNextBlock(juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
 {
-    const juce::ScopedLock sl(lock);
-    
     if (soundFont == nullptr || numSamples <= 0)
         return;
     
-    // Ensure render buffer is large enough
-    if (renderBuffer.size() < static_cast<size_t>(numSamples * 2))
-    {
-        renderBuffer.resize(numSamples * 2);
-    }
-    
-    // Clear render buffer
-    std::fill(renderBuffer.begin(), renderBuffer.begin() + numSamples * 2, 0.0f);
-    
-    // Render TSF output to interleaved buffer
-    tsf_render_float(soundFont, renderBuffer.data(), numSamples, 0);
+    events.drain([this](const Event& event) { applyEvent(event); });
     
-    // De-interleave and mix into output buffer
     auto* leftOut = buffer.getWritePointer(0, startSample);
     auto* rightOut = buffer.getNumChannels() > 1 ? buffer.getWritePointer(1, startSample) : nullptr;
+    const float outputGain = gain.load();
     
-    for (int i = 0; i < numSamples; ++i)
+    // Blocks longer than prepared are rendered in chunks rather than growing the buffer
+    for (int offset = 0; offset < numSamples; offset += currentBufferSize)
     {
-        float left = renderBuffer[i * 2] * gain;
-        float right = renderBuffer[i * 2 + 1] * gain;
+        const int chunkSize = juce::jmin(currentBufferSize, numSamples - offset);
+        const float* left = renderBuffer.get();
+        const float* right = left + chunkSize;
         
-        leftOut[i] += left;
+        tsf_render_float(soundFont, renderBuffer.get(), chunkSize, 0);
+        
+        juce::FloatVectorOperations::addWithMultiply(leftOut + offset, left, outputGain, chunkSize);
         if (rightOut != nullptr)
-            rightOut[i] += right;
+            juce::FloatVectorOperations::addWithMultiply(rightOut + offset, right, outputGain, chunkSize);
     }
 }
 
@@ -296,13 +292,7 @@ void SF2Instrument::renderNextBlock(juce::AudioBuffer<float>& buffer, int startS
 
 void SF2Instrument::setGlobalVolumeDb(float db)
 {
-    const juce::ScopedLock sl(lock);
-    
-    if (soundFont != nullptr)
-    {
-        float linear = juce::Decibels::decibelsToGain(db);
-        tsf_set_volume(soundFont, linear);
-    }
+    events.push({ { Event::Type::Volume, 0, 0, juce::Decibels::decibelsToGain(db) } });
 }
 
 void SF2Instrument::setChorusEnabled(bool /*enabled*/)
@@ -13,6 +13,9 @@
 
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
+#include "SampleCache.h"
+#include "TrackCommandQueue.h"
+#include <atomic>
 #include <vector>
 #include <map>
 
@@ -39,8 +42,13 @@ struct SF2PresetInfo
     SF2 Instrument - loads and plays SoundFont2 files.
     
     Thread Safety:
-    - Load/unload should be called from message thread
-    - noteOn/noteOff/render can be called from audio thread
+    - Load/unload, prepareToPlay/setSampleRate and releaseResources from the
+      message thread, before the instrument is swapped in or while its owner
+      keeps the audio thread out
+    - noteOn/noteOff/allNotesOff/setGlobalVolumeDb from any thread; they are
+      queued and applied at the start of the next renderNextBlock
+    - renderNextBlock never locks or allocates: TinySoundFont renders planar
+      into a buffer sized in prepareToPlay, and its voices are preallocated
 */
 class SF2Instrument
 {
@@ -90,13 +98,13 @@ public:
     
     /** Set the active preset for playback. */
     void setActivePreset(int presetIndex);
-    int getActivePreset() const { return activePreset; }
+    int getActivePreset() const { return activePreset.load(); }
     
     //==========================================================================
     // Playback
     //==========================================================================
     
-    /** Prepare for playback. */
+    /** Prepare for playback; sizes the render buffer for samplesPerBlock. */
     void prepareToPlay(double sampleRate, int samplesPerBlock);
     
     /** Set sample rate. */
@@ -123,7 +131,7 @@ public:
     /** Stop all notes. */
     void allNotesOff();
     
-    /** Render audio to buffer.
+    /** Apply queued events, then render and add into buffer.
         @param buffer Output buffer (stereo)
         @param startSample Start sample in buffer
         @param numSamples Number of samples to render */
@@ -134,8 +142,8 @@ public:
     //==========================================================================
     
     /** Set output gain (linear, default 1.0). */
-    void setGain(float newGain) { gain = newGain; }
-    float getGain() const { return gain; }
+    void setGain(float newGain) { gain.store(newGain); }
+    float getGain() const { return gain.load(); }
     
     /** Set global volume in dB. */
     void setGlobalVolumeDb(float db);
@@ -146,19 +154,41 @@ public:
     /** Enable/disable reverb effect. */
     void setReverbEnabled(bool enabled);
 
+    /** Voices preallocated per soundfont; beyond this the oldest releasing voice is stolen. */
+    static constexpr int maxVoices = 256;
+
 private:
+    /** A note or control event on its way to the render thread. */
+    struct Event
+    {
+        enum class Type { NoteOn, NoteOff, AllNotesOff, Volume };
+        
+        Type type = Type::NoteOn;
+        int preset = 0;
+        int note = 0;
+        float value = 0.0f;     // Velocity, or the linear volume
+    };
+    
+    void applyEvent(const Event& event) noexcept;
+    void configureOutput();
+    
     tsf* soundFont = nullptr;
     juce::String filePath;
     
+    // Font data shared through SampleCache; null for fonts loaded from memory
+    std::shared_ptr<const SharedSoundFont> sharedFont;
+    juce::SharedResourcePointer<SampleCache> sampleCache;
+    
     double currentSampleRate = 44100.0;
     int currentBufferSize = 512;
-    int activePreset = 0;
-    float gain = 1.0f;
+    std::atomic<int> activePreset { 0 };
+    std::atomic<float> gain { 1.0f };
+    float globalVolume = 4.0f;  // +12dB: SF2 samples are often quiet
     
-    // Render buffer for interleaved audio
-    std::vector<float> renderBuffer;
+    CommandQueue<Event, 1024> events;
     
-    juce::CriticalSection lock;
+    // Planar scratch (left block, then right block) for up to currentBufferSize samples
+    juce::HeapBlock<float> renderBuffer;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SF2Instrument)
 };
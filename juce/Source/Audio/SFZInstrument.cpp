@@ -10,6 +10,9 @@
 
 #include "SFZInstrument.h"
 
+#include <algorithm>
+#include <set>
+
 namespace mmg
 {
 
@@ -18,20 +21,33 @@ namespace mmg
 //==============================================================================
 
 void SFZVoice::startNote(int midiNote, float velocity, const SFZRegion* reg,
-                         juce::AudioBuffer<float>* sampleBuffer, double sampleRate)
+                         const StreamedSample* sample, double sampleRate, juce::uint32 noteOrder)
 {
-    if (reg == nullptr || sampleBuffer == nullptr || sampleBuffer->getNumSamples() == 0)
+    if (reg == nullptr || sample == nullptr || sample->getLength() == 0)
+    {
+        deactivate();   // Hands back the grant of a stolen voice
         return;
+    }
+    
+    // A stolen voice already holds a grant (see steal())
+    if (budget != nullptr && budgetGrant == PolyphonyBudget::Grant::None)
+    {
+        budgetGrant = budget->acquire();
+        if (budgetGrant == PolyphonyBudget::Grant::None)
+            return;
+    }
     
     active = true;
     currentNote = midiNote;
+    noteOnTime = noteOrder;
     currentVelocity = velocity;
     region = reg;
-    sampleData = sampleBuffer;
+    sampleData = sample;
     targetSampleRate = sampleRate;
     
     // Start position
     samplePosition = static_cast<double>(region->offset);
+    stream.start(*sample, region->offset);
     
     // Calculate pitch ratio
     calculatePitchRatio();
@@ -66,86 +82,124 @@ void SFZVoice::stopNote(bool allowTailOff)
     }
     else
     {
-        active = false;
+        deactivate();
         envState = EnvelopeState::Off;
         envLevel = 0.0f;
     }
 }
 
+void SFZVoice::steal()
+{
+    active = false;
+    stream.stop();
+    envState = EnvelopeState::Off;
+    envLevel = 0.0f;
+}
+
+void SFZVoice::deactivate()
+{
+    active = false;
+    stream.stop();
+    
+    if (budget != nullptr && budgetGrant != PolyphonyBudget::Grant::None)
+    {
+        budget->release(budgetGrant);
+        budgetGrant = PolyphonyBudget::Grant::None;
+    }
+}
+
 void SFZVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, 
                                 int startSample, int numSamples)
 {
     if (!active || sampleData == nullptr || region == nullptr)
         return;
     
-    const int numChannels = juce::jmin(outputBuffer.getNumChannels(), sampleData->getNumChannels());
-    const int sampleLength = sampleData->getNumSamples();
+    const int sampleLength = static_cast<int>(sampleData->getLength());
     const int endSample = (region->end > 0) ? juce::jmin(region->end, sampleLength) : sampleLength;
     
-    const float* srcL = sampleData->getReadPointer(0);
-    const float* srcR = (numChannels > 1) ? sampleData->getReadPointer(1) : srcL;
+    float* destL = outputBuffer.getWritePointer(0, startSample);
+    float* destR = (outputBuffer.getNumChannels() > 1) ? outputBuffer.getWritePointer(1, startSample) : nullptr;
     
-    float* destL = outputBuffer.getWritePointer(0);
-    float* destR = (outputBuffer.getNumChannels() > 1) ? outputBuffer.getWritePointer(1) : nullptr;
-    
-    for (int i = 0; i < numSamples; ++i)
+    // Render in runs that contain no loop point or sample end, each mixed in bulk
+    int rendered = 0;
+    while (rendered < numSamples)
     {
-        // Process envelope
-        float env = processEnvelope();
-        
-        if (envState == EnvelopeState::Off)
-        {
-            active = false;
-            break;
-        }
-        
         // Check if we've reached the end
-        int pos = static_cast<int>(samplePosition);
-        if (pos >= endSample - 1)
+        if (samplePosition >= endSample - 1)
         {
-            // Handle looping
-            if (region->loop_mode == "loop_continuous" || region->loop_mode == "loop_sustain")
-            {
-                int loopStart = region->loop_start;
-                int loopEnd = (region->loop_end > 0) ? region->loop_end : endSample;
-                
-                if (region->loop_mode == "loop_sustain" && envState == EnvelopeState::Release)
-                {
-                    // Stop looping on release
-                    active = false;
-                    break;
-                }
-                
-                // Wrap to loop start
-                samplePosition = loopStart + std::fmod(samplePosition - loopStart, loopEnd - loopStart);
-            }
-            else
+            const int loopStart = region->loop_start;
+            const int loopEnd = (region->loop_end > 0) ? region->loop_end : endSample;
+            
+            // No loop - fade out; sustain loops stop looping on release
+            if (!region->isLooped() || loopEnd <= loopStart
+                || (region->loopMode == SFZLoopMode::LoopSustain && envState == EnvelopeState::Release))
             {
-                // No loop - fade out
-                active = false;
+                deactivate();
                 break;
             }
+            
+            // Wrap to loop start
+            samplePosition = loopStart + std::fmod(samplePosition - loopStart, loopEnd - loopStart);
+        }
+        
+        // At least one frame, so a loop ending past the sample still advances
+        const int framesToEnd = juce::jmax(1, static_cast<int>(std::ceil((endSample - 1 - samplePosition) / pitchRatio)));
+        int runLength = juce::jmin(numSamples - rendered, framesToEnd,
+                                   SampleVoiceKernel::getMaxRunLength(pitchRatio));
+        
+        // Envelope first: a run ends early if the release finishes inside it
+        int envFrames = 0;
+        for (; envFrames < runLength; ++envFrames)
+        {
+            const float env = processEnvelope();
+            if (envState == EnvelopeState::Off)
+                break;
+            scratch.envelope[(size_t)envFrames] = env;
         }
         
-        // Linear interpolation for sample playback
-        pos = static_cast<int>(samplePosition);
-        float frac = static_cast<float>(samplePosition - pos);
+        const bool envelopeFinished = envFrames < runLength;
+        runLength = envFrames;
         
-        if (pos >= 0 && pos < sampleLength - 1)
+        if (runLength > 0)
         {
-            float sampleL = srcL[pos] + frac * (srcL[pos + 1] - srcL[pos]);
-            float sampleR = srcR[pos] + frac * (srcR[pos + 1] - srcR[pos]);
+            // Linear interpolation for sample playback
+            const auto firstFrame = static_cast<juce::int64>(samplePosition);
+            const double fraction = samplePosition - static_cast<double>(firstFrame);
+            const int span = SampleVoiceKernel::getSourceSpan(fraction, pitchRatio, runLength);
+            
+            const float* srcL = nullptr;
+            const float* srcR = nullptr;
+            stream.getFrames(firstFrame, span, scratch.sourceLeft.data(), scratch.sourceRight.data(), srcL, srcR);
+            
+            SampleVoiceKernel::resampleLinear(srcL, fraction, pitchRatio, scratch.left.data(), runLength);
+            if (destR != nullptr)
+            {
+                if (srcR != srcL)
+                    SampleVoiceKernel::resampleLinear(srcR, fraction, pitchRatio, scratch.right.data(), runLength);
+                else
+                    juce::FloatVectorOperations::copy(scratch.right.data(), scratch.left.data(), runLength);
+            }
             
             // Apply envelope and gain
-            int outIdx = startSample + i;
-            destL[outIdx] += sampleL * env * gainL;
+            SampleVoiceKernel::mixWithEnvelope(destL + rendered, scratch.left.data(), scratch.envelope.data(), gainL, runLength);
             if (destR != nullptr)
-                destR[outIdx] += sampleR * env * gainR;
+                SampleVoiceKernel::mixWithEnvelope(destR + rendered, scratch.right.data(), scratch.envelope.data(), gainR, runLength);
+            
+            // Advance position
+            samplePosition += runLength * pitchRatio;
+            rendered += runLength;
         }
         
-        // Advance position
-        samplePosition += pitchRatio;
+        if (envelopeFinished)
+        {
+            deactivate();
+            break;
+        }
     }
+    
+    // Frames behind the voice may now be recycled by the disk thread
+    if (active)
+        stream.setPlayPosition(static_cast<juce::int64>(samplePosition));
 }
 
 void SFZVoice::calculatePitchRatio()
@@ -251,14 +305,39 @@ SFZInstrument::SFZInstrument()
 SFZInstrument::~SFZInstrument()
 {
     allNotesOff();
+    
+    // The disk thread must be done with our voices before the samples go away
+    for (auto& voice : voices)
+        streamer->removeStream(voice->getStream());
+}
+
+void SFZInstrument::setVoiceBudget(PolyphonyBudget::Client* budget)
+{
+    allNotesOff();
+    
+    voiceBudget = budget;
+    for (auto& voice : voices)
+        voice->setVoiceBudget(budget);
+}
+
+void SFZInstrument::setNonRealtime(bool isNonRealtime)
+{
+    nonRealtime = isNonRealtime;
+    for (auto& voice : voices)
+        voice->getStream().setBlocking(isNonRealtime);
 }
 
 bool SFZInstrument::loadFromFile(const juce::File& sfzFile)
 {
     loaded = false;
     lastError.clear();
-    sampleBuffers.clear();
-    sampleRates.clear();
+    
+    // Reloading: silence the voices and detach them from the disk thread before the old samples go
+    allNotesOff();
+    for (auto& voice : voices)
+        streamer->removeStream(voice->getStream());
+    clearRegionTable();
+    samples.clear();
     
     // Parse SFZ file
     SFZParser parser;
@@ -274,6 +353,8 @@ bool SFZInstrument::loadFromFile(const juce::File& sfzFile)
         return false;
     }
     
+    buildRegionTable();
+    
     loaded = true;
     DBG("SFZInstrument: Loaded " + sfzFile.getFileName() + " with " + 
         juce::String(getNumRegions()) + " regions");
@@ -298,6 +379,16 @@ bool SFZInstrument::loadSamples()
 {
     int loadedCount = 0;
     int failedCount = 0;
+    int streamedCount = 0;
+    int mappedCount = 0;
+    bool needsRings = false;
+    
+    // Looping needs random access to the loop, so samples any looped region uses stay in memory
+    std::set<juce::String> loopedSamples;
+    for (const auto& group : instrumentData.groups)
+        for (const auto& region : group.regions)
+            if (region.isLooped())
+                loopedSamples.insert(region.sampleFile.getFullPathName());
     
     for (const auto& group : instrumentData.groups)
     {
@@ -306,7 +397,7 @@ bool SFZInstrument::loadSamples()
             juce::String key = region.sampleFile.getFullPathName();
             
             // Skip if already loaded
-            if (sampleBuffers.find(key) != sampleBuffers.end())
+            if (samples.find(key) != samples.end())
                 continue;
             
             // Load the sample
@@ -317,25 +408,26 @@ bool SFZInstrument::loadSamples()
                 continue;
             }
             
-            std::unique_ptr<juce::AudioFormatReader> reader(
-                formatManager.createReaderFor(region.sampleFile));
-            
-            if (reader == nullptr)
+            // Only the head is decoded for streamed samples; the rest is read during playback
+            const bool stream = diskStreaming && loopedSamples.count(key) == 0;
+            auto sample = sampleCache->getSample(formatManager, region.sampleFile,
+                                                 stream ? SampleStreamer::preloadSeconds : -1.0);
+            if (sample == nullptr)
             {
                 DBG("SFZInstrument: Could not read sample: " + region.sampleFile.getFileName());
                 failedCount++;
                 continue;
             }
             
-            // Create buffer and read samples
-            auto buffer = std::make_unique<juce::AudioBuffer<float>>(
-                static_cast<int>(reader->numChannels),
-                static_cast<int>(reader->lengthInSamples));
-            
-            reader->read(buffer.get(), 0, static_cast<int>(reader->lengthInSamples), 0, true, true);
+            if (sample->isMemoryMapped())
+                mappedCount++;
+            if (!sample->isFullyLoaded())
+            {
+                streamedCount++;
+                needsRings = needsRings || !sample->isMemoryMapped();
+            }
             
-            sampleRates[key] = reader->sampleRate;
-            sampleBuffers[key] = std::move(buffer);
+            samples[key] = std::move(sample);
             loadedCount++;
         }
     }
@@ -346,24 +438,148 @@ bool SFZInstrument::loadSamples()
         return false;
     }
     
+    // Disk thread only when something actually streams; ring buffers only for decoded streams
+    if (streamedCount > 0)
+    {
+        for (auto& voice : voices)
+        {
+            if (needsRings && !voice->getStream().isAllocated())
+                voice->getStream().allocate(SampleStreamer::ringFrames);
+            streamer->addStream(voice->getStream());
+        }
+    }
+    
     DBG("SFZInstrument: Loaded " + juce::String(loadedCount) + " samples (" +
+        juce::String(mappedCount) + " memory-mapped, " +
+        juce::String(streamedCount) + " streamed from disk, " +
         juce::String(failedCount) + " failed)");
     
     return true;
 }
 
+void SFZInstrument::clearRegionTable()
+{
+    regionTable.clear();
+    regionSpans.clear();
+    seqCounters.clear();
+}
+
+void SFZInstrument::buildRegionTable()
+{
+    clearRegionTable();
+    
+    // Regions that can start on note-on, with their sample resolved up front
+    std::vector<RegionEntry> playable;
+    int regionIndex = 0;
+    
+    for (const auto& group : instrumentData.groups)
+    {
+        for (const auto& region : group.regions)
+        {
+            const int index = regionIndex++;
+            
+            // Release triggers never start on note-on
+            if (region.triggerMode == SFZTrigger::Release)
+                continue;
+            
+            auto sampleIt = samples.find(region.sampleFile.getFullPathName());
+            if (sampleIt == samples.end())
+                continue;
+            
+            playable.push_back({ &region, sampleIt->second.get(), index });
+        }
+    }
+    
+    seqCounters.assign((size_t)regionIndex, 0);
+    regionSpans.assign(128 * 128, {});
+    
+    constexpr int numCells = 128 * 128;
+    
+    // Each region only visits the cells of its own key/velocity rectangle: count them,
+    // then scatter the regions (in file order) into one flat array grouped by cell
+    auto forEachCell = [](const SFZRegion& region, auto&& fn)
+    {
+        const int hikey = juce::jmin(127, region.hikey);
+        const int hivel = juce::jmin(127, region.hivel);
+        
+        for (int note = juce::jmax(0, region.lokey); note <= hikey; ++note)
+            for (int velocity = juce::jmax(0, region.lovel); velocity <= hivel; ++velocity)
+                fn(note * 128 + velocity);
+    };
+    
+    std::vector<juce::uint32> cellStart((size_t)numCells + 1, 0);
+    
+    for (const auto& entry : playable)
+        forEachCell(*entry.region, [&cellStart](int cell) { ++cellStart[(size_t)cell + 1]; });
+    
+    for (int cell = 0; cell < numCells; ++cell)
+        cellStart[(size_t)cell + 1] += cellStart[(size_t)cell];
+    
+    std::vector<int> cellEntries(cellStart.back());
+    std::vector<juce::uint32> cellFill(cellStart.begin(), cellStart.end() - 1);
+    
+    for (int i = 0; i < (int)playable.size(); ++i)
+        forEachCell(*playable[(size_t)i].region,
+                    [&cellEntries, &cellFill, i](int cell) { cellEntries[cellFill[(size_t)cell]++] = i; });
+    
+    // Neighbouring velocities usually hit the same layer, so a cell whose regions
+    // match the previous velocity's shares its span
+    for (int note = 0; note < 128; ++note)
+    {
+        RegionSpan previous;
+        
+        for (int velocity = 0; velocity < 128; ++velocity)
+        {
+            const int cell = note * 128 + velocity;
+            const auto first = cellEntries.begin() + cellStart[(size_t)cell];
+            const auto last = cellEntries.begin() + cellStart[(size_t)cell + 1];
+            const auto count = (juce::uint32)(last - first);
+            
+            const bool sameAsPrevious = velocity > 0 && previous.count == count
+                && std::equal(first, last, regionTable.begin() + previous.start,
+                              [&playable](int entry, const RegionEntry& b) { return playable[(size_t)entry].region == b.region; });
+            
+            if (!sameAsPrevious)
+            {
+                previous.start = (juce::uint32)regionTable.size();
+                previous.count = count;
+                for (auto it = first; it != last; ++it)
+                    regionTable.push_back(playable[(size_t)*it]);
+            }
+            
+            regionSpans[(size_t)cell] = previous;
+        }
+    }
+}
+
 void SFZInstrument::noteOn(int midiNote, float velocity)
 {
-    if (!loaded || velocity <= 0.0f)
+    if (!loaded || velocity <= 0.0f || !juce::isPositiveAndBelow(midiNote, 128))
         return;
     
     // Find matching regions
-    auto regions = instrumentData.findRegions(midiNote, static_cast<int>(velocity * 127.0f));
+    const int midiVelocity = juce::jlimit(0, 127, static_cast<int>(velocity * 127.0f));
+    const auto span = regionSpans[(size_t)(midiNote * 128 + midiVelocity)];
     
-    for (const auto* region : regions)
+    // One draw per note-on, shared by all of its regions
+    const float randomValue = random.nextFloat();
+    
+    for (juce::uint32 i = 0; i < span.count; ++i)
     {
-        // Skip release triggers
-        if (region->trigger == "release")
+        const auto& entry = regionTable[span.start + i];
+        const auto* region = entry.region;
+        
+        // Round robin: every hit advances the region's counter, it plays on its turn only
+        if (region->seq_length > 1)
+        {
+            auto& counter = seqCounters[(size_t)entry.regionIndex];
+            const bool isTurn = (int)(counter % (juce::uint32)region->seq_length) == region->seq_position - 1;
+            ++counter;
+            if (!isTurn)
+                continue;
+        }
+        
+        if (randomValue < region->lorand || randomValue >= region->hirand)
             continue;
         
         // Handle group exclusion (off_by)
@@ -372,18 +588,11 @@ void SFZInstrument::noteOn(int midiNote, float velocity)
             handleGroupOff(region->group);
         }
         
-        // Find sample buffer
-        juce::String key = region->sampleFile.getFullPathName();
-        auto bufferIt = sampleBuffers.find(key);
-        if (bufferIt == sampleBuffers.end())
-            continue;
-        
         // Find a free voice
         SFZVoice* voice = findFreeVoice();
         if (voice != nullptr)
         {
-            voice->startNote(midiNote, velocity, region, 
-                            bufferIt->second.get(), currentSampleRate);
+            voice->startNote(midiNote, velocity, region, entry.sample, currentSampleRate, ++lastNoteOnCounter);
         }
     }
 }
@@ -434,23 +643,25 @@ void SFZInstrument::renderNextBlock(juce::AudioBuffer<float>& buffer,
 
 SFZVoice* SFZInstrument::findFreeVoice()
 {
-    // Find inactive voice
-    for (auto& voice : voices)
+    // Find inactive voice, unless this track is at its polyphony budget
+    if (voiceBudget == nullptr || voiceBudget->canAcquire())
     {
-        if (!voice->isActive())
-            return voice.get();
+        for (auto& voice : voices)
+        {
+            if (!voice->isActive())
+                return voice.get();
+        }
     }
     
-    // Voice stealing - find oldest voice in release
-    for (auto& voice : voices)
-    {
-        // Could implement more sophisticated voice stealing here
-        // For now, just steal the first one
-        voice->stopNote(false);
-        return voice.get();
-    }
+    // Voice stealing - oldest released voice, else the quietest one
+    const int index = VoiceAllocator::findVoiceToSteal((int)voices.size(),
+                                                       [this](int i) { return voices[(size_t)i].get(); });
+    if (index < 0)
+        return nullptr;
     
-    return nullptr;
+    auto* voice = voices[(size_t)index].get();
+    voice->steal();
+    return voice;
 }
 
 SFZVoice* SFZInstrument::findVoicePlayingNote(int note)
@@ -465,10 +676,10 @@ SFZVoice* SFZInstrument::findVoicePlayingNote(int note)
 
 void SFZInstrument::handleGroupOff(int group)
 {
-    // Stop all voices in the specified group (for exclusive groups like hi-hats)
+    // Stop all voices switched off by the specified group (off_by, e.g. open/closed hi-hats)
     for (auto& voice : voices)
     {
-        if (voice->isActive() && voice->getGroup() == group)
+        if (voice->isActive() && voice->getOffBy() == group)
         {
             voice->stopNote(false);
         }
@@ -13,6 +13,9 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include "SFZParser.h"
+#include "SampleCache.h"
+#include "SampleVoiceKernel.h"
+#include "VoiceAllocator.h"
 #include <map>
 #include <memory>
 #include <vector>
@@ -30,23 +33,45 @@ public:
     SFZVoice() = default;
     ~SFZVoice() = default;
     
+    /** Starting a note takes a voice from this budget; the note is dropped if none is left. */
+    void setVoiceBudget(PolyphonyBudget::Client* newBudget) { budget = newBudget; }
+    
     void startNote(int midiNote, float velocity, const SFZRegion* region,
-                   juce::AudioBuffer<float>* sampleBuffer, double sampleRate);
+                   const StreamedSample* sample, double sampleRate, juce::uint32 noteOnTime);
     void stopNote(bool allowTailOff);
     void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples);
     
+    /** Silence the voice at once for a new note, keeping its budget grant so
+        no other track can take the slot before that note starts. */
+    void steal();
+    
     bool isActive() const { return active; }
     bool isPlayingNote(int note) const { return active && currentNote == note; }
     int getCurrentNote() const { return currentNote; }
     int getGroup() const { return region ? region->group : 0; }
+    int getOffBy() const { return region ? region->off_by : 0; }
+    
+    // Voice stealing (see VoiceAllocator::findVoiceToSteal)
+    bool isReleasing() const { return envState == EnvelopeState::Release; }
+    float getLevel() const { return envLevel * juce::jmax(gainL, gainR); }
+    bool wasStartedBefore(const SFZVoice& other) const { return noteOnTime < other.noteOnTime; }
+    
+    /** Source of frames past the sample's preloaded head. */
+    SampleStream& getStream() { return stream; }
     
 private:
     bool active = false;
     int currentNote = -1;
     float currentVelocity = 0.0f;
+    juce::uint32 noteOnTime = 0;
+    
+    PolyphonyBudget::Client* budget = nullptr;
+    PolyphonyBudget::Grant budgetGrant = PolyphonyBudget::Grant::None;
     
     const SFZRegion* region = nullptr;
-    juce::AudioBuffer<float>* sampleData = nullptr;
+    const StreamedSample* sampleData = nullptr;
+    SampleStream stream;
+    SampleVoiceKernel::Scratch scratch;
     double sourceSampleRate = 44100.0;
     double targetSampleRate = 44100.0;
     
@@ -70,6 +95,7 @@ private:
     void calculatePitchRatio();
     void calculateEnvelopeRates();
     float processEnvelope();
+    void deactivate();
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SFZVoice)
 };
@@ -122,6 +148,17 @@ public:
     
     /** Get last error message. */
     juce::String getLastError() const { return lastError; }
+    
+    /** Stream long one-shot samples from disk instead of decoding them fully (default on).
+        Call before loadFromFile(). Looped regions are always held in memory. */
+    void setDiskStreaming(bool shouldStream) { diskStreaming = shouldStream; }
+    
+    /** Offline rendering: voices wait for the disk instead of playing silence. */
+    void setNonRealtime(bool isNonRealtime);
+    
+    /** Count voices against a track's share of the global polyphony budget.
+        At the budget, new notes take over one of this instrument's voices. */
+    void setVoiceBudget(PolyphonyBudget::Client* budget);
 
 private:
     bool loaded = false;
@@ -130,9 +167,33 @@ private:
     SFZInstrumentData instrumentData;
     juce::AudioFormatManager formatManager;
     
-    // Sample buffers - keyed by sample file path
-    std::map<juce::String, std::unique_ptr<juce::AudioBuffer<float>>> sampleBuffers;
-    std::map<juce::String, double> sampleRates;
+    // Samples (preloaded head plus streaming info) - keyed by sample file path, shared with other tracks
+    std::map<juce::String, std::shared_ptr<const StreamedSample>> samples;
+    juce::SharedResourcePointer<SampleCache> sampleCache;
+    
+    bool diskStreaming = true;
+    bool nonRealtime = false;
+    juce::SharedResourcePointer<SampleStreamer> streamer;
+    
+    // Note-on lookup, built at load time: every key/velocity cell points at a span of
+    // regionTable, so noteOn neither searches the regions nor allocates
+    struct RegionEntry
+    {
+        const SFZRegion* region = nullptr;
+        const StreamedSample* sample = nullptr;
+        int regionIndex = 0;                    // Into seqCounters
+    };
+    
+    struct RegionSpan
+    {
+        juce::uint32 start = 0;
+        juce::uint32 count = 0;
+    };
+    
+    std::vector<RegionEntry> regionTable;
+    std::vector<RegionSpan> regionSpans;        // [note * 128 + velocity]
+    std::vector<juce::uint32> seqCounters;      // Round-robin position per region
+    juce::Random random;                        // lorand/hirand selection
     
     // Voices
     static constexpr int MaxVoices = 64;
@@ -141,7 +202,12 @@ private:
     double currentSampleRate = 44100.0;
     float masterVolume = 1.0f;
     
+    PolyphonyBudget::Client* voiceBudget = nullptr;
+    juce::uint32 lastNoteOnCounter = 0;
+    
     bool loadSamples();
+    void buildRegionTable();
+    void clearRegionTable();
     SFZVoice* findFreeVoice();
     SFZVoice* findVoicePlayingNote(int note);
     void handleGroupOff(int group);
@@ -2,26 +2,263 @@
   ==============================================================================
 
     SFZParser.cpp
-    
+
     Implementation of SFZ file parser.
 
   ==============================================================================
 */
 
 #include "SFZParser.h"
+#include <algorithm>
 
 namespace mmg
 {
 
-// Helper function: find substring starting from a position
-static int findFrom(const juce::String& str, int startPos, const juce::String& needle)
+namespace
+{
+
+using Text = std::string_view;
+
+char toLower(char c) noexcept
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(Text a, Text b) noexcept
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); ++i)
+        if (toLower(a[i]) != toLower(b[i]))
+            return false;
+
+    return true;
+}
+
+bool lessIgnoreCase(Text a, Text b) noexcept
+{
+    const auto size = std::min(a.size(), b.size());
+
+    for (size_t i = 0; i < size; ++i)
+        if (toLower(a[i]) != toLower(b[i]))
+            return toLower(a[i]) < toLower(b[i]);
+
+    return a.size() < b.size();
+}
+
+//==============================================================================
+// Tokenizer helpers
+//==============================================================================
+
+bool isSpace(char c) noexcept
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+bool isNameChar(char c) noexcept
 {
-    if (startPos >= str.length())
-        return -1;
-    int result = str.substring(startPos).indexOf(needle);
-    return (result >= 0) ? result + startPos : -1;
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '$';
+}
+
+bool isCommentStart(Text text, size_t pos) noexcept
+{
+    return pos + 1 < text.size() && text[pos] == '/' && (text[pos + 1] == '/' || text[pos + 1] == '*');
+}
+
+Text trim(Text text) noexcept
+{
+    while (!text.empty() && isSpace(text.front()))
+        text.remove_prefix(1);
+    while (!text.empty() && isSpace(text.back()))
+        text.remove_suffix(1);
+    return text;
+}
+
+/** Skip whitespace and comments. Returns false if a block comment never ends. */
+bool skipSpaceAndComments(Text text, size_t& pos) noexcept
+{
+    while (pos < text.size())
+    {
+        if (isSpace(text[pos]))
+        {
+            ++pos;
+        }
+        else if (isCommentStart(text, pos) && text[pos + 1] == '/')
+        {
+            const auto lineEnd = text.find('\n', pos);
+            pos = (lineEnd == Text::npos) ? text.size() : lineEnd + 1;
+        }
+        else if (isCommentStart(text, pos))
+        {
+            const auto commentEnd = text.find("*/", pos + 2);
+            if (commentEnd == Text::npos)
+            {
+                pos = text.size();
+                return false;
+            }
+            pos = commentEnd + 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return true;
+}
+
+/** True if a "name=" token starts at pos. */
+bool isOpcodeAt(Text text, size_t pos) noexcept
+{
+    const auto start = pos;
+    while (pos < text.size() && isNameChar(text[pos]))
+        ++pos;
+    return pos > start && pos < text.size() && text[pos] == '=';
+}
+
+/** Value of a plain opcode: up to whitespace, a header or a comment. */
+Text readValue(Text text, size_t& pos) noexcept
+{
+    const auto start = pos;
+    while (pos < text.size() && !isSpace(text[pos]) && text[pos] != '<' && !isCommentStart(text, pos))
+        ++pos;
+    return text.substr(start, pos - start);
+}
+
+/** Value of a path opcode: may contain spaces, so it runs to the end of the line
+    unless a header, a comment or the next opcode on the same line comes first. */
+Text readPathValue(Text text, size_t& pos) noexcept
+{
+    const auto start = pos;
+    while (pos < text.size() && text[pos] != '\n' && text[pos] != '<' && !isCommentStart(text, pos))
+    {
+        if (isSpace(text[pos]) && pos + 1 < text.size() && isOpcodeAt(text, pos + 1))
+            break;
+        ++pos;
+    }
+    return trim(text.substr(start, pos - start));
+}
+
+//==============================================================================
+// Value conversion (no allocation: numbers are at most a few dozen characters)
+//==============================================================================
+
+template <size_t size>
+const char* toCString(Text text, char (&buffer)[size]) noexcept
+{
+    const auto length = juce::jmin(text.size(), size - 1);
+    std::copy(text.begin(), text.begin() + (std::ptrdiff_t)length, buffer);
+    buffer[length] = 0;
+    return buffer;
+}
+
+int toInt(Text text) noexcept
+{
+    char buffer[32];
+    return juce::CharacterFunctions::getIntValue<int>(juce::CharPointer_UTF8(toCString(trim(text), buffer)));
+}
+
+float toFloat(Text text) noexcept
+{
+    char buffer[48];
+    return (float)juce::CharacterFunctions::getDoubleValue(juce::CharPointer_UTF8(toCString(trim(text), buffer)));
+}
+
+juce::String toString(Text text)
+{
+    return juce::String(juce::CharPointer_UTF8(text.data()), juce::CharPointer_UTF8(text.data() + text.size()));
+}
+
+/** Note names (C4, D#5, etc.) or MIDI numbers */
+int parseNote(Text text) noexcept
+{
+    text = trim(text);
+
+    // Try as integer first
+    bool isNumber = true;
+    for (auto c : text)
+        isNumber = isNumber && ((c >= '0' && c <= '9') || c == '-');
+
+    if (isNumber)
+        return toInt(text);
+
+    // Parse note name
+    static const int noteOffsets[] = { 9, 11, 0, 2, 4, 5, 7 }; // a, b, c, d, e, f, g
+
+    size_t pos = 0;
+    const char firstChar = toLower(text[pos++]);
+    if (firstChar < 'a' || firstChar > 'g')
+        return toInt(text);
+
+    int note = noteOffsets[firstChar - 'a'];
+
+    // Check for sharp/flat
+    if (pos < text.size())
+    {
+        const char second = toLower(text[pos]);
+        if (second == '#' || second == 's')
+        {
+            note++;
+            pos++;
+        }
+        else if (second == 'b')
+        {
+            note--;
+            pos++;
+        }
+    }
+
+    // Parse octave
+    const int octave = toInt(text.substr(pos));
+    note += (octave + 1) * 12;
+
+    return juce::jlimit(0, 127, note);
+}
+
+/** Replace $NAME variables from #define; the longest matching name wins. */
+std::string expandDefines(Text text, const std::map<std::string, std::string>& defines)
+{
+    std::string result;
+    result.reserve(text.size());
+
+    for (size_t pos = 0; pos < text.size();)
+    {
+        const std::string* replacement = nullptr;
+        size_t matchLength = 0;
+
+        if (text[pos] == '$')
+        {
+            for (const auto& [name, value] : defines)
+            {
+                if (name.size() > matchLength && text.compare(pos, name.size(), name) == 0)
+                {
+                    replacement = &value;
+                    matchLength = name.size();
+                }
+            }
+        }
+
+        if (replacement != nullptr)
+        {
+            result += *replacement;
+            pos += matchLength;
+        }
+        else
+        {
+            result += text[pos++];
+        }
+    }
+
+    return result;
 }
 
+} // namespace
+
+//==============================================================================
+// Parsing
+//==============================================================================
+
 bool SFZParser::parse(const juce::File& sfzFile, SFZInstrumentData& outData)
 {
     if (!sfzFile.existsAsFile())
@@ -29,469 +266,577 @@ bool SFZParser::parse(const juce::File& sfzFile, SFZInstrumentData& outData)
         lastError = "SFZ file not found: " + sfzFile.getFullPathName();
         return false;
     }
-    
-    juce::String content = sfzFile.loadFileAsString();
-    if (content.isEmpty())
+
+    // Tokenize straight out of the page cache; nothing is copied into a String
+    juce::MemoryMappedFile mappedFile(sfzFile, juce::MemoryMappedFile::readOnly);
+    if (mappedFile.getData() == nullptr || mappedFile.getSize() == 0)
     {
         lastError = "SFZ file is empty or unreadable";
         return false;
     }
-    
+
     outData.sfzFile = sfzFile;
     outData.baseDirectory = sfzFile.getParentDirectory();
-    
-    return parseString(content, outData.baseDirectory, outData);
+
+    return parseText(Text(static_cast<const char*>(mappedFile.getData()), mappedFile.getSize()),
+                     outData.baseDirectory, outData);
 }
 
 bool SFZParser::parseString(const juce::String& content, const juce::File& baseDir,
                             SFZInstrumentData& outData)
+{
+    return parseText(Text(content.toRawUTF8(), content.getNumBytesAsUTF8()), baseDir, outData);
+}
+
+bool SFZParser::parseText(Text text, const juce::File& baseDir, SFZInstrumentData& outData)
 {
     outData.baseDirectory = baseDir;
     outData.groups.clear();
     outData.defaultPath.clear();
     outData.globalVolume = 0.0f;
     outData.globalTune = 0;
-    
-    // Preprocessing - remove comments and normalize whitespace
-    juce::String processed;
-    bool inBlockComment = false;
-    
-    juce::StringArray lines;
-    lines.addTokens(content, "\n", "");
-    
-    for (auto& line : lines)
+
+    ParseState state;
+    state.data = &outData;
+    state.baseDir = baseDir;
+
+    if (!tokenize(text, state, 0))
+        return false;
+
+    // Save final region/group
+    finishRegion(state);
+    finishGroup(state);
+
+    return true;
+}
+
+//==============================================================================
+enum class SFZParser::Opcode
+{
+    Unknown,
+    Sample, DefaultPath,
+    Lokey, Hikey, Key, PitchKeycenter,
+    Lovel, Hivel,
+    SeqLength, SeqPosition, Lorand, Hirand,
+    Volume, Pan, Tune, Transpose, PitchKeytrack,
+    AmpegAttack, AmpegDecay, AmpegSustain, AmpegRelease,
+    LoopMode, LoopStart, LoopEnd,
+    Offset, End,
+    Group, OffBy,
+    Trigger
+};
+
+SFZParser::Opcode SFZParser::lookupOpcode(Text name) noexcept
+{
+    struct OpcodeName
     {
-        // Remove line comments
-        int commentPos = line.indexOf("//");
-        if (commentPos >= 0)
-            line = line.substring(0, commentPos);
-        
-        // Handle block comments /* */
-        while (true)
-        {
-            if (inBlockComment)
-            {
-                int endPos = line.indexOf("*/");
-                if (endPos >= 0)
-                {
-                    line = line.substring(endPos + 2);
-                    inBlockComment = false;
-                }
-                else
-                {
-                    line = "";
-                    break;
-                }
-            }
-            else
-            {
-                int startPos = line.indexOf("/*");
-                if (startPos >= 0)
-                {
-                    int endPos = findFrom(line, startPos + 2, "*/");
-                    if (endPos >= 0)
-                    {
-                        line = line.substring(0, startPos) + line.substring(endPos + 2);
-                    }
-                    else
-                    {
-                        line = line.substring(0, startPos);
-                        inBlockComment = true;
-                    }
-                }
-                else
-                {
-                    break;
-                }
-            }
-        }
-        
-        line = line.trim();
-        if (line.isNotEmpty())
-            processed += line + " ";
-    }
-    
-    // Parse sections and opcodes
-    SectionType currentSection = SectionType::None;
-    SFZGroup currentGroup;
-    SFZRegion currentRegion;
-    bool hasRegion = false;
-    bool hasGroup = false;
-    
-    int pos = 0;
-    while (pos < processed.length())
+        Text name;
+        Opcode opcode;
+    };
+
+    // Kept sorted by name for the binary search below
+    static constexpr OpcodeName opcodeNames[] =
+    {
+        { "ampeg_attack",    Opcode::AmpegAttack },
+        { "ampeg_decay",     Opcode::AmpegDecay },
+        { "ampeg_release",   Opcode::AmpegRelease },
+        { "ampeg_sustain",   Opcode::AmpegSustain },
+        { "default_path",    Opcode::DefaultPath },
+        { "end",             Opcode::End },
+        { "group",           Opcode::Group },
+        { "hikey",           Opcode::Hikey },
+        { "hirand",          Opcode::Hirand },
+        { "hivel",           Opcode::Hivel },
+        { "key",             Opcode::Key },
+        { "lokey",           Opcode::Lokey },
+        { "loop_end",        Opcode::LoopEnd },
+        { "loop_mode",       Opcode::LoopMode },
+        { "loop_start",      Opcode::LoopStart },
+        { "lorand",          Opcode::Lorand },
+        { "lovel",           Opcode::Lovel },
+        { "off_by",          Opcode::OffBy },
+        { "offset",          Opcode::Offset },
+        { "pan",             Opcode::Pan },
+        { "pitch_keycenter", Opcode::PitchKeycenter },
+        { "pitch_keytrack",  Opcode::PitchKeytrack },
+        { "sample",          Opcode::Sample },
+        { "seq_length",      Opcode::SeqLength },
+        { "seq_position",    Opcode::SeqPosition },
+        { "transpose",       Opcode::Transpose },
+        { "trigger",         Opcode::Trigger },
+        { "tune",            Opcode::Tune },
+        { "volume",          Opcode::Volume }
+    };
+
+    const auto it = std::lower_bound(std::begin(opcodeNames), std::end(opcodeNames), name,
+                                     [](const OpcodeName& entry, Text key) { return lessIgnoreCase(entry.name, key); });
+
+    if (it != std::end(opcodeNames) && equalsIgnoreCase(it->name, name))
+        return it->opcode;
+
+    return Opcode::Unknown;
+}
+
+bool SFZParser::tokenize(Text text, ParseState& state, int includeDepth)
+{
+    // UTF-8 byte order mark
+    if (text.size() >= 3 && text.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        text.remove_prefix(3);
+
+    size_t pos = 0;
+    while (true)
     {
-        // Skip whitespace
-        while (pos < processed.length() && juce::CharacterFunctions::isWhitespace(processed[pos]))
-            pos++;
-        
-        if (pos >= processed.length())
+        // An unterminated block comment runs to the end of the file
+        skipSpaceAndComments(text, pos);
+        if (pos >= text.size())
             break;
-        
-        // Check for header
-        if (processed[pos] == '<')
+
+        const char c = text[pos];
+
+        // Header
+        if (c == '<')
         {
-            int endPos = findFrom(processed, pos, ">");
-            if (endPos < 0)
+            const auto endPos = text.find('>', pos);
+            if (endPos == Text::npos)
             {
-                lastError = "Unterminated header at position " + juce::String(pos);
+                lastError = "Unterminated header at position " + juce::String((juce::int64)pos);
                 return false;
             }
-            
-            juce::String header = processed.substring(pos + 1, endPos).toLowerCase().trim();
+
+            handleHeader(trim(text.substr(pos + 1, endPos - pos - 1)), state);
             pos = endPos + 1;
-            
-            // Save current region/group if any
-            if (hasRegion)
-            {
-                // Resolve sample path
-                currentRegion.sampleFile = resolveSamplePath(currentRegion.sample, 
-                                                              baseDir, outData.defaultPath);
-                currentGroup.regions.push_back(currentRegion);
-                currentRegion = SFZRegion();
-                hasRegion = false;
-            }
-            
-            if (header == "global")
-            {
-                // Save current group if any
-                if (hasGroup && !currentGroup.regions.empty())
-                {
-                    outData.groups.push_back(currentGroup);
-                    currentGroup = SFZGroup();
-                }
-                currentSection = SectionType::Global;
-                hasGroup = false;
-            }
-            else if (header == "control")
-            {
-                if (hasGroup && !currentGroup.regions.empty())
-                {
-                    outData.groups.push_back(currentGroup);
-                    currentGroup = SFZGroup();
-                }
-                currentSection = SectionType::Control;
-                hasGroup = false;
-            }
-            else if (header == "group")
-            {
-                if (hasGroup && !currentGroup.regions.empty())
-                {
-                    outData.groups.push_back(currentGroup);
-                }
-                currentGroup = SFZGroup();
-                currentSection = SectionType::Group;
-                hasGroup = true;
-            }
-            else if (header == "region")
-            {
-                if (!hasGroup)
-                {
-                    // Create implicit group
-                    currentGroup = SFZGroup();
-                    hasGroup = true;
-                }
-                
-                // Initialize region with group defaults
-                currentRegion = SFZRegion();
-                currentRegion.lokey = currentGroup.lokey;
-                currentRegion.hikey = currentGroup.hikey;
-                currentRegion.lovel = currentGroup.lovel;
-                currentRegion.hivel = currentGroup.hivel;
-                currentRegion.pitch_keycenter = currentGroup.pitch_keycenter;
-                currentRegion.volume = currentGroup.volume;
-                currentRegion.pan = currentGroup.pan;
-                currentRegion.ampeg_attack = currentGroup.ampeg_attack;
-                currentRegion.ampeg_decay = currentGroup.ampeg_decay;
-                currentRegion.ampeg_sustain = currentGroup.ampeg_sustain;
-                currentRegion.ampeg_release = currentGroup.ampeg_release;
-                currentRegion.group = currentGroup.group;
-                currentRegion.off_by = currentGroup.off_by;
-                currentRegion.trigger = currentGroup.trigger;
-                
-                currentSection = SectionType::Region;
-                hasRegion = true;
-            }
-            else if (header == "curve" || header == "effect" || header == "master" || header == "midi")
-            {
-                // Unsupported headers - skip
-                currentSection = SectionType::None;
-            }
+            continue;
         }
-        else
+
+        // Preprocessor directive
+        if (c == '#')
         {
-            // Parse opcode=value
-            int eqPos = findFrom(processed, pos, "=");
-            if (eqPos < 0)
-            {
-                // Skip unknown token
-                while (pos < processed.length() && !juce::CharacterFunctions::isWhitespace(processed[pos]))
-                    pos++;
-                continue;
-            }
-            
-            juce::String opcode = processed.substring(pos, eqPos).trim().toLowerCase();
-            pos = eqPos + 1;
-            
-            // Parse value (may contain spaces if quoted or for sample paths)
-            juce::String value;
-            bool needsPath = (opcode == "sample" || opcode == "default_path");
-            
-            if (needsPath)
-            {
-                // Value extends until next opcode or header
-                int nextHeader = findFrom(processed, pos, "<");
-                int nextEq = findFrom(processed, pos, "=");
-                int endVal = processed.length();
-                
-                if (nextHeader >= 0 && (nextEq < 0 || nextHeader < nextEq))
-                    endVal = nextHeader;
-                else if (nextEq >= 0)
-                {
-                    // Find start of next opcode (word before =)
-                    int wordStart = nextEq - 1;
-                    while (wordStart > pos && !juce::CharacterFunctions::isWhitespace(processed[wordStart - 1]))
-                        wordStart--;
-                    if (wordStart > pos)
-                        endVal = wordStart;
-                }
-                
-                value = processed.substring(pos, endVal).trim();
-                pos = endVal;
-            }
-            else
-            {
-                // Simple value - read until whitespace
-                int startVal = pos;
-                while (pos < processed.length() && 
-                       !juce::CharacterFunctions::isWhitespace(processed[pos]) &&
-                       processed[pos] != '<')
-                    pos++;
-                value = processed.substring(startVal, pos).trim();
-            }
-            
-            // Apply opcode
-            parseOpcode(opcode, value, outData, currentGroup, currentRegion, currentSection);
+            handleDirective(text, pos, state, includeDepth);
+            continue;
         }
+
+        // Parse opcode=value
+        const auto nameStart = pos;
+        while (pos < text.size() && isNameChar(text[pos]))
+            ++pos;
+        auto opcode = text.substr(nameStart, pos - nameStart);
+
+        size_t eqPos = pos;
+        while (eqPos < text.size() && (text[eqPos] == ' ' || text[eqPos] == '\t'))
+            ++eqPos;
+
+        if (opcode.empty() || eqPos >= text.size() || text[eqPos] != '=')
+        {
+            // Skip unknown token
+            while (pos < text.size() && !isSpace(text[pos]) && text[pos] != '<')
+                ++pos;
+            continue;
+        }
+
+        pos = eqPos + 1;
+        while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t'))
+            ++pos;
+
+        // The name is resolved once here; applyOpcode only sees the enum
+        std::string expandedName;
+        if (!state.defines.empty() && opcode.find('$') != Text::npos)
+            opcode = expandedName = expandDefines(opcode, state.defines);
+
+        // Sample paths may contain spaces; everything else ends at whitespace
+        const auto kind = lookupOpcode(opcode);
+        const bool needsPath = (kind == Opcode::Sample || kind == Opcode::DefaultPath);
+        const auto value = needsPath ? readPathValue(text, pos) : readValue(text, pos);
+
+        applyOpcode(kind, value, state);
     }
-    
-    // Save final region/group
-    if (hasRegion)
-    {
-        currentRegion.sampleFile = resolveSamplePath(currentRegion.sample, 
-                                                      baseDir, outData.defaultPath);
-        currentGroup.regions.push_back(currentRegion);
-    }
-    
-    if (hasGroup && !currentGroup.regions.empty())
-    {
-        outData.groups.push_back(currentGroup);
-    }
-    
+
     return true;
 }
 
-void SFZParser::parseOpcode(const juce::String& opcode, const juce::String& value,
-                            SFZInstrumentData& data, SFZGroup& currentGroup,
-                            SFZRegion& currentRegion, SectionType section)
+void SFZParser::handleHeader(Text header, ParseState& state)
 {
-    // Helper to parse note names (C4, D#5, etc.) or MIDI numbers
-    auto parseNote = [](const juce::String& s) -> int {
-        juce::String lower = s.toLowerCase().trim();
-        
-        // Try as integer first
-        if (lower.containsOnly("0123456789-"))
-            return lower.getIntValue();
-        
-        // Parse note name
-        static const int noteOffsets[] = { 9, 11, 0, 2, 4, 5, 7 }; // a, b, c, d, e, f, g
-        
-        if (lower.isEmpty())
-            return 60;
-        
-        int note = 0;
-        int pos = 0;
-        
-        char firstChar = (char)lower[pos++];
-        if (firstChar >= 'a' && firstChar <= 'g')
-            note = noteOffsets[firstChar - 'a'];
-        else if (firstChar >= 'c' && firstChar <= 'b')
-            note = noteOffsets[firstChar - 'c' + 2];
-        else
-            return lower.getIntValue();
-        
-        // Check for sharp/flat
-        if (pos < lower.length())
-        {
-            char second = (char)lower[pos];
-            if (second == '#' || second == 's')
-            {
-                note++;
-                pos++;
-            }
-            else if (second == 'b')
-            {
-                note--;
-                pos++;
-            }
-        }
-        
-        // Parse octave
-        int octave = lower.substring(pos).getIntValue();
-        note += (octave + 1) * 12;
-        
-        return juce::jlimit(0, 127, note);
-    };
-    
-    // Apply opcode based on section
-    if (opcode == "sample")
-    {
-        if (section == SectionType::Region)
-            currentRegion.sample = value;
-    }
-    else if (opcode == "default_path")
-    {
-        data.defaultPath = value.replace("\\", "/");
-        if (!data.defaultPath.endsWithChar('/'))
-            data.defaultPath += "/";
-    }
-    else if (opcode == "lokey")
+    // Save current region if any
+    finishRegion(state);
+
+    if (equalsIgnoreCase(header, "global") || equalsIgnoreCase(header, "control"))
     {
-        int v = parseNote(value);
-        if (section == SectionType::Region) currentRegion.lokey = v;
-        else if (section == SectionType::Group) currentGroup.lokey = v;
+        finishGroup(state);
+        state.section = equalsIgnoreCase(header, "global") ? SectionType::Global : SectionType::Control;
+        state.hasGroup = false;
     }
-    else if (opcode == "hikey")
+    else if (equalsIgnoreCase(header, "group"))
     {
-        int v = parseNote(value);
-        if (section == SectionType::Region) currentRegion.hikey = v;
-        else if (section == SectionType::Group) currentGroup.hikey = v;
+        finishGroup(state);
+        state.currentGroup = SFZGroup();
+        state.section = SectionType::Group;
+        state.hasGroup = true;
     }
-    else if (opcode == "key")
+    else if (equalsIgnoreCase(header, "region"))
     {
-        int v = parseNote(value);
-        if (section == SectionType::Region)
+        if (!state.hasGroup)
         {
-            currentRegion.lokey = currentRegion.hikey = currentRegion.pitch_keycenter = v;
+            // Create implicit group
+            state.currentGroup = SFZGroup();
+            state.hasGroup = true;
         }
-        else if (section == SectionType::Group)
-        {
-            currentGroup.lokey = currentGroup.hikey = currentGroup.pitch_keycenter = v;
-        }
-    }
-    else if (opcode == "pitch_keycenter")
-    {
-        int v = parseNote(value);
-        if (section == SectionType::Region) currentRegion.pitch_keycenter = v;
-        else if (section == SectionType::Group) currentGroup.pitch_keycenter = v;
-    }
-    else if (opcode == "lovel")
-    {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.lovel = v;
-        else if (section == SectionType::Group) currentGroup.lovel = v;
-    }
-    else if (opcode == "hivel")
-    {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.hivel = v;
-        else if (section == SectionType::Group) currentGroup.hivel = v;
-    }
-    else if (opcode == "volume")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.volume = v;
-        else if (section == SectionType::Group) currentGroup.volume = v;
-        else if (section == SectionType::Global) data.globalVolume = v;
-    }
-    else if (opcode == "pan")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.pan = v;
-        else if (section == SectionType::Group) currentGroup.pan = v;
-    }
-    else if (opcode == "tune")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.tune = v;
-    }
-    else if (opcode == "transpose")
-    {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.transpose = v;
-    }
-    else if (opcode == "pitch_keytrack")
-    {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.pitch_keytrack = v;
-    }
-    else if (opcode == "ampeg_attack")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.ampeg_attack = v;
-        else if (section == SectionType::Group) currentGroup.ampeg_attack = v;
-    }
-    else if (opcode == "ampeg_decay")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.ampeg_decay = v;
-        else if (section == SectionType::Group) currentGroup.ampeg_decay = v;
-    }
-    else if (opcode == "ampeg_sustain")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.ampeg_sustain = v;
-        else if (section == SectionType::Group) currentGroup.ampeg_sustain = v;
-    }
-    else if (opcode == "ampeg_release")
-    {
-        float v = value.getFloatValue();
-        if (section == SectionType::Region) currentRegion.ampeg_release = v;
-        else if (section == SectionType::Group) currentGroup.ampeg_release = v;
-    }
-    else if (opcode == "loop_mode")
-    {
-        if (section == SectionType::Region)
-            currentRegion.loop_mode = value.toLowerCase();
-    }
-    else if (opcode == "loop_start")
-    {
-        if (section == SectionType::Region)
-            currentRegion.loop_start = value.getIntValue();
+
+        // Initialize region with group defaults
+        const auto& group = state.currentGroup;
+        auto& region = state.currentRegion;
+        region = SFZRegion();
+        region.lokey = group.lokey;
+        region.hikey = group.hikey;
+        region.lovel = group.lovel;
+        region.hivel = group.hivel;
+        region.pitch_keycenter = group.pitch_keycenter;
+        region.seq_length = group.seq_length;
+        region.seq_position = group.seq_position;
+        region.lorand = group.lorand;
+        region.hirand = group.hirand;
+        region.volume = group.volume;
+        region.pan = group.pan;
+        region.ampeg_attack = group.ampeg_attack;
+        region.ampeg_decay = group.ampeg_decay;
+        region.ampeg_sustain = group.ampeg_sustain;
+        region.ampeg_release = group.ampeg_release;
+        region.group = group.group;
+        region.off_by = group.off_by;
+        region.trigger = group.trigger;
+        region.triggerMode = group.triggerMode;
+
+        state.section = SectionType::Region;
+        state.hasRegion = true;
     }
-    else if (opcode == "loop_end")
+    else if (equalsIgnoreCase(header, "curve") || equalsIgnoreCase(header, "effect")
+             || equalsIgnoreCase(header, "master") || equalsIgnoreCase(header, "midi"))
     {
-        if (section == SectionType::Region)
-            currentRegion.loop_end = value.getIntValue();
+        // Unsupported headers - skip
+        state.section = SectionType::None;
     }
-    else if (opcode == "offset")
+}
+
+void SFZParser::handleDirective(Text text, size_t& pos, ParseState& state, int includeDepth)
+{
+    const auto lineEnd = juce::jmin(text.find('\n', pos), text.size());
+
+    const auto nameStart = ++pos;
+    while (pos < lineEnd && isNameChar(text[pos]))
+        ++pos;
+    const auto directive = text.substr(nameStart, pos - nameStart);
+
+    // Rest of the line, without a trailing comment
+    auto rest = text.substr(pos, lineEnd - pos);
+    for (size_t i = 0; i < rest.size(); ++i)
     {
-        if (section == SectionType::Region)
-            currentRegion.offset = value.getIntValue();
+        if (isCommentStart(rest, i))
+        {
+            rest = rest.substr(0, i);
+            break;
+        }
     }
-    else if (opcode == "end")
+    rest = trim(rest);
+    pos = lineEnd;
+
+    if (directive == "define")
     {
-        if (section == SectionType::Region)
-            currentRegion.end = value.getIntValue();
+        // #define $NAME value
+        size_t nameEnd = 0;
+        while (nameEnd < rest.size() && !isSpace(rest[nameEnd]))
+            ++nameEnd;
+
+        const auto name = rest.substr(0, nameEnd);
+        if (!name.empty() && name.front() == '$')
+            state.defines[std::string(name)] = std::string(trim(rest.substr(nameEnd)));
     }
-    else if (opcode == "group")
+    else if (directive == "include")
     {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.group = v;
-        else if (section == SectionType::Group) currentGroup.group = v;
+        // #include "relative/path.sfz"
+        if (rest.size() < 2 || rest.front() != '"')
+            return;
+
+        const auto closingQuote = rest.find('"', 1);
+        if (closingQuote == Text::npos)
+            return;
+
+        if (includeDepth >= maxIncludeDepth)
+        {
+            DBG("SFZParser: #include nested too deeply, skipping");
+            return;
+        }
+
+        const auto path = toString(rest.substr(1, closingQuote - 1)).replace("\\", "/");
+        const auto file = juce::File::isAbsolutePath(path) ? juce::File(path) : state.baseDir.getChildFile(path);
+
+        // Map each included file once, however often it is included
+        auto& mapped = state.includes[file.getFullPathName()];
+        if (mapped == nullptr)
+            mapped = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+
+        if (mapped->getData() == nullptr)
+        {
+            DBG("SFZParser: Could not open #include " << file.getFullPathName());
+            return;
+        }
+
+        tokenize(Text(static_cast<const char*>(mapped->getData()), mapped->getSize()), state, includeDepth + 1);
     }
-    else if (opcode == "off_by")
+}
+
+void SFZParser::finishRegion(ParseState& state)
+{
+    if (!state.hasRegion)
+        return;
+
+    // Resolve sample path
+    auto& region = state.currentRegion;
+    region.sampleFile = resolveSamplePath(region.sample, state.baseDir, state.data->defaultPath);
+    state.currentGroup.regions.push_back(std::move(region));
+    region = SFZRegion();
+    state.hasRegion = false;
+}
+
+void SFZParser::finishGroup(ParseState& state)
+{
+    if (state.hasGroup && !state.currentGroup.regions.empty())
     {
-        int v = value.getIntValue();
-        if (section == SectionType::Region) currentRegion.off_by = v;
-        else if (section == SectionType::Group) currentGroup.off_by = v;
+        state.data->groups.push_back(std::move(state.currentGroup));
+        state.currentGroup = SFZGroup();
     }
-    else if (opcode == "trigger")
+}
+
+void SFZParser::applyOpcode(Opcode opcode, Text value, ParseState& state)
+{
+    // Variables only cost a copy where they are used
+    std::string expandedValue;
+    if (!state.defines.empty() && value.find('$') != Text::npos)
+        value = expandedValue = expandDefines(value, state.defines);
+
+    auto& data = *state.data;
+    auto& currentGroup = state.currentGroup;
+    auto& currentRegion = state.currentRegion;
+    const auto section = state.section;
+
+    // Apply opcode based on section
+    switch (opcode)
     {
-        if (section == SectionType::Region) currentRegion.trigger = value.toLowerCase();
-        else if (section == SectionType::Group) currentGroup.trigger = value.toLowerCase();
+        case Opcode::Sample:
+            if (section == SectionType::Region)
+                currentRegion.sample = toString(value);
+            break;
+
+        case Opcode::DefaultPath:
+            data.defaultPath = toString(value).replace("\\", "/");
+            if (!data.defaultPath.endsWithChar('/'))
+                data.defaultPath += "/";
+            break;
+
+        case Opcode::Lokey:
+        {
+            int v = parseNote(value);
+            if (section == SectionType::Region) currentRegion.lokey = v;
+            else if (section == SectionType::Group) currentGroup.lokey = v;
+            break;
+        }
+
+        case Opcode::Hikey:
+        {
+            int v = parseNote(value);
+            if (section == SectionType::Region) currentRegion.hikey = v;
+            else if (section == SectionType::Group) currentGroup.hikey = v;
+            break;
+        }
+
+        case Opcode::Key:
+        {
+            int v = parseNote(value);
+            if (section == SectionType::Region)
+                currentRegion.lokey = currentRegion.hikey = currentRegion.pitch_keycenter = v;
+            else if (section == SectionType::Group)
+                currentGroup.lokey = currentGroup.hikey = currentGroup.pitch_keycenter = v;
+            break;
+        }
+
+        case Opcode::PitchKeycenter:
+        {
+            int v = parseNote(value);
+            if (section == SectionType::Region) currentRegion.pitch_keycenter = v;
+            else if (section == SectionType::Group) currentGroup.pitch_keycenter = v;
+            break;
+        }
+
+        case Opcode::Lovel:
+        {
+            int v = toInt(value);
+            if (section == SectionType::Region) currentRegion.lovel = v;
+            else if (section == SectionType::Group) currentGroup.lovel = v;
+            break;
+        }
+
+        case Opcode::Hivel:
+        {
+            int v = toInt(value);
+            if (section == SectionType::Region) currentRegion.hivel = v;
+            else if (section == SectionType::Group) currentGroup.hivel = v;
+            break;
+        }
+
+        case Opcode::SeqLength:
+        {
+            int v = juce::jmax(1, toInt(value));
+            if (section == SectionType::Region) currentRegion.seq_length = v;
+            else if (section == SectionType::Group) currentGroup.seq_length = v;
+            break;
+        }
+
+        case Opcode::SeqPosition:
+        {
+            int v = juce::jmax(1, toInt(value));
+            if (section == SectionType::Region) currentRegion.seq_position = v;
+            else if (section == SectionType::Group) currentGroup.seq_position = v;
+            break;
+        }
+
+        case Opcode::Lorand:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.lorand = v;
+            else if (section == SectionType::Group) currentGroup.lorand = v;
+            break;
+        }
+
+        case Opcode::Hirand:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.hirand = v;
+            else if (section == SectionType::Group) currentGroup.hirand = v;
+            break;
+        }
+
+        case Opcode::Volume:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.volume = v;
+            else if (section == SectionType::Group) currentGroup.volume = v;
+            else if (section == SectionType::Global) data.globalVolume = v;
+            break;
+        }
+
+        case Opcode::Pan:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.pan = v;
+            else if (section == SectionType::Group) currentGroup.pan = v;
+            break;
+        }
+
+        case Opcode::Tune:
+            if (section == SectionType::Region) currentRegion.tune = toFloat(value);
+            break;
+
+        case Opcode::Transpose:
+            if (section == SectionType::Region) currentRegion.transpose = toInt(value);
+            break;
+
+        case Opcode::PitchKeytrack:
+            if (section == SectionType::Region) currentRegion.pitch_keytrack = toInt(value);
+            break;
+
+        case Opcode::AmpegAttack:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.ampeg_attack = v;
+            else if (section == SectionType::Group) currentGroup.ampeg_attack = v;
+            break;
+        }
+
+        case Opcode::AmpegDecay:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.ampeg_decay = v;
+            else if (section == SectionType::Group) currentGroup.ampeg_decay = v;
+            break;
+        }
+
+        case Opcode::AmpegSustain:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.ampeg_sustain = v;
+            else if (section == SectionType::Group) currentGroup.ampeg_sustain = v;
+            break;
+        }
+
+        case Opcode::AmpegRelease:
+        {
+            float v = toFloat(value);
+            if (section == SectionType::Region) currentRegion.ampeg_release = v;
+            else if (section == SectionType::Group) currentGroup.ampeg_release = v;
+            break;
+        }
+
+        case Opcode::LoopMode:
+            if (section == SectionType::Region)
+            {
+                currentRegion.loop_mode = toString(value).toLowerCase();
+
+                if (equalsIgnoreCase(value, "loop_continuous"))
+                    currentRegion.loopMode = SFZLoopMode::LoopContinuous;
+                else if (equalsIgnoreCase(value, "loop_sustain"))
+                    currentRegion.loopMode = SFZLoopMode::LoopSustain;
+                else
+                    currentRegion.loopMode = SFZLoopMode::NoLoop;
+            }
+            break;
+
+        case Opcode::LoopStart:
+            if (section == SectionType::Region) currentRegion.loop_start = toInt(value);
+            break;
+
+        case Opcode::LoopEnd:
+            if (section == SectionType::Region) currentRegion.loop_end = toInt(value);
+            break;
+
+        case Opcode::Offset:
+            if (section == SectionType::Region) currentRegion.offset = toInt(value);
+            break;
+
+        case Opcode::End:
+            if (section == SectionType::Region) currentRegion.end = toInt(value);
+            break;
+
+        case Opcode::Group:
+        {
+            int v = toInt(value);
+            if (section == SectionType::Region) currentRegion.group = v;
+            else if (section == SectionType::Group) currentGroup.group = v;
+            break;
+        }
+
+        case Opcode::OffBy:
+        {
+            int v = toInt(value);
+            if (section == SectionType::Region) currentRegion.off_by = v;
+            else if (section == SectionType::Group) currentGroup.off_by = v;
+            break;
+        }
+
+        case Opcode::Trigger:
+        {
+            const auto trigger = toString(value).toLowerCase();
+
+            SFZTrigger mode = SFZTrigger::Attack;
+            if (trigger == "release")       mode = SFZTrigger::Release;
+            else if (trigger == "first")    mode = SFZTrigger::First;
+            else if (trigger == "legato")   mode = SFZTrigger::Legato;
+
+            if (section == SectionType::Region) { currentRegion.trigger = trigger; currentRegion.triggerMode = mode; }
+            else if (section == SectionType::Group) { currentGroup.trigger = trigger; currentGroup.triggerMode = mode; }
+            break;
+        }
+
+        case Opcode::Unknown:
+            // Many more opcodes could be supported here...
+            break;
     }
-    // Many more opcodes could be supported here...
 }
 
 juce::File SFZParser::resolveSamplePath(const juce::String& samplePath,
@@ -4,7 +4,8 @@
     SFZParser.h
     
     Simple SFZ file parser for loading sample-based instruments.
-    Supports common opcodes used in most SFZ instruments.
+    Supports common opcodes used in most SFZ instruments, plus the
+    #define and #include preprocessor directives.
 
   ==============================================================================
 */
@@ -15,10 +16,31 @@
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <vector>
 #include <map>
+#include <memory>
+#include <string>
+#include <string_view>
 
 namespace mmg
 {
 
+//==============================================================================
+/** Parsed loop_mode opcode. */
+enum class SFZLoopMode
+{
+    NoLoop,             // no_loop, one_shot
+    LoopContinuous,
+    LoopSustain
+};
+
+/** Parsed trigger opcode. */
+enum class SFZTrigger
+{
+    Attack,
+    Release,
+    First,
+    Legato
+};
+
 //==============================================================================
 /**
     A region within an SFZ file - maps samples to key/velocity ranges.
@@ -39,6 +61,12 @@ struct SFZRegion
     int lovel = 0;
     int hivel = 127;
     
+    // Round robin / random selection
+    int seq_length = 1;            // Regions in the round-robin cycle
+    int seq_position = 1;          // This region's turn in the cycle (1-based)
+    float lorand = 0.0f;           // Plays when lorand <= random < hirand
+    float hirand = 1.0f;
+    
     // Playback
     float volume = 0.0f;           // dB
     float pan = 0.0f;              // -100 to +100
@@ -53,6 +81,7 @@ struct SFZRegion
     
     // Loop
     juce::String loop_mode = "no_loop";  // no_loop, loop_continuous, loop_sustain
+    SFZLoopMode loopMode = SFZLoopMode::NoLoop;  // loop_mode resolved at parse time for playback
     int loop_start = 0;
     int loop_end = 0;
     
@@ -66,6 +95,10 @@ struct SFZRegion
     
     // Trigger
     juce::String trigger = "attack";  // attack, release, first, legato
+    SFZTrigger triggerMode = SFZTrigger::Attack;  // trigger resolved at parse time for note-on
+    
+    /** True if playback wraps around the loop points. */
+    bool isLooped() const { return loopMode != SFZLoopMode::NoLoop; }
     
     /** Check if this region responds to a given note and velocity. */
     bool matches(int note, int velocity) const
@@ -87,6 +120,10 @@ struct SFZGroup
     int lovel = 0;
     int hivel = 127;
     int pitch_keycenter = 60;
+    int seq_length = 1;
+    int seq_position = 1;
+    float lorand = 0.0f;
+    float hirand = 1.0f;
     float volume = 0.0f;
     float pan = 0.0f;
     float ampeg_attack = 0.001f;
@@ -96,6 +133,7 @@ struct SFZGroup
     int group = 0;
     int off_by = 0;
     juce::String trigger = "attack";
+    SFZTrigger triggerMode = SFZTrigger::Attack;
     
     std::vector<SFZRegion> regions;
 };
@@ -149,6 +187,12 @@ struct SFZInstrumentData
 //==============================================================================
 /**
     Parser for SFZ files.
+
+    Single pass over the file's bytes (memory-mapped for files): comments,
+    headers and opcode=value pairs are tokenised as string_views into that
+    buffer and applied straight to the region being built. Opcode names are
+    mapped to an enum once per token; values are only copied when they end up
+    as strings (sample paths) or contain #define variables.
 */
 class SFZParser
 {
@@ -178,10 +222,37 @@ private:
     
     // Parsing state
     enum class SectionType { None, Global, Group, Region, Control };
+    enum class Opcode;
+    
+    struct ParseState
+    {
+        SFZInstrumentData* data = nullptr;
+        juce::File baseDir;
+        
+        SectionType section = SectionType::None;
+        SFZGroup currentGroup;
+        SFZRegion currentRegion;
+        bool hasRegion = false;
+        bool hasGroup = false;
+        
+        std::map<std::string, std::string> defines;                                 // #define $NAME value
+        std::map<juce::String, std::unique_ptr<juce::MemoryMappedFile>> includes;   // Each #include mapped once
+    };
+    
+    bool parseText(std::string_view text, const juce::File& baseDir, SFZInstrumentData& outData);
+    bool tokenize(std::string_view text, ParseState& state, int includeDepth);
+    
+    void handleHeader(std::string_view header, ParseState& state);
+    void handleDirective(std::string_view text, size_t& pos, ParseState& state, int includeDepth);
+    void applyOpcode(Opcode opcode, std::string_view value, ParseState& state);
+    
+    /** Case-insensitive binary search of the sorted opcode name table. */
+    static Opcode lookupOpcode(std::string_view name) noexcept;
+    
+    void finishRegion(ParseState& state);
+    void finishGroup(ParseState& state);
     
-    void parseOpcode(const juce::String& opcode, const juce::String& value,
-                     SFZInstrumentData& data, SFZGroup& currentGroup, 
-                     SFZRegion& currentRegion, SectionType section);
+    static constexpr int maxIncludeDepth = 16;
     
     juce::File resolveSamplePath(const juce::String& samplePath,
                                   const juce::File& baseDir,
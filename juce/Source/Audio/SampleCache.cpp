@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    SampleCache.cpp
+
+    Implementation of the shared sample and SoundFont cache.
+
+  ==============================================================================
+*/
+
+#include "SampleCache.h"
+#include "External/tsf.h"
+
+namespace mmg
+{
+
+//==============================================================================
+// SharedSoundFont
+//==============================================================================
+
+SharedSoundFont::SharedSoundFont(tsf* loadedFont, const juce::File& sourceFile)
+    : font(loadedFont), file(sourceFile)
+{
+}
+
+SharedSoundFont::~SharedSoundFont()
+{
+    // Every instance holds a shared_ptr to us, so this is the last reference to the font data
+    tsf_close(font);
+}
+
+tsf* SharedSoundFont::createInstance() const
+{
+    const juce::ScopedLock sl(instanceLock);
+    return tsf_copy(font);
+}
+
+void SharedSoundFont::releaseInstance(tsf* instance) const
+{
+    if (instance == nullptr)
+        return;
+
+    const juce::ScopedLock sl(instanceLock);
+    tsf_close(instance);
+}
+
+//==============================================================================
+// SampleCache
+//==============================================================================
+
+std::shared_ptr<const StreamedSample> SampleCache::getSample(juce::AudioFormatManager& formatManager,
+                                                             const juce::File& file,
+                                                             double preloadSeconds,
+                                                             double maxSeconds)
+{
+    const auto key = makeKey(file, "sample|" + juce::String(preloadSeconds) + "|" + juce::String(maxSeconds));
+
+    {
+        const juce::ScopedLock sl(lock);
+        if (auto* entry = findEntry(key))
+            return entry->sample;
+    }
+
+    // Decode outside the lock so other tracks can load different files meanwhile
+    std::shared_ptr<const StreamedSample> sample = StreamedSample::load(formatManager, file, preloadSeconds, maxSeconds);
+    if (sample == nullptr)
+        return nullptr;
+
+    Entry entry;
+    entry.bytes = sample->getMemorySize();
+    entry.sample = std::move(sample);
+
+    const juce::ScopedLock sl(lock);
+    auto result = insertEntry(key, std::move(entry)).sample;
+    trimLocked(memoryBudget);
+    return result;
+}
+
+std::shared_ptr<const SharedSoundFont> SampleCache::getSoundFont(const juce::File& file)
+{
+    const auto key = makeKey(file, "sf2");
+
+    {
+        const juce::ScopedLock sl(lock);
+        if (auto* entry = findEntry(key))
+            return entry->soundFont;
+    }
+
+    auto* font = tsf_load_filename(file.getFullPathName().toRawUTF8());
+    if (font == nullptr)
+        return nullptr;
+
+    Entry entry;
+    entry.soundFont.reset(new SharedSoundFont(font, file));
+
+    // TSF converts the 16-bit sample pool to float, so the decoded font is about twice the file
+    entry.bytes = (size_t)file.getSize() * 2;
+
+    const juce::ScopedLock sl(lock);
+    auto result = insertEntry(key, std::move(entry)).soundFont;
+    trimLocked(memoryBudget);
+    return result;
+}
+
+//==============================================================================
+void SampleCache::setMemoryBudget(size_t bytes)
+{
+    const juce::ScopedLock sl(lock);
+    memoryBudget = bytes;
+    trimLocked(memoryBudget);
+}
+
+size_t SampleCache::getMemoryBudget() const
+{
+    const juce::ScopedLock sl(lock);
+    return memoryBudget;
+}
+
+void SampleCache::trim()
+{
+    const juce::ScopedLock sl(lock);
+    trimLocked(memoryBudget);
+}
+
+void SampleCache::clearUnused()
+{
+    const juce::ScopedLock sl(lock);
+    trimLocked(0);
+}
+
+SampleCache::Stats SampleCache::getStats() const
+{
+    const juce::ScopedLock sl(lock);
+    auto result = stats;
+    result.numEntries = (int)entries.size();
+    return result;
+}
+
+//==============================================================================
+juce::String SampleCache::makeKey(const juce::File& file, const juce::String& parameters)
+{
+    // Modification time and size catch a file that was replaced since it was cached
+    return file.getFullPathName()
+         + "|" + juce::String(file.getLastModificationTime().toMilliseconds())
+         + "|" + juce::String(file.getSize())
+         + "|" + parameters;
+}
+
+SampleCache::Entry* SampleCache::findEntry(const juce::String& key)
+{
+    auto it = entries.find(key);
+    if (it == entries.end())
+        return nullptr;
+
+    it->second.lastUsed = ++useCounter;
+    ++stats.hits;
+    return &it->second;
+}
+
+SampleCache::Entry& SampleCache::insertEntry(const juce::String& key, Entry&& entry)
+{
+    ++stats.misses;
+
+    // Another track loaded the same file while we were decoding: keep theirs, drop ours
+    auto it = entries.find(key);
+    if (it == entries.end())
+    {
+        stats.bytesCached += entry.bytes;
+        it = entries.emplace(key, std::move(entry)).first;
+    }
+
+    it->second.lastUsed = ++useCounter;
+    return it->second;
+}
+
+void SampleCache::trimLocked(size_t targetBytes)
+{
+    while (stats.bytesCached > targetBytes)
+    {
+        // Least recently used entry nobody outside the cache still references
+        auto victim = entries.end();
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+            if (it->second.isIdle() && (victim == entries.end() || it->second.lastUsed < victim->second.lastUsed))
+                victim = it;
+
+        // Everything left is in use; it is freed when its last instrument lets go
+        if (victim == entries.end())
+            break;
+
+        stats.bytesCached -= victim->second.bytes;
+        ++stats.evictions;
+        entries.erase(victim);
+    }
+}
+
+} // namespace mmg
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    SampleCache.h
+
+    Process-wide cache of decoded samples and SoundFonts. Tracks that load the
+    same file share one immutable copy, and switching presets between takes
+    reuses whatever is still cached instead of decoding it again.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "SampleStreamer.h"
+
+#include <map>
+#include <memory>
+
+// Forward declaration for TSF
+struct tsf;
+
+namespace mmg
+{
+
+//==============================================================================
+/**
+    A parsed SoundFont shared by every SF2Instrument playing the same file.
+
+    The preset table and sample pool stay owned by this object; each instrument
+    gets its own lightweight tsf handle (own voices and channels) from
+    createInstance() and must hand it back through releaseInstance().
+*/
+class SharedSoundFont
+{
+public:
+    ~SharedSoundFont();
+
+    /** A new playback handle over the shared font data. Message thread. */
+    tsf* createInstance() const;
+
+    /** Close a handle returned by createInstance(). */
+    void releaseInstance(tsf* instance) const;
+
+    const juce::File& getFile() const noexcept { return file; }
+
+private:
+    friend class SampleCache;
+    SharedSoundFont(tsf* loadedFont, const juce::File& sourceFile);
+
+    tsf* font = nullptr;
+    juce::File file;
+
+    // TinySoundFont's shared reference count is not atomic
+    juce::CriticalSection instanceLock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SharedSoundFont)
+};
+
+//==============================================================================
+/**
+    Shared, reference-counted cache of StreamedSamples and SharedSoundFonts.
+
+    Entries are keyed by file path, modification time and the load parameters,
+    so an edited file is decoded again. Callers hold shared_ptrs; an entry only
+    becomes evictable once the cache holds the last reference. Idle entries are
+    dropped least recently used first whenever the total exceeds the budget.
+
+    One instance is shared by all instruments (juce::SharedResourcePointer);
+    AudioEngine keeps one alive so the cache survives instrument reloads.
+*/
+class SampleCache
+{
+public:
+    SampleCache() = default;
+
+    /** Load (or reuse) a sample. Arguments as for StreamedSample::load().
+        Returns nullptr if the file cannot be read. */
+    std::shared_ptr<const StreamedSample> getSample(juce::AudioFormatManager& formatManager,
+                                                    const juce::File& file,
+                                                    double preloadSeconds,
+                                                    double maxSeconds = -1.0);
+
+    /** Load (or reuse) a SoundFont. Returns nullptr if the file cannot be parsed. */
+    std::shared_ptr<const SharedSoundFont> getSoundFont(const juce::File& file);
+
+    /** Memory that idle and in-use entries together may occupy before idle ones are evicted. */
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+
+    /** Drop idle entries until the cache fits its budget. */
+    void trim();
+
+    /** Drop every idle entry. */
+    void clearUnused();
+
+    struct Stats
+    {
+        juce::int64 hits = 0;
+        juce::int64 misses = 0;
+        juce::int64 evictions = 0;
+        size_t bytesCached = 0;
+        int numEntries = 0;
+    };
+
+    Stats getStats() const;
+
+    static constexpr size_t defaultMemoryBudget = (size_t)1024 * 1024 * 1024;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const StreamedSample> sample;
+        std::shared_ptr<const SharedSoundFont> soundFont;
+        size_t bytes = 0;
+        juce::uint64 lastUsed = 0;
+
+        bool isIdle() const noexcept { return sample.use_count() <= 1 && soundFont.use_count() <= 1; }
+    };
+
+    static juce::String makeKey(const juce::File& file, const juce::String& parameters);
+
+    /** Returns the cached entry for key (bumping its LRU stamp and the hit count), or nullptr. */
+    Entry* findEntry(const juce::String& key);
+
+    /** Insert a freshly loaded entry, or return the one another thread inserted meanwhile. */
+    Entry& insertEntry(const juce::String& key, Entry&& entry);
+
+    void trimLocked(size_t targetBytes);
+
+    mutable juce::CriticalSection lock;
+    std::map<juce::String, Entry> entries;
+    juce::uint64 useCounter = 0;
+    size_t memoryBudget = defaultMemoryBudget;
+    Stats stats;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleCache)
+};
+
+} // namespace mmg
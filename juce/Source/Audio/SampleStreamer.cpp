@@ -0,0 +1,411 @@
+/*
+  ==============================================================================
+
+    SampleStreamer.cpp
+
+    Implementation of disk streaming for sample-based instruments.
+
+  ==============================================================================
+*/
+
+#include "SampleStreamer.h"
+
+namespace mmg
+{
+
+//==============================================================================
+// StreamedSample
+//==============================================================================
+
+std::unique_ptr<StreamedSample> StreamedSample::load(juce::AudioFormatManager& formatManager,
+                                                     const juce::File& file,
+                                                     double preloadSeconds,
+                                                     double maxSeconds)
+{
+    if (auto mapped = loadMapped(formatManager, file, preloadSeconds, maxSeconds))
+        return mapped;
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (reader == nullptr)
+        return nullptr;
+
+    std::unique_ptr<StreamedSample> sample(new StreamedSample());
+    sample->file = file;
+    sample->sampleRate = reader->sampleRate;
+    sample->numChannels = juce::jmin(2, (int)reader->numChannels);
+    sample->length = maxSeconds >= 0.0 ? juce::jmin(reader->lengthInSamples, (juce::int64)(maxSeconds * reader->sampleRate))
+                                       : reader->lengthInSamples;
+
+    const auto framesToLoad = preloadSeconds >= 0.0 ? juce::jmin((juce::int64)(preloadSeconds * reader->sampleRate), sample->length)
+                                                    : sample->length;
+    sample->preloadedFrames = (int)framesToLoad;
+
+    // One extra frame so interpolation at the end of the head never reads past it
+    sample->head.setSize(sample->numChannels, sample->preloadedFrames + 1);
+    sample->head.clear();
+    reader->read(&sample->head, 0, sample->preloadedFrames, 0, true, true);
+
+    return sample;
+}
+
+std::unique_ptr<StreamedSample> StreamedSample::loadMapped(juce::AudioFormatManager& formatManager,
+                                                           const juce::File& file,
+                                                           double preloadSeconds,
+                                                           double maxSeconds)
+{
+    // Compressed formats have no memory-mapped reader and fall back to decoding
+    auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+    if (format == nullptr)
+        return nullptr;
+
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> reader(format->createMemoryMappedReader(file));
+    if (reader == nullptr || reader->numChannels < 1 || reader->numChannels > 2 || !reader->mapEntireFile())
+        return nullptr;
+
+    std::unique_ptr<StreamedSample> sample(new StreamedSample());
+    sample->file = file;
+    sample->sampleRate = reader->sampleRate;
+    sample->numChannels = (int)reader->numChannels;
+    sample->length = maxSeconds >= 0.0 ? juce::jmin(reader->lengthInSamples, (juce::int64)(maxSeconds * reader->sampleRate))
+                                       : reader->lengthInSamples;
+
+    const auto framesToTouch = preloadSeconds >= 0.0 ? juce::jmin((juce::int64)(preloadSeconds * reader->sampleRate), sample->length)
+                                                     : sample->length;
+    sample->preloadedFrames = (int)framesToTouch;
+
+    // Nothing is copied; just make sure note-on never waits for the disk
+    for (juce::int64 frame = 0; frame < framesToTouch; frame += SampleStreamer::touchStrideFrames)
+        reader->touchSample(frame);
+
+    sample->mappedReader = std::move(reader);
+    return sample;
+}
+
+void StreamedSample::readMappedFrames(juce::int64 firstFrame, int numFrames, float* left, float* right) const noexcept
+{
+    // Only the part inside the sample is read; the rest is silence
+    const auto start = juce::jlimit((juce::int64)0, length, firstFrame);
+    const auto end = juce::jlimit((juce::int64)0, length, firstFrame + numFrames);
+    const int offset = (int)(start - firstFrame);
+    const int count = (int)(end - start);
+
+    if (count <= 0)
+    {
+        juce::FloatVectorOperations::clear(left, numFrames);
+        if (right != nullptr)
+            juce::FloatVectorOperations::clear(right, numFrames);
+        return;
+    }
+
+    float* channels[] = { left + offset, right != nullptr ? right + offset : nullptr };
+    mappedReader->read(channels, right != nullptr ? 2 : 1, start, count);
+
+    const int tail = numFrames - offset - count;
+    for (auto* channel : { left, right })
+    {
+        if (channel == nullptr)
+            continue;
+
+        juce::FloatVectorOperations::clear(channel, offset);
+        juce::FloatVectorOperations::clear(channel + offset + count, tail);
+    }
+}
+
+//==============================================================================
+// SampleStream
+//==============================================================================
+
+void SampleStream::allocate(int numFrames)
+{
+    ring.setSize(2, numFrames);
+    ring.clear();
+}
+
+void SampleStream::start(const StreamedSample& sample, juce::int64 firstFrame) noexcept
+{
+    // A stolen voice may still be streaming its previous note
+    stop();
+    playingSample = &sample;
+
+    // Decoded samples need a ring; mapped ones only need the disk thread to fault pages in
+    if (sample.isFullyLoaded() || (!sample.isMemoryMapped() && !isAllocated()))
+        return;
+
+    requestedSample.store(&sample, std::memory_order_relaxed);
+    requestedFirstFrame.store(firstFrame, std::memory_order_relaxed);
+    playFrame.store(firstFrame, std::memory_order_relaxed);
+    playingGeneration = requestedGeneration.fetch_add(1, std::memory_order_release) + 1;
+    streaming = true;
+
+    if (owner != nullptr)
+        owner->wake();
+}
+
+void SampleStream::stop() noexcept
+{
+    playingSample = nullptr;
+
+    if (streaming)
+    {
+        streaming = false;
+        requestedSample.store(nullptr, std::memory_order_relaxed);
+        playingGeneration = requestedGeneration.fetch_add(1, std::memory_order_release) + 1;
+    }
+}
+
+float SampleStream::getSample(int channel, juce::int64 frame) noexcept
+{
+    const auto* sample = playingSample;
+    if (sample == nullptr || frame < 0 || frame >= sample->getLength())
+        return 0.0f;
+
+    if (sample->isMemoryMapped())
+    {
+        float frameValues[2];
+        sample->readMappedFrame(frame, frameValues);
+        return frameValues[juce::jmin(channel, 1)];
+    }
+
+    channel = juce::jmin(channel, sample->getNumChannels() - 1);
+
+    if (frame < sample->getNumPreloadedFrames())
+        return sample->getHeadPointer(channel)[frame];
+
+    if (!isAvailable(frame) && !(blocking && waitFor(frame)))
+    {
+        underruns.fetch_add(1, std::memory_order_relaxed);
+        return 0.0f;
+    }
+
+    return ring.getSample(channel, (int)(frame % ring.getNumSamples()));
+}
+
+void SampleStream::getFrames(juce::int64 firstFrame, int numFrames,
+                             float* scratchLeft, float* scratchRight,
+                             const float*& left, const float*& right) noexcept
+{
+    const auto* sample = playingSample;
+    const bool stereo = sample != nullptr && sample->getNumChannels() > 1;
+
+    left = scratchLeft;
+    right = stereo ? scratchRight : scratchLeft;
+
+    if (sample == nullptr)
+    {
+        juce::FloatVectorOperations::clear(scratchLeft, numFrames);
+        return;
+    }
+
+    if (sample->isMemoryMapped())
+    {
+        sample->readMappedFrames(firstFrame, numFrames, scratchLeft, stereo ? scratchRight : nullptr);
+        return;
+    }
+
+    // Whole range in the decoded head: no copy at all
+    if (firstFrame >= 0 && firstFrame + numFrames <= sample->getNumPreloadedFrames())
+    {
+        left = sample->getHeadPointer(0) + firstFrame;
+        right = stereo ? sample->getHeadPointer(1) + firstFrame : left;
+        return;
+    }
+
+    for (int i = 0; i < numFrames; ++i)
+    {
+        scratchLeft[i] = getSample(0, firstFrame + i);
+        if (stereo)
+            scratchRight[i] = getSample(1, firstFrame + i);
+    }
+}
+
+bool SampleStream::isAvailable(juce::int64 frame) const noexcept
+{
+    // Ring contents belong to an older note until the disk thread has taken our request
+    if (servedGeneration.load(std::memory_order_acquire) != playingGeneration)
+        return false;
+
+    return frame >= fillStart.load(std::memory_order_relaxed)
+        && frame < writtenEnd.load(std::memory_order_acquire);
+}
+
+bool SampleStream::waitFor(juce::int64 frame) noexcept
+{
+    // Offline only: the render thread may wait, but not forever if the file went away
+    const auto giveUpTime = juce::Time::getMillisecondCounter() + 2000;
+
+    while (!isAvailable(frame))
+    {
+        if (owner != nullptr)
+            owner->wake();
+
+        if (juce::Time::getMillisecondCounter() > giveUpTime)
+            return false;
+
+        juce::Thread::yield();
+    }
+
+    return true;
+}
+
+//==============================================================================
+// SampleStreamer
+//==============================================================================
+
+SampleStreamer::SampleStreamer()
+    : juce::Thread("Sample Streamer")
+{
+    formatManager.registerBasicFormats();
+    scratch.setSize(2, chunkFrames);
+
+    startThread(juce::Thread::Priority::high);
+}
+
+SampleStreamer::~SampleStreamer()
+{
+    stopThread(2000);
+}
+
+void SampleStreamer::addStream(SampleStream& stream)
+{
+    const juce::ScopedLock sl(streamsLock);
+    stream.owner = this;
+    streams.addIfNotAlreadyThere(&stream);
+}
+
+void SampleStreamer::removeStream(SampleStream& stream)
+{
+    // Blocks while the disk thread is mid-pass, so the stream is never used after this returns
+    const juce::ScopedLock sl(streamsLock);
+    streams.removeFirstMatchingValue(&stream);
+    stream.owner = nullptr;
+}
+
+void SampleStreamer::run()
+{
+    while (!threadShouldExit())
+    {
+        bool didWork = false;
+
+        {
+            const juce::ScopedLock sl(streamsLock);
+            for (auto* stream : streams)
+                didWork = serviceStream(*stream) || didWork;
+        }
+
+        // Nothing to top up: sleep until a voice starts, or poll again shortly
+        if (!didWork)
+            wait(2);
+    }
+}
+
+bool SampleStreamer::serviceStream(SampleStream& stream)
+{
+    const auto generation = stream.requestedGeneration.load(std::memory_order_acquire);
+
+    // New note (or stop) on this voice: restart the ring right after the preloaded head
+    if (generation != stream.servedGeneration.load(std::memory_order_relaxed))
+    {
+        stream.servingSample = stream.requestedSample.load(std::memory_order_relaxed);
+
+        juce::int64 firstFrame = 0;
+        if (stream.servingSample != nullptr)
+            firstFrame = juce::jmax((juce::int64)stream.servingSample->getNumPreloadedFrames(),
+                                    stream.requestedFirstFrame.load(std::memory_order_relaxed));
+
+        stream.fillStart.store(firstFrame, std::memory_order_relaxed);
+        stream.writtenEnd.store(firstFrame, std::memory_order_relaxed);
+        stream.servedGeneration.store(generation, std::memory_order_release);
+    }
+
+    const auto* sample = stream.servingSample;
+    if (sample == nullptr)
+        return false;
+
+    if (sample->isMemoryMapped())
+        return prefetchMapped(stream, *sample);
+
+    const auto end = stream.writtenEnd.load(std::memory_order_relaxed);
+    const auto remaining = sample->getLength() - end;
+    if (remaining <= 0)
+        return false;
+
+    // Frames below the voice's play position may be overwritten, nothing at or above it
+    const int ringSize = stream.ring.getNumSamples();
+    const auto space = stream.playFrame.load(std::memory_order_acquire) + ringSize - end;
+    const int numFrames = (int)juce::jmin(space, remaining, (juce::int64)chunkFrames);
+
+    // Wait for a full chunk of space unless this is the tail of the file
+    if (numFrames <= 0 || (numFrames < chunkFrames && numFrames < remaining))
+        return false;
+
+    auto* reader = getReader(*sample);
+    if (reader == nullptr)
+    {
+        stream.servingSample = nullptr;
+        return false;
+    }
+
+    reader->read(&scratch, 0, numFrames, end, true, true);
+
+    // The voice moved on to another note while we were reading; drop this chunk
+    if (stream.requestedGeneration.load(std::memory_order_acquire) != generation)
+        return true;
+
+    const int numChannels = juce::jmin(scratch.getNumChannels(), sample->getNumChannels());
+    const int ringStart = (int)(end % ringSize);
+    const int firstPart = juce::jmin(numFrames, ringSize - ringStart);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        stream.ring.copyFrom(ch, ringStart, scratch, ch, 0, firstPart);
+        if (firstPart < numFrames)
+            stream.ring.copyFrom(ch, 0, scratch, ch, firstPart, numFrames - firstPart);
+    }
+
+    stream.writtenEnd.store(end + numFrames, std::memory_order_release);
+    return true;
+}
+
+bool SampleStreamer::prefetchMapped(SampleStream& stream, const StreamedSample& sample)
+{
+    // Same read-ahead distance as a ring, but the pages stay in the OS cache instead of a copy
+    const auto end = stream.writtenEnd.load(std::memory_order_relaxed);
+    const auto target = juce::jmin(sample.getLength(), stream.playFrame.load(std::memory_order_acquire) + ringFrames);
+
+    if (target - end < chunkFrames && target < sample.getLength())
+        return false;
+    if (end >= target)
+        return false;
+
+    for (auto frame = end; frame < target; frame += touchStrideFrames)
+        sample.touchMappedFrame(frame);
+
+    stream.writtenEnd.store(target, std::memory_order_release);
+    return true;
+}
+
+juce::AudioFormatReader* SampleStreamer::getReader(const StreamedSample& sample)
+{
+    const auto key = sample.getFile().getFullPathName();
+
+    auto it = readers.find(key);
+    if (it != readers.end())
+        return it->second.get();
+
+    // Bound the number of open file handles; readers are cheap to reopen
+    if ((int)readers.size() >= maxOpenReaders)
+        readers.clear();
+
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(sample.getFile()));
+    if (reader == nullptr)
+    {
+        DBG("SampleStreamer: Could not reopen " << sample.getFile().getFullPathName());
+        return nullptr;
+    }
+
+    auto* result = reader.get();
+    readers[key] = std::move(reader);
+    return result;
+}
+
+} // namespace mmg
@@ -0,0 +1,234 @@
+/*
+  ==============================================================================
+
+    SampleStreamer.h
+
+    Disk streaming for sample-based instruments. Uncompressed WAV/AIFF files
+    are memory-mapped and converted to float as voices read them. Other files
+    keep only their first few hundred milliseconds in memory; voices that play
+    past that are fed from a background I/O thread through per-voice ring
+    buffers, so memory use follows polyphony instead of library size.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+namespace mmg
+{
+
+class SampleStreamer;
+
+//==============================================================================
+/**
+    A sample file with its head preloaded.
+
+    PCM WAV/AIFF files with up to two channels are memory-mapped instead of
+    decoded: nothing is copied, voices convert frames with readMappedFrame(),
+    and the OS page cache is shared with every other process reading the file.
+    The "preloaded" head of a mapped sample is the part whose pages were
+    faulted in at load time.
+
+    Short samples (and samples loaded with a negative preloadSeconds) are held
+    entirely in memory and never touch the disk thread.
+*/
+class StreamedSample
+{
+public:
+    /** Open file and read its first preloadSeconds into memory (negative = the whole
+        sample). maxSeconds caps the playable length (negative = no cap). Returns
+        nullptr if the file cannot be read. */
+    static std::unique_ptr<StreamedSample> load(juce::AudioFormatManager& formatManager,
+                                                const juce::File& file,
+                                                double preloadSeconds,
+                                                double maxSeconds = -1.0);
+
+    const juce::File& getFile() const noexcept { return file; }
+    double getSampleRate() const noexcept { return sampleRate; }
+    int getNumChannels() const noexcept { return numChannels; }
+    juce::int64 getLength() const noexcept { return length; }
+
+    /** Frames [0, getNumPreloadedFrames()) are always in memory. */
+    int getNumPreloadedFrames() const noexcept { return preloadedFrames; }
+    bool isFullyLoaded() const noexcept { return preloadedFrames >= length; }
+
+    /** Decoded head; not available for memory-mapped samples. */
+    const float* getHeadPointer(int channel) const noexcept { return head.getReadPointer(channel); }
+
+    bool isMemoryMapped() const noexcept { return mappedReader != nullptr; }
+
+    /** Channels 0 and 1 of a mapped frame, converted to float (mono fills both). */
+    void readMappedFrame(juce::int64 frame, float* leftRight) const noexcept
+    {
+        mappedReader->getSample(frame, leftRight);
+        if (numChannels == 1)
+            leftRight[1] = leftRight[0];
+    }
+
+    /** Channels 0 and 1 of numFrames mapped frames from firstFrame, converted to float.
+        right may be nullptr for mono samples; frames outside the sample read as silence. */
+    void readMappedFrames(juce::int64 firstFrame, int numFrames, float* left, float* right) const noexcept;
+
+    /** Fault the pages holding frame in, so the audio thread does not have to. */
+    void touchMappedFrame(juce::int64 frame) const noexcept { mappedReader->touchSample(frame); }
+
+    /** Bytes held in memory (the preloaded head). */
+    size_t getMemorySize() const noexcept { return (size_t)head.getNumChannels() * (size_t)head.getNumSamples() * sizeof(float); }
+
+private:
+    StreamedSample() = default;
+
+    /** PCM WAV/AIFF path of load(); nullptr if the file cannot be mapped. */
+    static std::unique_ptr<StreamedSample> loadMapped(juce::AudioFormatManager& formatManager,
+                                                      const juce::File& file,
+                                                      double preloadSeconds,
+                                                      double maxSeconds);
+
+    juce::File file;
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+    juce::int64 length = 0;
+    int preloadedFrames = 0;
+    juce::AudioBuffer<float> head;      // preloadedFrames plus one guard frame for interpolation
+    std::unique_ptr<juce::MemoryMappedAudioFormatReader> mappedReader;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StreamedSample)
+};
+
+//==============================================================================
+/**
+    Per-voice reader over a StreamedSample.
+
+    The voice calls start() on note-on and then reads frames with getSample();
+    frames past the preloaded head come from a ring buffer that the
+    SampleStreamer thread keeps filled ahead of setPlayPosition(). If the disk
+    falls behind, missing frames read as silence (or, in blocking mode for
+    offline renders, the voice waits for them).
+*/
+class SampleStream
+{
+public:
+    SampleStream() = default;
+
+    /** Allocate the ring buffer. Message thread, before the stream is registered. */
+    void allocate(int ringFrames);
+    bool isAllocated() const noexcept { return ring.getNumSamples() > 0; }
+
+    /** Wait for the disk instead of reading silence (offline rendering). */
+    void setBlocking(bool shouldBlock) noexcept { blocking = shouldBlock; }
+
+    //==========================================================================
+    // Voice (audio thread)
+
+    /** Begin playing sample from firstFrame. Never blocks or allocates. */
+    void start(const StreamedSample& sample, juce::int64 firstFrame) noexcept;
+
+    /** Let go of the sample; the disk thread stops reading for this voice. */
+    void stop() noexcept;
+
+    /** Lowest frame the voice may still read; call after each rendered block. */
+    void setPlayPosition(juce::int64 frame) noexcept { playFrame.store(frame, std::memory_order_release); }
+
+    /** Value of channel at frame (mono samples return channel 0 for both).
+        Voices read mapped samples directly; this is for decoded ones. */
+    float getSample(int channel, juce::int64 frame) noexcept;
+
+    /** numFrames consecutive frames from firstFrame, for block rendering.
+        Points left/right straight into the preloaded head when the range lies
+        inside it; otherwise converts (mapped) or copies (streamed) the frames
+        into scratchLeft/scratchRight. Mono samples return the same pointer twice. */
+    void getFrames(juce::int64 firstFrame, int numFrames,
+                   float* scratchLeft, float* scratchRight,
+                   const float*& left, const float*& right) noexcept;
+
+    /** Frames that read as silence because the disk thread was late. */
+    int getNumUnderruns() const noexcept { return underruns.load(std::memory_order_relaxed); }
+
+private:
+    friend class SampleStreamer;
+
+    bool isAvailable(juce::int64 frame) const noexcept;
+    bool waitFor(juce::int64 frame) noexcept;
+
+    SampleStreamer* owner = nullptr;                    // Set by SampleStreamer::addStream
+    juce::AudioBuffer<float> ring;
+    bool blocking = false;
+
+    // Voice side
+    const StreamedSample* playingSample = nullptr;
+    juce::uint32 playingGeneration = 0;
+    bool streaming = false;                             // The disk thread is serving playingSample
+    std::atomic<int> underruns { 0 };
+
+    // Requests from the voice to the disk thread
+    std::atomic<const StreamedSample*> requestedSample { nullptr };
+    std::atomic<juce::int64> requestedFirstFrame { 0 };
+    std::atomic<juce::uint32> requestedGeneration { 0 };
+    std::atomic<juce::int64> playFrame { 0 };
+
+    // Published by the disk thread: ring holds frames [fillStart, writtenEnd)
+    // of the request servedGeneration refers to
+    std::atomic<juce::uint32> servedGeneration { 0 };
+    std::atomic<juce::int64> fillStart { 0 };
+    std::atomic<juce::int64> writtenEnd { 0 };
+    const StreamedSample* servingSample = nullptr;      // Disk thread only
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleStream)
+};
+
+//==============================================================================
+/**
+    The background I/O thread that fills every registered SampleStream.
+    One instance is shared by all instruments (juce::SharedResourcePointer).
+*/
+class SampleStreamer : private juce::Thread
+{
+public:
+    SampleStreamer();
+    ~SampleStreamer() override;
+
+    /** Register or unregister a voice's stream (message thread). Streams that only
+        play memory-mapped samples need no ring buffer. */
+    void addStream(SampleStream& stream);
+    void removeStream(SampleStream& stream);
+
+    /** Wake the disk thread early, e.g. after a voice starts. Safe on the audio thread. */
+    void wake() noexcept { notify(); }
+
+    static constexpr double preloadSeconds = 0.25;      // Covers disk latency at note-on
+    static constexpr int ringFrames = 32768;            // Per voice; ~0.7 s at 44.1 kHz (also the mapped read-ahead)
+    static constexpr int chunkFrames = 4096;            // Disk read granularity
+    static constexpr int touchStrideFrames = 512;       // Under one page even for 24-bit stereo
+
+private:
+    void run() override;
+
+    /** Top up one stream. Returns true if it did any work. */
+    bool serviceStream(SampleStream& stream);
+
+    /** Fault in the pages of a mapped sample ahead of the voice. */
+    bool prefetchMapped(SampleStream& stream, const StreamedSample& sample);
+
+    juce::AudioFormatReader* getReader(const StreamedSample& sample);
+
+    juce::CriticalSection streamsLock;                  // Never taken by the audio thread
+    juce::Array<SampleStream*> streams;
+
+    // Disk thread only
+    juce::AudioFormatManager formatManager;
+    std::map<juce::String, std::unique_ptr<juce::AudioFormatReader>> readers;
+    juce::AudioBuffer<float> scratch;
+
+    static constexpr int maxOpenReaders = 64;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SampleStreamer)
+};
+
+} // namespace mmg
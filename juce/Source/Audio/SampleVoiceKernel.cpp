@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    SampleVoiceKernel.cpp
+
+    Implementation of the sample-playback voice kernels.
+
+  ==============================================================================
+*/
+
+#include "SampleVoiceKernel.h"
+
+namespace mmg
+{
+namespace SampleVoiceKernel
+{
+
+void resampleLinear(const float* src, double position, double step, float* dest, int numFrames) noexcept
+{
+    // Unpitched playback on a frame boundary (most drum hits): a straight copy
+    if (step == 1.0 && position == (double)(int)position)
+    {
+        juce::FloatVectorOperations::copy(dest, src + (int)position, numFrames);
+        return;
+    }
+
+    // Gather each frame's two neighbours and fraction, then interpolate the whole
+    // span with vector operations: dest = s0 + fraction * (s1 - s0)
+    std::array<float, maxRunFrames> next, fractions;
+
+    for (int done = 0; done < numFrames;)
+    {
+        const int spanLength = juce::jmin(maxRunFrames, numFrames - done);
+        float* span = dest + done;
+
+        for (int i = 0; i < spanLength; ++i)
+        {
+            const int index = (int)position;
+            span[i] = src[index];
+            next[(size_t)i] = src[index + 1];
+            fractions[(size_t)i] = (float)(position - index);
+            position += step;
+        }
+
+        juce::FloatVectorOperations::subtract(next.data(), span, spanLength);
+        juce::FloatVectorOperations::multiply(next.data(), fractions.data(), spanLength);
+        juce::FloatVectorOperations::add(span, next.data(), spanLength);
+
+        done += spanLength;
+    }
+}
+
+} // namespace SampleVoiceKernel
+} // namespace mmg
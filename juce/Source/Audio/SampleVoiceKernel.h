@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    SampleVoiceKernel.h
+
+    Block resampling and mixing shared by the sample-playback voices
+    (SFZVoice, ZonedSamplerVoice). Voices split each block into runs that
+    contain no loop point or sample end, fetch the source frames a run needs
+    in one go and then interpolate, apply the envelope and accumulate the
+    whole run with vectorised operations.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include <array>
+
+namespace mmg
+{
+namespace SampleVoiceKernel
+{
+
+/** Longest run rendered at once, in output frames. */
+static constexpr int maxRunFrames = 256;
+
+/** Source frames a voice can stage per run (bounds runs at high pitch ratios). */
+static constexpr int maxSourceFrames = 1024;
+
+/** Per-voice working memory, so rendering never allocates. */
+struct Scratch
+{
+    std::array<float, maxRunFrames> envelope;
+    std::array<float, maxRunFrames> left, right;
+    std::array<float, maxSourceFrames> sourceLeft, sourceRight;
+};
+
+/** Longest run whose source frames fit in Scratch at this pitch ratio. */
+inline int getMaxRunLength(double step) noexcept
+{
+    return juce::jlimit(1, maxRunFrames, (int)((maxSourceFrames - 2) / juce::jmax(step, 1.0e-6)));
+}
+
+/** Source frames (counted from the integer part of the start position) that
+    resampleLinear() reads for numFrames output frames. */
+inline int getSourceSpan(double fraction, double step, int numFrames) noexcept
+{
+    return (int)(fraction + (numFrames - 1) * step) + 2;
+}
+
+/** Linear interpolation: dest[i] = src at (position + i * step).
+    src must hold getSourceSpan(position, step, numFrames) frames. The neighbour
+    frames are gathered one at a time; the interpolation runs as vector operations. */
+void resampleLinear(const float* src, double position, double step, float* dest, int numFrames) noexcept;
+
+/** dest += src * envelope * gain. src is scaled in place. */
+inline void mixWithEnvelope(float* dest, float* src, const float* envelope, float gain, int numFrames) noexcept
+{
+    juce::FloatVectorOperations::multiply(src, envelope, numFrames);
+    juce::FloatVectorOperations::addWithMultiply(dest, src, gain, numFrames);
+}
+
+} // namespace SampleVoiceKernel
+} // namespace mmg
@@ -18,28 +18,18 @@ namespace mmg
 //==============================================================================
 
 ZonedSamplerSound::ZonedSamplerSound(const juce::String& soundName,
-                                     juce::AudioFormatReader& source,
+                                     std::shared_ptr<const StreamedSample> sourceSample,
                                      const juce::BigInteger& notes,
                                      int midiNoteForNormalPitch,
                                      double attackTimeSecs,
-                                     double releaseTimeSecs,
-                                     double maxSampleLengthSecs)
+                                     double releaseTimeSecs)
     : name(soundName),
-      sourceSampleRate(source.sampleRate),
+      sample(std::move(sourceSample)),
+      sourceSampleRate(sample->getSampleRate()),
       midiNotes(notes),
       midiRootNote(midiNoteForNormalPitch)
 {
-    // Calculate sample length
-    int numSamples = (int)juce::jmin((juce::int64)source.lengthInSamples,
-                                     (juce::int64)(maxSampleLengthSecs * source.sampleRate));
-    
-    length = numSamples;
-    
-    // Read audio data
-    data = std::make_unique<juce::AudioBuffer<float>>(
-        juce::jmin(2, (int)source.numChannels), numSamples + 4);
-    
-    source.read(data.get(), 0, numSamples + 4, 0, true, true);
+    length = (int)sample->getLength();
     
     // Set ADSR parameters
     adsrParams.attack = (float)attackTimeSecs;
@@ -70,7 +60,13 @@ bool ZonedSamplerSound::appliesToChannel(int /*midiChannel*/)
 //==============================================================================
 
 ZonedSamplerVoice::ZonedSamplerVoice() {}
-ZonedSamplerVoice::~ZonedSamplerVoice() {}
+
+ZonedSamplerVoice::~ZonedSamplerVoice()
+{
+    // Voices deleted mid-note (setPolyphony) still hand their budget back
+    if (budget != nullptr && budgetGrant != PolyphonyBudget::Grant::None)
+        budget->release(budgetGrant);
+}
 
 bool ZonedSamplerVoice::canPlaySound(juce::SynthesiserSound* sound)
 {
@@ -83,6 +79,18 @@ void ZonedSamplerVoice::startNote(int midiNoteNumber, float velocity,
 {
     if (auto* sound = dynamic_cast<const ZonedSamplerSound*>(s))
     {
+        // A stolen voice already holds a grant (see keepGrantForNextNote())
+        handingOver = false;
+        if (budget != nullptr && budgetGrant == PolyphonyBudget::Grant::None)
+        {
+            budgetGrant = budget->acquire();
+            if (budgetGrant == PolyphonyBudget::Grant::None)
+            {
+                clearCurrentNote();
+                return;
+            }
+        }
+        
         // Calculate pitch ratio based on distance from root note
         double rootFreq = juce::MidiMessage::getMidiNoteInHertz(sound->midiRootNote);
         double noteFreq = juce::MidiMessage::getMidiNoteInHertz(midiNoteNumber);
@@ -90,6 +98,7 @@ void ZonedSamplerVoice::startNote(int midiNoteNumber, float velocity,
         pitchRatio = noteFreq / rootFreq * (sound->sourceSampleRate / getSampleRate());
         
         sourceSamplePosition = 0.0;
+        stream.start(sound->getSample(), 0);
         
         // Velocity-sensitive gain with stereo spread
         // Apply velocity curve and boost for better audibility
@@ -104,10 +113,13 @@ void ZonedSamplerVoice::startNote(int midiNoteNumber, float velocity,
         adsr.setParameters(sound->adsrParams);
         adsr.setSampleRate(getSampleRate());
         adsr.noteOn();
+        envelopeLevel = 0.0f;
     }
     else
     {
         jassertfalse; // this shouldn't happen
+        handingOver = false;
+        finishNote();
     }
 }
 
@@ -119,11 +131,24 @@ void ZonedSamplerVoice::stopNote(float /*velocity*/, bool allowTailOff)
     }
     else
     {
-        clearCurrentNote();
+        finishNote();
         adsr.reset();
     }
 }
 
+void ZonedSamplerVoice::finishNote()
+{
+    stream.stop();
+    clearCurrentNote();
+    envelopeLevel = 0.0f;
+    
+    if (budget != nullptr && budgetGrant != PolyphonyBudget::Grant::None && !handingOver)
+    {
+        budget->release(budgetGrant);
+        budgetGrant = PolyphonyBudget::Grant::None;
+    }
+}
+
 void ZonedSamplerVoice::pitchWheelMoved(int /*newPitchWheelValue*/) {}
 void ZonedSamplerVoice::controllerMoved(int /*controllerNumber*/, int /*newControllerValue*/) {}
 
@@ -132,40 +157,53 @@ void ZonedSamplerVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer,
 {
     if (auto* playingSound = dynamic_cast<ZonedSamplerSound*>(getCurrentlyPlayingSound().get()))
     {
-        auto* data = playingSound->getAudioData();
-        const float* const inL = data->getReadPointer(0);
-        const float* const inR = data->getNumChannels() > 1 ? data->getReadPointer(1) : nullptr;
-        
         float* outL = outputBuffer.getWritePointer(0, startSample);
         float* outR = outputBuffer.getNumChannels() > 1 ? outputBuffer.getWritePointer(1, startSample) : nullptr;
         
-        while (--numSamples >= 0)
+        // Render in runs up to the end of the sample, each mixed in bulk
+        while (numSamples > 0)
         {
-            auto pos = (int)sourceSamplePosition;
-            auto alpha = (float)(sourceSamplePosition - pos);
-            auto invAlpha = 1.0f - alpha;
+            const int framesToEnd = juce::jmax(1, (int)std::floor((playingSound->length - sourceSamplePosition) / pitchRatio) + 1);
+            const int runLength = juce::jmin(numSamples, framesToEnd, SampleVoiceKernel::getMaxRunLength(pitchRatio));
             
             // Simple linear interpolation
-            float l = (inL[pos] * invAlpha + inL[pos + 1] * alpha);
-            float r = (inR != nullptr) ? (inR[pos] * invAlpha + inR[pos + 1] * alpha) : l;
+            const auto firstFrame = (juce::int64)sourceSamplePosition;
+            const double fraction = sourceSamplePosition - (double)firstFrame;
+            const int span = SampleVoiceKernel::getSourceSpan(fraction, pitchRatio, runLength);
+            
+            const float* inL = nullptr;
+            const float* inR = nullptr;
+            stream.getFrames(firstFrame, span, scratch.sourceLeft.data(), scratch.sourceRight.data(), inL, inR);
             
-            // Apply envelope
-            auto envelopeValue = adsr.getNextSample();
+            SampleVoiceKernel::resampleLinear(inL, fraction, pitchRatio, scratch.left.data(), runLength);
+            if (inR != inL)
+                SampleVoiceKernel::resampleLinear(inR, fraction, pitchRatio, scratch.right.data(), runLength);
+            else
+                juce::FloatVectorOperations::copy(scratch.right.data(), scratch.left.data(), runLength);
+            
+            // Apply envelope (kept per frame so voice stealing can see the level)
+            for (int i = 0; i < runLength; ++i)
+                scratch.envelope[(size_t)i] = adsr.getNextSample();
+            envelopeLevel = scratch.envelope[(size_t)(runLength - 1)];
             
-            l *= lgain * envelopeValue;
-            r *= rgain * envelopeValue;
+            juce::FloatVectorOperations::multiply(scratch.left.data(), scratch.envelope.data(), runLength);
+            juce::FloatVectorOperations::multiply(scratch.right.data(), scratch.envelope.data(), runLength);
             
             if (outR != nullptr)
             {
-                *outL++ += l;
-                *outR++ += r;
+                juce::FloatVectorOperations::addWithMultiply(outL, scratch.left.data(), lgain, runLength);
+                juce::FloatVectorOperations::addWithMultiply(outR, scratch.right.data(), rgain, runLength);
+                outR += runLength;
             }
             else
             {
-                *outL++ += (l + r) * 0.5f;
+                juce::FloatVectorOperations::addWithMultiply(outL, scratch.left.data(), lgain * 0.5f, runLength);
+                juce::FloatVectorOperations::addWithMultiply(outL, scratch.right.data(), rgain * 0.5f, runLength);
             }
             
-            sourceSamplePosition += pitchRatio;
+            outL += runLength;
+            numSamples -= runLength;
+            sourceSamplePosition += runLength * pitchRatio;
             
             // Check if we've reached the end of the sample
             if (sourceSamplePosition > playingSound->length)
@@ -177,10 +215,44 @@ void ZonedSamplerVoice::renderNextBlock(juce::AudioBuffer<float>& outputBuffer,
         
         // Check if envelope has finished
         if (!adsr.isActive())
-            clearCurrentNote();
+            finishNote();
+        else
+            stream.setPlayPosition((juce::int64)sourceSamplePosition);
     }
 }
 
+//==============================================================================
+// BudgetedSynthesiser
+//==============================================================================
+
+juce::SynthesiserVoice* BudgetedSynthesiser::findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                                           int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+    if (budget == nullptr || budget->canAcquire())
+        return juce::Synthesiser::findFreeVoice(soundToPlay, midiChannel, midiNoteNumber, stealIfNoneAvailable);
+    
+    // At the polyphony budget: the note has to take over a sounding voice
+    return stealIfNoneAvailable ? findVoiceToSteal(soundToPlay, midiChannel, midiNoteNumber) : nullptr;
+}
+
+juce::SynthesiserVoice* BudgetedSynthesiser::findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int /*midiChannel*/,
+                                                              int /*midiNoteNumber*/) const
+{
+    const int index = VoiceAllocator::findVoiceToSteal(voices.size(), [&](int i) -> const ZonedSamplerVoice*
+    {
+        auto* voice = dynamic_cast<ZonedSamplerVoice*>(voices.getUnchecked(i));
+        return (voice != nullptr && voice->canPlaySound(soundToPlay)) ? voice : nullptr;
+    });
+    
+    if (index < 0)
+        return nullptr;
+    
+    // juce::Synthesiser stops the voice and starts the new note on it straight away
+    auto* voice = static_cast<ZonedSamplerVoice*>(voices.getUnchecked(index));
+    voice->keepGrantForNextNote();
+    return voice;
+}
+
 //==============================================================================
 // SamplerInstrument
 //==============================================================================
@@ -201,6 +273,35 @@ SamplerInstrument::~SamplerInstrument()
     clear();
 }
 
+void SamplerInstrument::setNonRealtime(bool isNonRealtime)
+{
+    nonRealtime = isNonRealtime;
+    
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<ZonedSamplerVoice*>(synth.getVoice(i)))
+            voice->getStream().setBlocking(isNonRealtime);
+}
+
+void SamplerInstrument::attachStreams()
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+    {
+        if (auto* voice = dynamic_cast<ZonedSamplerVoice*>(synth.getVoice(i)))
+        {
+            if (needsStreamRings && !voice->getStream().isAllocated())
+                voice->getStream().allocate(SampleStreamer::ringFrames);
+            streamer->addStream(voice->getStream());
+        }
+    }
+}
+
+void SamplerInstrument::detachStreams()
+{
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<ZonedSamplerVoice*>(synth.getVoice(i)))
+            streamer->removeStream(voice->getStream());
+}
+
 bool SamplerInstrument::loadFromDefinition(const InstrumentDefinition& definition,
                                            juce::AudioFormatManager& formatManager)
 {
@@ -223,6 +324,9 @@ bool SamplerInstrument::loadFromDefinition(const InstrumentDefinition& definitio
     
     int loadedZones = 0;
     int failedZones = 0;
+    int streamedZones = 0;
+    int mappedZones = 0;
+    needsStreamRings = false;
     
     // Load each sample zone
     for (const auto& zone : definition.zones)
@@ -233,27 +337,36 @@ bool SamplerInstrument::loadFromDefinition(const InstrumentDefinition& definitio
             continue;
         }
         
-        std::unique_ptr<juce::AudioFormatReader> reader(
-            formatManager.createReaderFor(zone.sampleFile));
+        // Only the head is decoded when streaming; the rest is read during playback
+        auto sample = sampleCache->getSample(formatManager, zone.sampleFile,
+                                             diskStreaming ? SampleStreamer::preloadSeconds : -1.0,
+                                             maxSampleLengthSeconds);
         
-        if (!reader)
+        if (!sample)
         {
             failedZones++;
             continue;
         }
         
+        if (sample->isMemoryMapped())
+            mappedZones++;
+        if (!sample->isFullyLoaded())
+        {
+            streamedZones++;
+            needsStreamRings = needsStreamRings || !sample->isMemoryMapped();
+        }
+        
         // Create note range for this zone
         juce::BigInteger midiNotes;
         midiNotes.setRange(zone.lowNote, zone.highNote - zone.lowNote + 1, true);
         
         // Create sound with zone parameters
         auto* sound = new ZonedSamplerSound(zone.sampleName,
-                                            *reader,
+                                            std::move(sample),
                                             midiNotes,
                                             zone.rootNote,
                                             adsrParams.attack,
-                                            adsrParams.release,
-                                            10.0); // Max 10 second samples
+                                            adsrParams.release);
         
         sound->setEnvelopeParameters(adsrParams);
         synth.addSound(sound);
@@ -263,15 +376,25 @@ bool SamplerInstrument::loadFromDefinition(const InstrumentDefinition& definitio
     
     loaded = loadedZones > 0;
     
+    // Disk thread only when something actually streams
+    hasStreamedSamples = streamedZones > 0;
+    if (hasStreamedSamples)
+        attachStreams();
+    
     DBG("SamplerInstrument: " << instrumentName << " - loaded " << loadedZones 
-        << "/" << definition.zones.size() << " zones");
+        << "/" << definition.zones.size() << " zones (" << mappedZones << " memory-mapped, "
+        << streamedZones << " streamed from disk)");
     
     return loaded;
 }
 
 void SamplerInstrument::clear()
 {
+    // The disk thread must be done with our voices before the samples go away
+    detachStreams();
     synth.clearSounds();
+    hasStreamedSamples = false;
+    needsStreamRings = false;
     loaded = false;
     instrumentId.clear();
     instrumentName.clear();
@@ -325,6 +448,17 @@ void SamplerInstrument::allNotesOff(int channel, bool allowTailOff)
     synth.allNotesOff(channel, allowTailOff);
 }
 
+void SamplerInstrument::setVoiceBudget(PolyphonyBudget::Client* budget)
+{
+    synth.allNotesOff(0, false);
+    
+    voiceBudget = budget;
+    synth.setVoiceBudget(budget);
+    for (int i = 0; i < synth.getNumVoices(); ++i)
+        if (auto* voice = dynamic_cast<ZonedSamplerVoice*>(synth.getVoice(i)))
+            voice->setVoiceBudget(budget);
+}
+
 void SamplerInstrument::setPolyphony(int numVoices)
 {
     if (numVoices != polyphony && numVoices > 0)
@@ -336,10 +470,19 @@ void SamplerInstrument::setPolyphony(int numVoices)
 
 void SamplerInstrument::setupVoices(int numVoices)
 {
+    detachStreams();
     synth.clearVoices();
     
     for (int i = 0; i < numVoices; ++i)
-        synth.addVoice(new ZonedSamplerVoice());
+    {
+        auto* voice = new ZonedSamplerVoice();
+        voice->getStream().setBlocking(nonRealtime);
+        voice->setVoiceBudget(voiceBudget);
+        synth.addVoice(voice);
+    }
+    
+    if (hasStreamedSamples)
+        attachStreams();
 }
 
 } // namespace mmg
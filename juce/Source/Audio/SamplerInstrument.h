@@ -14,6 +14,9 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include "ExpansionInstrumentLoader.h"
+#include "SampleCache.h"
+#include "SampleVoiceKernel.h"
+#include "VoiceAllocator.h"
 
 namespace mmg
 {
@@ -21,22 +24,22 @@ namespace mmg
 //==============================================================================
 /**
     Custom SamplerSound that stores zone information.
+    The sample may be only partly in memory; voices stream the rest (see SampleStreamer).
 */
 class ZonedSamplerSound : public juce::SynthesiserSound
 {
 public:
     ZonedSamplerSound(const juce::String& name,
-                      juce::AudioFormatReader& source,
+                      std::shared_ptr<const StreamedSample> sample,
                       const juce::BigInteger& midiNotes,
                       int midiNoteForNormalPitch,
                       double attackTimeSecs,
-                      double releaseTimeSecs,
-                      double maxSampleLengthSecs);
+                      double releaseTimeSecs);
     
     ~ZonedSamplerSound() override;
     
     const juce::String& getName() const noexcept { return name; }
-    juce::AudioBuffer<float>* getAudioData() const noexcept { return data.get(); }
+    const StreamedSample& getSample() const noexcept { return *sample; }
     
     int getMidiNoteForNormalPitch() const noexcept { return midiRootNote; }
     
@@ -50,7 +53,7 @@ private:
     friend class ZonedSamplerVoice;
     
     juce::String name;
-    std::unique_ptr<juce::AudioBuffer<float>> data;
+    std::shared_ptr<const StreamedSample> sample;      // Shared through SampleCache
     double sourceSampleRate;
     juce::BigInteger midiNotes;
     int length = 0, midiRootNote = 0;
@@ -84,8 +87,32 @@ public:
                          int startSample, int numSamples) override;
     
     using SynthesiserVoice::renderNextBlock;
+    
+    /** Source of frames past the sample's preloaded head. */
+    SampleStream& getStream() { return stream; }
+    
+    /** Starting a note takes a voice from this budget; the note is dropped if none is left. */
+    void setVoiceBudget(PolyphonyBudget::Client* newBudget) { budget = newBudget; }
+    
+    // Voice stealing (see VoiceAllocator::findVoiceToSteal)
+    bool isActive() const { return isVoiceActive(); }
+    bool isReleasing() const { return isPlayingButReleased(); }
+    float getLevel() const { return envelopeLevel * juce::jmax(lgain, rgain); }
+    
+    /** The voice is being stolen: the hard stop that follows keeps its budget grant
+        for the incoming note, so no other track can take the slot in between. */
+    void keepGrantForNextNote() { handingOver = true; }
 
 private:
+    void finishNote();
+    
+    PolyphonyBudget::Client* budget = nullptr;
+    PolyphonyBudget::Grant budgetGrant = PolyphonyBudget::Grant::None;
+    bool handingOver = false;                   // Set by keepGrantForNextNote until startNote
+    float envelopeLevel = 0.0f;                 // At the end of the last rendered block
+    
+    SampleStream stream;
+    SampleVoiceKernel::Scratch scratch;
     double pitchRatio = 0.0;
     double sourceSamplePosition = 0.0;
     float lgain = 0.0f, rgain = 0.0f;
@@ -94,6 +121,27 @@ private:
     JUCE_LEAK_DETECTOR(ZonedSamplerVoice)
 };
 
+//==============================================================================
+/**
+    Synthesiser that keeps to a polyphony budget and steals with
+    VoiceAllocator's priorities instead of juce::Synthesiser's defaults.
+*/
+class BudgetedSynthesiser : public juce::Synthesiser
+{
+public:
+    void setVoiceBudget(PolyphonyBudget::Client* newBudget) { budget = newBudget; }
+
+protected:
+    juce::SynthesiserVoice* findFreeVoice(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                          int midiNoteNumber, bool stealIfNoneAvailable) const override;
+    
+    juce::SynthesiserVoice* findVoiceToSteal(juce::SynthesiserSound* soundToPlay, int midiChannel,
+                                             int midiNoteNumber) const override;
+
+private:
+    PolyphonyBudget::Client* budget = nullptr;
+};
+
 //==============================================================================
 /**
     Complete sampler instrument that loads from an InstrumentDefinition.
@@ -167,9 +215,21 @@ public:
     /** Set polyphony (number of voices). */
     void setPolyphony(int numVoices);
     int getPolyphony() const { return polyphony; }
+    
+    /** Stream long samples from disk instead of decoding them fully (default on).
+        Call before loadFromDefinition(). */
+    void setDiskStreaming(bool shouldStream) { diskStreaming = shouldStream; }
+    
+    /** Offline rendering: voices wait for the disk instead of playing silence. */
+    void setNonRealtime(bool isNonRealtime);
+    
+    /** Count voices against a track's share of the global polyphony budget.
+        At the budget, new notes take over one of this instrument's voices. */
+    void setVoiceBudget(PolyphonyBudget::Client* budget);
 
 private:
-    juce::Synthesiser synth;
+    BudgetedSynthesiser synth;
+    PolyphonyBudget::Client* voiceBudget = nullptr;
     bool loaded = false;
     juce::String instrumentId;
     juce::String instrumentName;
@@ -180,8 +240,24 @@ private:
     
     juce::ADSR::Parameters adsrParams;
     
+    bool diskStreaming = true;
+    bool nonRealtime = false;
+    bool hasStreamedSamples = false;
+    bool needsStreamRings = false;              // Some streamed zone is decoded rather than mapped
+    juce::SharedResourcePointer<SampleStreamer> streamer;
+    juce::SharedResourcePointer<SampleCache> sampleCache;
+    
+    // Longest playable sample per zone
+    static constexpr double maxSampleLengthSeconds = 10.0;
+    
     void setupVoices(int numVoices);
     
+    /** Register every voice with the disk thread, with a ring buffer if needsStreamRings. */
+    void attachStreams();
+    
+    /** Unregister every voice; afterwards no voice is touched by the disk thread. */
+    void detachStreams();
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplerInstrument)
 };
 
@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    TrackCommandQueue.h
+
+    Lock-free queue carrying live input (auditions, piano-roll clicks,
+    all-notes-off on stop) from the message thread to a track's render
+    callback, which applies it at the start of its next block.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <initializer_list>
+
+namespace mmg
+{
+
+//==============================================================================
+/** One event for a track, timed relative to the block that picks it up. */
+struct TrackCommand
+{
+    enum class Type { NoteOn, NoteOff, AllNotesOff };
+
+    Type type = Type::NoteOn;
+    int note = 0;
+    float velocity = 0.0f;
+    int sampleOffset = 0;       // Samples after the start of the block that applies it
+};
+
+//==============================================================================
+/**
+    Fixed-size, single-consumer FIFO of commands for a render callback.
+
+    The render thread is the only consumer and never blocks. Producers are
+    normally just the message thread; a spin lock on the producer side keeps
+    the queue single-producer if another thread pushes too. Commands pushed
+    together are always picked up by the same block.
+*/
+template <typename Command, int queueCapacity>
+class CommandQueue
+{
+public:
+    CommandQueue() = default;
+
+    /** Queue commands from any thread.
+        @returns false (and queues nothing) if there is no room for all of them */
+    bool push(std::initializer_list<Command> newCommands) noexcept
+    {
+        const juce::SpinLock::ScopedLockType sl(producerLock);
+
+        const int numToWrite = (int)newCommands.size();
+        if (fifo.getFreeSpace() < numToWrite)
+            return false;
+
+        const auto scope = fifo.write(numToWrite);
+        auto source = newCommands.begin();
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            commands[(size_t)(scope.startIndex1 + i)] = *source++;
+        for (int i = 0; i < scope.blockSize2; ++i)
+            commands[(size_t)(scope.startIndex2 + i)] = *source++;
+
+        return true;
+    }
+
+    /** Hand every queued command to apply(const Command&), oldest first.
+        Render thread only. */
+    template <typename ApplyFunction>
+    void drain(ApplyFunction&& apply) noexcept
+    {
+        const auto scope = fifo.read(fifo.getNumReady());
+
+        for (int i = 0; i < scope.blockSize1; ++i)
+            apply(commands[(size_t)(scope.startIndex1 + i)]);
+        for (int i = 0; i < scope.blockSize2; ++i)
+            apply(commands[(size_t)(scope.startIndex2 + i)]);
+    }
+
+    static constexpr int capacity = queueCapacity;
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<Command, (size_t)capacity> commands;
+    juce::SpinLock producerLock;
+
+    JUCE_DECLARE_NON_COPYABLE(CommandQueue)
+};
+
+using TrackCommandQueue = CommandQueue<TrackCommand, 256>;
+
+} // namespace mmg
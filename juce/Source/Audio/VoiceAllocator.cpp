@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+    VoiceAllocator.cpp
+
+    Implementation of the shared polyphony budget.
+
+  ==============================================================================
+*/
+
+#include "VoiceAllocator.h"
+
+namespace mmg
+{
+
+//==============================================================================
+// PolyphonyBudget::Client
+//==============================================================================
+
+PolyphonyBudget::Client::~Client()
+{
+    // Voices must have been released by now (instruments stop them on destruction)
+    jassert(getVoicesInUse() == 0);
+    setBudget(nullptr);
+}
+
+void PolyphonyBudget::Client::setBudget(PolyphonyBudget* newBudget)
+{
+    jassert(getVoicesInUse() == 0);
+
+    if (budget != nullptr)
+        budget->totalReserved.fetch_sub(reserved.load());
+
+    budget = newBudget;
+
+    if (budget != nullptr)
+        budget->totalReserved.fetch_add(reserved.load());
+}
+
+void PolyphonyBudget::Client::setReservedVoices(int numVoices)
+{
+    numVoices = juce::jmax(0, numVoices);
+    const int previous = reserved.exchange(numVoices);
+
+    if (budget != nullptr)
+        budget->totalReserved.fetch_add(numVoices - previous);
+}
+
+bool PolyphonyBudget::Client::canAcquire() const noexcept
+{
+    if (budget == nullptr || reservedInUse.load() < reserved.load())
+        return true;
+
+    return budget->sharedInUse.load() < budget->getSharedVoices();
+}
+
+PolyphonyBudget::Grant PolyphonyBudget::Client::acquire() noexcept
+{
+    if (budget == nullptr)
+        return Grant::Shared;
+
+    // A client is only driven from its own track's render thread, so its
+    // counters cannot race with themselves
+    if (reservedInUse.load() < reserved.load())
+    {
+        reservedInUse.fetch_add(1);
+        budget->reservedInUse.fetch_add(1);
+        return Grant::Reserved;
+    }
+
+    // The shared pool is contended by every track
+    int inUse = budget->sharedInUse.load();
+    do
+    {
+        if (inUse >= budget->getSharedVoices())
+            return Grant::None;
+    }
+    while (!budget->sharedInUse.compare_exchange_weak(inUse, inUse + 1));
+
+    sharedInUse.fetch_add(1);
+    return Grant::Shared;
+}
+
+void PolyphonyBudget::Client::release(Grant grant) noexcept
+{
+    if (grant == Grant::Reserved)
+    {
+        reservedInUse.fetch_sub(1);
+        if (budget != nullptr)
+            budget->reservedInUse.fetch_sub(1);
+    }
+    else if (grant == Grant::Shared && budget != nullptr)
+    {
+        sharedInUse.fetch_sub(1);
+        budget->sharedInUse.fetch_sub(1);
+    }
+}
+
+} // namespace mmg
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    VoiceAllocator.h
+
+    Voice stealing and polyphony budgeting shared by the sample instruments
+    (SFZInstrument, SamplerInstrument). A PolyphonyBudget caps the voices
+    sounding across every track, with a number of them reserved per track;
+    when an instrument is at the budget (or out of voices) it takes over one
+    of its own voices, picked by VoiceAllocator::findVoiceToSteal().
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <atomic>
+
+namespace mmg
+{
+
+//==============================================================================
+/**
+    Global voice limit shared by all tracks.
+
+    Each track owns a Client. A client's reserved voices are always available to
+    it; voices beyond that come from the shared pool (the budget minus every
+    reservation), first come first served. Acquire/release are lock-free and may
+    be called from several render threads at once.
+*/
+class PolyphonyBudget
+{
+public:
+    /** Where an acquired voice came from, so it is returned to the same place. */
+    enum class Grant { None, Reserved, Shared };
+
+    //==========================================================================
+    /** One track's share of the budget. Without a budget every voice is granted
+        (offline render copies). */
+    class Client
+    {
+    public:
+        Client() = default;
+        ~Client();
+
+        /** Attach to a budget. Call before any voice is acquired. */
+        void setBudget(PolyphonyBudget* newBudget);
+
+        /** Voices this client can always get, whatever the other tracks use. */
+        void setReservedVoices(int numVoices);
+        int getReservedVoices() const noexcept { return reserved.load(); }
+
+        /** True if acquire() would currently succeed. */
+        bool canAcquire() const noexcept;
+
+        /** Take a voice; Grant::None means the budget is exhausted. */
+        Grant acquire() noexcept;
+
+        /** Return a voice taken by acquire(). */
+        void release(Grant grant) noexcept;
+
+        /** Voices currently held by this client. */
+        int getVoicesInUse() const noexcept { return reservedInUse.load() + sharedInUse.load(); }
+
+    private:
+        PolyphonyBudget* budget = nullptr;
+        std::atomic<int> reserved { 0 };
+        std::atomic<int> reservedInUse { 0 };
+        std::atomic<int> sharedInUse { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE(Client)
+    };
+
+    //==========================================================================
+    PolyphonyBudget() = default;
+
+    /** Voices allowed to sound at once across all clients. */
+    void setMaxVoices(int numVoices) { maxVoices.store(juce::jmax(1, numVoices)); }
+    int getMaxVoices() const noexcept { return maxVoices.load(); }
+
+    /** Voices sounding across all clients. */
+    int getVoicesInUse() const noexcept { return reservedInUse.load() + sharedInUse.load(); }
+
+    static constexpr int defaultMaxVoices = 256;
+
+private:
+    std::atomic<int> maxVoices { defaultMaxVoices };
+    std::atomic<int> totalReserved { 0 };
+    std::atomic<int> reservedInUse { 0 };
+    std::atomic<int> sharedInUse { 0 };
+
+    int getSharedVoices() const noexcept { return maxVoices.load() - totalReserved.load(); }
+
+    JUCE_DECLARE_NON_COPYABLE(PolyphonyBudget)
+};
+
+//==============================================================================
+namespace VoiceAllocator
+{
+
+/** Pick the voice a new note should take over.
+    Released voices go first (oldest first), then the quietest held voice
+    (oldest on a tie). getVoice(i) returns the voice at index i, or nullptr to
+    skip it; a voice provides isActive(), isReleasing(), getLevel() and
+    wasStartedBefore(other).
+    @returns the index of the voice to steal, or -1 if no voice is active */
+template <typename GetVoice>
+int findVoiceToSteal(int numVoices, GetVoice&& getVoice)
+{
+    int best = -1;
+
+    for (int i = 0; i < numVoices; ++i)
+    {
+        const auto* voice = getVoice(i);
+        if (voice == nullptr || !voice->isActive())
+            continue;
+
+        if (best < 0)
+        {
+            best = i;
+            continue;
+        }
+
+        const auto* current = getVoice(best);
+        const bool releasing = voice->isReleasing();
+
+        if (releasing != current->isReleasing())
+        {
+            if (releasing)
+                best = i;
+            continue;
+        }
+
+        // Both released: the oldest has faded furthest
+        if (releasing)
+        {
+            if (voice->wasStartedBefore(*current))
+                best = i;
+            continue;
+        }
+
+        const float level = voice->getLevel();
+        const float currentLevel = current->getLevel();
+
+        if (level < currentLevel || (level == currentLevel && voice->wasStartedBefore(*current)))
+            best = i;
+    }
+
+    return best;
+}
+
+} // namespace VoiceAllocator
+
+} // namespace mmg
@@ -620,6 +620,7 @@ MainComponent::MainComponent(AppState& state, mmg::AudioEngine& engine)
 
     // Listen to project state changes
     appState.getProjectState().addStateListener(this);
+    appState.getProjectState().addNoteListener(this);
 
     // Set size with enforced minimum dimensions for responsive design
     setSize(Layout::defaultWindowWidth, Layout::defaultWindowHeight);
@@ -696,6 +697,7 @@ MainComponent::~MainComponent()
 {
     appState.removeListener(this);
     appState.getProjectState().removeStateListener(this);
+    appState.getProjectState().removeNoteListener(this);
     stopTimer();
     
     // Close floating windows
@@ -1835,12 +1837,12 @@ void MainComponent::onGenerationComplete(const GenerationResult& result)
         currentStatus = outputFile.existsAsFile()
                             ? (juce::String(hasMasteredAudio
                                                 ? "Generated backend mastered reference: "
-                                                : "Generated dry/unmastered MIDI preview/fallback: ")
+                                                : "Generated unmastered MIDI preview/fallback: ")
                                + outputFile.getFileNameWithoutExtension()
-                               + (hasMasteredAudio ? "" : " (no live FX/mastering)"))
+                               + (hasMasteredAudio ? "" : " (live FX, no mastering)"))
                             : juce::String(hasMasteredAudio
                                                ? "Generation complete: backend mastered reference"
-                                               : "Generation complete: dry/unmastered MIDI preview/fallback (no live FX/mastering)");
+                                               : "Generation complete: unmastered MIDI preview/fallback (live FX, no mastering)");
     }
     generationStatus = GenerationStatus::Completed;
     generationCompleteTime = juce::Time::getCurrentTime();
@@ -1882,9 +1884,9 @@ void MainComponent::onGenerationComplete(const GenerationResult& result)
                 applyGeneratedInstrumentPatchSubset(result);
 
                 if (result.audioPath.isEmpty())
-                    currentStatus = "Loaded dry/unmastered MIDI preview/fallback: "
+                    currentStatus = "Loaded unmastered MIDI preview/fallback: "
                                     + midiFile.getFileNameWithoutExtension()
-                                    + " (no live FX/mastering)";
+                                    + " (live FX, no mastering)";
             }
         }
 
@@ -1899,11 +1901,11 @@ void MainComponent::onGenerationComplete(const GenerationResult& result)
                     currentStatus = "Loaded backend mastered reference: "
                                     + audioFile.getFileNameWithoutExtension();
                 else
-                    currentStatus = "Backend mastered reference load failed; using dry/unmastered MIDI preview/fallback (no live FX/mastering)";
+                    currentStatus = "Backend mastered reference load failed; using unmastered MIDI preview/fallback (live FX, no mastering)";
             }
             else
             {
-                currentStatus = "Backend mastered reference missing; using dry/unmastered MIDI preview/fallback (no live FX/mastering)";
+                currentStatus = "Backend mastered reference missing; using unmastered MIDI preview/fallback (live FX, no mastering)";
             }
         }
         
@@ -1921,7 +1923,7 @@ void MainComponent::onGenerationComplete(const GenerationResult& result)
         
         // Show completion message (no callback to prevent accidental triggers)
         juce::String message = "Generation complete!\n\n";
-        message += "Dry/unmastered MIDI preview/fallback (no live FX/mastering): " + result.midiPath + "\n";
+        message += "Unmastered MIDI preview/fallback (live FX, no mastering): " + result.midiPath + "\n";
         if (result.audioPath.isNotEmpty())
             message += "Backend mastered reference: " + result.audioPath + "\n";
         message += "\nDuration: " + juce::String(result.duration, 1) + "s";
@@ -2296,8 +2298,8 @@ void MainComponent::fileSelected(const juce::File& file)
     if (file.hasFileExtension(".wav;.wave;.aiff;.aif;.flac;.mp3;.ogg"))
         currentStatus = "Loaded audio file/reference: " + file.getFileName();
     else if (file.hasFileExtension(".mid;.midi"))
-        currentStatus = "Loaded dry/unmastered MIDI preview/fallback: " + file.getFileName()
-                        + " (no live FX/mastering)";
+        currentStatus = "Loaded unmastered MIDI preview/fallback: " + file.getFileName()
+                        + " (live FX, no mastering)";
     else
         currentStatus = "Loaded: " + file.getFileName();
     
@@ -2418,7 +2420,7 @@ void MainComponent::updateControlsNextOverridesUi()
 void MainComponent::masteringSettingsChanged(MasteringSuitePanel* /*panel*/)
 {
     // Handle mastering UI-only settings changes
-    currentStatus = "Mastering UI settings changed locally only; no backend apply path is wired and live preview stays dry/unmastered";
+    currentStatus = "Mastering UI settings changed locally only; no backend apply path is wired and live preview stays unmastered";
     repaint();
 }
 
@@ -2428,7 +2430,7 @@ void MainComponent::applyMasteringRequested(const juce::String& processorType, c
 
     juce::ignoreUnused(processorType, settings);
 
-    currentStatus = "Mastering apply unavailable: no backend action is wired and live preview stays dry/unmastered";
+    currentStatus = "Mastering apply unavailable: no backend action is wired and live preview stays unmastered";
     repaint();
 }
 
@@ -2723,9 +2725,9 @@ void MainComponent::fxChainChanged(FXChainPanel* panel)
     if (panel == nullptr) return;
     
     DBG("FX chain updated");
-    currentStatus = "FX chain updated for backend render parity only; live MIDI preview stays dry/unmastered";
+    currentStatus = "FX chain updated";
     
-    // Apply FX chain to real-time MixerGraph
+    // Apply FX chain to real-time MixerGraph (units that survive the edit keep their state)
     auto& mixerGraph = audioEngine.getMixerGraph();
     
     // Get chains for each bus and apply to MixerGraph
@@ -3172,7 +3174,7 @@ bool MainComponent::applyTakeCompToProject(const juce::String& track, const juce
 }
 
 //==============================================================================
-// ProjectState::Listener overrides
+// ProjectState::Listener / NoteListener overrides
 void MainComponent::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
 {
     if (tree.hasType(Project::IDs::TRACK))
@@ -3186,38 +3188,21 @@ void MainComponent::valueTreePropertyChanged(juce::ValueTree& tree, const juce::
                 track->setMute(tree.getProperty(property));
             else if (property == Project::IDs::solo)
                 track->setSolo(tree.getProperty(property));
+            else if (property == Project::IDs::pan)
+                audioEngine.getMixerGraph().setTrackPan(index, tree.getProperty(property));
+            else if (property == Project::IDs::stereoWidth)
+                audioEngine.getMixerGraph().setTrackStereoWidth(index, tree.getProperty(property));
         }
     }
-    else if (tree.hasType(Project::IDs::NOTE))
-    {
-        // Note changed (moved, resized)
-        juce::MessageManager::callAsync([this]() {
-            auto midi = appState.getProjectState().exportToMidiFile();
-            audioEngine.loadMidiData(midi);
-        });
-    }
 }
 
-void MainComponent::valueTreeChildAdded(juce::ValueTree& parent, juce::ValueTree& child)
+void MainComponent::notesChanged(const juce::Array<Project::NoteId>& /*changedNotes*/)
 {
-    if (child.hasType(Project::IDs::NOTE))
-    {
-        juce::MessageManager::callAsync([this]() {
-            auto midi = appState.getProjectState().exportToMidiFile();
-            audioEngine.loadMidiData(midi);
-        });
-    }
-}
-
-void MainComponent::valueTreeChildRemoved(juce::ValueTree& parent, juce::ValueTree& child, int index)
-{
-    if (child.hasType(Project::IDs::NOTE))
-    {
-        juce::MessageManager::callAsync([this]() {
-            auto midi = appState.getProjectState().exportToMidiFile();
-            audioEngine.loadMidiData(midi);
-        });
-    }
+    // Notes added, moved, resized or removed
+    juce::MessageManager::callAsync([this]() {
+        auto midi = appState.getProjectState().exportToMidiFile();
+        audioEngine.loadMidiData(midi);
+    });
 }
 
 //==============================================================================
@@ -3504,7 +3489,7 @@ bool MainComponent::keyPressed(const juce::KeyPress& key)
             if (audioEngine.hasAudioFileLoaded())
                 currentStatus = "Playing loaded audio file/reference";
             else if (audioEngine.hasMidiLoaded())
-                currentStatus = "Playing dry/unmastered MIDI preview (no live FX/mastering)";
+                currentStatus = "Playing unmastered MIDI preview (live FX, no mastering)";
             else
                 currentStatus = "Playing";
         }
@@ -3513,7 +3498,7 @@ bool MainComponent::keyPressed(const juce::KeyPress& key)
             if (audioEngine.hasAudioFileLoaded())
                 currentStatus = "Paused loaded audio file/reference";
             else if (audioEngine.hasMidiLoaded())
-                currentStatus = "Paused dry/unmastered MIDI preview (no live FX/mastering)";
+                currentStatus = "Paused unmastered MIDI preview (live FX, no mastering)";
             else
                 currentStatus = "Paused";
         }
@@ -66,6 +66,7 @@ class MainComponent : public juce::Component,
                       public TimelineComponent::Listener,
                       public TransportComponent::Listener,
                       public Project::ProjectState::Listener,
+                      public Project::ProjectState::NoteListener,
                       public ControlsPanel::Listener,
                       public MasteringSuitePanel::Listener,
                       public juce::Timer
@@ -170,11 +171,14 @@ public:
     //==============================================================================
     // ProjectState::Listener overrides
     void valueTreePropertyChanged(juce::ValueTree& treeWhosePropertyHasChanged, const juce::Identifier& property) override;
-    void valueTreeChildAdded(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenAdded) override;
-    void valueTreeChildRemoved(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenRemoved, int indexFromWhichChildWasRemoved) override;
+    void valueTreeChildAdded(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenAdded) override {}
+    void valueTreeChildRemoved(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenRemoved, int indexFromWhichChildWasRemoved) override {}
     void valueTreeChildOrderChanged(juce::ValueTree& parentTreeWhichHasChanged, int oldIndex, int newIndex) override {}
     void valueTreeParentChanged(juce::ValueTree& treeWhoseParentHasChanged) override {}
     
+    // ProjectState::NoteListener overrides
+    void notesChanged(const juce::Array<Project::NoteId>& changedNotes) override;
+    
     //==============================================================================
     // TimelineComponent::Listener overrides
     void timelineSeekRequested(double positionSeconds) override;
@@ -283,7 +287,7 @@ private:
     juce::var nextRegenerateOverrides;
 
     // Take comping: snapshot of original per-track notes (keyed by track index).
-    std::map<int, juce::ValueTree> takeCompSnapshots;
+    std::map<int, std::vector<Project::Note>> takeCompSnapshots;
     bool masteringReferenceAnalysisPending = false;
     bool takeRenderPending = false;
     bool expansionResolvePending = false;
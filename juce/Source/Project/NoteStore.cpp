@@ -0,0 +1,309 @@
+/*
+  ==============================================================================
+
+    NoteStore.cpp
+
+    Columnar note storage and its project-file encoding.
+
+  ==============================================================================
+*/
+
+#include "NoteStore.h"
+#include "ProjectState.h"
+
+#include <numeric>
+
+namespace Project
+{
+    namespace
+    {
+        // Columns are written as base64 of little-endian values, one property per column
+        juce::String encodeColumn(const std::vector<juce::uint8>& column)
+        {
+            return juce::Base64::toBase64(column.data(), column.size());
+        }
+
+        juce::String encodeColumn(const std::vector<double>& column)
+        {
+            juce::MemoryOutputStream out(column.size() * sizeof(double));
+            for (auto value : column)
+                out.writeDouble(value);
+
+            return juce::Base64::toBase64(out.getData(), out.getDataSize());
+        }
+
+        juce::MemoryBlock decodeColumn(const juce::var& property)
+        {
+            juce::MemoryOutputStream out;
+            juce::Base64::convertFromBase64(out, property.toString());
+            return out.getMemoryBlock();
+        }
+    }
+
+    //==============================================================================
+    // NoteDiff
+
+    void NoteDiff::record(const Note* before, const Note* after)
+    {
+        const NoteId id = before != nullptr ? before->id : after->id;
+        jassert(id != 0);
+
+        const auto found = entryIndex.find(id);
+        if (found != entryIndex.end())
+        {
+            // Keep the earliest "before", take the latest "after"
+            auto& entry = entries[found->second];
+            entry.hasAfter = after != nullptr;
+            if (after != nullptr)
+                entry.after = *after;
+            return;
+        }
+
+        Entry entry;
+        entry.hasBefore = before != nullptr;
+        entry.hasAfter = after != nullptr;
+        if (before != nullptr) entry.before = *before;
+        if (after != nullptr)  entry.after = *after;
+
+        entryIndex[id] = entries.size();
+        entries.push_back(entry);
+    }
+
+    void NoteDiff::append(const NoteDiff& later)
+    {
+        for (const auto& entry : later.entries)
+            record(entry.hasBefore ? &entry.before : nullptr,
+                   entry.hasAfter ? &entry.after : nullptr);
+    }
+
+    //==============================================================================
+    // NoteStore
+
+    Note NoteStore::TrackColumns::getNote(int channel, size_t row) const
+    {
+        Note note;
+        note.id = ids[row];
+        note.noteNumber = noteNumbers[row];
+        note.start = starts[row];
+        note.length = lengths[row];
+        note.velocity = velocities[row];
+        note.channel = channel;
+        return note;
+    }
+
+    void NoteStore::TrackColumns::updateOrder() const
+    {
+        if (orderValid)
+            return;
+
+        byStart.resize(ids.size());
+        std::iota(byStart.begin(), byStart.end(), 0);
+        std::sort(byStart.begin(), byStart.end(), [this](int a, int b)
+        {
+            return starts[(size_t)a] < starts[(size_t)b];
+        });
+
+        maxLength = lengths.empty() ? 0.0 : *std::max_element(lengths.begin(), lengths.end());
+        orderValid = true;
+    }
+
+    void NoteStore::set(const Note& note)
+    {
+        jassert(note.id != 0);
+
+        auto found = locations.find(note.id);
+        if (found != locations.end() && found->second.channel != note.channel)
+        {
+            remove(note.id);
+            found = locations.end();
+        }
+
+        const auto noteNumber = (juce::uint8)juce::jlimit(0, 127, note.noteNumber);
+        const auto velocity = (juce::uint8)juce::jlimit(0, 127, note.velocity);
+        auto& track = tracks[note.channel];
+
+        if (found == locations.end())
+        {
+            locations[note.id] = { note.channel, track.ids.size() };
+            track.ids.push_back(note.id);
+            track.noteNumbers.push_back(noteNumber);
+            track.starts.push_back(note.start);
+            track.lengths.push_back(note.length);
+            track.velocities.push_back(velocity);
+            track.orderValid = false;
+
+            nextId = juce::jmax(nextId, note.id + 1);
+            return;
+        }
+
+        const auto row = found->second.row;
+        if (track.starts[row] != note.start || track.lengths[row] != note.length)
+            track.orderValid = false;
+
+        track.noteNumbers[row] = noteNumber;
+        track.starts[row] = note.start;
+        track.lengths[row] = note.length;
+        track.velocities[row] = velocity;
+    }
+
+    bool NoteStore::remove(NoteId id)
+    {
+        const auto found = locations.find(id);
+        if (found == locations.end())
+            return false;
+
+        const auto [channel, row] = found->second;
+        locations.erase(found);
+
+        auto trackIt = tracks.find(channel);
+        auto& track = trackIt->second;
+        const auto last = track.ids.size() - 1;
+
+        // Swap the last row into the hole
+        if (row != last)
+        {
+            track.ids[row] = track.ids[last];
+            track.noteNumbers[row] = track.noteNumbers[last];
+            track.starts[row] = track.starts[last];
+            track.lengths[row] = track.lengths[last];
+            track.velocities[row] = track.velocities[last];
+            locations[track.ids[row]].row = row;
+        }
+
+        track.ids.pop_back();
+        track.noteNumbers.pop_back();
+        track.starts.pop_back();
+        track.lengths.pop_back();
+        track.velocities.pop_back();
+        track.orderValid = false;
+
+        if (track.ids.empty())
+            tracks.erase(trackIt);
+
+        return true;
+    }
+
+    void NoteStore::clear()
+    {
+        tracks.clear();
+        locations.clear();
+    }
+
+    void NoteStore::apply(const NoteDiff& diff, bool forwards)
+    {
+        for (const auto& entry : diff.entries)
+        {
+            const bool exists = forwards ? entry.hasAfter : entry.hasBefore;
+
+            if (exists)
+                set(forwards ? entry.after : entry.before);
+            else
+                remove(entry.getId());
+        }
+    }
+
+    //==============================================================================
+    Note NoteStore::get(NoteId id) const
+    {
+        const auto found = locations.find(id);
+        if (found == locations.end())
+            return {};
+
+        return tracks.at(found->second.channel).getNote(found->second.channel, found->second.row);
+    }
+
+    juce::Array<int> NoteStore::getChannels() const
+    {
+        juce::Array<int> channels;
+        for (const auto& track : tracks)
+            channels.add(track.first);
+
+        return channels;
+    }
+
+    double NoteStore::getEndBeats() const
+    {
+        double end = 0.0;
+        for (const auto& [channel, track] : tracks)
+            for (size_t row = 0; row < track.ids.size(); ++row)
+                end = juce::jmax(end, track.starts[row] + track.lengths[row]);
+
+        return end;
+    }
+
+    //==============================================================================
+    // Project file
+
+    void NoteStore::writeTo(juce::ValueTree& notesNode) const
+    {
+        notesNode.removeAllChildren(nullptr);
+
+        for (const auto& [channel, track] : tracks)
+        {
+            juce::ValueTree columns(IDs::NOTE_COLUMNS);
+            columns.setProperty(IDs::channel, channel, nullptr);
+            columns.setProperty(IDs::count, (int)track.ids.size(), nullptr);
+            columns.setProperty(IDs::noteNumber, encodeColumn(track.noteNumbers), nullptr);
+            columns.setProperty(IDs::start, encodeColumn(track.starts), nullptr);
+            columns.setProperty(IDs::length, encodeColumn(track.lengths), nullptr);
+            columns.setProperty(IDs::velocity, encodeColumn(track.velocities), nullptr);
+            notesNode.appendChild(columns, nullptr);
+        }
+    }
+
+    void NoteStore::readFrom(const juce::ValueTree& notesNode)
+    {
+        clear();
+
+        for (const auto& child : notesNode)
+        {
+            if (child.hasType(IDs::NOTE))
+            {
+                // Projects saved before the columnar format: one node per note
+                Note note;
+                note.id = createId();
+                note.noteNumber = child.getProperty(IDs::noteNumber);
+                note.start = child.getProperty(IDs::start);
+                note.length = child.getProperty(IDs::length);
+                note.velocity = child.getProperty(IDs::velocity);
+                note.channel = child.getProperty(IDs::channel);
+                set(note);
+                continue;
+            }
+
+            if (!child.hasType(IDs::NOTE_COLUMNS))
+                continue;
+
+            const int count = child.getProperty(IDs::count);
+            const auto noteNumbers = decodeColumn(child.getProperty(IDs::noteNumber));
+            const auto starts = decodeColumn(child.getProperty(IDs::start));
+            const auto lengths = decodeColumn(child.getProperty(IDs::length));
+            const auto velocities = decodeColumn(child.getProperty(IDs::velocity));
+
+            if (count <= 0
+                || noteNumbers.getSize() != (size_t)count
+                || velocities.getSize() != (size_t)count
+                || starts.getSize() != (size_t)count * sizeof(double)
+                || lengths.getSize() != (size_t)count * sizeof(double))
+            {
+                DBG("NoteStore: skipping malformed NOTE_COLUMNS for channel " << child.getProperty(IDs::channel).toString());
+                continue;
+            }
+
+            juce::MemoryInputStream startStream(starts, false);
+            juce::MemoryInputStream lengthStream(lengths, false);
+
+            for (int i = 0; i < count; ++i)
+            {
+                Note note;
+                note.id = createId();
+                note.noteNumber = (int)static_cast<const juce::uint8*>(noteNumbers.getData())[i];
+                note.start = startStream.readDouble();
+                note.length = lengthStream.readDouble();
+                note.velocity = (int)static_cast<const juce::uint8*>(velocities.getData())[i];
+                note.channel = child.getProperty(IDs::channel);
+                set(note);
+            }
+        }
+    }
+}
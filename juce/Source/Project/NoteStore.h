@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    NoteStore.h
+
+    Columnar storage for the project's notes: parallel arrays per track,
+    stable note ids, start-ordered range queries, and the compact diffs
+    that undo/redo replays.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace Project
+{
+    /** Identifies a note for as long as the project is open; 0 is never a valid id. */
+    using NoteId = juce::uint32;
+
+    //==============================================================================
+    /** One note, as handed in and out of NoteStore. Times are in beats. */
+    struct Note
+    {
+        NoteId id = 0;
+        int noteNumber = 60;
+        double start = 0.0;
+        double length = 1.0;
+        int velocity = 100;
+        int channel = 0;        // 0-based track index in our model
+
+        double getEnd() const noexcept { return start + length; }
+    };
+
+    //==============================================================================
+    /**
+        Before/after images of the notes touched by an edit.
+
+        Each note appears once, however often it was changed: recording the
+        same note again only replaces its "after" image. A missing image means
+        the note did not exist on that side (added or removed).
+    */
+    struct NoteDiff
+    {
+        struct Entry
+        {
+            Note before, after;
+            bool hasBefore = false;
+            bool hasAfter = false;
+
+            NoteId getId() const noexcept { return hasBefore ? before.id : after.id; }
+        };
+
+        void added(const Note& note)                            { record(nullptr, &note); }
+        void removed(const Note& note)                          { record(&note, nullptr); }
+        void changed(const Note& before, const Note& after)     { record(&before, &after); }
+
+        /** Fold a later diff into this one. */
+        void append(const NoteDiff& later);
+
+        bool isEmpty() const noexcept { return entries.empty(); }
+
+        std::vector<Entry> entries;
+
+    private:
+        void record(const Note* before, const Note* after);
+
+        std::unordered_map<NoteId, size_t> entryIndex;
+    };
+
+    //==============================================================================
+    /**
+        The project's notes, stored column-wise per track.
+
+        Each track (keyed by channel) keeps parallel arrays of ids, pitches,
+        starts, lengths and velocities instead of a ValueTree node per note.
+        Removal swaps the last row in, so rows are unordered; a start-sorted
+        row index is rebuilt lazily for range queries.
+
+        Message thread only.
+    */
+    class NoteStore
+    {
+    public:
+        NoteStore() = default;
+
+        /** A fresh id for a note about to be added. */
+        NoteId createId() noexcept { return nextId++; }
+
+        /** Insert the note, or replace the one with the same id (moving it to another track if its channel changed). */
+        void set(const Note& note);
+
+        /** @returns false if there was no such note */
+        bool remove(NoteId id);
+
+        void clear();
+
+        /** Redo (forwards) or undo a diff. */
+        void apply(const NoteDiff& diff, bool forwards);
+
+        //==============================================================================
+        bool contains(NoteId id) const { return locations.find(id) != locations.end(); }
+
+        /** The note with this id, or a Note whose id is 0 if there is none. */
+        Note get(NoteId id) const;
+
+        int size() const noexcept { return (int)locations.size(); }
+        bool isEmpty() const noexcept { return locations.empty(); }
+
+        /** Tracks holding at least one note, in ascending order. */
+        juce::Array<int> getChannels() const;
+
+        /** End of the last note, in beats (0 if there are none). */
+        double getEndBeats() const;
+
+        /** Call fn(const Note&) for every note, track by track. */
+        template <typename Function>
+        void forEach(Function&& fn) const
+        {
+            for (const auto& [channel, track] : tracks)
+                for (size_t row = 0; row < track.ids.size(); ++row)
+                    fn(track.getNote(channel, row));
+        }
+
+        /** Call fn(const Note&) for every note of one track, in no particular order. */
+        template <typename Function>
+        void forEachInTrack(int channel, Function&& fn) const
+        {
+            const auto found = tracks.find(channel);
+            if (found == tracks.end())
+                return;
+
+            for (size_t row = 0; row < found->second.ids.size(); ++row)
+                fn(found->second.getNote(channel, row));
+        }
+
+        /** Call fn(const Note&) for the notes of one track that overlap [startBeats, endBeats), ordered by start. */
+        template <typename Function>
+        void forEachInRange(int channel, double startBeats, double endBeats, Function&& fn) const
+        {
+            const auto found = tracks.find(channel);
+            if (found == tracks.end())
+                return;
+
+            const auto& track = found->second;
+            track.updateOrder();
+
+            // Nothing starting earlier than this can reach startBeats
+            const double earliestStart = startBeats - track.maxLength;
+            auto row = std::lower_bound(track.byStart.begin(), track.byStart.end(), earliestStart,
+                                        [&track](int r, double t) { return track.starts[(size_t)r] < t; });
+
+            for (; row != track.byStart.end() && track.starts[(size_t)*row] < endBeats; ++row)
+            {
+                const auto r = (size_t)*row;
+                if (track.starts[r] >= startBeats || track.starts[r] + track.lengths[r] > startBeats)
+                    fn(track.getNote(channel, r));
+            }
+        }
+
+        //==============================================================================
+        // Project file
+
+        /** Replace the children of the NOTES node with one NOTE_COLUMNS node per track. */
+        void writeTo(juce::ValueTree& notesNode) const;
+
+        /** Load NOTE_COLUMNS nodes, or the one-node-per-note NOTE children of older projects. Ids are assigned afresh. */
+        void readFrom(const juce::ValueTree& notesNode);
+
+    private:
+        struct TrackColumns
+        {
+            std::vector<NoteId> ids;
+            std::vector<juce::uint8> noteNumbers;
+            std::vector<double> starts;
+            std::vector<double> lengths;
+            std::vector<juce::uint8> velocities;
+
+            // Rows sorted by start, and the longest note; rebuilt when a start or length changes
+            mutable std::vector<int> byStart;
+            mutable double maxLength = 0.0;
+            mutable bool orderValid = false;
+
+            Note getNote(int channel, size_t row) const;
+            void updateOrder() const;
+        };
+
+        struct Location
+        {
+            int channel = 0;
+            size_t row = 0;
+        };
+
+        std::map<int, TrackColumns> tracks;
+        std::unordered_map<NoteId, Location> locations;
+        NoteId nextId = 1;
+
+        JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoteStore)
+    };
+}
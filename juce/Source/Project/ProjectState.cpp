@@ -9,9 +9,58 @@
 */
 
 #include "ProjectState.h"
+#include "Command.h"
 
 namespace Project
 {
+    //==============================================================================
+    /**
+        Undo record for note edits: one NoteDiff instead of a ValueTree action
+        per property. Consecutive edits in one transaction (a drag, an import)
+        coalesce into a single command.
+    */
+    class NoteEditCommand : public Command
+    {
+    public:
+        NoteEditCommand(ProjectState& owner, NoteDiff noteDiff)
+            : Command("Edit Notes"), state(owner), diff(std::move(noteDiff)),
+              units(juce::jmax(1, (int)diff.entries.size()))
+        {
+        }
+
+        bool perform() override
+        {
+            state.applyNoteDiff(diff, true);
+            return true;
+        }
+
+        bool undo() override
+        {
+            state.applyNoteDiff(diff, false);
+            return true;
+        }
+
+        int getSizeInUnits() override { return units; }
+
+        juce::UndoableAction* createCoalescedAction(juce::UndoableAction* nextAction) override
+        {
+            auto* next = dynamic_cast<NoteEditCommand*>(nextAction);
+            if (next == nullptr || &next->state != &state)
+                return nullptr;
+
+            // The UndoManager deletes this action once the merged one replaces it, so the diff can move
+            NoteDiff merged(std::move(diff));
+            merged.append(next->diff);
+            return new NoteEditCommand(state, std::move(merged));
+        }
+
+    private:
+        ProjectState& state;
+        NoteDiff diff;
+        const int units;    // Cached: the diff is moved out when coalescing
+    };
+
+    //==============================================================================
     ProjectState::ProjectState()
         : projectTree(IDs::PROJECT), isDirty(false)
     {
@@ -90,7 +139,7 @@ namespace Project
         projectTree.removeAllChildren(&undoManager);
         projectTree.removeAllProperties(&undoManager);
         
-        projectTree.setProperty(IDs::version, "1.1.0", &undoManager);
+        projectTree.setProperty(IDs::version, "1.2.0", &undoManager);
         
         // Create Generation Node
         juce::ValueTree genNode(IDs::GENERATION);
@@ -122,6 +171,10 @@ namespace Project
         juce::ValueTree fxChainsNode(IDs::FX_CHAINS);
         projectTree.addChild(fxChainsNode, -1, &undoManager);
         
+        notes.clear();
+        sendNotesChanged({});
+        flushNoteChanges();
+        
         undoManager.clearUndoHistory();
         currentFile = juce::File();
     }
@@ -160,14 +213,23 @@ namespace Project
                             ensureTrackDefaults(child);
                 }
 
+                // Notes live in the NoteStore; the NOTES node stays empty until the next save
+                auto notesNode = projectTree.getChildWithName(IDs::NOTES);
+                if (!notesNode.isValid())
+                {
+                    notesNode = juce::ValueTree(IDs::NOTES);
+                    projectTree.addChild(notesNode, -1, nullptr);
+                }
+                
+                const bool hasLegacyNotes = notesNode.getChildWithName(IDs::NOTE).isValid();
+                notes.readFrom(notesNode);
+                notesNode.removeAllChildren(nullptr);
+
                 // One-time migration: some older sessions stored note "channel" as 1-based track number
                 // (Track 1 => 1) instead of our 0-based track index. Detect and fix safely.
                 static const juce::Identifier legacyFixedId("legacyTrackChannelsFixed");
-                if (! (bool) projectTree.getProperty(legacyFixedId, false))
+                if (hasLegacyNotes && ! (bool) projectTree.getProperty(legacyFixedId, false))
                 {
-                    auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-                    auto mixerNode = projectTree.getChildWithName(IDs::MIXER);
-
                     int trackCount = 0;
                     if (mixerNode.isValid())
                     {
@@ -181,39 +243,27 @@ namespace Project
                         }
                     }
 
-                    if (notesNode.isValid() && notesNode.getNumChildren() > 0 && trackCount > 0)
+                    // Heuristic: if there are notes, none are on channel 0, and all channels are within 1..trackCount,
+                    // treat it as legacy 1-based and shift down.
+                    const auto channels = notes.getChannels();
+                    if (!channels.isEmpty() && trackCount > 0 && channels.getFirst() >= 1 && channels.getLast() <= trackCount)
                     {
-                        bool hasZero = false;
-                        int minCh = 999;
-                        int maxCh = -999;
+                        std::vector<Note> shifted;
+                        shifted.reserve((size_t)notes.size());
+                        notes.forEach([&shifted](const Note& note) { shifted.push_back(note); });
 
-                        for (const auto& note : notesNode)
+                        for (auto& note : shifted)
                         {
-                            if (!note.hasType(IDs::NOTE))
-                                continue;
-                            int ch = (int)note.getProperty(IDs::channel);
-                            if (ch == 0) hasZero = true;
-                            minCh = juce::jmin(minCh, ch);
-                            maxCh = juce::jmax(maxCh, ch);
-                        }
-
-                        // Heuristic: if there are notes, none are on channel 0, and all channels are within 1..trackCount,
-                        // treat it as legacy 1-based and shift down.
-                        if (!hasZero && minCh >= 1 && maxCh <= trackCount)
-                        {
-                            for (int i = 0; i < notesNode.getNumChildren(); ++i)
-                            {
-                                auto note = notesNode.getChild(i);
-                                if (!note.hasType(IDs::NOTE))
-                                    continue;
-                                int ch = (int)note.getProperty(IDs::channel);
-                                note.setProperty(IDs::channel, juce::jmax(0, ch - 1), nullptr);
-                            }
-                            projectTree.setProperty(legacyFixedId, true, nullptr);
+                            note.channel = juce::jmax(0, note.channel - 1);
+                            notes.set(note);
                         }
+                        projectTree.setProperty(legacyFixedId, true, nullptr);
                     }
                 }
 
+                sendNotesChanged({});
+                flushNoteChanges();
+
                 undoManager.clearUndoHistory();
                 currentFile = file;
                 isDirty = false;
@@ -225,7 +275,19 @@ namespace Project
 
     bool ProjectState::saveProject(const juce::File& file)
     {
-        if (auto xml = projectTree.createXml())
+        // Write the notes into a copy, so saving does not disturb the live tree or its listeners
+        auto tree = projectTree.createCopy();
+        auto notesNode = tree.getChildWithName(IDs::NOTES);
+        if (!notesNode.isValid())
+        {
+            notesNode = juce::ValueTree(IDs::NOTES);
+            tree.addChild(notesNode, -1, nullptr);
+        }
+        
+        notes.writeTo(notesNode);
+        tree.setProperty(IDs::version, "1.2.0", nullptr);  // Columnar notes
+        
+        if (auto xml = tree.createXml())
         {
             if (xml->writeTo(file))
             {
@@ -508,125 +570,175 @@ namespace Project
 
     //==============================================================================
     // Note Editing
-    void ProjectState::clearNotes()
+    void ProjectState::performNoteEdit(NoteDiff diff)
     {
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (notesNode.isValid())
-        {
-            undoManager.beginNewTransaction("Clear Notes");
-            notesNode.removeAllChildren(&undoManager);
-        }
+        if (diff.isEmpty())
+            return;
+        
+        // A new transaction has begun: report the previous one before mixing in this one
+        if (undoManager.getNumActionsInCurrentTransaction() == 0)
+            flushNoteChanges();
+        
+        undoManager.perform(new NoteEditCommand(*this, std::move(diff)));
     }
 
-    void ProjectState::addNote(int noteNum, double startBeats, double lengthBeats, int velocity, int channel)
+    void ProjectState::applyNoteDiff(const NoteDiff& diff, bool forwards)
     {
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (notesNode.isValid())
-        {
-            juce::ValueTree note(IDs::NOTE);
-            note.setProperty(IDs::noteNumber, noteNum, nullptr);
-            note.setProperty(IDs::start, startBeats, nullptr);
-            note.setProperty(IDs::length, lengthBeats, nullptr);
-            note.setProperty(IDs::velocity, velocity, nullptr);
-            note.setProperty(IDs::channel, channel, nullptr);
-            
-            // Don't start a transaction here, usually called in batch or by UI that started one
-            notesNode.addChild(note, -1, &undoManager);
-        }
-        else
-        {
-            DBG("ERROR: addNote called but NOTES node is invalid!");
-        }
+        notes.apply(diff, forwards);
+        
+        juce::Array<NoteId> changed;
+        changed.ensureStorageAllocated((int)diff.entries.size());
+        for (const auto& entry : diff.entries)
+            changed.add(entry.getId());
+        
+        sendNotesChanged(changed);
     }
 
-    void ProjectState::deleteNote(const juce::ValueTree& noteNode)
+    void ProjectState::sendNotesChanged(const juce::Array<NoteId>& changedNotes)
     {
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (notesNode.isValid() && noteNode.isAChildOf(notesNode))
-        {
-            notesNode.removeChild(noteNode, &undoManager);
-        }
+        isDirty = true;
+        
+        if (changedNotes.isEmpty())
+            pendingAllNotesChanged = true;
+        else if (!pendingAllNotesChanged)
+            for (auto id : changedNotes)
+                pendingNoteChanges.add(id);
+        
+        triggerAsyncUpdate();
     }
 
-    void ProjectState::deleteNotes(const juce::Array<juce::ValueTree>& noteNodes)
+    void ProjectState::handleAsyncUpdate()
     {
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (!notesNode.isValid()) return;
+        juce::Array<NoteId> changed;
+        if (!pendingAllNotesChanged)
+            changed.addArray(pendingNoteChanges.getRawDataPointer(), pendingNoteChanges.size());
         
-        // Delete in reverse order to avoid index shifting issues
-        for (int i = noteNodes.size() - 1; i >= 0; --i)
-        {
-            const auto& noteNode = noteNodes[i];
-            if (noteNode.isValid() && noteNode.isAChildOf(notesNode))
-            {
-                notesNode.removeChild(noteNode, &undoManager);
-            }
-        }
+        pendingNoteChanges.clear();
+        pendingAllNotesChanged = false;
+        
+        noteListeners.call([&changed](NoteListener& l) { l.notesChanged(changed); });
     }
 
-    void ProjectState::moveNote(juce::ValueTree& noteNode, double newStart, int newNoteNum)
+    NoteDiff ProjectState::removeTrackNotes(int trackIndex) const
     {
-        if (noteNode.isValid())
-        {
-            noteNode.setProperty(IDs::start, newStart, &undoManager);
-            noteNode.setProperty(IDs::noteNumber, newNoteNum, &undoManager);
-        }
+        NoteDiff diff;
+        notes.forEachInTrack(trackIndex, [&diff](const Note& note) { diff.removed(note); });
+        return diff;
     }
 
-    void ProjectState::resizeNote(juce::ValueTree& noteNode, double newLength)
+    void ProjectState::clearNotes()
     {
-        if (noteNode.isValid())
-        {
-            noteNode.setProperty(IDs::length, newLength, &undoManager);
-        }
+        undoManager.beginNewTransaction("Clear Notes");
+        
+        NoteDiff diff;
+        notes.forEach([&diff](const Note& note) { diff.removed(note); });
+        performNoteEdit(std::move(diff));
+    }
+
+    NoteId ProjectState::addNote(int noteNum, double startBeats, double lengthBeats, int velocity, int channel)
+    {
+        Note note;
+        note.id = notes.createId();
+        note.noteNumber = noteNum;
+        note.start = startBeats;
+        note.length = lengthBeats;
+        note.velocity = velocity;
+        note.channel = channel;
+        
+        // Don't start a transaction here, usually called in batch or by UI that started one
+        NoteDiff diff;
+        diff.added(note);
+        performNoteEdit(std::move(diff));
+        return note.id;
     }
 
-    void ProjectState::setNoteVelocity(juce::ValueTree& noteNode, int newVelocity)
+    void ProjectState::addNotes(const std::vector<Note>& newNotes)
     {
-        if (noteNode.isValid())
+        NoteDiff diff;
+        for (auto note : newNotes)
         {
-            noteNode.setProperty(IDs::velocity, newVelocity, &undoManager);
+            note.id = notes.createId();
+            diff.added(note);
         }
+        
+        performNoteEdit(std::move(diff));
     }
 
-    juce::ValueTree ProjectState::copyNotesForTrack(int trackIndex) const
+    void ProjectState::deleteNote(NoteId id)
     {
-        juce::ValueTree snapshot("NOTES_SNAPSHOT");
+        deleteNotes({ id });
+    }
 
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (!notesNode.isValid())
-            return snapshot;
+    void ProjectState::deleteNotes(const juce::Array<NoteId>& ids)
+    {
+        NoteDiff diff;
+        for (auto id : ids)
+            if (notes.contains(id))
+                diff.removed(notes.get(id));
+        
+        performNoteEdit(std::move(diff));
+    }
 
-        for (const auto& note : notesNode)
-        {
-            if (note.hasType(IDs::NOTE) && (int)note.getProperty(IDs::channel) == trackIndex)
-                snapshot.addChild(note.createCopy(), -1, nullptr);
-        }
+    void ProjectState::moveNote(NoteId id, double newStart, int newNoteNum)
+    {
+        if (!notes.contains(id))
+            return;
+        
+        const auto before = notes.get(id);
+        auto after = before;
+        after.start = newStart;
+        after.noteNumber = newNoteNum;
+        
+        NoteDiff diff;
+        diff.changed(before, after);
+        performNoteEdit(std::move(diff));
+    }
 
-        return snapshot;
+    void ProjectState::resizeNote(NoteId id, double newLength)
+    {
+        if (!notes.contains(id))
+            return;
+        
+        const auto before = notes.get(id);
+        auto after = before;
+        after.length = newLength;
+        
+        NoteDiff diff;
+        diff.changed(before, after);
+        performNoteEdit(std::move(diff));
     }
 
-    void ProjectState::restoreNotesForTrack(int trackIndex, const juce::ValueTree& snapshot)
+    void ProjectState::setNoteVelocity(NoteId id, int newVelocity)
     {
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (!notesNode.isValid())
+        if (!notes.contains(id))
             return;
+        
+        const auto before = notes.get(id);
+        auto after = before;
+        after.velocity = newVelocity;
+        
+        NoteDiff diff;
+        diff.changed(before, after);
+        performNoteEdit(std::move(diff));
+    }
+
+    std::vector<Note> ProjectState::copyNotesForTrack(int trackIndex) const
+    {
+        std::vector<Note> snapshot;
+        notes.forEachInTrack(trackIndex, [&snapshot](const Note& note) { snapshot.push_back(note); });
+        return snapshot;
+    }
 
+    void ProjectState::restoreNotesForTrack(int trackIndex, const std::vector<Note>& snapshot)
+    {
         undoManager.beginNewTransaction("Revert Take Comp");
 
-        for (int i = notesNode.getNumChildren() - 1; i >= 0; --i)
-        {
-            auto child = notesNode.getChild(i);
-            if (child.hasType(IDs::NOTE) && (int)child.getProperty(IDs::channel) == trackIndex)
-                notesNode.removeChild(i, &undoManager);
-        }
+        // Snapshot notes keep their ids, so ones that were never replaced come out as unchanged edits
+        auto diff = removeTrackNotes(trackIndex);
+        for (const auto& note : snapshot)
+            diff.added(note);
 
-        for (int i = 0; i < snapshot.getNumChildren(); ++i)
-        {
-            auto child = snapshot.getChild(i);
-            if (child.hasType(IDs::NOTE))
-                notesNode.addChild(child.createCopy(), -1, &undoManager);
-        }
+        performNoteEdit(std::move(diff));
     }
 
     bool ProjectState::replaceNotesForTrackFromMidiFile(int trackIndex, const juce::File& midiFile)
@@ -643,22 +755,10 @@ namespace Project
         int timeFormat = midi.getTimeFormat();
         double ticksPerBeat = (timeFormat > 0) ? (double)timeFormat : 960.0;
 
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (!notesNode.isValid())
-        {
-            lastImportStats = "FAILED: NOTES node missing";
-            return false;
-        }
-
         undoManager.beginNewTransaction("Apply Take Comp");
 
-        // Clear existing notes for this track/channel only.
-        for (int i = notesNode.getNumChildren() - 1; i >= 0; --i)
-        {
-            auto child = notesNode.getChild(i);
-            if (child.hasType(IDs::NOTE) && (int)child.getProperty(IDs::channel) == trackIndex)
-                notesNode.removeChild(i, &undoManager);
-        }
+        // Clear existing notes for this track/channel only, in the same diff as the new ones.
+        auto diff = removeTrackNotes(trackIndex);
 
         int totalNotesAdded = 0;
 
@@ -679,18 +779,21 @@ namespace Project
                     if (auto* noteOff = ev->noteOffObject)
                         length = (noteOff->message.getTimeStamp() - ev->message.getTimeStamp()) / ticksPerBeat;
 
-                    addNote(
-                        ev->message.getNoteNumber(),
-                        start,
-                        juce::jmax(0.0, length),
-                        ev->message.getVelocity(),
-                        trackIndex
-                    );
+                    Note note;
+                    note.id = notes.createId();
+                    note.noteNumber = ev->message.getNoteNumber();
+                    note.start = start;
+                    note.length = juce::jmax(0.0, length);
+                    note.velocity = ev->message.getVelocity();
+                    note.channel = trackIndex;
+                    diff.added(note);
                     totalNotesAdded++;
                 }
             }
         }
 
+        performNoteEdit(std::move(diff));
+
         lastImportStats = "Applied take comp: " + juce::String(totalNotesAdded) + " notes to track " + juce::String(trackIndex);
         return true;
     }
@@ -721,7 +824,8 @@ namespace Project
                 }
             }
             
-            auto notesNode = projectTree.getChildWithName(IDs::NOTES);
+            // Collected first and added as one diff
+            std::vector<Note> importedNotes;
             int totalNotesAdded = 0;
             
             // Use MidiMessageSequence to pair notes
@@ -787,17 +891,21 @@ namespace Project
                         if (auto* noteOff = ev->noteOffObject)
                             length = (noteOff->message.getTimeStamp() - ev->message.getTimeStamp()) / ticksPerBeat;
                             
-                        addNote(ev->message.getNoteNumber(), 
-                                start, 
-                                length, 
-                                ev->message.getVelocity(), 
-                                t); // Use track index 't' as channel/track ID
+                        Note note;
+                        note.noteNumber = ev->message.getNoteNumber();
+                        note.start = start;
+                        note.length = length;
+                        note.velocity = ev->message.getVelocity();
+                        note.channel = t; // Use track index 't' as channel/track ID
+                        importedNotes.push_back(note);
                         totalNotesAdded++;
                         trackNoteCount++;
                     }
                 }
             }
             
+            addNotes(importedNotes);
+            
             // Store stats for debug display
             lastImportStats = "Imported " + juce::String(totalNotesAdded) + " notes from " + 
                              juce::String(midi.getNumTracks()) + " tracks";
@@ -815,35 +923,19 @@ namespace Project
         
         juce::MidiMessageSequence seq;
         
-        auto notesNode = projectTree.getChildWithName(IDs::NOTES);
-        if (notesNode.isValid())
+        notes.forEach([&seq](const Note& note)
         {
-            for (const auto& note : notesNode)
-            {
-                if (note.hasType(IDs::NOTE))
-                {
-                    int noteNum = note.getProperty(IDs::noteNumber);
-                    double start = note.getProperty(IDs::start);
-                    double length = note.getProperty(IDs::length);
-                    int vel = note.getProperty(IDs::velocity);
-                    // IDs::channel is a 0-based track index in our model.
-                    // JUCE MIDI channels are 1..16, and MidiPlayer maps (channel - 1) back to track index.
-                    int trackIndex = (int) note.getProperty(IDs::channel);
-                    int ch = juce::jlimit(1, 16, trackIndex + 1);
-                    
-                    // Convert beats to ticks
-                    // juce::MidiFile expects ticks if we don't use setTicksPerQuarterNote?
-                    // Actually, if we use addEvent with timestamp, we need to know the unit.
-                    // If we setTicksPerQuarterNote(960), then timestamp 960 = 1 beat.
-                    
-                    int startTicks = (int)(start * 960.0);
-                    int endTicks = (int)((start + length) * 960.0);
-                    
-                    seq.addEvent(juce::MidiMessage::noteOn(ch, noteNum, (juce::uint8)vel), startTicks);
-                    seq.addEvent(juce::MidiMessage::noteOff(ch, noteNum), endTicks);
-                }
-            }
-        }
+            // Note::channel is a 0-based track index in our model.
+            // JUCE MIDI channels are 1..16, and MidiPlayer maps (channel - 1) back to track index.
+            int ch = juce::jlimit(1, 16, note.channel + 1);
+            
+            // Convert beats to ticks (setTicksPerQuarterNote(960): timestamp 960 = 1 beat)
+            int startTicks = (int)(note.start * 960.0);
+            int endTicks = (int)(note.getEnd() * 960.0);
+            
+            seq.addEvent(juce::MidiMessage::noteOn(ch, note.noteNumber, (juce::uint8)note.velocity), startTicks);
+            seq.addEvent(juce::MidiMessage::noteOff(ch, note.noteNumber), endTicks);
+        });
         
         seq.sort();
         midi.addTrack(seq);
@@ -899,6 +991,12 @@ namespace Project
                     fxNode.setProperty(IDs::parameters, juce::JSON::toString(juce::var(paramsObj)), nullptr);
                 }
                 
+                // Automation lanes, also as a JSON string
+                if (auto* automationObj = fxVar.getProperty("automation", juce::var()).getDynamicObject())
+                {
+                    fxNode.setProperty(IDs::automation, juce::JSON::toString(juce::var(automationObj)), nullptr);
+                }
+                
                 busNode.addChild(fxNode, -1, &undoManager);
             }
         }
@@ -933,6 +1031,12 @@ namespace Project
                             fxObj->setProperty("parameters", juce::JSON::parse(paramsStr));
                         }
                         
+                        juce::String automationStr = fxNode.getProperty(IDs::automation).toString();
+                        if (automationStr.isNotEmpty())
+                        {
+                            fxObj->setProperty("automation", juce::JSON::parse(automationStr));
+                        }
+                        
                         chainArray.add(juce::var(fxObj));
                     }
                 }
@@ -15,6 +15,10 @@
 #include <juce_data_structures/juce_data_structures.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 
+#include "NoteStore.h"
+
+#include <vector>
+
 namespace Project
 {
     //==============================================================================
@@ -36,10 +40,13 @@ namespace Project
         static const juce::Identifier displayName("displayName");
         static const juce::Identifier enabled("enabled");
         static const juce::Identifier parameters("parameters");
+        static const juce::Identifier automation("automation");   // JSON: { param: [[seconds, value], ...] }
         
-        // Note Data
+        // Note Data (NOTE is the per-note node of projects before 1.2.0)
         static const juce::Identifier NOTES("NOTES");
         static const juce::Identifier NOTE("NOTE");
+        static const juce::Identifier NOTE_COLUMNS("NOTE_COLUMNS");
+        static const juce::Identifier count("count");
         static const juce::Identifier noteNumber("n");
         static const juce::Identifier velocity("v");
         static const juce::Identifier start("s");
@@ -83,9 +90,23 @@ namespace Project
     }
 
     //==============================================================================
-    class ProjectState : public juce::ValueTree::Listener
+    class ProjectState : public juce::ValueTree::Listener,
+                         private juce::AsyncUpdater
     {
     public:
+        //==============================================================================
+        /** Told about note edits, including undo/redo: once per undo transaction,
+            asynchronously, with every note the transaction touched. */
+        class NoteListener
+        {
+        public:
+            virtual ~NoteListener() = default;
+
+            /** @param changedNotes Ids of the notes added, removed or modified, each once.
+                                    Empty when every note may have changed (new project, load). */
+            virtual void notesChanged(const juce::Array<NoteId>& changedNotes) = 0;
+        };
+
         ProjectState();
         ~ProjectState() override;
 
@@ -123,6 +144,13 @@ namespace Project
         // loadProject() swapping the underlying ValueTree.
         void addStateListener(juce::ValueTree::Listener* listener);
         void removeStateListener(juce::ValueTree::Listener* listener);
+
+        // Notes are not part of the ValueTree; edits are announced here instead
+        void addNoteListener(NoteListener* listener) { noteListeners.add(listener); }
+        void removeNoteListener(NoteListener* listener) { noteListeners.remove(listener); }
+
+        /** Deliver pending note notifications now rather than on the next message loop. */
+        void flushNoteChanges() { handleUpdateNowIfNeeded(); }
         
         // Generation Data
         void setGenerationData(const juce::String& prompt, int bpm, const juce::String& key, const juce::String& genre);
@@ -140,17 +168,21 @@ namespace Project
 
         //==============================================================================
         // Note Editing
+        // Each call is recorded as a compact diff in the current undo transaction;
+        // calls within one transaction merge into a single diff.
+        const NoteStore& getNotes() const { return notes; }
         void clearNotes();
-        void addNote(int noteNum, double startBeats, double lengthBeats, int velocity, int channel);
-        void deleteNote(const juce::ValueTree& noteNode);
-        void deleteNotes(const juce::Array<juce::ValueTree>& noteNodes);  // Batch delete
-        void moveNote(juce::ValueTree& noteNode, double newStart, int newNoteNum);
-        void resizeNote(juce::ValueTree& noteNode, double newLength);
-        void setNoteVelocity(juce::ValueTree& noteNode, int newVelocity);
+        NoteId addNote(int noteNum, double startBeats, double lengthBeats, int velocity, int channel);
+        void addNotes(const std::vector<Note>& newNotes);  // Batch add; ids are assigned here
+        void deleteNote(NoteId id);
+        void deleteNotes(const juce::Array<NoteId>& ids);  // Batch delete
+        void moveNote(NoteId id, double newStart, int newNoteNum);
+        void resizeNote(NoteId id, double newLength);
+        void setNoteVelocity(NoteId id, int newVelocity);
 
         // Track-scoped Note Utilities (for take comping)
-        juce::ValueTree copyNotesForTrack(int trackIndex) const;
-        void restoreNotesForTrack(int trackIndex, const juce::ValueTree& snapshot);
+        std::vector<Note> copyNotesForTrack(int trackIndex) const;
+        void restoreNotesForTrack(int trackIndex, const std::vector<Note>& snapshot);
         bool replaceNotesForTrackFromMidiFile(int trackIndex, const juce::File& midiFile);
         
         // Import/Export
@@ -196,8 +228,14 @@ namespace Project
         void valueTreeParentChanged(juce::ValueTree& treeWhoseParentHasChanged) override;
 
     private:
+        friend class NoteEditCommand;
+
         juce::ValueTree projectTree;
         juce::UndoManager undoManager;
+        NoteStore notes;
+        juce::ListenerList<NoteListener> noteListeners;
+        juce::SortedSet<NoteId> pendingNoteChanges;    // Since the last notification
+        bool pendingAllNotesChanged = false;
         juce::File currentFile;
         juce::String lastImportStats;  // Debug: stores last import result
         bool isDirty = false;
@@ -206,6 +244,20 @@ namespace Project
 
         void createDefaultProject();
         void ensureTrackDefaults(juce::ValueTree& trackNode);
+
+        /** Apply a diff through the undo manager. Notifications still pending from an
+            earlier transaction are sent first, so each transaction is reported on its own. */
+        void performNoteEdit(NoteDiff diff);
+
+        /** Redo (forwards) or undo a diff and queue its ids for the note listeners. */
+        void applyNoteDiff(const NoteDiff& diff, bool forwards);
+
+        /** Diff that removes every note of one track. */
+        NoteDiff removeTrackNotes(int trackIndex) const;
+
+        /** Queue a notification; an empty array means every note. */
+        void sendNotesChanged(const juce::Array<NoteId>& changedNotes);
+        void handleAsyncUpdate() override;
         
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ProjectState)
     };
@@ -28,6 +28,7 @@ struct FXUnit
     bool enabled = true;
     
     std::map<juce::String, float> parameters;
+    juce::var automation;     // { param: [[seconds, value], ...] }, passed through to the mixer
     
     /** Parse from JSON */
     static FXUnit fromJSON(const juce::var& json)
@@ -44,6 +45,9 @@ struct FXUnit
                 fx.parameters[prop.name.toString()] = static_cast<float>(prop.value);
         }
         
+        if (json.getProperty("automation", juce::var()).getDynamicObject() != nullptr)
+            fx.automation = json.getProperty("automation", juce::var()).clone();
+        
         return fx;
     }
     
@@ -61,6 +65,10 @@ struct FXUnit
             paramsObj->setProperty(juce::Identifier(key), value);
         
         obj->setProperty("parameters", juce::var(paramsObj));
+        
+        if (automation.getDynamicObject() != nullptr)
+            obj->setProperty("automation", automation);
+        
         return juce::var(obj);
     }
 };
@@ -9,9 +9,9 @@ namespace UI
         scopeNoticeLabel.setFont(juce::Font(11.0f));
         scopeNoticeLabel.setColour(juce::Label::textColourId, AppColours::textSecondary.withAlpha(0.9f));
         scopeNoticeLabel.setJustificationType(juce::Justification::centredLeft);
-        scopeNoticeLabel.setText("Scope: FX chain affects backend/offline render parity; live MIDI preview stays dry/unmastered.",
+        scopeNoticeLabel.setText("Scope: FX chain applies to live MIDI preview and backend/offline render; mastering stays backend-only.",
                                  juce::dontSendNotification);
-        scopeNoticeLabel.setTooltip("Mixer and FX settings target backend/offline render parity. Live MIDI preview remains dry/unmastered with no live mastering path in this build.");
+        scopeNoticeLabel.setTooltip("Mixer pan/width and FX chains are processed live and mirrored to the backend for offline render parity. Live MIDI preview has no mastering path in this build.");
         addAndMakeVisible(scopeNoticeLabel);
 
         addAndMakeVisible(viewport);
@@ -657,6 +657,8 @@ void RecentFilesPanel::exportToWav()
                             juce::MessageBoxIconType::InfoIcon,
                             "Export Complete",
                             "Successfully exported to:\n\n" + destFile.getFullPathName()
+                                + "\n\nRendered at " + juce::String(audioEngine.getLastRenderStats().realtimeFactor, 1)
+                                + "x realtime"
                         );
                         
                         // Optionally reveal in explorer
@@ -203,22 +203,9 @@ void ArrangementView::zoomToShowFullSong()
         return;
     
     // Find total duration from all notes
-    double maxTime = 0.0;
-    auto notesNode = projectState->getState().getChildWithName(Project::IDs::NOTES);
-    if (notesNode.isValid())
-    {
-        double bpm = projectState->getState().getProperty(Project::IDs::bpm, 120.0);
-        double secondsPerBeat = 60.0 / bpm;
-        
-        for (int i = 0; i < notesNode.getNumChildren(); ++i)
-        {
-            auto noteNode = notesNode.getChild(i);
-            double startBeats = noteNode.getProperty(Project::IDs::start);
-            double lengthBeats = noteNode.getProperty(Project::IDs::length);
-            double endTime = (startBeats + lengthBeats) * secondsPerBeat;
-            maxTime = juce::jmax(maxTime, endTime);
-        }
-    }
+    double bpm = projectState->getState().getProperty(Project::IDs::bpm, 120.0);
+    double secondsPerBeat = 60.0 / bpm;
+    double maxTime = projectState->getNotes().getEndBeats() * secondsPerBeat;
     
     // Add some padding (10%)
     maxTime *= 1.1;
@@ -266,9 +253,7 @@ void ArrangementView::paint(juce::Graphics& g)
     // Debug: Show total notes in ProjectState
     if (projectState)
     {
-        auto notesNode = projectState->getState().getChildWithName(Project::IDs::NOTES);
-        int totalNotes = notesNode.isValid() ? notesNode.getNumChildren() : -1;
-        juce::String nodeStatus = notesNode.isValid() ? "valid" : "INVALID";
+        int totalNotes = projectState->getNotes().size();
         
         // Show notes count and last import stats
         g.setColour(juce::Colours::yellow);
@@ -140,7 +140,7 @@ void TransportComponent::setupSliders()
     
     // Load MIDI button (for testing MIDI playback)
     loadMidiButton.setColour(juce::TextButton::buttonColourId, AppColours::primary);
-    loadMidiButton.setTooltip("Load a MIDI file for dry/unmastered preview only (no live FX/mastering).");
+    loadMidiButton.setTooltip("Load a MIDI file for unmastered preview (live FX chain, no mastering).");
     loadMidiButton.onClick = [this] {
         // Open file chooser for MIDI files
         auto chooser = std::make_shared<juce::FileChooser>(
@@ -161,8 +161,8 @@ void TransportComponent::setupSliders()
                         currentPosition = 0.0;
                         updateTimeDisplay();
                         updateButtonStates();
-                        setStatusText("Loaded dry/unmastered MIDI preview: " + file.getFileName()
-                                          + " (no live FX/mastering)",
+                        setStatusText("Loaded unmastered MIDI preview: " + file.getFileName()
+                                          + " (live FX, no mastering)",
                                       AppColours::success);
                         
                         // Disable test tone when loading MIDI
@@ -245,7 +245,7 @@ void TransportComponent::setStatusText(const juce::String& text, juce::Colour co
 
 juce::String TransportComponent::getCapabilityHelperText() const
 {
-    return "Scope: backend WAV/reference = mastered offline | live MIDI = dry/no live FX/mastering | external audio = generic reference";
+    return "Scope: backend WAV/reference = mastered offline | live MIDI = live FX, no mastering | external audio = generic reference";
 }
 
 juce::String TransportComponent::buildStatusTooltip(const juce::String& status) const
@@ -253,7 +253,7 @@ juce::String TransportComponent::buildStatusTooltip(const juce::String& status)
     return status
         + "\n\nPlayback scope:\n"
         + "- Backend-generated WAV/reference = mastered offline path\n"
-        + "- Live MIDI preview = dry/unmastered with no live FX/mastering\n"
+        + "- Live MIDI preview = live FX chain, unmastered\n"
         + "- External loaded audio = generic audio file/reference unless provenance is known";
 }
 
@@ -410,9 +410,9 @@ void TransportComponent::playClicked()
     
     setStatusText(juce::String(hasLoadedAudio
                                    ? "Playing loaded audio file/reference... (dur: "
-                                   : "Playing dry/unmastered MIDI preview... (dur: ")
+                                   : "Playing unmastered MIDI preview... (dur: ")
                       + juce::String(duration, 1)
-                      + (hasLoadedAudio ? "s)" : "s, no live FX/mastering)"),
+                      + (hasLoadedAudio ? "s)" : "s, live FX, no mastering)"),
                   AppColours::success);
     
     listeners.call(&TransportComponent::Listener::transportPlayRequested);
@@ -461,8 +461,8 @@ void TransportComponent::onGenerationCompleted(const juce::File& outputFile)
         const juce::String readyStatus = outputIsAudio
             ? "Ready backend mastered reference: " + outputFile.getFileName()
             : (outputIsMidi
-                   ? "Ready dry/unmastered MIDI preview/fallback: " + outputFile.getFileName()
-                         + " (no live FX/mastering)"
+                   ? "Ready unmastered MIDI preview/fallback: " + outputFile.getFileName()
+                         + " (live FX, no mastering)"
                    : "Ready: " + outputFile.getFileName());
         setStatusText(readyStatus, AppColours::success);
         
@@ -560,7 +560,7 @@ void TransportComponent::timerCallback()
         // Show detailed playback debug status with honest mastering-path labeling.
         setStatusText(juce::String(hasLoadedAudio
                                        ? "Playing loaded audio file/reference: "
-                                       : "Playing dry/unmastered MIDI preview (no live FX/mastering): ")
+                                       : "Playing unmastered MIDI preview (live FX, no mastering): ")
                           + audioEngine.getPlaybackDebugStatus(),
                       AppColours::success);
     }
@@ -582,7 +582,7 @@ void TransportComponent::timerCallback()
         {
             setStatusText("Dry/unmastered MIDI preview loaded: "
                               + juce::String(audioEngine.getTotalDuration(), 1)
-                              + "s (no live FX/mastering)",
+                              + "s (live FX, no mastering)",
                           AppColours::success);
         }
     }
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    NoteIntervalIndex.cpp
+
+    Time-bucketed index of the piano roll's cached notes.
+
+  ==============================================================================
+*/
+
+#include "NoteIntervalIndex.h"
+
+#include <algorithm>
+
+//==============================================================================
+void NoteIntervalIndex::reset(double newBucketSeconds)
+{
+    tracks.clear();
+    bucketSeconds = newBucketSeconds > 0.0 ? newBucketSeconds : 2.0;
+}
+
+int NoteIntervalIndex::getBucket(double time) const
+{
+    return time > 0.0 ? (int)(time / bucketSeconds) : 0;
+}
+
+void NoteIntervalIndex::add(int noteIndex, int trackIndex, double startTime, double endTime, int noteNumber)
+{
+    auto& track = tracks[trackIndex];
+    const int firstBucket = getBucket(startTime);
+    const int lastBucket = juce::jmax(firstBucket, getBucket(endTime));
+
+    if ((int)track.buckets.size() <= lastBucket)
+        track.buckets.resize((size_t)lastBucket + 1);
+
+    for (int b = firstBucket; b <= lastBucket; ++b)
+        track.buckets[(size_t)b].push_back({ noteIndex, firstBucket });
+
+    ++track.notesPerPitch[(size_t)juce::jlimit(0, 127, noteNumber)];
+    ++track.numNotes;
+}
+
+void NoteIntervalIndex::remove(int noteIndex, int trackIndex, double startTime, double endTime, int noteNumber)
+{
+    const auto found = tracks.find(trackIndex);
+    if (found == tracks.end())
+    {
+        jassertfalse;   // Removed with timing it was never added with
+        return;
+    }
+
+    auto& track = found->second;
+    const int firstBucket = getBucket(startTime);
+    const int lastBucket = juce::jmin(juce::jmax(firstBucket, getBucket(endTime)), (int)track.buckets.size() - 1);
+
+    for (int b = firstBucket; b <= lastBucket; ++b)
+    {
+        auto& bucket = track.buckets[(size_t)b];
+        const auto entry = std::find_if(bucket.begin(), bucket.end(),
+                                        [noteIndex](const Entry& e) { return e.noteIndex == noteIndex; });
+        if (entry != bucket.end())
+        {
+            *entry = bucket.back();
+            bucket.pop_back();
+        }
+    }
+
+    --track.notesPerPitch[(size_t)juce::jlimit(0, 127, noteNumber)];
+
+    if (--track.numNotes <= 0)
+        tracks.erase(found);
+}
+
+//==============================================================================
+juce::Array<int> NoteIntervalIndex::getTracks() const
+{
+    juce::Array<int> result;
+    for (const auto& track : tracks)
+        result.add(track.first);
+
+    return result;
+}
+
+bool NoteIntervalIndex::getNoteRange(int trackIndex, int& lowestNote, int& highestNote) const
+{
+    lowestNote = 128;
+    highestNote = -1;
+
+    for (const auto& [index, track] : tracks)
+    {
+        if (trackIndex >= 0 && index != trackIndex)
+            continue;
+
+        for (int pitch = 0; pitch < 128; ++pitch)
+        {
+            if (track.notesPerPitch[(size_t)pitch] > 0)
+            {
+                lowestNote = juce::jmin(lowestNote, pitch);
+                highestNote = juce::jmax(highestNote, pitch);
+            }
+        }
+    }
+
+    return lowestNote <= highestNote;
+}
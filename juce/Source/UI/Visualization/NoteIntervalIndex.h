@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    NoteIntervalIndex.h
+
+    Time-bucketed index of the piano roll's cached notes, per track.
+    Lets painting, hit-testing and rubber-band selection visit only the
+    notes near a time range instead of every note in the arrangement.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <map>
+#include <vector>
+
+//==============================================================================
+/**
+    Maps time ranges to note indices (positions in the owner's note array).
+
+    Each track keeps one bucket per bar; a note is listed in every bucket it
+    overlaps, so a query only walks the buckets it covers. The owner keeps it
+    in step with its array: add() on insert, remove() with the note's old
+    timing before a note moves or its index changes.
+
+    Message thread only.
+*/
+class NoteIntervalIndex
+{
+public:
+    NoteIntervalIndex() = default;
+
+    /** Drop everything and use buckets of this length (normally one bar). */
+    void reset(double newBucketSeconds);
+
+    void add(int noteIndex, int trackIndex, double startTime, double endTime, int noteNumber);
+    void remove(int noteIndex, int trackIndex, double startTime, double endTime, int noteNumber);
+
+    /** Tracks holding at least one note, in ascending order. */
+    juce::Array<int> getTracks() const;
+
+    /** Lowest and highest note number on a track (or on every track if trackIndex < 0).
+        @returns false if there are no notes */
+    bool getNoteRange(int trackIndex, int& lowestNote, int& highestNote) const;
+
+    /** Call fn(int noteIndex) once for each note of the track that may overlap
+        [startTime, endTime]. Notes in nearby buckets are included, so callers
+        still test the exact bounds. */
+    template <typename Function>
+    void forEachInRange(int trackIndex, double startTime, double endTime, Function&& fn) const
+    {
+        const auto found = tracks.find(trackIndex);
+        if (found == tracks.end() || endTime < startTime)
+            return;
+
+        const auto& buckets = found->second.buckets;
+        const int firstBucket = getBucket(startTime);
+        const int lastBucket = juce::jmin(getBucket(endTime), (int)buckets.size() - 1);
+
+        for (int b = firstBucket; b <= lastBucket; ++b)
+        {
+            for (const auto& entry : buckets[(size_t)b])
+            {
+                // A note spanning several buckets is reported from the first one the query covers
+                if (juce::jmax(entry.firstBucket, firstBucket) == b)
+                    fn(entry.noteIndex);
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        int noteIndex = 0;
+        int firstBucket = 0;
+    };
+
+    struct Track
+    {
+        std::vector<std::vector<Entry>> buckets;
+        std::array<int, 128> notesPerPitch {};
+        int numNotes = 0;
+    };
+
+    int getBucket(double time) const;
+
+    std::map<int, Track> tracks;
+    double bucketSeconds = 2.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(NoteIntervalIndex)
+};
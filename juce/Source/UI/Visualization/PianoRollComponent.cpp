@@ -40,7 +40,7 @@ PianoRollComponent::PianoRollComponent(mmg::AudioEngine& engine)
         if (soloedTrack >= 0)
             lastAuditionTrackIndex = soloedTrack;
         listeners.call(&PianoRollComponent::Listener::pianoRollSoloTrackChanged, soloedTrack);
-        repaint(); 
+        repaintNotes();
     };
     
     DBG("PianoRollComponent created");
@@ -49,7 +49,7 @@ PianoRollComponent::PianoRollComponent(mmg::AudioEngine& engine)
 PianoRollComponent::~PianoRollComponent()
 {
     if (projectState)
-        projectState->removeStateListener(this);
+        projectState->removeNoteListener(this);
         
     audioEngine.removeListener(this);
     stopTimer();
@@ -59,13 +59,13 @@ PianoRollComponent::~PianoRollComponent()
 void PianoRollComponent::setProjectState(Project::ProjectState* state)
 {
     if (projectState)
-        projectState->removeStateListener(this);
+        projectState->removeNoteListener(this);
         
     projectState = state;
     
     if (projectState)
     {
-        projectState->addStateListener(this);
+        projectState->addNoteListener(this);
         syncNotesFromState();
     }
 }
@@ -75,16 +75,16 @@ void PianoRollComponent::syncNotesFromState()
     if (!projectState)
         return;
     
+    // The hovered note is about to move in memory; find it again afterwards
+    const auto hoveredId = hoveredNote != nullptr ? hoveredNote->noteId : 0;
+    hoveredNote = nullptr;
+    
     notes.clear();
+    noteIndices.clear();
+    timeIndex.reset(4.0 * getSecondsPerBeat());
     // Do NOT clear selection here, as it breaks drag operations.
     // Instead, we validate selection at the end.
     
-    auto notesNode = projectState->getState().getChildWithName(Project::IDs::NOTES);
-    if (!notesNode.isValid())
-        return;
-    
-    double secondsPerBeat = 60.0 / currentBPM;
-    
     int maxTrackIndex = 0;
     
     // Also count tracks from mixer node to ensure all tracks show in dropdown
@@ -101,33 +101,25 @@ void PianoRollComponent::syncNotesFromState()
         }
     }
     
-    for (const auto& child : notesNode)
+    const auto& store = projectState->getNotes();
+    notes.ensureStorageAllocated(store.size());
+    
+    store.forEach([&](const Project::Note& stored)
     {
-        if (child.hasType(Project::IDs::NOTE))
-        {
-            MidiNoteEvent note;
-            note.noteNumber = child.getProperty(Project::IDs::noteNumber);
-            note.velocity = child.getProperty(Project::IDs::velocity);
-            note.channel = child.getProperty(Project::IDs::channel); // This is actually track index in our model
-            
-            double startBeats = child.getProperty(Project::IDs::start);
-            double lengthBeats = child.getProperty(Project::IDs::length);
-            
-            note.startTime = startBeats * secondsPerBeat;
-            note.endTime = (startBeats + lengthBeats) * secondsPerBeat;
-            note.trackIndex = note.channel; // Use channel as track index
-            note.stateNode = child;
-            
-            notes.add(note);
-            totalDuration = juce::jmax(totalDuration, note.endTime);
-            maxTrackIndex = juce::jmax(maxTrackIndex, note.trackIndex);
-        }
-    }
+        MidiNoteEvent note;
+        applyStoredNote(note, stored);
+        addCachedNote(note);
+        
+        totalDuration = juce::jmax(totalDuration, note.endTime);
+        maxTrackIndex = juce::jmax(maxTrackIndex, note.trackIndex);
+    });
+    
+    hoveredNote = findNote(hoveredId);
     
-    // Validate selection - remove nodes that no longer exist
+    // Validate selection - remove notes that no longer exist
     for (int i = selectedNotes.size() - 1; i >= 0; --i)
     {
-        if (!selectedNotes[i].isValid() || !selectedNotes[i].getParent().isValid())
+        if (!store.contains(selectedNotes[i]))
             selectedNotes.remove(i);
     }
     
@@ -146,7 +138,154 @@ void PianoRollComponent::syncNotesFromState()
         hasInitialZoom = true;
     }
     
-    repaint();
+    repaintNotes();
+}
+
+void PianoRollComponent::patchNotesFromState(const juce::Array<Project::NoteId>& changedNotes)
+{
+    if (!projectState)
+        return;
+    
+    // Adding may reallocate and removing swaps rows, so track the hovered note by id
+    const auto hoveredId = hoveredNote != nullptr ? hoveredNote->noteId : 0;
+    hoveredNote = nullptr;
+    
+    const auto& store = projectState->getNotes();
+    int maxTrackIndex = trackColors.size() - 1;
+    
+    for (auto id : changedNotes)
+    {
+        const auto found = noteIndices.find(id);
+        
+        if (!store.contains(id))
+        {
+            if (found == noteIndices.end())
+                continue;
+            
+            removeCachedNote(found->second);
+            selectedNotes.removeFirstMatchingValue(id);
+            continue;
+        }
+        
+        const auto stored = store.get(id);
+        
+        if (found != noteIndices.end())
+        {
+            updateCachedNote(found->second, stored);
+        }
+        else
+        {
+            MidiNoteEvent note;
+            applyStoredNote(note, stored);
+            addCachedNote(note);
+        }
+        
+        totalDuration = juce::jmax(totalDuration, stored.getEnd() * getSecondsPerBeat());
+        maxTrackIndex = juce::jmax(maxTrackIndex, stored.channel);
+    }
+    
+    hoveredNote = findNote(hoveredId);
+    
+    // A note landed on a track we have not seen yet
+    if (maxTrackIndex >= trackColors.size())
+    {
+        assignTrackColors(maxTrackIndex + 1);
+        updateTrackList();
+    }
+    
+    // As in syncNotesFromState: a freshly loaded file still gets its initial zoom
+    if (embeddedMode && !hasInitialZoom)
+    {
+        zoomToFit();
+        hasInitialZoom = true;
+    }
+    
+    repaintNotes();
+}
+
+void PianoRollComponent::applyStoredNote(MidiNoteEvent& target, const Project::Note& stored) const
+{
+    const double secondsPerBeat = getSecondsPerBeat();
+    
+    target.noteNumber = stored.noteNumber;
+    target.velocity = stored.velocity;
+    target.channel = stored.channel; // This is actually track index in our model
+    target.startTime = stored.start * secondsPerBeat;
+    target.endTime = stored.getEnd() * secondsPerBeat;
+    target.trackIndex = stored.channel; // Use channel as track index
+    target.noteId = stored.id;
+}
+
+void PianoRollComponent::addCachedNote(const MidiNoteEvent& note)
+{
+    const int index = notes.size();
+    notes.add(note);
+    
+    if (note.noteId != 0)
+        noteIndices[note.noteId] = index;
+    
+    timeIndex.add(index, note.trackIndex, note.startTime, note.endTime, note.noteNumber);
+}
+
+void PianoRollComponent::removeCachedNote(int index)
+{
+    const auto& note = notes.getReference(index);
+    timeIndex.remove(index, note.trackIndex, note.startTime, note.endTime, note.noteNumber);
+    noteIndices.erase(note.noteId);
+    
+    // Swap the last note into the hole
+    const int last = notes.size() - 1;
+    if (index != last)
+    {
+        const auto& moved = notes.getReference(last);
+        timeIndex.remove(last, moved.trackIndex, moved.startTime, moved.endTime, moved.noteNumber);
+        timeIndex.add(index, moved.trackIndex, moved.startTime, moved.endTime, moved.noteNumber);
+        
+        if (moved.noteId != 0)
+            noteIndices[moved.noteId] = index;
+        
+        notes.swap(index, last);
+    }
+    
+    notes.removeLast();
+}
+
+void PianoRollComponent::updateCachedNote(int index, const Project::Note& stored)
+{
+    auto& note = notes.getReference(index);
+    timeIndex.remove(index, note.trackIndex, note.startTime, note.endTime, note.noteNumber);
+    applyStoredNote(note, stored);
+    timeIndex.add(index, note.trackIndex, note.startTime, note.endTime, note.noteNumber);
+}
+
+void PianoRollComponent::rebuildTimeIndex()
+{
+    timeIndex.reset(4.0 * getSecondsPerBeat());   // One bucket per 4/4 bar
+    
+    for (int i = 0; i < notes.size(); ++i)
+    {
+        const auto& note = notes.getReference(i);
+        timeIndex.add(i, note.trackIndex, note.startTime, note.endTime, note.noteNumber);
+    }
+}
+
+juce::Array<int> PianoRollComponent::getShownTracks() const
+{
+    if (soloedTrack >= 0)
+        return { soloedTrack };
+    
+    auto tracks = timeIndex.getTracks();
+    tracks.removeIf([this](int track) { return !isTrackVisible(track); });
+    return tracks;
+}
+
+MidiNoteEvent* PianoRollComponent::findNote(Project::NoteId id)
+{
+    if (id == 0)
+        return nullptr;
+    
+    const auto found = noteIndices.find(id);
+    return found != noteIndices.end() ? &notes.getReference(found->second) : nullptr;
 }
 
 //==============================================================================
@@ -163,9 +302,8 @@ void PianoRollComponent::loadMidiFile(const juce::File& midiFile)
         DBG("  Calling projectState->importMidiFile...");
         projectState->importMidiFile(midiFile);
         DBG("  Import complete, checking notes...");
-        auto notesNode = projectState->getState().getChildWithName(Project::IDs::NOTES);
-        DBG("  NOTES node has " << notesNode.getNumChildren() << " children after import");
-        // syncNotesFromState will be called via listener callback
+        DBG("  Project has " << projectState->getNotes().size() << " notes after import");
+        // The notes arrive through notesChanged once the import's transaction is reported
     }
     else
     {
@@ -187,6 +325,8 @@ void PianoRollComponent::setMidiData(const juce::MidiFile& midiFile)
 {
     // This is the legacy visualization-only path
     notes.clear();
+    noteIndices.clear();
+    hoveredNote = nullptr;
     juce::MidiFile midiCopy = midiFile;
     midiCopy.convertTimestampTicksToSeconds();
     
@@ -234,9 +374,10 @@ void PianoRollComponent::setMidiData(const juce::MidiFile& midiFile)
     }
     
     totalDuration = juce::jmax(totalDuration, 1.0);
+    rebuildTimeIndex();
     assignTrackColors(numTracks);
     zoomToFit();
-    repaint();
+    repaintNotes();
 }
 
 void PianoRollComponent::clearNotes()
@@ -244,9 +385,14 @@ void PianoRollComponent::clearNotes()
     if (projectState)
         projectState->clearNotes();
     else
+    {
         notes.clear();
+        noteIndices.clear();
+        timeIndex.reset(4.0 * getSecondsPerBeat());
+        hoveredNote = nullptr;
+    }
         
-    repaint();
+    repaintNotes();
 }
 
 void PianoRollComponent::setBPM(int bpm)
@@ -313,18 +459,9 @@ void PianoRollComponent::zoomToFit()
         hZoom = juce::jlimit(0.1f, 10.0f, targetPixelsPerSecond / 100.0f);
     }
     
+    // When soloed to a track, only consider notes from that track
     int minNoteFound = 127, maxNoteFound = 0;
-    for (const auto& note : notes)
-    {
-        // When soloed to a track, only consider notes from that track
-        if (soloedTrack >= 0 && note.trackIndex != soloedTrack)
-            continue;
-            
-        minNoteFound = juce::jmin(minNoteFound, note.noteNumber);
-        maxNoteFound = juce::jmax(maxNoteFound, note.noteNumber);
-    }
-    
-    if (minNoteFound <= maxNoteFound)
+    if (timeIndex.getNoteRange(soloedTrack, minNoteFound, maxNoteFound))
     {
         scrollY = (minNoteFound + maxNoteFound) / 2;
         
@@ -349,7 +486,7 @@ void PianoRollComponent::setTrackVisible(int trackIndex, bool visible)
     if (trackIndex >= 0 && trackIndex < trackVisible.size())
     {
         trackVisible.set(trackIndex, visible);
-        repaint();
+        repaintNotes();
     }
 }
 
@@ -365,7 +502,7 @@ void PianoRollComponent::soloTrack(int trackIndex)
     soloedTrack = trackIndex;
     if (soloedTrack >= 0)
         lastAuditionTrackIndex = soloedTrack;
-    repaint();
+    repaintNotes();
 }
 
 void PianoRollComponent::setAuditionTrackIndex(int trackIndex)
@@ -393,6 +530,7 @@ void PianoRollComponent::setTrackCount(int count)
     {
         assignTrackColors(count);
         updateTrackList();
+        repaintNotes();     // Notes are drawn in their track's colour
     }
 }
 
@@ -469,11 +607,17 @@ void PianoRollComponent::updateTrackList()
 //==============================================================================
 void PianoRollComponent::paint(juce::Graphics& g)
 {
-    drawBackground(g);
-    drawTimeRuler(g);   // Bar:Beat timeline ruler at top
-    drawGridLines(g);
-    drawLoopRegion(g);  // Draw loop region behind notes
-    drawNotes(g);
+    if (getWidth() <= 0 || getHeight() <= 0)
+        return;
+    
+    // Cached layers are rendered at the display's pixel density and drawn back at 1:1
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    updateLayers(scale);
+    const auto toComponent = juce::AffineTransform::scale(1.0f / scale);
+    
+    g.drawImageTransformed(backgroundLayer, toComponent);  // Background, ruler, grid, loop region
+    drawPositionReadout(g);
+    g.drawImageTransformed(noteLayer, toComponent);
     
     if (isSelecting)
         drawSelectionRect(g);
@@ -482,12 +626,87 @@ void PianoRollComponent::paint(juce::Graphics& g)
     
     // Only draw piano keys when NOT in embedded mode
     if (!embeddedMode)
-        drawPianoKeys(g);
+        g.drawImageTransformed(keyLayer, toComponent);
     
     if (hoveredNote != nullptr)
         drawNoteTooltip(g);
 }
 
+void PianoRollComponent::updateLayers(float scale)
+{
+    const LayerKey key { getWidth(), getHeight(), scale, hZoom, vZoom, scrollX, scrollY, currentBPM,
+                         embeddedMode, drumMode, loopRegionStart, loopRegionEnd };
+    
+    if (!(key == layerKey))
+    {
+        layerKey = key;
+        backgroundLayer = {};
+        keyLayer = {};
+        noteLayerDirty = true;
+    }
+    
+    auto createLayer = [scale](int width, int height, juce::Image::PixelFormat format)
+    {
+        return juce::Image(format, juce::jmax(1, juce::roundToInt((float)width * scale)),
+                           juce::jmax(1, juce::roundToInt((float)height * scale)), true);
+    };
+    
+    if (!backgroundLayer.isValid())
+    {
+        backgroundLayer = createLayer(getWidth(), getHeight(), juce::Image::RGB);
+        juce::Graphics lg(backgroundLayer);
+        lg.addTransform(juce::AffineTransform::scale(scale));
+        drawBackground(lg);
+        drawTimeRuler(lg);   // Bar:Beat timeline ruler at top
+        drawGridLines(lg);
+        drawLoopRegion(lg);  // Draw loop region behind notes
+    }
+    
+    if (noteLayerDirty || !noteLayer.isValid())
+    {
+        if (noteLayer.getWidth() != backgroundLayer.getWidth() || noteLayer.getHeight() != backgroundLayer.getHeight())
+            noteLayer = createLayer(getWidth(), getHeight(), juce::Image::ARGB);
+        else
+            noteLayer.clear(noteLayer.getBounds());
+        
+        juce::Graphics lg(noteLayer);
+        lg.addTransform(juce::AffineTransform::scale(scale));
+        drawNotes(lg);
+        noteLayerDirty = false;
+    }
+    
+    if (!embeddedMode && !keyLayer.isValid())
+    {
+        // Keys only cover the strip at the left edge
+        keyLayer = createLayer(getEffectiveKeyWidth(), getHeight(), juce::Image::ARGB);
+        juce::Graphics lg(keyLayer);
+        lg.addTransform(juce::AffineTransform::scale(scale));
+        drawPianoKeys(lg);
+    }
+}
+
+void PianoRollComponent::repaintNotes()
+{
+    noteLayerDirty = true;
+    repaint();
+}
+
+juce::Rectangle<int> PianoRollComponent::getPlayheadArea(double positionSeconds) const
+{
+    // Line plus the marker triangle, with a pixel of slack for rounding
+    const int x = (int)timeToX(positionSeconds);
+    return { x - 6, 0, 13, getHeight() };
+}
+
+void PianoRollComponent::repaintPlayhead(double previousPosition)
+{
+    repaint(getPlayheadArea(previousPosition));
+    repaint(getPlayheadArea(playheadPosition));
+    
+    if (!embeddedMode)
+        repaint(0, 0, getEffectiveKeyWidth(), getEffectiveRulerHeight());   // Bar:beat readout
+}
+
 void PianoRollComponent::drawBackground(juce::Graphics& g)
 {
     g.fillAll(AppColours::background);
@@ -681,10 +900,17 @@ void PianoRollComponent::drawTimeRuler(juce::Graphics& g)
             }
         }
     }
+}
+
+void PianoRollComponent::drawPositionReadout(juce::Graphics& g)
+{
+    int keyWidth = getEffectiveKeyWidth();
+    int rulerHeight = getEffectiveRulerHeight();
     
-    // Draw current position in bar:beat format at left side
-    if (!embeddedMode)
+    // Draw current position in bar:beat format at left side of the ruler
+    if (!embeddedMode && rulerHeight > 0)
     {
+        auto rulerBounds = getLocalBounds().removeFromTop(rulerHeight);
         juce::String timeStr = formatBarBeat(playheadPosition);
         g.setColour(AppColours::accent);
         g.setFont(11.0f);
@@ -917,25 +1143,16 @@ void PianoRollComponent::drawNotes(juce::Graphics& g)
     
     int keyWidth = getEffectiveKeyWidth();
     
-    for (const auto& note : notes)
+    // Only the buckets under the visible time range; other tracks are skipped when soloed
+    forEachNoteInRange(xToTime((float)keyWidth), xToTime((float)getWidth()), [&](const MidiNoteEvent& note)
     {
-        // Filter by track
-        if (soloedTrack >= 0 && note.trackIndex != soloedTrack) 
-        {
-            // Optional: Draw ghost notes?
-            // For now, just skip to reduce clutter as requested
-            continue; 
-        }
-        
-        if (!isTrackVisible(note.trackIndex)) continue;
-        
         float x = timeToX(note.startTime);
         float endX = timeToX(note.endTime);
         float y = noteToY(note.noteNumber);
         float width = juce::jmax(2.0f, endX - x);
         
-        if (endX < keyWidth || x > getWidth()) continue;
-        if (y + noteHeight < 0 || y > getHeight()) continue;
+        if (endX < keyWidth || x > getWidth()) return;
+        if (y + noteHeight < 0 || y > getHeight()) return;
         
         if (x < keyWidth)
         {
@@ -948,7 +1165,7 @@ void PianoRollComponent::drawNotes(juce::Graphics& g)
         noteColour = noteColour.withMultipliedBrightness(velocityBrightness);
         
         // Selection highlight
-        bool isSelected = selectedNotes.contains(note.stateNode);
+        bool isSelected = note.noteId != 0 && selectedNotes.contains(note.noteId);
         if (isSelected)
             noteColour = juce::Colours::white;
         else if (&note == hoveredNote)
@@ -988,7 +1205,7 @@ void PianoRollComponent::drawNotes(juce::Graphics& g)
         float velocityHeight = (noteHeight - 4) * (note.velocity / 127.0f);
         g.setColour(noteColour.brighter(0.4f));
         g.fillRect(x + 1, y + 2 + (noteHeight - 4 - velocityHeight), 2.0f, velocityHeight);
-    }
+    });
 }
 
 void PianoRollComponent::drawSelectionRect(juce::Graphics& g)
@@ -1102,87 +1319,61 @@ MidiNoteEvent* PianoRollComponent::getNoteAt(juce::Point<float> position)
     if (position.x < getEffectiveKeyWidth()) return nullptr;
     float noteHeight = whiteKeyHeight * vZoom;
     
-    for (auto& note : notes)
+    // Expand hit area slightly (esp. horizontally) so edge resize is easier to grab.
+    const float grabX = 6.0f;
+    MidiNoteEvent* hit = nullptr;
+    
+    forEachNoteInRange(xToTime(position.x - grabX), xToTime(position.x + grabX), [&](MidiNoteEvent& note)
     {
-        if (soloedTrack >= 0 && note.trackIndex != soloedTrack) continue;
-        if (!isTrackVisible(note.trackIndex)) continue;
+        if (hit != nullptr)
+            return;
         
         float x = timeToX(note.startTime);
         float endX = timeToX(note.endTime);
         float y = noteToY(note.noteNumber);
         
         juce::Rectangle<float> noteRect(x, y, endX - x, noteHeight);
-        // Expand hit area slightly (esp. horizontally) so edge resize is easier to grab.
-        if (noteRect.expanded(6.0f, 2.0f).contains(position))
-            return &note;
-    }
-    return nullptr;
+        if (noteRect.expanded(grabX, 2.0f).contains(position))
+            hit = &note;
+    });
+    return hit;
 }
 
-juce::ValueTree PianoRollComponent::resolveNoteStateNode(const MidiNoteEvent& note) const
+Project::NoteId PianoRollComponent::resolveNoteId(const MidiNoteEvent& note) const
 {
     if (projectState == nullptr)
-        return {};
-
-    auto notesNode = projectState->getState().getChildWithName(Project::IDs::NOTES);
-    if (!notesNode.isValid())
-        return {};
+        return 0;
 
     const double secondsPerBeat = getSecondsPerBeat();
     if (secondsPerBeat <= 0.0)
-        return {};
+        return 0;
 
     const double targetStartBeats = note.startTime / secondsPerBeat;
     const double targetLengthBeats = note.getDuration() / secondsPerBeat;
 
-    // First try a tight match.
+    // Pick the closest matching note by start/length; a tight match wins outright.
     constexpr double tolBeats = 1.0e-3;
-    for (const auto& child : notesNode)
-    {
-        if (!child.hasType(Project::IDs::NOTE))
-            continue;
-
-        const int childNote = (int)child.getProperty(Project::IDs::noteNumber);
-        const int childTrack = (int)child.getProperty(Project::IDs::channel);
-        if (childNote != note.noteNumber || childTrack != note.trackIndex)
-            continue;
-
-        const double childStart = (double)child.getProperty(Project::IDs::start);
-        const double childLength = (double)child.getProperty(Project::IDs::length);
-
-        if (std::abs(childStart - targetStartBeats) <= tolBeats && std::abs(childLength - targetLengthBeats) <= tolBeats)
-            return child;
-    }
-
-    // Fallback: pick the closest matching note by start/length.
     double bestScore = std::numeric_limits<double>::infinity();
-    juce::ValueTree best;
-    for (const auto& child : notesNode)
-    {
-        if (!child.hasType(Project::IDs::NOTE))
-            continue;
+    Project::NoteId best = 0;
 
-        const int childNote = (int)child.getProperty(Project::IDs::noteNumber);
-        const int childTrack = (int)child.getProperty(Project::IDs::channel);
-        if (childNote != note.noteNumber || childTrack != note.trackIndex)
-            continue;
-
-        const double childStart = (double)child.getProperty(Project::IDs::start);
-        const double childLength = (double)child.getProperty(Project::IDs::length);
+    projectState->getNotes().forEachInTrack(note.trackIndex, [&](const Project::Note& candidate)
+    {
+        if (candidate.noteNumber != note.noteNumber || bestScore <= tolBeats)
+            return;
 
-        const double score = std::abs(childStart - targetStartBeats) + std::abs(childLength - targetLengthBeats);
+        const double score = std::abs(candidate.start - targetStartBeats) + std::abs(candidate.length - targetLengthBeats);
         if (score < bestScore)
         {
             bestScore = score;
-            best = child;
+            best = candidate.id;
         }
-    }
+    });
 
     // Only accept the fallback if it's reasonably close.
-    if (best.isValid() && bestScore <= 0.05)
+    if (best != 0 && bestScore <= 0.05)
         return best;
 
-    return {};
+    return 0;
 }
 
 //==============================================================================
@@ -1255,13 +1446,9 @@ void PianoRollComponent::mouseDown(const juce::MouseEvent& event)
         
         if (note)
         {
-            // Ensure we have a valid state node for editing.
-            if (projectState != nullptr && !note->stateNode.isValid())
-            {
-                auto resolved = resolveNoteStateNode(*note);
-                if (resolved.isValid())
-                    note->stateNode = resolved;
-            }
+            // Ensure we have a note id for editing.
+            if (projectState != nullptr && note->noteId == 0)
+                note->noteId = resolveNoteId(*note);
 
             // Play the note for feedback
             audioEngine.playNote(note->trackIndex, note->noteNumber, note->velocity / 127.0f);
@@ -1271,23 +1458,23 @@ void PianoRollComponent::mouseDown(const juce::MouseEvent& event)
             if (event.mods.isShiftDown())
             {
                 // Toggle selection
-                if (note->stateNode.isValid())
+                if (note->noteId != 0)
                 {
-                    if (selectedNotes.contains(note->stateNode))
-                        selectedNotes.removeFirstMatchingValue(note->stateNode);
+                    if (selectedNotes.contains(note->noteId))
+                        selectedNotes.removeFirstMatchingValue(note->noteId);
                     else
-                        selectedNotes.add(note->stateNode);
+                        selectedNotes.add(note->noteId);
                 }
             }
             else
             {
                 // Select only this note (unless already selected)
-                if (note->stateNode.isValid())
+                if (note->noteId != 0)
                 {
-                    if (!selectedNotes.contains(note->stateNode))
+                    if (!selectedNotes.contains(note->noteId))
                     {
                         selectedNotes.clear();
-                        selectedNotes.add(note->stateNode);
+                        selectedNotes.add(note->noteId);
                     }
                 }
             }
@@ -1319,15 +1506,17 @@ void PianoRollComponent::mouseDown(const juce::MouseEvent& event)
                 // (incremental deltas + snapping can otherwise get "stuck" and never cross a grid threshold).
                 dragNoteSnapshots.clear();
                 dragNoteSnapshots.ensureStorageAllocated(selectedNotes.size());
-                for (const auto& node : selectedNotes)
+                const auto& store = projectState->getNotes();
+                for (auto id : selectedNotes)
                 {
-                    if (!node.isValid())
+                    if (!store.contains(id))
                         continue;
+                    const auto stored = store.get(id);
                     DragNoteSnapshot snap;
-                    snap.node = node;
-                    snap.startBeats = (double)node.getProperty(Project::IDs::start);
-                    snap.lengthBeats = (double)node.getProperty(Project::IDs::length);
-                    snap.noteNumber = (int)node.getProperty(Project::IDs::noteNumber);
+                    snap.id = id;
+                    snap.startBeats = stored.start;
+                    snap.lengthBeats = stored.length;
+                    snap.noteNumber = stored.noteNumber;
                     dragNoteSnapshots.add(snap);
                 }
             }
@@ -1345,7 +1534,7 @@ void PianoRollComponent::mouseDown(const juce::MouseEvent& event)
             // Seek if simple click (handled in mouseUp to distinguish from drag)
         }
         
-        repaint();
+        repaintNotes();
     }
     else if (event.mods.isMiddleButtonDown())
     {
@@ -1382,28 +1571,14 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
     if (secondsPerBeat <= 0.0)
         return;
 
-    auto updateCachedNoteFromState = [this, secondsPerBeat](const juce::ValueTree& noteNode)
-    {
-        if (!noteNode.isValid())
-            return;
-
-        const int newNoteNumber = (int)noteNode.getProperty(Project::IDs::noteNumber);
-        const int newTrackIndex = (int)noteNode.getProperty(Project::IDs::channel);
-        const double startBeats = (double)noteNode.getProperty(Project::IDs::start);
-        const double lengthBeats = (double)noteNode.getProperty(Project::IDs::length);
+    const auto& store = projectState->getNotes();
 
-        for (auto& cached : notes)
-        {
-            if (cached.stateNode == noteNode)
-            {
-                cached.noteNumber = newNoteNumber;
-                cached.channel = newTrackIndex;
-                cached.trackIndex = newTrackIndex;
-                cached.startTime = startBeats * secondsPerBeat;
-                cached.endTime = (startBeats + lengthBeats) * secondsPerBeat;
-                break;
-            }
-        }
+    // Keep the dragged notes under the mouse now; the transaction's notification follows later
+    auto updateCachedNoteFromState = [this, &store](Project::NoteId id)
+    {
+        const auto found = noteIndices.find(id);
+        if (found != noteIndices.end() && store.contains(id))
+            updateCachedNote(found->second, store.get(id));
     };
     
     if (isMoving)
@@ -1418,8 +1593,7 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
         {
             for (const auto& snap : dragNoteSnapshots)
             {
-                auto node = snap.node;
-                if (!node.isValid())
+                if (!store.contains(snap.id))
                     continue;
 
                 double newStart = snap.startBeats + deltaBeats;
@@ -1431,29 +1605,28 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
 
                 newNoteNum = juce::jlimit(0, 127, newNoteNum);
 
-                projectState->moveNote(node, newStart, newNoteNum);
-                updateCachedNoteFromState(node);
+                projectState->moveNote(snap.id, newStart, newNoteNum);
+                updateCachedNoteFromState(snap.id);
             }
         }
         else
         {
-            for (auto& node : selectedNotes)
+            for (auto id : selectedNotes)
             {
-                if (!node.isValid())
+                if (!store.contains(id))
                     continue;
-                const double start = (double)node.getProperty(Project::IDs::start);
-                const int noteNum = (int)node.getProperty(Project::IDs::noteNumber);
+                const auto stored = store.get(id);
 
-                double newStart = juce::jmax(0.0, start + deltaBeats);
+                double newStart = juce::jmax(0.0, stored.start + deltaBeats);
                 if (!event.mods.isAltDown())
                     newStart = snapBeatsToGrid(newStart);
 
-                const int newNoteNum = juce::jlimit(0, 127, noteNum + deltaNote);
-                projectState->moveNote(node, newStart, newNoteNum);
-                updateCachedNoteFromState(node);
+                const int newNoteNum = juce::jlimit(0, 127, stored.noteNumber + deltaNote);
+                projectState->moveNote(id, newStart, newNoteNum);
+                updateCachedNoteFromState(id);
             }
         }
-        repaint();
+        repaintNotes();
     }
     else if (isResizing)
     {
@@ -1468,8 +1641,7 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
         {
             for (const auto& snap : dragNoteSnapshots)
             {
-                auto node = snap.node;
-                if (!node.isValid())
+                if (!store.contains(snap.id))
                     continue;
 
                 double newLen = snap.lengthBeats + deltaBeats;
@@ -1484,18 +1656,18 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
                     newLen = juce::jmax(0.1, newLen);
                 }
 
-                projectState->resizeNote(node, newLen);
-                updateCachedNoteFromState(node);
+                projectState->resizeNote(snap.id, newLen);
+                updateCachedNoteFromState(snap.id);
             }
         }
         else
         {
-            for (auto& node : selectedNotes)
+            for (auto id : selectedNotes)
             {
-                if (!node.isValid())
+                if (!store.contains(id))
                     continue;
 
-                const double currentLen = (double)node.getProperty(Project::IDs::length);
+                const double currentLen = store.get(id).length;
                 double newLen = currentLen + deltaBeats;
 
                 if (!event.mods.isAltDown())
@@ -1508,11 +1680,11 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
                     newLen = juce::jmax(0.1, newLen);
                 }
 
-                projectState->resizeNote(node, newLen);
-                updateCachedNoteFromState(node);
+                projectState->resizeNote(id, newLen);
+                updateCachedNoteFromState(id);
             }
         }
-        repaint();
+        repaintNotes();
     }
     else if (isSelecting)
     {
@@ -1523,26 +1695,24 @@ void PianoRollComponent::mouseDrag(const juce::MouseEvent& event)
             std::abs(event.y - (int)dragStartPos.y)
         );
         
-        // Update selection based on rect - respecting track filter
+        // Update selection based on rect - respecting track filter (solo/embedded mode)
         selectedNotes.clear();
-        for (auto& note : notes)
+        const auto rectStart = xToTime((float)selectionRect.getX());
+        const auto rectEnd = xToTime((float)selectionRect.getRight());
+        forEachNoteInRange(rectStart, rectEnd, [&](const MidiNoteEvent& note)
         {
-            // Skip notes from other tracks when in solo/embedded mode
-            if (soloedTrack >= 0 && note.trackIndex != soloedTrack) continue;
-            if (!isTrackVisible(note.trackIndex)) continue;
-            
             float x = timeToX(note.startTime);
             float endX = timeToX(note.endTime);
             float y = noteToY(note.noteNumber);
             float h = whiteKeyHeight * vZoom;
             
             juce::Rectangle<float> noteRect(x, y, endX - x, h);
-            if (selectionRect.toFloat().intersects(noteRect))
+            if (note.noteId != 0 && selectionRect.toFloat().intersects(noteRect))
             {
-                selectedNotes.add(note.stateNode);
+                selectedNotes.add(note.noteId);
             }
-        }
-        repaint();
+        });
+        repaintNotes();
     }
 }
 
@@ -1609,14 +1779,9 @@ bool PianoRollComponent::keyPressed(const juce::KeyPress& key)
     {
         if (!selectedNotes.isEmpty() && projectState)
         {
-            // Copy nodes to a local array first, as deletion triggers syncNotesFromState
-            // which can invalidate the selectedNotes during iteration
-            juce::Array<juce::ValueTree> nodesToDelete;
-            for (auto& note : selectedNotes)
-            {
-                if (note.isValid())
-                    nodesToDelete.add(note);
-            }
+            // Copy ids to a local array first, as the deletion's notification
+            // prunes selectedNotes
+            auto idsToDelete = selectedNotes;
             
             // Clear selection BEFORE deletion to prevent accessing invalid nodes
             selectedNotes.clear();
@@ -1624,7 +1789,7 @@ bool PianoRollComponent::keyPressed(const juce::KeyPress& key)
             projectState->getUndoManager().beginNewTransaction("Delete Notes");
             
             // Use batch delete for better performance
-            projectState->deleteNotes(nodesToDelete);
+            projectState->deleteNotes(idsToDelete);
             
             return true;
         }
@@ -1641,7 +1806,7 @@ void PianoRollComponent::mouseMove(const juce::MouseEvent& event)
     {
         hoveredNote = note;
         listeners.call(&PianoRollComponent::Listener::pianoRollNoteHovered, note);
-        repaint();
+        repaintNotes();
     }
     
     // Cursor updates
@@ -1705,7 +1870,7 @@ void PianoRollComponent::mouseExit(const juce::MouseEvent& /*event*/)
     {
         hoveredNote = nullptr;
         listeners.call(&PianoRollComponent::Listener::pianoRollNoteHovered, nullptr);
-        repaint();
+        repaintNotes();
     }
 }
 
@@ -1714,16 +1879,22 @@ void PianoRollComponent::transportStateChanged(mmg::AudioEngine::TransportState
 
 void PianoRollComponent::playbackPositionChanged(double positionSeconds)
 {
-    playheadPosition = positionSeconds;
-    juce::MessageManager::callAsync([this]() { repaint(); });
+    juce::MessageManager::callAsync([this, positionSeconds]()
+    {
+        const double previousPosition = playheadPosition;
+        playheadPosition = positionSeconds;
+        repaintPlayhead(previousPosition);
+    });
 }
 
 void PianoRollComponent::timerCallback()
 {
     if (audioEngine.isPlaying())
     {
+        // Only the playhead moves; the cached layers are reused
+        const double previousPosition = playheadPosition;
         playheadPosition = audioEngine.getPlaybackPosition();
-        repaint();
+        repaintPlayhead(previousPosition);
     }
 }
 
@@ -1732,24 +1903,12 @@ void PianoRollComponent::addListener(Listener* listener) { listeners.add(listene
 void PianoRollComponent::removeListener(Listener* listener) { listeners.remove(listener); }
 
 //==============================================================================
-// ProjectState::Listener overrides
-void PianoRollComponent::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
-{
-    if (tree.hasType(Project::IDs::NOTE))
-        syncNotesFromState();
-}
-
-void PianoRollComponent::valueTreeChildAdded(juce::ValueTree& parent, juce::ValueTree& child)
+// ProjectState::NoteListener overrides
+void PianoRollComponent::notesChanged(const juce::Array<Project::NoteId>& changedNotes)
 {
-    if (child.hasType(Project::IDs::NOTE))
-        syncNotesFromState();
-}
-
-void PianoRollComponent::valueTreeChildRemoved(juce::ValueTree& parent, juce::ValueTree& child, int index)
-{
-    if (child.hasType(Project::IDs::NOTE))
+    // One call per undo transaction; only a load or new project needs the full rebuild
+    if (changedNotes.isEmpty())
         syncNotesFromState();
+    else
+        patchNotesFromState(changedNotes);
 }
-
-void PianoRollComponent::valueTreeChildOrderChanged(juce::ValueTree&, int, int) {}
-void PianoRollComponent::valueTreeParentChanged(juce::ValueTree&) {}
@@ -14,6 +14,10 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "../../Audio/AudioEngine.h"
 #include "../../Project/ProjectState.h"
+#include "NoteIntervalIndex.h"
+
+#include <tuple>
+#include <unordered_map>
 
 //==============================================================================
 /**
@@ -28,8 +32,8 @@ struct MidiNoteEvent
     int channel = 0;            // MIDI channel (0-15)
     int trackIndex = 0;         // Track index for coloring
     
-    // Link to source state
-    juce::ValueTree stateNode;
+    // Link to source state (0 for visualization-only notes)
+    Project::NoteId noteId = 0;
     
     double getDuration() const { return endTime - startTime; }
     
@@ -59,7 +63,7 @@ struct MidiNoteEvent
 class PianoRollComponent : public juce::Component,
                            private mmg::AudioEngine::Listener,
                            private juce::Timer,
-                           public Project::ProjectState::Listener
+                           public Project::ProjectState::NoteListener
 {
 public:
     //==============================================================================
@@ -91,7 +95,7 @@ public:
     //==============================================================================
     // Note Release Visualization
     /** Enable/disable note release tail visualization (ADSR decay) */
-    void setShowReleaseTails(bool show) { showReleaseTails = show; repaint(); }
+    void setShowReleaseTails(bool show) { showReleaseTails = show; repaintNotes(); }
     bool isShowingReleaseTails() const { return showReleaseTails; }
     
     //==============================================================================
@@ -161,12 +165,8 @@ public:
     void removeListener(Listener* listener);
 
     //==============================================================================
-    // ProjectState::Listener overrides
-    void valueTreePropertyChanged(juce::ValueTree& treeWhosePropertyHasChanged, const juce::Identifier& property) override;
-    void valueTreeChildAdded(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenAdded) override;
-    void valueTreeChildRemoved(juce::ValueTree& parentTree, juce::ValueTree& childWhichHasBeenRemoved, int indexFromWhichChildWasRemoved) override;
-    void valueTreeChildOrderChanged(juce::ValueTree& parentTreeWhichHasChanged, int oldIndex, int newIndex) override;
-    void valueTreeParentChanged(juce::ValueTree& treeWhoseParentHasChanged) override;
+    // ProjectState::NoteListener overrides
+    void notesChanged(const juce::Array<Project::NoteId>& changedNotes) override;
 
 private:
     //==============================================================================
@@ -189,6 +189,45 @@ private:
     void drawPlayhead(juce::Graphics& g);
     void drawNoteTooltip(juce::Graphics& g);
     void drawSelectionRect(juce::Graphics& g);
+    void drawPositionReadout(juce::Graphics& g);    // Bar:beat of the playhead, left of the ruler
+    
+    //==============================================================================
+    // Cached layers: paint() blits these and draws only the playhead, selection
+    // rectangle, position readout and tooltip live
+    struct LayerKey
+    {
+        int width = 0, height = 0;
+        float scale = 0.0f;
+        float hZoom = 0.0f, vZoom = 0.0f;
+        double scrollX = 0.0;
+        int scrollY = 0;
+        int bpm = 0;
+        bool embedded = false, drumMode = false;
+        double loopStart = 0.0, loopEnd = 0.0;
+        
+        bool operator==(const LayerKey& other) const
+        {
+            return std::tie(width, height, scale, hZoom, vZoom, scrollX, scrollY, bpm, embedded, drumMode, loopStart, loopEnd)
+                == std::tie(other.width, other.height, other.scale, other.hZoom, other.vZoom, other.scrollX, other.scrollY,
+                            other.bpm, other.embedded, other.drumMode, other.loopStart, other.loopEnd);
+        }
+    };
+    
+    /** Re-render whichever layers the view or note edits have invalidated. */
+    void updateLayers(float scale);
+    
+    /** Repaint after the notes, their selection/hover state or track filtering changed. */
+    void repaintNotes();
+    
+    /** Repaint just the old and new playhead strips (and the readout). */
+    void repaintPlayhead(double previousPosition);
+    juce::Rectangle<int> getPlayheadArea(double positionSeconds) const;
+    
+    LayerKey layerKey;                  // View the layers were rendered for
+    juce::Image backgroundLayer;        // Background, ruler, grid and loop region
+    juce::Image noteLayer;              // Notes, over a transparent background
+    juce::Image keyLayer;               // Piano keys strip (standalone mode only)
+    bool noteLayerDirty = true;
     
     //==============================================================================
     // Time formatting helpers
@@ -211,9 +250,9 @@ private:
     // Note hit testing
     MidiNoteEvent* getNoteAt(juce::Point<float> position);
 
-    // If a note was created via legacy visualization-only paths, it may not have a valid ValueTree.
-    // This tries to re-associate it with the ProjectState NOTES node so editing (move/resize/delete) works.
-    juce::ValueTree resolveNoteStateNode(const MidiNoteEvent& note) const;
+    // If a note was created via legacy visualization-only paths, it has no note id.
+    // This tries to re-associate it with a ProjectState note so editing (move/resize/delete) works.
+    Project::NoteId resolveNoteId(const MidiNoteEvent& note) const;
     
     //==============================================================================
     mmg::AudioEngine& audioEngine;
@@ -222,6 +261,8 @@ private:
     
     // MIDI data
     juce::Array<MidiNoteEvent> notes;
+    std::unordered_map<Project::NoteId, int> noteIndices;  // Note id -> index in notes
+    NoteIntervalIndex timeIndex;                           // Per-track bar buckets -> index in notes
     double totalDuration = 60.0;
     double minimumDuration = 600.0;  // 10 minutes minimum for professional workflow
     int currentBPM = 120;
@@ -278,11 +319,11 @@ private:
     juce::int64 clickStartTime = 0;  // For distinguishing click vs drag
     
     // Editing State
-    juce::Array<juce::ValueTree> selectedNotes;
+    juce::Array<Project::NoteId> selectedNotes;
 
     struct DragNoteSnapshot
     {
-        juce::ValueTree node;
+        Project::NoteId id = 0;
         double startBeats = 0.0;
         double lengthBeats = 0.0;
         int noteNumber = 60;
@@ -312,5 +353,28 @@ private:
     void assignTrackColors(int numTracks);
     void syncNotesFromState();
     
+    // Incremental sync: update, add or drop only the cached notes whose ids changed
+    void patchNotesFromState(const juce::Array<Project::NoteId>& changedNotes);
+    void applyStoredNote(MidiNoteEvent& target, const Project::Note& stored) const;
+    MidiNoteEvent* findNote(Project::NoteId id);
+    
+    // Every change to notes goes through these, keeping noteIndices and timeIndex in step
+    void addCachedNote(const MidiNoteEvent& note);
+    void removeCachedNote(int index);
+    void updateCachedNote(int index, const Project::Note& stored);
+    void rebuildTimeIndex();
+    
+    // Tracks whose notes are drawn and hit-tested (the soloed one, or the visible ones)
+    juce::Array<int> getShownTracks() const;
+    
+    /** Call fn(MidiNoteEvent&) for the shown notes that may overlap [startTime, endTime]. */
+    template <typename Function>
+    void forEachNoteInRange(double startTime, double endTime, Function&& fn)
+    {
+        for (auto track : getShownTracks())
+            timeIndex.forEachInRange(track, startTime, endTime,
+                                     [this, &fn](int index) { fn(notes.getReference(index)); });
+    }
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PianoRollComponent)
 };
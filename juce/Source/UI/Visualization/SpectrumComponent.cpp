@@ -50,39 +50,33 @@ SpectrumComponent::~SpectrumComponent()
 }
 
 //==============================================================================
-void SpectrumComponent::pushSamples(const float* samples, int numSamples)
+void SpectrumComponent::setSource(const mmg::AnalysisTap* tap)
 {
-    // Push samples into FIFO for FFT processing
-    for (int i = 0; i < numSamples; ++i)
-    {
-        if (fifoIndex < fftSize)
-        {
-            fifo[fifoIndex++] = samples[i];
-        }
-        
-        if (fifoIndex >= fftSize)
-        {
-            // FIFO is full, signal that FFT can be performed
-            nextFFTBlockReady = true;
-            fifoIndex = 0;
-        }
-    }
+    source = tap;
+    reader = {};    // Start from the newest sample
+    fifoIndex = 0;
 }
 
-void SpectrumComponent::pushSamples(const float* leftSamples, const float* rightSamples, int numSamples)
+void SpectrumComponent::readFromSource()
 {
-    // Average stereo to mono for spectrum analysis
-    for (int i = 0; i < numSamples; ++i)
+    if (source == nullptr)
+        return;
+    
+    for (;;)
     {
-        float sample = (leftSamples[i] + rightSamples[i]) * 0.5f;
+        const int numRead = source->read(reader, readLeft.data(), readRight.data(), fftSize - fifoIndex);
+        if (numRead <= 0)
+            break;
         
-        if (fifoIndex < fftSize)
-        {
-            fifo[fifoIndex++] = sample;
-        }
+        // Average stereo to mono for spectrum analysis
+        juce::FloatVectorOperations::add(fifo.data() + fifoIndex, readLeft.data(), readRight.data(), numRead);
+        juce::FloatVectorOperations::multiply(fifo.data() + fifoIndex, 0.5f, numRead);
+        fifoIndex += numRead;
         
         if (fifoIndex >= fftSize)
         {
+            // A full block: keep the newest one for processFFT and start collecting the next
+            std::copy(fifo.begin(), fifo.begin() + fftSize, fftData.begin());
             nextFFTBlockReady = true;
             fifoIndex = 0;
         }
@@ -99,6 +93,7 @@ void SpectrumComponent::clear()
     std::fill(peakHoldCountdown.begin(), peakHoldCountdown.end(), 0);
     nextFFTBlockReady = false;
     fifoIndex = 0;
+    reader = {};
     repaint();
 }
 
@@ -211,7 +206,9 @@ float SpectrumComponent::applyEnvelope(float current, float target, int bandInde
 //==============================================================================
 void SpectrumComponent::timerCallback()
 {
-    if (nextFFTBlockReady.load())
+    readFromSource();
+    
+    if (nextFFTBlockReady)
     {
         processFFT();
         nextFFTBlockReady = false;
@@ -253,9 +250,7 @@ void SpectrumComponent::timerCallback()
 
 void SpectrumComponent::processFFT()
 {
-    // Copy FIFO to FFT data buffer
-    std::copy(fifo.begin(), fifo.begin() + fftSize, fftData.begin());
-    
+    // fftData holds the newest full block, copied out of the FIFO by readFromSource.
     // Apply windowing function (Hann window reduces spectral leakage)
     window.multiplyWithWindowingTable(fftData.data(), fftSize);
     
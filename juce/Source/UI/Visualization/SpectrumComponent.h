@@ -17,6 +17,7 @@
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_dsp/juce_dsp.h>
 #include "GenreTheme.h"
+#include "../../Audio/AnalysisBus.h"
 
 //==============================================================================
 /**
@@ -32,7 +33,7 @@
     
     Performance:
     - Uses JUCE DSP FFT for efficient processing
-    - Lock-free sample input from audio thread
+    - Reads an AnalysisTap from the display timer; nothing runs on the audio thread
     - Renders at 60fps with minimal CPU
 */
 class SpectrumComponent : public juce::Component,
@@ -66,11 +67,9 @@ public:
     ~SpectrumComponent() override;
     
     //==========================================================================
-    /** Push audio samples for analysis (call from audio thread) */
-    void pushSamples(const float* samples, int numSamples);
-    
-    /** Push stereo audio samples (averages L+R) */
-    void pushSamples(const float* leftSamples, const float* rightSamples, int numSamples);
+    /** Analyse the audio passing through a tap (L+R averaged; null to stop).
+        The tap is polled on the display timer; it must outlive this component. */
+    void setSource(const mmg::AnalysisTap* tap);
     
     /** Clear spectrum data */
     void clear();
@@ -135,11 +134,18 @@ private:
     juce::dsp::FFT forwardFFT;
     juce::dsp::WindowingFunction<float> window;
     
-    // Input buffer (ring buffer for audio thread)
+    // Input, gathered from the tap on the message thread: fifo collects fftSize
+    // mono samples, which are moved to fftData for the next processFFT
+    const mmg::AnalysisTap* source = nullptr;
+    mmg::AnalysisTap::Reader reader;
+    std::array<float, fftSize> readLeft, readRight;
     std::array<float, fftSize * 2> fifo;
     std::array<float, fftSize * 2> fftData;
     int fifoIndex = 0;
-    std::atomic<bool> nextFFTBlockReady { false };
+    bool nextFFTBlockReady = false;
+    
+    /** Pull whatever the tap has gained since the last tick into fifo. */
+    void readFromSource();
     
     // Output data
     std::vector<float> spectrumData;      // Current smoothed levels
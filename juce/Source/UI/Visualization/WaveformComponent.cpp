@@ -38,28 +38,6 @@ WaveformComponent::~WaveformComponent()
 }
 
 //==============================================================================
-void WaveformComponent::pushSamples(const float* samples, int numSamples)
-{
-    // Push mono samples to both channels
-    pushSamples(samples, samples, numSamples);
-}
-
-void WaveformComponent::pushSamples(const float* leftSamples, const float* rightSamples, int numSamples)
-{
-    // Write samples to ring buffer (lock-free for audio thread)
-    int pos = writePosition.load();
-    
-    for (int i = 0; i < numSamples; ++i)
-    {
-        leftBuffer[pos] = leftSamples[i];
-        rightBuffer[pos] = rightSamples != nullptr ? rightSamples[i] : leftSamples[i];
-        
-        pos = (pos + 1) % bufferSize;
-    }
-    
-    writePosition.store(pos);
-}
-
 void WaveformComponent::clear()
 {
     leftBuffer.fill(0.0f);
@@ -109,6 +87,14 @@ void WaveformComponent::setStereoMode(bool stereo)
 //==============================================================================
 void WaveformComponent::timerCallback()
 {
+    if (source != nullptr)
+    {
+        // The newest bufferSize frames, oldest first; a copy the audio thread overran
+        // just shows for one frame
+        source->readLatest(leftBuffer.data(), rightBuffer.data(), bufferSize);
+        writePosition = 0;
+    }
+    
     processSamplesForDisplay();
     
     // Apply peak release (envelope follower style)
@@ -125,7 +111,7 @@ void WaveformComponent::timerCallback()
 
 void WaveformComponent::processSamplesForDisplay()
 {
-    int readPos = writePosition.load();
+    int readPos = writePosition;
     
     // Calculate how many buffer samples per display sample
     float samplesPerPixel = (float)bufferSize / (float)displaySamples;
@@ -31,7 +31,7 @@
     - Peak hold indicators
     
     Performance:
-    - Uses a ring buffer for efficient sample capture
+    - Copies the newest samples from an AnalysisTap once per frame
     - Renders at 60fps with minimal CPU usage
     - Path-based rendering for smooth curves
 */
@@ -54,11 +54,9 @@ public:
     ~WaveformComponent() override;
     
     //==========================================================================
-    /** Push audio samples for visualization (call from audio thread) */
-    void pushSamples(const float* samples, int numSamples);
-    
-    /** Push stereo audio samples */
-    void pushSamples(const float* leftSamples, const float* rightSamples, int numSamples);
+    /** Show the audio passing through an analysis tap (null to freeze the display).
+        The tap is polled on the display timer; it must outlive this component. */
+    void setSource(const mmg::AnalysisTap* tap) { source = tap; }
     
     /** Clear the waveform buffer */
     void clear();
@@ -115,11 +113,12 @@ private:
     float interpolateCatmullRom(const std::vector<float>& buffer, float position);
     
     //==========================================================================
-    // Ring buffer for incoming samples (lock-free for audio thread safety)
+    // Latest samples from the tap, refreshed on each timer tick (message thread only)
+    const mmg::AnalysisTap* source = nullptr;
     static constexpr int bufferSize = 4096;
     std::array<float, bufferSize> leftBuffer;
     std::array<float, bufferSize> rightBuffer;
-    std::atomic<int> writePosition { 0 };
+    int writePosition = 0;
     
     // Display buffer (processed for rendering)
     std::vector<float> displayBufferLeft;
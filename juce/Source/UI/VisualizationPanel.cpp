@@ -50,8 +50,9 @@ VisualizationPanel::VisualizationPanel(AppState& state, mmg::AudioEngine& engine
     recentFiles->addListener(this);
     addChildComponent(*recentFiles);
     
-    // Register for audio samples
-    audioEngine.addVisualizationListener(this);
+    // Analyzers read the master output from the engine's analysis bus on their own timers
+    waveform->setSource(&audioEngine.getAnalysisBus().getMasterTap());
+    spectrum->setSource(&audioEngine.getAnalysisBus().getMasterTap());
     
     // Setup tab buttons
     auto setupTab = [this](juce::TextButton& tab, const juce::String& name, int index) {
@@ -316,9 +317,6 @@ void VisualizationPanel::updatePianoRollDrumModeForCurrentSoloTrack()
 
 VisualizationPanel::~VisualizationPanel()
 {
-    // Unregister from audio engine
-    audioEngine.removeVisualizationListener(this);
-    
     if (arrangementView)
         arrangementView->removeListener(this);
     if (pianoRoll)
@@ -437,8 +435,7 @@ void VisualizationPanel::loadMidiFile(const juce::File& midiFile)
         
         // Check notes in ProjectState after import
         auto& ps = appState.getProjectState();
-        auto notesNode = ps.getState().getChildWithName(Project::IDs::NOTES);
-        DBG("  After import: NOTES node has " << notesNode.getNumChildren() << " children");
+        DBG("  After import: project has " << ps.getNotes().size() << " notes");
         
         // Rebind ArrangementView to pick up new tracks from ProjectState
         if (arrangementView)
@@ -579,18 +576,6 @@ void VisualizationPanel::updateTheme()
         spectrum->setTheme(theme);
 }
 
-//==============================================================================
-void VisualizationPanel::audioSamplesReady(const float* leftSamples, 
-                                            const float* rightSamples, 
-                                            int numSamples)
-{
-    // Called from audio thread - forward to visualizers
-    if (waveform)
-        waveform->pushSamples(leftSamples, rightSamples, numSamples);
-    if (spectrum)
-        spectrum->pushSamples(leftSamples, rightSamples, numSamples);
-}
-
 //==============================================================================
 void VisualizationPanel::fileSelected(const juce::File& file)
 {
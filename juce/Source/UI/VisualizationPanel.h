@@ -36,8 +36,7 @@
 class VisualizationPanel : public juce::Component,
                            public RecentFilesPanel::Listener,
                            public PianoRollComponent::Listener,
-                           public UI::ArrangementView::Listener,
-                           private mmg::AudioEngine::VisualizationListener
+                           public UI::ArrangementView::Listener
 {
 public:
     //==============================================================================
@@ -114,11 +113,6 @@ private:
     void arrangementTrackLoadSF2Requested(int trackIndex) override;
     void arrangementTrackLoadSFZRequested(int trackIndex) override;
     
-    // AudioEngine::VisualizationListener (called from audio thread)
-    void audioSamplesReady(const float* leftSamples, 
-                           const float* rightSamples, 
-                           int numSamples) override;
-    
     //==============================================================================
     AppState& appState;
     mmg::AudioEngine& audioEngine;